@@ -108,12 +108,13 @@ static inline int lnet_md_exhausted(struct lnet_libmd *md)
 
 static inline int lnet_md_unlinkable(struct lnet_libmd *md)
 {
-	/* Should unlink md when its refcount is 0 and either:
+	/* Should unlink md when its refcount is 0, no event handler is
+	 * running for it and either:
 	 *  - md has been flagged for deletion (by auto unlink or LNetM[DE]Unlink,
 	 *    in the latter case md may not be exhausted).
 	 *  - auto unlink is on and md is exhausted.
 	 */
-	if (md->md_refcount != 0)
+	if (md->md_refcount != 0 || md->md_handling != 0)
 		return 0;
 
 	if ((md->md_flags & LNET_MD_FLAG_ZOMBIE) != 0)
@@ -564,8 +565,10 @@ extern unsigned int lnet_health_sensitivity;
 extern unsigned int lnet_recovery_interval;
 extern unsigned int lnet_peer_discovery_disabled;
 extern unsigned int lnet_drop_asym_route;
+extern unsigned int lnet_perf_sensitivity;
 extern unsigned int router_sensitivity_percentage;
 extern int alive_router_check_interval;
+extern int router_buffers_autotune;
 extern int portal_rotor;
 
 void lnet_mt_event_handler(struct lnet_event *event);
@@ -601,6 +604,8 @@ int  lnet_rtrpools_adjust(int tiny, int small, int large);
 int lnet_rtrpools_enable(void);
 void lnet_rtrpools_disable(void);
 void lnet_rtrpools_free(int keep_pools);
+void lnet_rtrpools_autotune(void);
+__u64 lnet_rtrpools_nbytes(void);
 void lnet_rtr_transfer_to_peer(struct lnet_peer *src,
 			       struct lnet_peer *target);
 struct lnet_remotenet *lnet_find_rnet_locked(__u32 net);
@@ -949,6 +954,27 @@ int lnet_get_peer_ni_info(__u32 peer_index, __u64 *nid,
 			  __u32 *peer_tx_qnob);
 int lnet_get_peer_ni_hstats(struct lnet_ioctl_peer_ni_hstats *stats);
 
+/* peer NI round trip time and throughput estimates older than this many
+ * seconds are not used for selection */
+#define LNET_PERF_MAX_AGE	120
+/* messages at least this big are compared by throughput, not RTT */
+#define LNET_PERF_BULK_NOB	(64 << 10)
+
+/* whether peer NIs are compared by their estimates, see lnet_perf_sensitivity;
+ * nothing is measured while they are not */
+static inline bool lnet_perf_enabled(void)
+{
+	unsigned int sens = READ_ONCE(lnet_perf_sensitivity);
+
+	return sens > 0 && sens < 100;
+}
+
+void lnet_peer_ni_rtt_sample(struct lnet_peer_ni *lpni, ktime_t sent);
+void lnet_peer_ni_tput_sample(struct lnet_peer_ni *lpni, unsigned int nob,
+			      ktime_t sent);
+__u64 lnet_peer_ni_cost(struct lnet_peer_ni *lpni, unsigned int nob);
+void lnet_reply_perf_sample(struct lnet_msg *msg);
+
 static inline struct lnet_peer_net *
 lnet_find_peer_net_locked(struct lnet_peer *peer, __u32 net_id)
 {
@@ -43,6 +43,7 @@
 #endif
 
 #include <linux/kthread.h>
+#include <linux/llist.h>
 #include <linux/uio.h>
 #include <linux/semaphore.h>
 #include <linux/types.h>
@@ -88,6 +89,9 @@ struct lnet_rsp_tracker {
 	lnet_nid_t rspt_next_hop_nid;
 	/* deadline of the REPLY/ACK */
 	ktime_t rspt_deadline;
+	/* when the request was last sent, and its size */
+	ktime_t rspt_send_stamp;
+	unsigned int rspt_send_nob;
 	/* parent MD */
 	struct lnet_handle_md rspt_mdh;
 };
@@ -95,6 +99,8 @@ struct lnet_rsp_tracker {
 struct lnet_msg {
 	struct list_head	msg_activelist;
 	struct list_head	msg_list;	/* Q for credits/MD */
+	/* on lnet_msg_container::msc_finalizing */
+	struct llist_node	msg_finalize_node;
 
 	struct lnet_process_id	msg_target;
 	/* Primary NID of the source. */
@@ -214,6 +220,10 @@ struct lnet_libmd {
 	unsigned int		 md_max_size;
 	int			 md_threshold;
 	int			 md_refcount;
+	/* an event handler runs for this MD without lnet_res_lock */
+	int			 md_handling;
+	/* messages whose events wait for the running handler */
+	struct list_head	 md_msgs_pending;
 	unsigned int		 md_options;
 	unsigned int		 md_flags;
 	unsigned int		 md_niov;	/* # frags at end of struct */
@@ -586,6 +596,15 @@ struct lnet_peer_ni {
 	unsigned int		lpni_ping_feats;
 	/* time last message was received from the peer */
 	time64_t		lpni_last_alive;
+	/*
+	 * smoothed round trip time (usecs) and throughput (KiB/s) to the
+	 * peer NI, and when they were last sampled; see
+	 * lnet_peer_ni_cost(). Not locked, a lost sample is harmless.
+	 */
+	__u32			lpni_rtt_us;
+	__u32			lpni_tput;
+	time64_t		lpni_rtt_stamp;
+	time64_t		lpni_tput_stamp;
 	/* preferred local nids: if only one, use lpni_pref.nid */
 	union lpni_pref {
 		lnet_nid_t	nid;
@@ -858,6 +877,10 @@ struct lnet_rtrbufpool {
 	int			rbp_credits;
 	/* low water mark */
 	int			rbp_mincredits;
+	/* low water mark since the last autotuning pass */
+	int			rbp_tune_mincredits;
+	/* # autotuning passes in a row which found the pool idle */
+	int			rbp_idle_passes;
 };
 
 struct lnet_rtrbuf {
@@ -970,10 +993,10 @@ struct lnet_msg_container {
 	int			msc_init;	/* initialized or not */
 	/* max # threads finalizing */
 	int			msc_nfinalizers;
-	/* msgs waiting to complete finalizing */
-	struct list_head	msc_finalizing;
+	/* msgs waiting to complete finalizing, added without any lock */
+	struct llist_head	msc_finalizing;
 	struct list_head	msc_active;	/* active message list */
-	/* threads doing finalization */
+	/* threads doing finalization, slots claimed with cmpxchg() */
 	void			**msc_finalizers;
 };
 
@@ -200,6 +200,18 @@ struct lnet_ioctl_peer_ni_hstats {
 	__s32 hlpni_health_value;
 };
 
+/*
+ * estimates used to choose between peer NIs and gateways, 0 if unknown.
+ * IOC_LIBCFS_GET_PEER_NI returns an array of these after all peer NI
+ * records, if prcfg_size has room for it.
+ */
+struct lnet_ioctl_peer_ni_perf {
+	__u32 plpni_rtt_us;		/* smoothed round trip time */
+	__u32 plpni_tput;		/* smoothed throughput, KiB/s */
+	__u64 plpni_score_small_us;	/* expected usecs for a small msg */
+	__u64 plpni_score_bulk_us;	/* expected usecs for LNET_MTU bytes */
+};
+
 struct lnet_ioctl_element_msg_stats {
 	struct libcfs_ioctl_hdr im_hdr;
 	__u32 im_idx;
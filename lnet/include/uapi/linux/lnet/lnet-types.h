@@ -253,9 +253,23 @@ struct lnet_counters_health {
 	__u32	lch_network_timeout_count;
 };
 
+/* router buffer pool autotuning, see lnet_rtrpools_autotune() */
+struct lnet_counters_rtrbuf {
+	__u32	lcr_blocked_count;	/* msgs which waited for a buffer */
+	__u32	lcr_grow_count;		/* pools grown */
+	__u32	lcr_grow_denied_count;	/* growth refused by the budget */
+	__u32	lcr_shrink_count;	/* idle pools shrunk */
+	__u64	lcr_bytes;		/* memory held by router buffers */
+};
+
+/*
+ * IOC_LIBCFS_GET_LNET_STATS fills in as much of this as the caller's
+ * ioc_len covers, so new members have to go at the end.
+ */
 struct lnet_counters {
 	struct lnet_counters_common lct_common;
 	struct lnet_counters_health lct_health;
+	struct lnet_counters_rtrbuf lct_rtrbuf;
 };
 
 #define LNET_NI_STATUS_UP	0x15aac0de
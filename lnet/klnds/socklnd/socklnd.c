@@ -80,6 +80,7 @@ ksocknal_create_route(__u32 ipaddr, int port)
         route->ksnr_connected = 0;
         route->ksnr_deleted = 0;
         route->ksnr_conn_count = 0;
+	memset(route->ksnr_type_conns, 0, sizeof(route->ksnr_type_conns));
         route->ksnr_share_count = 0;
 
         return (route);
@@ -356,6 +357,7 @@ ksocknal_associate_route_conn_locked(struct ksock_route *route, struct ksock_con
 
         route->ksnr_connected |= (1<<type);
         route->ksnr_conn_count++;
+	route->ksnr_type_conns[type]++;
 
         /* Successful connection => further attempts can
          * proceed immediately */
@@ -1029,6 +1031,8 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
 	int cpt;
 	struct ksock_tx *tx;
 	struct ksock_tx *txtmp;
+	int ntyped = 0;
+	int ndup = 0;
 	int rc;
 	int rc2;
 	int active;
@@ -1206,27 +1210,36 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
                 goto failed_2;
         }
 
-	/* Refuse to duplicate an existing connection, unless this is a
-	 * loopback connection */
-	if (conn->ksnc_ipaddr != conn->ksnc_myipaddr) {
-		list_for_each(tmp, &peer_ni->ksnp_conns) {
-			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
+	/* Refuse to create more than conns_per_peer connections of a type
+	 * between the same addresses, unless this is a loopback connection.
+	 * Passive ones are checked against the local limit too, so when both
+	 * sides connect at once the loser is refused with EALREADY instead of
+	 * being accepted here and then closed as a duplicate by the peer_ni.
+	 * conns_per_peer should therefore be the same on both sides. */
+	list_for_each(tmp, &peer_ni->ksnp_conns) {
+		conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
 
-                        if (conn2->ksnc_ipaddr != conn->ksnc_ipaddr ||
-                            conn2->ksnc_myipaddr != conn->ksnc_myipaddr ||
-                            conn2->ksnc_type != conn->ksnc_type)
-                                continue;
+		if (conn2->ksnc_type != conn->ksnc_type)
+			continue;
 
-                        /* Reply on a passive connection attempt so the peer_ni
-                         * realises we're connected. */
-                        LASSERT (rc == 0);
-                        if (!active)
-                                rc = EALREADY;
+		ntyped++;
+		if (conn->ksnc_ipaddr == conn->ksnc_myipaddr ||
+		    conn2->ksnc_ipaddr != conn->ksnc_ipaddr ||
+		    conn2->ksnc_myipaddr != conn->ksnc_myipaddr)
+			continue;
 
-                        warn = "duplicate";
-                        goto failed_2;
-                }
-        }
+		if (++ndup < ksocknal_conns_per_peer())
+			continue;
+
+		/* Reply on a passive connection attempt so the peer_ni
+		 * realises we're connected. */
+		LASSERT(rc == 0);
+		if (!active)
+			rc = EALREADY;
+
+		warn = "duplicate";
+		goto failed_2;
+	}
 
         /* If the connection created by this route didn't bind to the IP
          * address the route connected to, the connection/route matching
@@ -1258,6 +1271,11 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
 	peer_ni->ksnp_send_keepalive = 0;
 	peer_ni->ksnp_error = 0;
 
+	/* Spread further connections of the same type over the other CPTs,
+	 * so they are not all served by the scheduler threads of one. */
+	if (ntyped > 0)
+		cpt = (cpt + ntyped) % cfs_cpt_number(lnet_cpt_table());
+
 	sched = ksocknal_choose_scheduler_locked(cpt);
 	if (!sched) {
 		CERROR("no schedulers available. node is unhealthy\n");
@@ -1271,7 +1289,7 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
         sched->kss_nconns++;
         conn->ksnc_scheduler = sched;
 
-	conn->ksnc_tx_last_post = ktime_get_seconds();
+	conn->ksnc_tx_last_post = ktime_get();
 	/* Set the deadline for the outgoing HELLO to drain */
 	conn->ksnc_tx_bufnob = sock->sk->sk_wmem_queued;
 	conn->ksnc_tx_deadline = ktime_get_seconds() +
@@ -1423,8 +1441,6 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
          * Caller holds ksnd_global_lock exclusively in irq context */
 	struct ksock_peer_ni *peer_ni = conn->ksnc_peer;
 	struct ksock_route *route;
-	struct ksock_conn *conn2;
-	struct list_head *tmp;
 
 	LASSERT(peer_ni->ksnp_error == 0);
 	LASSERT(!conn->ksnc_closing);
@@ -1438,18 +1454,9 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
 		/* dissociate conn from route... */
 		LASSERT(!route->ksnr_deleted);
 		LASSERT((route->ksnr_connected & (1 << conn->ksnc_type)) != 0);
+		LASSERT(route->ksnr_type_conns[conn->ksnc_type] > 0);
 
-		conn2 = NULL;
-		list_for_each(tmp, &peer_ni->ksnp_conns) {
-			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
-
-			if (conn2->ksnc_route == route &&
-			    conn2->ksnc_type == conn->ksnc_type)
-				break;
-
-			conn2 = NULL;
-		}
-		if (conn2 == NULL)
+		if (--route->ksnr_type_conns[conn->ksnc_type] == 0)
 			route->ksnr_connected &= ~(1 << conn->ksnc_type);
 
 		conn->ksnc_route = NULL;
@@ -2193,6 +2200,7 @@ ksocknal_ctl(struct lnet_ni *ni, unsigned int cmd, void *arg)
 		data->ioc_u32[4] = conn->ksnc_scheduler->kss_cpt;
                 data->ioc_u32[5] = rxmem;
                 data->ioc_u32[6] = conn->ksnc_peer->ksnp_id.pid;
+		data->ioc_u64[0] = conn->ksnc_rx_read_sock_nob;
                 ksocknal_conn_decref(conn);
                 return 0;
         }
@@ -74,6 +74,7 @@
 #define SOCKNAL_RESCHED         100             /* # scheduler loops before reschedule */
 #define SOCKNAL_INSANITY_RECONN 5000            /* connd is trying on reconn infinitely */
 #define SOCKNAL_ENOMEM_RETRY    1		/* seconds between retries */
+#define SOCKNAL_CONNS_PER_PEER_MAX 16		/* max conns of one type per peer_ni */
 
 #define SOCKNAL_SINGLE_FRAG_TX      0           /* disable multi-fragment sends */
 #define SOCKNAL_SINGLE_FRAG_RX      0           /* disable multi-fragment receives */
@@ -133,6 +134,7 @@ struct ksock_tunables {
         int              *ksnd_max_reconnectms; /* ...exponentially increasing to this */
         int              *ksnd_eager_ack;       /* make TCP ack eagerly? */
         int              *ksnd_typed_conns;     /* drive sockets by type? */
+	int		 *ksnd_conns_per_peer;	/* # conns of each type per peer_ni */
         int              *ksnd_min_bulk;        /* smallest "large" message */
         int              *ksnd_tx_buffer_size;  /* socket tx buffer size */
         int              *ksnd_rx_buffer_size;  /* socket rx buffer size */
@@ -152,6 +154,8 @@ struct ksock_tunables {
         unsigned int     *ksnd_zc_min_payload;  /* minimum zero copy payload size */
         int              *ksnd_zc_recv;         /* enable ZC receive (for Chelsio TOE) */
         int              *ksnd_zc_recv_min_nfrags; /* minimum # of fragments to enable ZC receive */
+	int		 *ksnd_direct_recv;	/* read bulk straight from skbs */
+	int		 *ksnd_direct_recv_min_nob; /* min payload to read directly */
 #ifdef CPU_AFFINITY
         int              *ksnd_irq_affinity;    /* enable IRQ affinity? */
 #endif
@@ -342,6 +346,7 @@ struct ksock_conn {
         lnet_kiov_t          *ksnc_rx_kiov;     /* the page frags */
 	union ksock_rxiovspace	ksnc_rx_iov_space;/* space for frag descriptors */
         __u32                 ksnc_rx_csum;     /* partial checksum for incoming data */
+	__u64		      ksnc_rx_read_sock_nob; /* bytes received by tcp_read_sock() */
 	struct lnet_msg      *ksnc_lnet_msg;    /* rx lnet_finalize arg*/
 	struct ksock_msg	ksnc_msg;	/* incoming message buffer:
 						 * V2.x message takes the
@@ -368,7 +373,7 @@ struct ksock_conn {
 	/* being progressed */
 	int			ksnc_tx_scheduled;
 	/* time stamp of the last posted TX */
-	time64_t		ksnc_tx_last_post;
+	ktime_t			ksnc_tx_last_post;
 };
 
 struct ksock_route {
@@ -387,6 +392,8 @@ struct ksock_route {
         unsigned int          ksnr_deleted:1;   /* been removed from peer_ni? */
         unsigned int          ksnr_share_count; /* created explicitly? */
         int                   ksnr_conn_count;  /* # conns established by this route */
+	/* # conns of each type currently bound to this route */
+	__u8		      ksnr_type_conns[SOCKLND_CONN_NTYPES];
 };
 
 #define SOCKNAL_KEEPALIVE_PING          1       /* cookie for keepalive ping */
@@ -483,6 +490,31 @@ ksocknal_route_mask(void)
                 (1 << SOCKLND_CONN_BULK_OUT));
 }
 
+static inline int
+ksocknal_conns_per_peer(void)
+{
+	return clamp(*ksocknal_tunables.ksnd_conns_per_peer, 1,
+		     SOCKNAL_CONNS_PER_PEER_MAX);
+}
+
+/* connection types @route still has to establish connections of */
+static inline int
+ksocknal_route_wanted(struct ksock_route *route)
+{
+	int mask = ksocknal_route_mask();
+	int nconns = ksocknal_conns_per_peer();
+	int wanted = 0;
+	int type;
+
+	for (type = 0; type < SOCKLND_CONN_NTYPES; type++) {
+		if ((mask & (1 << type)) != 0 &&
+		    route->ksnr_type_conns[type] < nconns)
+			wanted |= 1 << type;
+	}
+
+	return wanted;
+}
+
 static inline struct list_head *
 ksocknal_nid2peerlist (lnet_nid_t nid)
 {
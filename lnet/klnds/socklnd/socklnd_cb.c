@@ -647,7 +647,7 @@ ksocknal_launch_connection_locked(struct ksock_route *route)
 
         LASSERT (!route->ksnr_scheduled);
         LASSERT (!route->ksnr_connecting);
-        LASSERT ((ksocknal_route_mask() & ~route->ksnr_connected) != 0);
+        LASSERT(ksocknal_route_wanted(route) != 0);
 
         route->ksnr_scheduled = 1;              /* scheduling conn for connd */
         ksocknal_route_addref(route);           /* extra ref for connd */
@@ -709,7 +709,8 @@ ksocknal_find_conn_locked(struct ksock_peer_ni *peer_ni, struct ksock_tx *tx, in
                 case SOCKNAL_MATCH_YES: /* typed connection */
                         if (typed == NULL || tnob > nob ||
                             (tnob == nob && *ksocknal_tunables.ksnd_round_robin &&
-			     typed->ksnc_tx_last_post > c->ksnc_tx_last_post)) {
+			     ktime_after(typed->ksnc_tx_last_post,
+					 c->ksnc_tx_last_post))) {
                                 typed = c;
                                 tnob  = nob;
                         }
@@ -718,7 +719,8 @@ ksocknal_find_conn_locked(struct ksock_peer_ni *peer_ni, struct ksock_tx *tx, in
                 case SOCKNAL_MATCH_MAY: /* fallback connection */
                         if (fallback == NULL || fnob > nob ||
                             (fnob == nob && *ksocknal_tunables.ksnd_round_robin &&
-			     fallback->ksnc_tx_last_post > c->ksnc_tx_last_post)) {
+			     ktime_after(fallback->ksnc_tx_last_post,
+					 c->ksnc_tx_last_post))) {
                                 fallback = c;
                                 fnob     = nob;
                         }
@@ -730,7 +732,7 @@ ksocknal_find_conn_locked(struct ksock_peer_ni *peer_ni, struct ksock_tx *tx, in
         conn = (typed != NULL) ? typed : fallback;
 
         if (conn != NULL)
-		conn->ksnc_tx_last_post = ktime_get_seconds();
+		conn->ksnc_tx_last_post = ktime_get();
 
         return conn;
 }
@@ -849,7 +851,7 @@ ksocknal_find_connectable_route_locked(struct ksock_peer_ni *peer_ni)
                         continue;
 
                 /* all route types connected ? */
-                if ((ksocknal_route_mask() & ~route->ksnr_connected) == 0)
+                if (ksocknal_route_wanted(route) == 0)
                         continue;
 
                 if (!(route->ksnr_retry_interval == 0 || /* first attempt */
@@ -1937,6 +1939,7 @@ ksocknal_connect(struct ksock_route *route)
 	struct ksock_peer_ni *peer_ni = route->ksnr_peer;
         int               type;
         int               wanted;
+	int		  i;
 	struct socket     *sock;
 	time64_t deadline;
         int               retry_later = 0;
@@ -1952,7 +1955,7 @@ ksocknal_connect(struct ksock_route *route)
         route->ksnr_connecting = 1;
 
         for (;;) {
-                wanted = ksocknal_route_mask() & ~route->ksnr_connected;
+                wanted = ksocknal_route_wanted(route);
 
                 /* stop connecting if peer_ni/route got closed under me, or
                  * route got connected while queued */
@@ -1973,16 +1976,19 @@ ksocknal_connect(struct ksock_route *route)
                 if (retry_later) /* needs reschedule */
                         break;
 
-                if ((wanted & (1 << SOCKLND_CONN_ANY)) != 0) {
-                        type = SOCKLND_CONN_ANY;
-                } else if ((wanted & (1 << SOCKLND_CONN_CONTROL)) != 0) {
-                        type = SOCKLND_CONN_CONTROL;
-                } else if ((wanted & (1 << SOCKLND_CONN_BULK_IN)) != 0) {
-                        type = SOCKLND_CONN_BULK_IN;
-                } else {
-                        LASSERT ((wanted & (1 << SOCKLND_CONN_BULK_OUT)) != 0);
-                        type = SOCKLND_CONN_BULK_OUT;
-                }
+		/* With several conns per type, bring up one of each
+		 * type before adding the next, so that every type of
+		 * traffic can flow as soon as possible. */
+		type = SOCKLND_CONN_NONE;
+		for (i = SOCKLND_CONN_ANY; i < SOCKLND_CONN_NTYPES; i++) {
+			if ((wanted & (1 << i)) == 0)
+				continue;
+			if (type == SOCKLND_CONN_NONE ||
+			    route->ksnr_type_conns[i] <
+			    route->ksnr_type_conns[type])
+				type = i;
+		}
+		LASSERT(type != SOCKLND_CONN_NONE);
 
 		write_unlock_bh(&ksocknal_data.ksnd_global_lock);
 
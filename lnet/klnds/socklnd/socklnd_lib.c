@@ -299,6 +299,99 @@ ksocknal_lib_kiov_vmap(lnet_kiov_t *kiov, int niov,
         return addr;
 }
 
+struct ksock_read_desc {
+	struct ksock_conn	*krd_conn;
+	lnet_kiov_t		*krd_kiov;	/* current fragment */
+	unsigned int		 krd_offset;	/* bytes done in *krd_kiov */
+	int			 krd_csum;	/* accumulate ksnc_rx_csum */
+};
+
+/* tcp_read_sock() actor: copy from @skb into the pages of the kiov */
+static int
+ksocknal_lib_read_actor(read_descriptor_t *desc, struct sk_buff *skb,
+			unsigned int offset, size_t len)
+{
+	struct ksock_read_desc *krd = desc->arg.data;
+	size_t done = 0;
+
+	while (done < len && desc->count > 0) {
+		lnet_kiov_t *kiov = krd->krd_kiov;
+		unsigned int fragnob;
+		void *base;
+		int rc;
+
+		fragnob = min_t(size_t, len - done,
+				kiov->kiov_len - krd->krd_offset);
+		fragnob = min_t(size_t, fragnob, desc->count);
+
+		base = kmap_atomic(kiov->kiov_page) + kiov->kiov_offset +
+		       krd->krd_offset;
+		rc = skb_copy_bits(skb, offset + done, base, fragnob);
+		/* checksum while the data is still in cache */
+		if (rc == 0 && krd->krd_csum)
+			krd->krd_conn->ksnc_rx_csum =
+				ksocknal_csum(krd->krd_conn->ksnc_rx_csum,
+					      base, fragnob);
+		kunmap_atomic(base);
+		if (rc != 0) {
+			desc->error = rc;
+			break;
+		}
+
+		done += fragnob;
+		desc->count -= fragnob;
+		krd->krd_offset += fragnob;
+		if (krd->krd_offset == kiov->kiov_len) {
+			krd->krd_kiov++;
+			krd->krd_offset = 0;
+		}
+	}
+
+	return done;
+}
+
+/*
+ * Read the payload of a bulk message from the socket's receive queue
+ * with tcp_read_sock(). The data is copied once, from the skbs into the
+ * kiov pages, without setting up a mapping for every fragment and with
+ * the checksum folded into the copy instead of a second pass.
+ *
+ * Returns the number of bytes received, or 0 if nothing could be read
+ * this way and the caller should use kernel_recvmsg(), which also
+ * reports EOF and socket errors.
+ */
+static int
+ksocknal_lib_recv_kiov_direct(struct ksock_conn *conn)
+{
+	struct sock *sk = conn->ksnc_sock->sk;
+	struct ksock_read_desc krd = {
+		.krd_conn	= conn,
+		.krd_kiov	= conn->ksnc_rx_kiov,
+		.krd_csum	= conn->ksnc_msg.ksm_csum != 0,
+	};
+	read_descriptor_t desc = {
+		.arg.data	= &krd,
+	};
+	int nob;
+	int i;
+	int rc;
+
+	for (nob = i = 0; i < conn->ksnc_rx_nkiov; i++)
+		nob += conn->ksnc_rx_kiov[i].kiov_len;
+	LASSERT(nob <= conn->ksnc_rx_nob_wanted);
+	desc.count = nob;
+
+	lock_sock(sk);
+	rc = tcp_read_sock(sk, &desc, ksocknal_lib_read_actor);
+	release_sock(sk);
+
+	if (rc <= 0)
+		return 0;
+
+	conn->ksnc_rx_read_sock_nob += rc;
+	return rc;
+}
+
 int
 ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
 		       struct kvec *scratchiov)
@@ -327,6 +420,17 @@ ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
         int          fragnob;
 	int n;
 
+	/* zc_recv takes precedence: the offloaded receive of a TOE device
+	 * relies on kernel_recvmsg() into the vmap()ed fragments below */
+	if (*ksocknal_tunables.ksnd_direct_recv &&
+	    !*ksocknal_tunables.ksnd_zc_recv &&
+	    conn->ksnc_rx_nob_wanted >=
+	    *ksocknal_tunables.ksnd_direct_recv_min_nob) {
+		rc = ksocknal_lib_recv_kiov_direct(conn);
+		if (rc > 0)
+			return rc;
+	}
+
         /* NB we can't trust socket ops to either consume our iovs
          * or leave them alone. */
 	if ((addr = ksocknal_lib_kiov_vmap(kiov, niov, scratchiov, pages)) != NULL) {
@@ -71,6 +71,10 @@ static int typed_conns = 1;
 module_param(typed_conns, int, 0444);
 MODULE_PARM_DESC(typed_conns, "use different sockets for bulk");
 
+static int conns_per_peer = 1;
+module_param(conns_per_peer, int, 0644);
+MODULE_PARM_DESC(conns_per_peer, "number of connections of each type per peer (1-16), should match on all nodes");
+
 static int min_bulk = (1<<10);
 module_param(min_bulk, int, 0644);
 MODULE_PARM_DESC(min_bulk, "smallest 'large' message");
@@ -139,6 +143,14 @@ static unsigned int zc_recv_min_nfrags = 16;
 module_param(zc_recv_min_nfrags, int, 0644);
 MODULE_PARM_DESC(zc_recv_min_nfrags, "minimum # of fragments to enable ZC recv");
 
+static int direct_recv = 1;
+module_param(direct_recv, int, 0644);
+MODULE_PARM_DESC(direct_recv, "copy bulk payload straight from socket buffers into pages, unless zc_recv is set");
+
+static int direct_recv_min_nob = (16 << 10);
+module_param(direct_recv_min_nob, int, 0644);
+MODULE_PARM_DESC(direct_recv_min_nob, "minimum payload size to receive directly");
+
 #ifdef SOCKNAL_BACKOFF
 static int backoff_init = 3;
 module_param(backoff_init, int, 0644);
@@ -169,6 +181,7 @@ int ksocknal_tunables_init(void)
         ksocknal_tunables.ksnd_max_reconnectms    = &max_reconnectms;
         ksocknal_tunables.ksnd_eager_ack          = &eager_ack;
         ksocknal_tunables.ksnd_typed_conns        = &typed_conns;
+	ksocknal_tunables.ksnd_conns_per_peer	  = &conns_per_peer;
         ksocknal_tunables.ksnd_min_bulk           = &min_bulk;
         ksocknal_tunables.ksnd_tx_buffer_size     = &tx_buffer_size;
         ksocknal_tunables.ksnd_rx_buffer_size     = &rx_buffer_size;
@@ -188,6 +201,8 @@ int ksocknal_tunables_init(void)
         ksocknal_tunables.ksnd_zc_min_payload     = &zc_min_payload;
         ksocknal_tunables.ksnd_zc_recv            = &zc_recv;
         ksocknal_tunables.ksnd_zc_recv_min_nfrags = &zc_recv_min_nfrags;
+	ksocknal_tunables.ksnd_direct_recv	  = &direct_recv;
+	ksocknal_tunables.ksnd_direct_recv_min_nob = &direct_recv_min_nob;
 
 #ifdef CPU_AFFINITY
 	if (enable_irq_affinity) {
@@ -179,6 +179,17 @@ module_param_call(lnet_drop_asym_route, drop_asym_route_set, param_get_int,
 MODULE_PARM_DESC(lnet_drop_asym_route,
 		 "Set to 1 to drop asymmetrical route messages.");
 
+/*
+ * How much faster, in percent, the measured path to one peer NI or
+ * gateway has to be before it is preferred over an equally healthy
+ * one. 0, the default, (or 100 and more) selects by credits and round
+ * robin only, and nothing is measured then.
+ */
+unsigned int lnet_perf_sensitivity;
+module_param(lnet_perf_sensitivity, uint, 0644);
+MODULE_PARM_DESC(lnet_perf_sensitivity,
+		 "Percent faster a peer NI or route has to be to be preferred (0 to disable)");
+
 #define LNET_TRANSACTION_TIMEOUT_NO_HEALTH_DEFAULT 50
 #define LNET_TRANSACTION_TIMEOUT_HEALTH_DEFAULT 10
 
@@ -883,6 +894,7 @@ lnet_counters_get(struct lnet_counters *counters)
 {
 	struct lnet_counters *ctr;
 	struct lnet_counters_health *health = &counters->lct_health;
+	struct lnet_counters_rtrbuf *rtrbuf = &counters->lct_rtrbuf;
 	int		i;
 
 	memset(counters, 0, sizeof(*counters));
@@ -916,8 +928,15 @@ lnet_counters_get(struct lnet_counters *counters)
 				ctr->lct_health.lch_remote_timeout_count;
 		health->lch_network_timeout_count +=
 				ctr->lct_health.lch_network_timeout_count;
+		rtrbuf->lcr_blocked_count += ctr->lct_rtrbuf.lcr_blocked_count;
+		rtrbuf->lcr_grow_count += ctr->lct_rtrbuf.lcr_grow_count;
+		rtrbuf->lcr_grow_denied_count +=
+				ctr->lct_rtrbuf.lcr_grow_denied_count;
+		rtrbuf->lcr_shrink_count += ctr->lct_rtrbuf.lcr_shrink_count;
 	}
 	lnet_net_unlock(LNET_LOCK_EX);
+
+	rtrbuf->lcr_bytes = lnet_rtrpools_nbytes();
 }
 EXPORT_SYMBOL(lnet_counters_get);
 
@@ -3674,13 +3693,21 @@ LNetCtl(unsigned int cmd, void *arg)
 	case IOC_LIBCFS_GET_LNET_STATS:
 	{
 		struct lnet_ioctl_lnet_stats *lnet_stats = arg;
+		struct lnet_counters counters;
+		size_t len;
 
-		if (lnet_stats->st_hdr.ioc_len < sizeof(*lnet_stats))
+		/* tools built before lct_rtrbuf get the counters they know */
+		len = lnet_stats->st_hdr.ioc_len;
+		if (len < offsetof(struct lnet_ioctl_lnet_stats,
+				   st_cntrs.lct_rtrbuf))
 			return -EINVAL;
+		len = min(len - offsetof(struct lnet_ioctl_lnet_stats,
+					 st_cntrs), sizeof(counters));
 
 		mutex_lock(&the_lnet.ln_api_mutex);
-		lnet_counters_get(&lnet_stats->st_cntrs);
+		lnet_counters_get(&counters);
 		mutex_unlock(&the_lnet.ln_api_mutex);
+		memcpy(&lnet_stats->st_cntrs, &counters, len);
 		return 0;
 	}
 
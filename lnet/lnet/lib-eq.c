@@ -205,7 +205,9 @@ EXPORT_SYMBOL(LNetEQFree);
 void
 lnet_eq_enqueue_event(struct lnet_eq *eq, struct lnet_event *ev)
 {
-	/* MUST called with resource lock hold but w/o lnet_eq_wait_lock */
+	/* MUST be called w/o lnet_eq_wait_lock. The caller holds either the
+	 * resource lock or its own reference on @eq, which is what
+	 * lnet_msg_detach_md() does to deliver events without the lock */
 	int index;
 
 	if (eq->eq_size == 0) {
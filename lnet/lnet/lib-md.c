@@ -61,7 +61,7 @@ lnet_md_unlink(struct lnet_libmd *md)
 		lnet_res_lh_invalidate(&md->md_lh);
 	}
 
-	if (md->md_refcount != 0) {
+	if (md->md_refcount != 0 || md->md_handling != 0) {
 		CDEBUG(D_NET, "Queueing unlink of md %p\n", md);
 		return;
 	}
@@ -205,6 +205,8 @@ lnet_md_build(struct lnet_libmd *lmd, struct lnet_md *umd, int unlink)
 	lmd->md_eq = NULL;
 	lmd->md_threshold = umd->threshold;
 	lmd->md_refcount = 0;
+	lmd->md_handling = 0;
+	INIT_LIST_HEAD(&lmd->md_msgs_pending);
 	lmd->md_flags = (unlink == LNET_UNLINK) ? LNET_MD_FLAG_AUTO_UNLINK : 0;
 	lmd->md_bulk_handle = umd->bulk_handle;
 
@@ -517,6 +519,12 @@ EXPORT_SYMBOL(LNetMDBind);
  *   returns, and the unlinked event will be piggybacked on the event of
  *   the completion of the last operation by setting the unlinked field of
  *   the event. No dedicated LNET_EVENT_UNLINK event is generated.
+ * - If an event handler of the MD is still running, e.g. the caller is that
+ *   handler, the LNET_EVENT_UNLINK event is logged when it returns.
+ *
+ * This function never sleeps. It may be called from an event handler, but
+ * not while handling an LNET_EVENT_UNLINK logged by this function or by
+ * LNetMEUnlink(), which is delivered with the resource lock held.
  *
  * Note that in both cases the unlinked field of the event is always set; no
  * more event will happen on the MD after such an event is logged.
@@ -547,8 +555,10 @@ LNetMDUnlink(struct lnet_handle_md mdh)
 	md->md_flags |= LNET_MD_FLAG_ABORTED;
 	/* If the MD is busy, lnet_md_unlink just marks it for deletion, and
 	 * when the LND is done, the completion event flags that the MD was
-	 * unlinked. Otherwise, we enqueue an event now... */
-	if (md->md_eq != NULL && md->md_refcount == 0) {
+	 * unlinked. If only an event handler is running for it, the unlink
+	 * event is delivered when the handler returns. Otherwise, we enqueue
+	 * an event now... */
+	if (md->md_eq != NULL && md->md_refcount == 0 && md->md_handling == 0) {
 		lnet_build_unlink_event(md, &ev);
 		lnet_eq_enqueue_event(md->md_eq, &ev);
 	}
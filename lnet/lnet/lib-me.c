@@ -241,7 +241,8 @@ LNetMEUnlink(struct lnet_handle_me meh)
 	md = me->me_md;
 	if (md != NULL) {
 		md->md_flags |= LNET_MD_FLAG_ABORTED;
-		if (md->md_eq != NULL && md->md_refcount == 0) {
+		if (md->md_eq != NULL && md->md_refcount == 0 &&
+		    md->md_handling == 0) {
 			lnet_build_unlink_event(md, &ev);
 			lnet_eq_enqueue_event(md->md_eq, &ev);
 		}
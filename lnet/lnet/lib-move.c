@@ -1045,12 +1045,16 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 		rbp->rbp_credits--;
 		if (rbp->rbp_credits < rbp->rbp_mincredits)
 			rbp->rbp_mincredits = rbp->rbp_credits;
+		if (rbp->rbp_credits < rbp->rbp_tune_mincredits)
+			rbp->rbp_tune_mincredits = rbp->rbp_credits;
 
 		if (rbp->rbp_credits < 0) {
 			/* must have checked eager_recv before here */
 			LASSERT(msg->msg_rx_ready_delay);
 			msg->msg_rx_delayed = 1;
 			list_add_tail(&msg->msg_list, &rbp->rbp_msgs);
+			the_lnet.ln_counters[msg->msg_rx_cpt]->
+				lct_rtrbuf.lcr_blocked_count++;
 			return LNET_CREDIT_WAIT;
 		}
 	}
@@ -1337,18 +1341,68 @@ lnet_compare_peers(struct lnet_peer_ni *p1, struct lnet_peer_ni *p2)
 	return 0;
 }
 
+/*
+ * Number of bytes @msg moves between us and the peer. A GET carries no
+ * payload, but the data of its sink MD comes back in the REPLY.
+ */
+static unsigned int
+lnet_msg_perf_nob(struct lnet_msg *msg)
+{
+	if (msg == NULL)
+		return 0;
+	if (msg->msg_type == LNET_MSG_GET && msg->msg_md != NULL)
+		return msg->msg_md->md_length;
+	return msg->msg_len;
+}
+
+/*
+ * Compare the measured time to get @nob bytes to @p1 and @p2.
+ *
+ * \retval 1 if @p1 is faster by more than lnet_perf_sensitivity percent
+ * \retval -1 if @p2 is
+ * \retval 0 if they are close, either has no recent estimate, or the
+ *	     faster one is out of credits while the other one is not
+ */
+static int
+lnet_compare_peer_perf(struct lnet_peer_ni *p1, struct lnet_peer_ni *p2,
+		       unsigned int nob)
+{
+	unsigned int sens = READ_ONCE(lnet_perf_sensitivity);
+	__u64 c1;
+	__u64 c2;
+
+	if (sens == 0 || sens >= 100 || p1 == p2)
+		return 0;
+
+	c1 = lnet_peer_ni_cost(p1, nob);
+	c2 = lnet_peer_ni_cost(p2, nob);
+	if (c1 == 0 || c2 == 0)
+		return 0;
+
+	if (c1 * 100 < c2 * (100 - sens))
+		return (p1->lpni_txcredits > 0 ||
+			p1->lpni_txcredits >= p2->lpni_txcredits) ? 1 : 0;
+
+	if (c2 * 100 < c1 * (100 - sens))
+		return (p2->lpni_txcredits > 0 ||
+			p2->lpni_txcredits >= p1->lpni_txcredits) ? -1 : 0;
+
+	return 0;
+}
+
 static struct lnet_peer_ni *
 lnet_select_peer_ni(struct lnet_ni *best_ni, lnet_nid_t dst_nid,
 		    struct lnet_peer *peer,
-		    struct lnet_peer_net *peer_net)
+		    struct lnet_peer_net *peer_net, unsigned int nob)
 {
 	/*
 	 * Look at the peer NIs for the destination peer that connect
 	 * to the chosen net. If a peer_ni is preferred when using the
 	 * best_ni to communicate, we use that one. If there is no
 	 * preferred peer_ni, or there are multiple preferred peer_ni,
-	 * the available transmit credits are used. If the transmit
-	 * credits are equal, we round-robin over the peer_ni.
+	 * one which measurably gets @nob bytes there faster is used,
+	 * otherwise the available transmit credits are used. If the
+	 * transmit credits are equal, we round-robin over the peer_ni.
 	 */
 	struct lnet_peer_ni *lpni = NULL;
 	struct lnet_peer_ni *best_lpni = NULL;
@@ -1357,6 +1411,7 @@ lnet_select_peer_ni(struct lnet_ni *best_ni, lnet_nid_t dst_nid,
 	bool ni_is_pref;
 	int best_lpni_healthv = 0;
 	int lpni_healthv;
+	int perf;
 
 	while ((lpni = lnet_get_next_peer_ni_locked(peer, peer_net, lpni))) {
 		/*
@@ -1373,12 +1428,14 @@ lnet_select_peer_ni(struct lnet_ni *best_ni, lnet_nid_t dst_nid,
 		}
 
 		lpni_healthv = atomic_read(&lpni->lpni_healthv);
+		perf = best_lpni ?
+		       lnet_compare_peer_perf(lpni, best_lpni, nob) : 0;
 
 		if (best_lpni)
-			CDEBUG(D_NET, "%s c:[%d, %d], s:[%d, %d]\n",
+			CDEBUG(D_NET, "%s c:[%d, %d], s:[%d, %d], p:%d\n",
 				libcfs_nid2str(lpni->lpni_nid),
 				lpni->lpni_txcredits, best_lpni_credits,
-				lpni->lpni_seq, best_lpni->lpni_seq);
+				lpni->lpni_seq, best_lpni->lpni_seq, perf);
 
 		/* pick the healthiest peer ni */
 		if (lpni_healthv < best_lpni_healthv) {
@@ -1394,6 +1451,11 @@ lnet_select_peer_ni(struct lnet_ni *best_ni, lnet_nid_t dst_nid,
 			 * it.
 			 */
 			continue;
+		} else if (perf < 0) {
+			/* the best peer so far is measurably faster */
+			continue;
+		} else if (perf > 0) {
+			/* this one is measurably faster, use it */
 		} else if (lpni->lpni_txcredits < best_lpni_credits) {
 			/*
 			 * We already have a peer that has more credits
@@ -1456,12 +1518,13 @@ lnet_find_best_lpni_on_net(struct lnet_send_data *sd, struct lnet_peer *peer,
 	}
 
 	return lnet_select_peer_ni(sd->sd_best_ni, sd->sd_dst_nid,
-				   peer, peer_net);
+				   peer, peer_net,
+				   lnet_msg_perf_nob(sd->sd_msg));
 }
 
 static int
 lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2,
-		    struct lnet_peer_ni **best_lpni)
+		    struct lnet_peer_ni **best_lpni, struct lnet_msg *msg)
 {
 	int r1_hops = (r1->lr_hops == LNET_UNDEFINED_HOPS) ? 1 : r1->lr_hops;
 	int r2_hops = (r2->lr_hops == LNET_UNDEFINED_HOPS) ? 1 : r2->lr_hops;
@@ -1474,6 +1537,7 @@ lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2,
 
 	sd.sd_best_ni = NULL;
 	sd.sd_dst_nid = LNET_NID_ANY;
+	sd.sd_msg = msg;
 	lpni1 = lnet_find_best_lpni_on_net(&sd, lp1, r1->lr_lnet);
 	lpni2 = lnet_find_best_lpni_on_net(&sd, lp2, r2->lr_lnet);
 	LASSERT(lpni1 && lpni2);
@@ -1498,6 +1562,16 @@ lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2,
 		return -1;
 	}
 
+	/* the RTT of a gateway NI covers the whole path behind it */
+	rc = lnet_compare_peer_perf(lpni1, lpni2, lnet_msg_perf_nob(msg));
+	if (rc == 1) {
+		*best_lpni = lpni1;
+		return rc;
+	} else if (rc == -1) {
+		*best_lpni = lpni2;
+		return rc;
+	}
+
 	rc = lnet_compare_peers(lpni1, lpni2);
 	if (rc == 1) {
 		*best_lpni = lpni1;
@@ -1519,7 +1593,7 @@ lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2,
 static struct lnet_route *
 lnet_find_route_locked(struct lnet_net *net, __u32 remote_net,
 		       lnet_nid_t rtr_nid, struct lnet_route **prev_route,
-		       struct lnet_peer_ni **gwni)
+		       struct lnet_peer_ni **gwni, struct lnet_msg *msg)
 {
 	struct lnet_peer_ni *best_gw_ni = NULL;
 	struct lnet_route *best_route;
@@ -1554,7 +1628,7 @@ lnet_find_route_locked(struct lnet_net *net, __u32 remote_net,
 		if (last_route->lr_seq - route->lr_seq < 0)
 			last_route = route;
 
-		rc = lnet_compare_routes(route, best_route, &best_gw_ni);
+		rc = lnet_compare_routes(route, best_route, &best_gw_ni, msg);
 		if (rc < 0)
 			continue;
 
@@ -1841,6 +1915,9 @@ lnet_handle_send(struct lnet_send_data *sd)
 		rspt = msg->msg_md->md_rspt_ptr;
 		if (rspt) {
 			rspt->rspt_next_hop_nid = msg->msg_txpeer->lpni_nid;
+			rspt->rspt_send_stamp = lnet_perf_enabled() ?
+						ktime_get() : 0;
+			rspt->rspt_send_nob = msg->msg_len;
 			CDEBUG(D_NET, "rspt_next_hop_nid = %s\n",
 			       libcfs_nid2str(rspt->rspt_next_hop_nid));
 		}
@@ -2078,7 +2155,7 @@ lnet_handle_find_routed_path(struct lnet_send_data *sd,
 
 	best_route = lnet_find_route_locked(NULL, best_lpn->lpn_net_id,
 					    sd->sd_rtr_nid, &last_route,
-					    &gwni);
+					    &gwni, sd->sd_msg);
 	if (!best_route) {
 		CERROR("no route to %s from %s\n",
 		       libcfs_nid2str(dst_nid), libcfs_nid2str(src_nid));
@@ -3443,6 +3520,7 @@ lnet_monitor_thread(void *arg)
 {
 	time64_t recovery_timeout = 0;
 	time64_t rsp_timeout = 0;
+	time64_t rtrpool_timeout = 0;
 	int interval;
 	time64_t now;
 
@@ -3455,6 +3533,7 @@ lnet_monitor_thread(void *arg)
 	 *     pings them
 	 *  4. Checks if there are any NIs on the remote recovery queue
 	 *     and pings them.
+	 *  5. Resizes the router buffer pools if autotuning is enabled
 	 */
 	cfs_block_allsigs();
 
@@ -3477,6 +3556,11 @@ lnet_monitor_thread(void *arg)
 			recovery_timeout = now + lnet_recovery_interval;
 		}
 
+		if (router_buffers_autotune > 0 && now >= rtrpool_timeout) {
+			lnet_rtrpools_autotune();
+			rtrpool_timeout = now + router_buffers_autotune;
+		}
+
 		/*
 		 * TODO do we need to check if we should sleep without
 		 * timeout?  Technically, an active system will always
@@ -3936,6 +4020,67 @@ lnet_parse_get(struct lnet_ni *ni, struct lnet_msg *msg, int rdma_get)
 	return 0;
 }
 
+/*
+ * Time the round trip of the small PUT @md was sent with, now that its
+ * ACK @msg arrived. Call with lnet_res_lock held.
+ */
+static void
+lnet_ack_perf_sample(struct lnet_libmd *md, struct lnet_msg *msg)
+{
+	struct lnet_rsp_tracker *rspt = md->md_rspt_ptr;
+
+	if (!rspt || !msg->msg_rxpeer ||
+	    ktime_to_ns(rspt->rspt_send_stamp) == 0)
+		return;
+
+	if (rspt->rspt_send_nob < LNET_PERF_BULK_NOB)
+		lnet_peer_ni_rtt_sample(msg->msg_rxpeer,
+					rspt->rspt_send_stamp);
+}
+
+/*
+ * The REPLY @msg to one of our GETs has been received completely, by
+ * lnet_parse_reply() or by an LND which elided the REPLY message. A small
+ * one took a round trip to the next hop the GET was sent to, the data of
+ * a bulk one moved at the rate of that next hop. GETs are real traffic:
+ * Lustre bulk writes are GETs by the server, and so are the pings of the
+ * monitor thread and of discovery.
+ */
+void
+lnet_reply_perf_sample(struct lnet_msg *msg)
+{
+	struct lnet_libmd *md = msg->msg_md;
+	struct lnet_rsp_tracker *rspt;
+	struct lnet_peer_ni *lpni;
+	lnet_nid_t nid = LNET_NID_ANY;
+	ktime_t sent = 0;
+	int cpt;
+
+	cpt = lnet_cpt_of_cookie(md->md_lh.lh_cookie);
+	lnet_res_lock(cpt);
+	rspt = md->md_rspt_ptr;
+	if (rspt) {
+		nid = rspt->rspt_next_hop_nid;
+		sent = rspt->rspt_send_stamp;
+	}
+	lnet_res_unlock(cpt);
+
+	if (nid == LNET_NID_ANY || ktime_to_ns(sent) == 0)
+		return;
+
+	cpt = lnet_net_lock_current();
+	lpni = lnet_find_peer_ni_locked(nid);
+	if (lpni) {
+		if (msg->msg_ev.mlength < LNET_PERF_BULK_NOB)
+			lnet_peer_ni_rtt_sample(lpni, sent);
+		else
+			lnet_peer_ni_tput_sample(lpni, msg->msg_ev.mlength,
+						 sent);
+		lnet_peer_ni_decref_locked(lpni);
+	}
+	lnet_net_unlock(cpt);
+}
+
 static int
 lnet_parse_reply(struct lnet_ni *ni, struct lnet_msg *msg)
 {
@@ -4043,6 +4188,7 @@ lnet_parse_ack(struct lnet_ni *ni, struct lnet_msg *msg)
 	       libcfs_nid2str(ni->ni_nid), libcfs_id2str(src),
 	       hdr->msg.ack.dst_wmd.wh_object_cookie);
 
+	lnet_ack_perf_sample(md, msg);
 	lnet_msg_attach_md(msg, md, 0, 0);
 
 	lnet_res_unlock(cpt);
@@ -815,29 +815,110 @@ resend:
 	return 0;
 }
 
-static void
-lnet_msg_detach_md(struct lnet_msg *msg, int cpt, int status)
+static void lnet_msg_finalize_committed(struct lnet_msg *msg);
+
+/*
+ * Drop the message's reference on its MD and deliver the completion event.
+ *
+ * The event handler is called without the resource lock, so handlers of
+ * different MDs in the same CPT do not serialise on it. Events of one MD
+ * are still delivered one at a time and in completion order, nobody sleeps
+ * for that though: while a handler runs for the MD (md_handling), messages
+ * completing meanwhile are queued on md_msgs_pending, and the thread
+ * running the handler delivers their events in turn when it returns and
+ * finalizes those messages too.
+ *
+ * The MD is not unlinked while a handler runs for it. If it becomes
+ * unlinkable meanwhile, because the last message finished or
+ * LNetM[DE]Unlink() was called (possibly by the handler itself), the last
+ * pending event is delivered with unlinked set, or an LNET_EVENT_UNLINK
+ * is delivered after the last one, so the unlinked event is still the last
+ * one of the MD. An extra reference on the EQ keeps LNetEQFree() away
+ * while the MD may be gone.
+ *
+ * Returns true if @msg was queued for the thread delivering events of its
+ * MD, which finalizes it then.
+ */
+static bool
+lnet_msg_detach_md(struct lnet_msg *msg, int status)
 {
 	struct lnet_libmd *md = msg->msg_md;
+	struct lnet_msg *first = msg;
+	struct lnet_event ev;
+	struct lnet_eq *eq;
+	int cpt = lnet_cpt_of_cookie(md->md_lh.lh_cookie);
 	int unlink;
 
+	lnet_res_lock(cpt);
 	/* Now it's safe to drop my caller's ref */
 	md->md_refcount--;
 	LASSERT(md->md_refcount >= 0);
 
-	unlink = lnet_md_unlinkable(md);
-	if (md->md_eq != NULL) {
-		msg->msg_ev.status   = status;
-		msg->msg_ev.unlinked = unlink;
-		lnet_eq_enqueue_event(md->md_eq, &msg->msg_ev);
+	eq = md->md_eq;
+	if (eq == NULL) {
+		if (lnet_md_unlinkable(md)) {
+			lnet_detach_rsp_tracker(md, cpt);
+			lnet_md_unlink(md);
+		}
+		lnet_res_unlock(cpt);
+		msg->msg_md = NULL;
+		return false;
 	}
 
-	if (unlink) {
-		lnet_detach_rsp_tracker(md, cpt);
-		lnet_md_unlink(md);
+	msg->msg_ev.status = status;
+	if (md->md_handling) {
+		/* the running handler delivers it next */
+		list_add_tail(&msg->msg_list, &md->md_msgs_pending);
+		lnet_res_unlock(cpt);
+		return true;
+	}
+
+	(*eq->eq_refs[cpt])++;
+	while (1) {
+		/* the last pending event carries the unlink, if any */
+		unlink = list_empty(&md->md_msgs_pending) &&
+			 lnet_md_unlinkable(md);
+		md->md_handling = !unlink;
+		msg->msg_ev.unlinked = unlink;
+		if (unlink) {
+			lnet_detach_rsp_tracker(md, cpt);
+			lnet_md_unlink(md);
+		}
+		lnet_res_unlock(cpt);
+
+		msg->msg_md = NULL;
+		lnet_eq_enqueue_event(eq, &msg->msg_ev);
+		if (msg != first)
+			lnet_msg_finalize_committed(msg);
+
+		lnet_res_lock(cpt);
+		if (unlink)
+			break;
+
+		if (list_empty(&md->md_msgs_pending)) {
+			md->md_handling = 0;
+			/* complete the unlink deferred while the handler ran */
+			if (lnet_md_unlinkable(md)) {
+				lnet_build_unlink_event(md, &ev);
+				lnet_detach_rsp_tracker(md, cpt);
+				lnet_md_unlink(md);
+				lnet_res_unlock(cpt);
+
+				lnet_eq_enqueue_event(eq, &ev);
+				lnet_res_lock(cpt);
+			}
+			break;
+		}
+
+		msg = list_first_entry(&md->md_msgs_pending, struct lnet_msg,
+				       msg_list);
+		list_del_init(&msg->msg_list);
 	}
+	LASSERT(*eq->eq_refs[cpt] > 0);
+	(*eq->eq_refs[cpt])--;
+	lnet_res_unlock(cpt);
 
-	msg->msg_md = NULL;
+	return false;
 }
 
 static bool
@@ -937,15 +1018,81 @@ lnet_send_error_simulation(struct lnet_msg *msg,
 }
 EXPORT_SYMBOL(lnet_send_error_simulation);
 
-void
-lnet_finalize(struct lnet_msg *msg, int status)
+/*
+ * Take a finalizer slot of @container for the current thread.
+ *
+ * \retval slot index
+ * \retval -1 if this thread is finalizing already, or there are enough
+ *	       other threads doing it
+ */
+static int
+lnet_msg_finalizer_claim(struct lnet_msg_container *container)
 {
-	struct lnet_msg_container *container;
-	int my_slot;
-	int cpt;
-	int rc;
 	int i;
 
+	for (i = 0; i < container->msc_nfinalizers; i++) {
+		if (READ_ONCE(container->msc_finalizers[i]) == current)
+			return -1;
+	}
+
+	for (i = 0; i < container->msc_nfinalizers; i++) {
+		if (READ_ONCE(container->msc_finalizers[i]) == NULL &&
+		    cmpxchg(&container->msc_finalizers[i], NULL, current) ==
+		    NULL)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Complete all messages queued on @container, taking them off the queue
+ * in batches. Called and returns with lnet_net_lock(@cpt) held.
+ *
+ * Returns the message which could not be completed because sending its
+ * ACK, or forwarding it, failed; the caller has to finalize it again.
+ * The rest of its batch is queued back first.
+ */
+static struct lnet_msg *
+lnet_msg_finalize_batch_locked(struct lnet_msg_container *container, int cpt)
+{
+	struct llist_node *batch;
+	struct lnet_msg *msg;
+
+	while ((batch = llist_del_all(&container->msc_finalizing)) != NULL) {
+		/* llist is LIFO, complete the messages in order */
+		batch = llist_reverse_order(batch);
+		while (batch != NULL) {
+			msg = llist_entry(batch, struct lnet_msg,
+					  msg_finalize_node);
+			batch = batch->next;
+
+			/* NB drops and regains the lnet lock if it actually
+			 * does anything, so my finalizing friends can chomp
+			 * along too */
+			if (lnet_complete_msg_locked(msg, cpt) == 0)
+				continue;
+
+			/* queue the rest back in one go and in the LIFO order
+			 * it was taken off in, so it is still completed in
+			 * order and before anything queued meanwhile */
+			if (batch != NULL) {
+				struct llist_node *last = batch;
+
+				batch = llist_reverse_order(batch);
+				llist_add_batch(batch, last,
+						&container->msc_finalizing);
+			}
+			return msg;
+		}
+	}
+
+	return NULL;
+}
+
+void
+lnet_finalize(struct lnet_msg *msg, int status)
+{
 	LASSERT(!in_interrupt());
 
 	if (msg == NULL)
@@ -953,6 +1100,11 @@ lnet_finalize(struct lnet_msg *msg, int status)
 
 	msg->msg_ev.status = status;
 
+	/* time a GET once the REPLY came back, see lnet_peer_ni_cost() */
+	if (status == 0 && msg->msg_ev.type == LNET_EVENT_REPLY &&
+	    msg->msg_md != NULL && lnet_perf_enabled())
+		lnet_reply_perf_sample(msg);
+
 	if (lnet_is_health_check(msg)) {
 		/*
 		 * Check the health status of the message. If it has one
@@ -975,12 +1127,23 @@ lnet_finalize(struct lnet_msg *msg, int status)
 	 * We're not going to resend this message so detach its MD and invoke
 	 * the appropriate callbacks
 	 */
-	if (msg->msg_md != NULL) {
-		cpt = lnet_cpt_of_cookie(msg->msg_md->md_lh.lh_cookie);
-		lnet_res_lock(cpt);
-		lnet_msg_detach_md(msg, cpt, status);
-		lnet_res_unlock(cpt);
-	}
+	if (msg->msg_md != NULL && lnet_msg_detach_md(msg, status))
+		return;
+
+	lnet_msg_finalize_committed(msg);
+}
+EXPORT_SYMBOL(lnet_finalize);
+
+/*
+ * Finalize @msg, whose MD has been detached already: release what it
+ * committed on the network, or just free it if it never got that far.
+ */
+static void
+lnet_msg_finalize_committed(struct lnet_msg *msg)
+{
+	struct lnet_msg_container *container;
+	int my_slot;
+	int cpt;
 
 again:
 	if (!msg->msg_tx_committed && !msg->msg_rx_committed) {
@@ -996,57 +1159,39 @@ again:
 	 * (finalize sending first then finalize receiving)
 	 */
 	cpt = msg->msg_tx_committed ? msg->msg_tx_cpt : msg->msg_rx_cpt;
-	lnet_net_lock(cpt);
-
 	container = the_lnet.ln_msg_containers[cpt];
-	list_add_tail(&msg->msg_list, &container->msc_finalizing);
-
-	/* Recursion breaker.  Don't complete the message here if I am (or
-	 * enough other threads are) already completing messages */
-
-	my_slot = -1;
-	for (i = 0; i < container->msc_nfinalizers; i++) {
-		if (container->msc_finalizers[i] == current)
-			break;
-
-		if (my_slot < 0 && container->msc_finalizers[i] == NULL)
-			my_slot = i;
-	}
-
-	if (i < container->msc_nfinalizers || my_slot < 0) {
-		lnet_net_unlock(cpt);
-		return;
-	}
 
-	container->msc_finalizers[my_slot] = current;
+	/* Queue the message without any lock; whoever finalizes for this
+	 * CPT completes everything queued under a single lnet_net_lock() */
+	llist_add(&msg->msg_finalize_node, &container->msc_finalizing);
 
-	rc = 0;
-	while (!list_empty(&container->msc_finalizing)) {
-		msg = list_entry(container->msc_finalizing.next,
-				 struct lnet_msg, msg_list);
-
-		list_del_init(&msg->msg_list);
+	do {
+		/* Recursion breaker.  Don't complete the message here if I
+		 * am (or enough other threads are) already completing
+		 * messages */
+		my_slot = lnet_msg_finalizer_claim(container);
+		if (my_slot < 0)
+			return;
 
-		/* NB drops and regains the lnet lock if it actually does
-		 * anything, so my finalizing friends can chomp along too */
-		rc = lnet_complete_msg_locked(msg, cpt);
-		if (rc != 0)
-			break;
-	}
+		lnet_net_lock(cpt);
+		msg = lnet_msg_finalize_batch_locked(container, cpt);
 
-	if (unlikely(!list_empty(&the_lnet.ln_delay_rules))) {
+		if (unlikely(!list_empty(&the_lnet.ln_delay_rules))) {
+			lnet_net_unlock(cpt);
+			lnet_delay_rule_check();
+			lnet_net_lock(cpt);
+		}
 		lnet_net_unlock(cpt);
-		lnet_delay_rule_check();
-		lnet_net_lock(cpt);
-	}
 
-	container->msc_finalizers[my_slot] = NULL;
-	lnet_net_unlock(cpt);
+		smp_store_release(&container->msc_finalizers[my_slot], NULL);
+		if (msg != NULL)
+			goto again;
 
-	if (rc != 0)
-		goto again;
+		/* pairs with llist_add() of the threads which found no free
+		 * slot and left their messages to us */
+		smp_mb();
+	} while (!llist_empty(&container->msc_finalizing));
 }
-EXPORT_SYMBOL(lnet_finalize);
 
 void
 lnet_msg_container_cleanup(struct lnet_msg_container *container)
@@ -1088,7 +1233,7 @@ lnet_msg_container_setup(struct lnet_msg_container *container, int cpt)
 	container->msc_init = 1;
 
 	INIT_LIST_HEAD(&container->msc_active);
-	INIT_LIST_HEAD(&container->msc_finalizing);
+	init_llist_head(&container->msc_finalizing);
 
 	/* number of CPUs */
 	container->msc_nfinalizers = cfs_cpt_weight(lnet_cpt_table(), cpt);
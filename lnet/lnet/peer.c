@@ -902,6 +902,94 @@ lnet_push_update_to_peers(int force)
 	wake_up(&the_lnet.ln_dc_waitq);
 }
 
+/*
+ * Fold @sample into the moving average @avg the way TCP smooths its RTT,
+ * with a gain of 1/8. An estimate nobody refreshed for LNET_PERF_MAX_AGE
+ * seconds starts over from the sample.
+ */
+static __u32
+lnet_perf_ewma(__u32 avg, time64_t stamp, time64_t now, __u64 sample)
+{
+	__s64 val = min_t(__u64, max_t(__u64, sample, 1), UINT_MAX);
+
+	if (avg == 0 || now - stamp > LNET_PERF_MAX_AGE)
+		return val;
+
+	return max_t(__s64, 1, (__s64)avg + (val - (__s64)avg) / 8);
+}
+
+/*
+ * A REPLY or ACK to a request handed to the LND at @sent has just come
+ * in from @lpni. Only small requests and responses are timed, the transfer
+ * time of bulk data is measured by lnet_peer_ni_tput_sample().
+ *
+ * Samples taken on different CPTs may race and one of them may get lost,
+ * which is fine for a hint; READ_ONCE/WRITE_ONCE keep the fields whole.
+ */
+void
+lnet_peer_ni_rtt_sample(struct lnet_peer_ni *lpni, ktime_t sent)
+{
+	time64_t now = ktime_get_seconds();
+	__s64 usecs = ktime_us_delta(ktime_get(), sent);
+
+	if (usecs < 0)
+		return;
+
+	WRITE_ONCE(lpni->lpni_rtt_us,
+		   lnet_perf_ewma(READ_ONCE(lpni->lpni_rtt_us),
+				  READ_ONCE(lpni->lpni_rtt_stamp), now, usecs));
+	WRITE_ONCE(lpni->lpni_rtt_stamp, now);
+}
+
+/*
+ * The @nob bytes of the REPLY to a GET handed to the LND at @sent have
+ * all arrived from @lpni. Unlike the completion of a send, which on some
+ * LNDs only means the data was queued in a socket buffer, this is the
+ * rate the data actually moved at.
+ */
+void
+lnet_peer_ni_tput_sample(struct lnet_peer_ni *lpni, unsigned int nob,
+			 ktime_t sent)
+{
+	time64_t now = ktime_get_seconds();
+	__s64 usecs = ktime_us_delta(ktime_get(), sent);
+
+	if (usecs <= 0)
+		return;
+
+	WRITE_ONCE(lpni->lpni_tput,
+		   lnet_perf_ewma(READ_ONCE(lpni->lpni_tput),
+				  READ_ONCE(lpni->lpni_tput_stamp), now,
+				  div64_u64(((__u64)nob * USEC_PER_SEC) >> 10,
+					    usecs)));
+	WRITE_ONCE(lpni->lpni_tput_stamp, now);
+}
+
+/*
+ * Expected time in usecs to get @nob bytes to @lpni: the round trip time
+ * for small messages, the transfer time at the measured throughput for
+ * bulk ones. 0 if there is no recent estimate.
+ */
+__u64
+lnet_peer_ni_cost(struct lnet_peer_ni *lpni, unsigned int nob)
+{
+	time64_t now = ktime_get_seconds();
+	__u32 tput;
+
+	if (nob < LNET_PERF_BULK_NOB) {
+		if (now - READ_ONCE(lpni->lpni_rtt_stamp) > LNET_PERF_MAX_AGE)
+			return 0;
+		return READ_ONCE(lpni->lpni_rtt_us);
+	}
+
+	tput = READ_ONCE(lpni->lpni_tput);
+	if (tput == 0 ||
+	    now - READ_ONCE(lpni->lpni_tput_stamp) > LNET_PERF_MAX_AGE)
+		return 0;
+
+	return div_u64(((__u64)nob * USEC_PER_SEC) >> 10, tput);
+}
+
 /*
  * Test whether a ni is a preferred ni for this peer_ni, e.g, whether
  * this is a preferred point-to-point path. Call with lnet_net_lock in
@@ -1959,7 +2047,8 @@ static void lnet_peer_discovery_complete(struct lnet_peer *lp)
 
 /*
  * Handle inbound push.
- * Like any event handler, called with lnet_res_lock/CPT held.
+ * Like any event handler, must not sleep. Called without lnet_res_lock,
+ * see lnet_msg_detach_md().
  */
 void lnet_peer_push_event(struct lnet_event *ev)
 {
@@ -3559,14 +3648,23 @@ int lnet_get_peer_ni_info(__u32 peer_index, __u64 *nid,
 }
 
 /* ln_api_mutex is held, which keeps the peer list stable */
+/*
+ * The bulk buffer gets a record per peer NI, followed by an array of
+ * struct lnet_ioctl_peer_ni_perf, one per peer NI in the same order.
+ * The array is only filled in if the buffer has room for it, so that
+ * tools which don't know about it still parse the records correctly;
+ * cfg->prcfg_size tells whether it is there.
+ */
 int lnet_get_peer_info(struct lnet_ioctl_peer_cfg *cfg, void __user *bulk)
 {
 	struct lnet_ioctl_element_stats *lpni_stats;
 	struct lnet_ioctl_element_msg_stats *lpni_msg_stats;
 	struct lnet_ioctl_peer_ni_hstats *lpni_hstats;
+	struct lnet_ioctl_peer_ni_perf lpni_perf;
 	struct lnet_peer_ni_credit_info *lpni_info;
 	struct lnet_peer_ni *lpni;
 	struct lnet_peer *lp;
+	void __user *bulk_perf = NULL;
 	lnet_nid_t nid;
 	__u32 size;
 	int rc;
@@ -3582,10 +3680,14 @@ int lnet_get_peer_info(struct lnet_ioctl_peer_cfg *cfg, void __user *bulk)
 		+ sizeof(*lpni_msg_stats) + sizeof(*lpni_hstats);
 	size *= lp->lp_nnis;
 	if (size > cfg->prcfg_size) {
-		cfg->prcfg_size = size;
+		cfg->prcfg_size = size + sizeof(lpni_perf) * lp->lp_nnis;
 		rc = -E2BIG;
 		goto out_lp_decref;
 	}
+	if (size + sizeof(lpni_perf) * lp->lp_nnis <= cfg->prcfg_size) {
+		bulk_perf = bulk + size;
+		size += sizeof(lpni_perf) * lp->lp_nnis;
+	}
 
 	cfg->prcfg_prim_nid = lp->lp_primary_nid;
 	cfg->prcfg_mr = lnet_peer_is_multi_rail(lp);
@@ -3664,6 +3766,16 @@ int lnet_get_peer_info(struct lnet_ioctl_peer_cfg *cfg, void __user *bulk)
 		if (copy_to_user(bulk, lpni_hstats, sizeof(*lpni_hstats)))
 			goto out_free_hstats;
 		bulk += sizeof(*lpni_hstats);
+		if (!bulk_perf)
+			continue;
+		lpni_perf.plpni_rtt_us = lpni->lpni_rtt_us;
+		lpni_perf.plpni_tput = lpni->lpni_tput;
+		lpni_perf.plpni_score_small_us = lnet_peer_ni_cost(lpni, 0);
+		lpni_perf.plpni_score_bulk_us = lnet_peer_ni_cost(lpni,
+								  LNET_MTU);
+		if (copy_to_user(bulk_perf, &lpni_perf, sizeof(lpni_perf)))
+			goto out_free_hstats;
+		bulk_perf += sizeof(lpni_perf);
 	}
 	rc = 0;
 
@@ -50,6 +50,18 @@ MODULE_PARM_DESC(small_router_buffers, "# of small (1 page) messages to buffer i
 static int large_router_buffers;
 module_param(large_router_buffers, int, 0444);
 MODULE_PARM_DESC(large_router_buffers, "# of large messages to buffer in the router");
+int router_buffers_autotune;
+module_param(router_buffers_autotune, int, 0644);
+MODULE_PARM_DESC(router_buffers_autotune, "Seconds between router buffer pool autotuning passes (0 to disable)");
+static int router_buffers_max_mb;
+module_param(router_buffers_max_mb, int, 0644);
+MODULE_PARM_DESC(router_buffers_max_mb, "Memory limit in MiB for autotuned router buffers (0 for 1/8 of RAM)");
+
+/* passes in a row a pool has to be idle before it is shrunk */
+#define LNET_RTRPOOL_IDLE_PASSES	3
+/* a starving pool grows by at least 1 / (1 << shift) of its size */
+#define LNET_RTRPOOL_GROW_SHIFT		3
+
 static int peer_buffer_credits;
 module_param(peer_buffer_credits, int, 0444);
 MODULE_PARM_DESC(peer_buffer_credits, "# router buffer credits per peer");
@@ -1069,6 +1081,8 @@ lnet_rtrpool_free_bufs(struct lnet_rtrbufpool *rbp, int cpt)
 	rbp->rbp_req_nbuffers = 0;
 	rbp->rbp_nbuffers = rbp->rbp_credits = 0;
 	rbp->rbp_mincredits = 0;
+	rbp->rbp_tune_mincredits = 0;
+	rbp->rbp_idle_passes = 0;
 	lnet_net_unlock(cpt);
 
 	/* Free buffers on the free list. */
@@ -1138,6 +1152,9 @@ lnet_rtrpool_adjust_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
 	rbp->rbp_nbuffers += num_buffers;
 	rbp->rbp_credits += num_buffers;
 	rbp->rbp_mincredits = rbp->rbp_credits;
+	/* the backlog seen so far is served by the new buffers, don't let
+	 * the next autotuning pass grow the pool for it again */
+	rbp->rbp_tune_mincredits = rbp->rbp_credits;
 	/* We need to schedule blocked msg using the newly
 	 * added buffers. */
 	while (!list_empty(&rbp->rbp_bufs) &&
@@ -1158,6 +1175,38 @@ failed:
 	return -ENOMEM;
 }
 
+/* free the idle buffers which @rbp holds beyond rbp_req_nbuffers, the busy
+ * ones are dropped by lnet_return_rx_credits_locked() as they come back */
+static int
+lnet_rtrpool_trim_bufs(struct lnet_rtrbufpool *rbp, int cpt)
+{
+	struct lnet_rtrbuf *rb;
+	struct list_head tmp;
+	int nfreed = 0;
+
+	INIT_LIST_HEAD(&tmp);
+
+	lnet_net_lock(cpt);
+	while (rbp->rbp_nbuffers > rbp->rbp_req_nbuffers &&
+	       rbp->rbp_credits > 0) {
+		rb = list_entry(rbp->rbp_bufs.next, struct lnet_rtrbuf,
+				rb_list);
+		list_move(&rb->rb_list, &tmp);
+		rbp->rbp_nbuffers--;
+		rbp->rbp_credits--;
+		nfreed++;
+	}
+	lnet_net_unlock(cpt);
+
+	while (!list_empty(&tmp)) {
+		rb = list_entry(tmp.next, struct lnet_rtrbuf, rb_list);
+		list_del(&rb->rb_list);
+		lnet_destroy_rtrbuf(rb, rbp->rbp_npages);
+	}
+
+	return nfreed;
+}
+
 static void
 lnet_rtrpool_init(struct lnet_rtrbufpool *rbp, int npages)
 {
@@ -1167,6 +1216,38 @@ lnet_rtrpool_init(struct lnet_rtrbufpool *rbp, int npages)
 	rbp->rbp_npages = npages;
 	rbp->rbp_credits = 0;
 	rbp->rbp_mincredits = 0;
+	rbp->rbp_tune_mincredits = 0;
+	rbp->rbp_idle_passes = 0;
+}
+
+static inline __u64
+lnet_rtrbuf_size(struct lnet_rtrbufpool *rbp)
+{
+	return offsetof(struct lnet_rtrbuf, rb_kiov[rbp->rbp_npages]) +
+	       (__u64)rbp->rbp_npages * PAGE_SIZE;
+}
+
+/* memory held by the router buffers of all CPTs */
+__u64
+lnet_rtrpools_nbytes(void)
+{
+	struct lnet_rtrbufpool *rtrp;
+	__u64 nbytes = 0;
+	int i;
+	int j;
+
+	if (the_lnet.ln_rtrpools == NULL)
+		return 0;
+
+	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+		lnet_net_lock(i);
+		for (j = 0; j < LNET_NRBPOOLS; j++)
+			nbytes += rtrp[j].rbp_nbuffers *
+				  lnet_rtrbuf_size(&rtrp[j]);
+		lnet_net_unlock(i);
+	}
+
+	return nbytes;
 }
 
 void
@@ -1435,6 +1516,138 @@ lnet_rtrpools_disable(void)
 	lnet_rtrpools_free(1);
 }
 
+static void
+lnet_rtrpool_autotune(struct lnet_rtrbufpool *rbp, int idx, int cpt,
+		      __u64 budget, __u64 *nbytes)
+{
+	struct lnet_counters_rtrbuf *ctr;
+	__u64 bufsize = lnet_rtrbuf_size(rbp);
+	int mincredits;
+	int nbuffers;
+	int nbufs;
+	int floor;
+	int grow;
+	int rc;
+
+	switch (idx) {
+	case LNET_TINY_BUF_IDX:
+		floor = lnet_nrb_tiny_calculate();
+		break;
+	case LNET_SMALL_BUF_IDX:
+		floor = lnet_nrb_small_calculate();
+		break;
+	default:
+		floor = lnet_nrb_large_calculate();
+		break;
+	}
+
+	lnet_net_lock(cpt);
+	nbuffers = rbp->rbp_req_nbuffers;
+	mincredits = rbp->rbp_tune_mincredits;
+	rbp->rbp_tune_mincredits = rbp->rbp_credits;
+	lnet_net_unlock(cpt);
+
+	if (mincredits < 0) {
+		/* messages had to wait for a buffer: grow by the backlog */
+		rbp->rbp_idle_passes = 0;
+		grow = max(-mincredits, nbuffers >> LNET_RTRPOOL_GROW_SHIFT);
+		if (*nbytes >= budget)
+			grow = 0;
+		else
+			grow = min_t(__u64, grow, div64_u64(budget - *nbytes,
+							    bufsize));
+
+		rc = grow > 0 ?
+		     lnet_rtrpool_adjust_bufs(rbp, nbuffers + grow, cpt) :
+		     -ENOSPC;
+
+		lnet_net_lock(cpt);
+		ctr = &the_lnet.ln_counters[cpt]->lct_rtrbuf;
+		if (rc == 0)
+			ctr->lcr_grow_count++;
+		else
+			ctr->lcr_grow_denied_count++;
+		lnet_net_unlock(cpt);
+
+		if (rc != 0) {
+			CDEBUG(D_NET, "CPT %d: can't grow pool of %d page "
+			       "buffers beyond %d: rc = %d\n",
+			       cpt, rbp->rbp_npages, nbuffers, rc);
+			return;
+		}
+
+		*nbytes += grow * bufsize;
+		CDEBUG(D_NET, "CPT %d: pool of %d page buffers grown to %d\n",
+		       cpt, rbp->rbp_npages, nbuffers + grow);
+		return;
+	}
+
+	/* shrink only pools which kept more than half of their buffers
+	 * unused for a while, and never below the configured size */
+	if (nbuffers <= floor || mincredits * 2 <= nbuffers) {
+		rbp->rbp_idle_passes = 0;
+		return;
+	}
+
+	if (++rbp->rbp_idle_passes < LNET_RTRPOOL_IDLE_PASSES)
+		return;
+	rbp->rbp_idle_passes = 0;
+
+	nbufs = max(floor, nbuffers - mincredits / 2);
+	lnet_rtrpool_adjust_bufs(rbp, nbufs, cpt);
+	*nbytes -= min_t(__u64, *nbytes,
+			 lnet_rtrpool_trim_bufs(rbp, cpt) * bufsize);
+
+	lnet_net_lock(cpt);
+	the_lnet.ln_counters[cpt]->lct_rtrbuf.lcr_shrink_count++;
+	lnet_net_unlock(cpt);
+
+	CDEBUG(D_NET, "CPT %d: pool of %d page buffers shrunk to %d\n",
+	       cpt, rbp->rbp_npages, nbufs);
+}
+
+/*
+ * Resize the router buffer pools of all CPTs to the traffic they have seen
+ * since the previous pass; called by the monitor thread every
+ * router_buffers_autotune seconds.
+ *
+ * A pool which ran out of buffers grows by the peak number of messages that
+ * waited for one, but at least by 1/8 of its size, as long as all router
+ * buffers together stay within router_buffers_max_mb. A pool which kept
+ * more than half of its buffers unused for LNET_RTRPOOL_IDLE_PASSES passes
+ * gives half of the unused ones back, but never goes below the size set by
+ * the *_router_buffers parameters or "lnetctl set *_buffers".
+ */
+void
+lnet_rtrpools_autotune(void)
+{
+	struct lnet_rtrbufpool *rtrp;
+	__u64 budget;
+	__u64 nbytes;
+	int i;
+	int j;
+
+	/* don't race with reconfiguration, just try again next time */
+	if (!mutex_trylock(&the_lnet.ln_api_mutex))
+		return;
+
+	if (!the_lnet.ln_routing || the_lnet.ln_rtrpools == NULL)
+		goto out;
+
+	if (router_buffers_max_mb > 0)
+		budget = (__u64)router_buffers_max_mb << 20;
+	else
+		budget = ((__u64)cfs_totalram_pages() << PAGE_SHIFT) / 8;
+	nbytes = lnet_rtrpools_nbytes();
+
+	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+		for (j = 0; j < LNET_NRBPOOLS; j++)
+			lnet_rtrpool_autotune(&rtrp[j], j, i, budget, &nbytes);
+	}
+out:
+	mutex_unlock(&the_lnet.ln_api_mutex);
+}
+
 static inline void
 lnet_notify_peer_down(struct lnet_ni *ni, lnet_nid_t nid)
 {
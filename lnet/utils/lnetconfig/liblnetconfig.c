@@ -2148,6 +2148,33 @@ add_msg_stats_to_yaml_blk(struct cYAML *yaml,
 	return true;
 }
 
+/* what lnet_select_peer_ni() and route selection go by, 0 means not
+ * measured recently */
+static bool
+add_peer_ni_perf_to_yaml_blk(struct cYAML *yaml,
+			     struct lnet_ioctl_peer_ni_perf *perf)
+{
+	struct cYAML *yperf;
+
+	yperf = cYAML_create_object(yaml, "selection");
+	if (yperf == NULL)
+		return false;
+	if (cYAML_create_number(yperf, "rtt_usec",
+				perf->plpni_rtt_us) == NULL)
+		return false;
+	if (cYAML_create_number(yperf, "throughput_KiB_s",
+				perf->plpni_tput) == NULL)
+		return false;
+	if (cYAML_create_number(yperf, "score_small_usec",
+				perf->plpni_score_small_us) == NULL)
+		return false;
+	if (cYAML_create_number(yperf, "score_1M_usec",
+				perf->plpni_score_bulk_us) == NULL)
+		return false;
+
+	return true;
+}
+
 static struct lnet_ioctl_comm_count *
 get_counts(struct lnet_ioctl_element_msg_stats *msg_stats, int idx)
 {
@@ -2745,6 +2772,50 @@ int lustre_lnet_config_drop_asym_route(int drop, int seq_no,
 
 }
 
+static int config_rtr_buffers_param(char *param, int value, int seq_no,
+				    struct cYAML **err_rc)
+{
+	int rc = LUSTRE_CFG_RC_NO_ERR;
+	char err_str[LNET_MAX_STR_LEN];
+	char val[LNET_MAX_STR_LEN];
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+
+	if (value < 0) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"invalid %s value %d\"", param, value);
+		rc = LUSTRE_CFG_RC_BAD_PARAM;
+		goto out;
+	}
+
+	snprintf(val, sizeof(val), "%d", value);
+
+	rc = write_sysfs_file(modparam_path, param, val,
+			      1, strlen(val) + 1);
+	if (rc)
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot configure %s: %s\"", param,
+			 strerror(errno));
+out:
+	cYAML_build_error(rc, seq_no, ADD_CMD, param, err_str, err_rc);
+
+	return rc;
+}
+
+int lustre_lnet_config_rtr_buffers_autotune(int interval, int seq_no,
+					    struct cYAML **err_rc)
+{
+	return config_rtr_buffers_param("router_buffers_autotune", interval,
+					seq_no, err_rc);
+}
+
+int lustre_lnet_config_rtr_buffers_max_mb(int max_mb, int seq_no,
+					  struct cYAML **err_rc)
+{
+	return config_rtr_buffers_param("router_buffers_max_mb", max_mb,
+					seq_no, err_rc);
+}
+
 int lustre_lnet_config_numa_range(int range, int seq_no, struct cYAML **err_rc)
 {
 	return ioctl_set_value(range, IOC_LIBCFS_SET_NUMA_RANGE,
@@ -2978,6 +3049,7 @@ int lustre_lnet_show_peer(char *knid, int detail, int seq_no,
 	struct lnet_ioctl_element_stats *lpni_stats;
 	struct lnet_ioctl_element_msg_stats *msg_stats;
 	struct lnet_ioctl_peer_ni_hstats *hstats;
+	struct lnet_ioctl_peer_ni_perf *perf;
 	lnet_nid_t *nidp;
 	int rc = LUSTRE_CFG_RC_OUT_OF_MEM;
 	int i, j, k;
@@ -2992,6 +3064,7 @@ int lustre_lnet_show_peer(char *knid, int detail, int seq_no,
 	struct lnet_process_id *list = NULL;
 	void *data = NULL;
 	void *lpni_data;
+	size_t rec_size;
 	bool exist = false;
 
 	snprintf(err_str, sizeof(err_str),
@@ -3121,6 +3194,15 @@ int lustre_lnet_show_peer(char *knid, int detail, int seq_no,
 		if (tmp == NULL)
 			goto out;
 
+		/* the perf array follows the records, if the kernel has it */
+		rec_size = sizeof(*nidp) + sizeof(*lpni_cri) +
+			   sizeof(*lpni_stats) + sizeof(*msg_stats) +
+			   sizeof(*hstats);
+		perf = NULL;
+		if (peer_info.prcfg_size >= (rec_size + sizeof(*perf)) *
+					    peer_info.prcfg_count)
+			perf = data + rec_size * peer_info.prcfg_count;
+
 		lpni_data = data;
 		for (j = 0; j < peer_info.prcfg_count; j++) {
 			nidp = lpni_data;
@@ -3203,6 +3285,10 @@ int lustre_lnet_show_peer(char *knid, int detail, int seq_no,
 			    == NULL)
 				goto out;
 
+			if (perf && !add_peer_ni_perf_to_yaml_blk(peer_ni,
+								  &perf[j]))
+				goto out;
+
 			if (detail < 2)
 				continue;
 
@@ -3779,6 +3865,45 @@ int lustre_lnet_show_drop_asym_route(int seq_no, struct cYAML **show_rc,
 				       show_rc, err_rc, l_errno);
 }
 
+static int show_rtr_buffers_param(char *param, int seq_no,
+				  struct cYAML **show_rc,
+				  struct cYAML **err_rc)
+{
+	char val[LNET_MAX_STR_LEN];
+	char err_str[LNET_MAX_STR_LEN];
+	int value = -1, l_errno = 0;
+	int rc;
+
+	snprintf(err_str, sizeof(err_str), "\"out of memory\"");
+
+	rc = read_sysfs_file(modparam_path, param, val, 1, sizeof(val));
+	if (rc) {
+		l_errno = -errno;
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot get %s setting: %d\"", param, rc);
+	} else {
+		value = atoi(val);
+	}
+
+	return build_global_yaml_entry(err_str, sizeof(err_str), seq_no,
+				       param, value, show_rc, err_rc,
+				       l_errno);
+}
+
+int lustre_lnet_show_rtr_buffers_autotune(int seq_no, struct cYAML **show_rc,
+					  struct cYAML **err_rc)
+{
+	return show_rtr_buffers_param("router_buffers_autotune", seq_no,
+				      show_rc, err_rc);
+}
+
+int lustre_lnet_show_rtr_buffers_max_mb(int seq_no, struct cYAML **show_rc,
+					struct cYAML **err_rc)
+{
+	return show_rtr_buffers_param("router_buffers_max_mb", seq_no,
+				      show_rc, err_rc);
+}
+
 int lustre_lnet_show_numa_range(int seq_no, struct cYAML **show_rc,
 				struct cYAML **err_rc)
 {
@@ -3919,6 +4044,26 @@ int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 				 cntrs->lct_common.lcc_drop_length))
 		goto out;
 
+	if (!cYAML_create_number(stats, "rtr_buf_blocked_count",
+				 cntrs->lct_rtrbuf.lcr_blocked_count))
+		goto out;
+
+	if (!cYAML_create_number(stats, "rtr_buf_grow_count",
+				 cntrs->lct_rtrbuf.lcr_grow_count))
+		goto out;
+
+	if (!cYAML_create_number(stats, "rtr_buf_grow_denied_count",
+				 cntrs->lct_rtrbuf.lcr_grow_denied_count))
+		goto out;
+
+	if (!cYAML_create_number(stats, "rtr_buf_shrink_count",
+				 cntrs->lct_rtrbuf.lcr_shrink_count))
+		goto out;
+
+	if (!cYAML_create_number(stats, "rtr_buf_bytes",
+				 cntrs->lct_rtrbuf.lcr_bytes))
+		goto out;
+
 	if (!show_rc)
 		cYAML_print_tree(root);
 
@@ -4692,7 +4837,8 @@ static int handle_yaml_config_global_settings(struct cYAML *tree,
 					      struct cYAML **err_rc)
 {
 	struct cYAML *max_intf, *numa, *discovery, *retry, *tto, *seq_no,
-		     *sen, *recov, *rsen, *drop_asym_route;
+		     *sen, *recov, *rsen, *drop_asym_route, *autotune,
+		     *max_mb;
 	int rc = 0;
 
 	seq_no = cYAML_get_object_item(tree, "seq_no");
@@ -4759,6 +4905,20 @@ static int handle_yaml_config_global_settings(struct cYAML *tree,
 							: -1,
 						     err_rc);
 
+	autotune = cYAML_get_object_item(tree, "router_buffers_autotune");
+	if (autotune)
+		rc = lustre_lnet_config_rtr_buffers_autotune(
+			autotune->cy_valueint,
+			seq_no ? seq_no->cy_valueint : -1,
+			err_rc);
+
+	max_mb = cYAML_get_object_item(tree, "router_buffers_max_mb");
+	if (max_mb)
+		rc = lustre_lnet_config_rtr_buffers_max_mb(
+			max_mb->cy_valueint,
+			seq_no ? seq_no->cy_valueint : -1,
+			err_rc);
+
 	return rc;
 }
 
@@ -4806,7 +4966,8 @@ static int handle_yaml_show_global_settings(struct cYAML *tree,
 					    struct cYAML **err_rc)
 {
 	struct cYAML *max_intf, *numa, *discovery, *retry, *tto, *seq_no,
-		     *sen, *recov, *rsen, *drop_asym_route;
+		     *sen, *recov, *rsen, *drop_asym_route, *autotune,
+		     *max_mb;
 	int rc = 0;
 
 	seq_no = cYAML_get_object_item(tree, "seq_no");
@@ -4864,6 +5025,18 @@ static int handle_yaml_show_global_settings(struct cYAML *tree,
 							: -1,
 						     show_rc, err_rc);
 
+	autotune = cYAML_get_object_item(tree, "router_buffers_autotune");
+	if (autotune)
+		rc = lustre_lnet_show_rtr_buffers_autotune(
+			seq_no ? seq_no->cy_valueint : -1,
+			show_rc, err_rc);
+
+	max_mb = cYAML_get_object_item(tree, "router_buffers_max_mb");
+	if (max_mb)
+		rc = lustre_lnet_show_rtr_buffers_max_mb(
+			seq_no ? seq_no->cy_valueint : -1,
+			show_rc, err_rc);
+
 	return rc;
 }
 
@@ -451,6 +451,56 @@ int lustre_lnet_config_drop_asym_route(int drop, int seq_no,
 int lustre_lnet_show_drop_asym_route(int seq_no, struct cYAML **show_rc,
 				     struct cYAML **err_rc);
 
+/*
+ * lustre_lnet_config_rtr_buffers_autotune
+ *   Set the number of seconds between router buffer pool autotuning
+ *   passes. 0 disables autotuning.
+ *
+ *   interval - seconds between passes
+ *   seq_no - sequence number of the request
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_config_rtr_buffers_autotune(int interval, int seq_no,
+					    struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_show_rtr_buffers_autotune
+ *    show the router buffer pool autotuning interval
+ *
+ *   seq_no - sequence number of the request
+ *   show_rc - [OUT] struct cYAML tree containing the interval
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_show_rtr_buffers_autotune(int seq_no, struct cYAML **show_rc,
+					  struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_config_rtr_buffers_max_mb
+ *   Set the memory limit for router buffers grown by autotuning.
+ *   0 means 1/8 of the RAM.
+ *
+ *   max_mb - limit in MiB
+ *   seq_no - sequence number of the request
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_config_rtr_buffers_max_mb(int max_mb, int seq_no,
+					  struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_show_rtr_buffers_max_mb
+ *    show the memory limit for autotuned router buffers
+ *
+ *   seq_no - sequence number of the request
+ *   show_rc - [OUT] struct cYAML tree containing the limit
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_show_rtr_buffers_max_mb(int seq_no, struct cYAML **show_rc,
+					struct cYAML **err_rc);
+
 /*
  * lustre_lnet_config_buffers
  *   Send down an IOCTL to configure routing buffer sizes.  A value of 0 means
@@ -64,6 +64,8 @@ static int jt_del_peer_nid(int argc, char **argv);
 static int jt_set_max_intf(int argc, char **argv);
 static int jt_set_discovery(int argc, char **argv);
 static int jt_set_drop_asym_route(int argc, char **argv);
+static int jt_set_rtr_buffers_autotune(int argc, char **argv);
+static int jt_set_rtr_buffers_max_mb(int argc, char **argv);
 static int jt_list_peer(int argc, char **argv);
 /*static int jt_show_peer(int argc, char **argv);*/
 static int lnetctl_list_commands(int argc, char **argv);
@@ -214,6 +216,14 @@ command_t set_cmds[] = {
 	{"router_sensitivity", jt_set_rtr_sensitivity, 0, "router sensitivity %\n"
 	 "\t100 - router interfaces need to be fully healthy to be used\n"
 	 "\t<100 - router interfaces can be used even if not healthy\n"},
+	{"router_buffers_autotune", jt_set_rtr_buffers_autotune, 0,
+	 "resize router buffer pools to the traffic\n"
+	 "\t0 - keep pools at the configured size (default)\n"
+	 "\t>0 - seconds between resizing passes\n"},
+	{"router_buffers_max_mb", jt_set_rtr_buffers_max_mb, 0,
+	 "memory limit for autotuned router buffers\n"
+	 "\t0 - 1/8 of the RAM (default)\n"
+	 "\t>0 - limit in MiB\n"},
 	{ 0, 0, 0, NULL }
 };
 
@@ -569,6 +579,66 @@ static int jt_set_drop_asym_route(int argc, char **argv)
 	return rc;
 }
 
+static int jt_set_rtr_buffers_autotune(int argc, char **argv)
+{
+	long int value;
+	int rc;
+	struct cYAML *err_rc = NULL;
+
+	rc = check_cmd(set_cmds, "set", "router_buffers_autotune", 2, argc,
+		       argv);
+	if (rc)
+		return rc;
+
+	rc = parse_long(argv[1], &value);
+	if (rc != 0) {
+		cYAML_build_error(-1, -1, "parser", "set",
+				  "cannot parse router_buffers_autotune value",
+				  &err_rc);
+		cYAML_print_tree2file(stderr, err_rc);
+		cYAML_free_tree(err_rc);
+		return -1;
+	}
+
+	rc = lustre_lnet_config_rtr_buffers_autotune(value, -1, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
+static int jt_set_rtr_buffers_max_mb(int argc, char **argv)
+{
+	long int value;
+	int rc;
+	struct cYAML *err_rc = NULL;
+
+	rc = check_cmd(set_cmds, "set", "router_buffers_max_mb", 2, argc,
+		       argv);
+	if (rc)
+		return rc;
+
+	rc = parse_long(argv[1], &value);
+	if (rc != 0) {
+		cYAML_build_error(-1, -1, "parser", "set",
+				  "cannot parse router_buffers_max_mb value",
+				  &err_rc);
+		cYAML_print_tree2file(stderr, err_rc);
+		cYAML_free_tree(err_rc);
+		return -1;
+	}
+
+	rc = lustre_lnet_config_rtr_buffers_max_mb(value, -1, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
 static int jt_set_tiny(int argc, char **argv)
 {
 	long int value;
@@ -1350,6 +1420,18 @@ static int jt_show_global(int argc, char **argv)
 		goto out;
 	}
 
+	rc = lustre_lnet_show_rtr_buffers_autotune(-1, &show_rc, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_print_tree2file(stderr, err_rc);
+		goto out;
+	}
+
+	rc = lustre_lnet_show_rtr_buffers_max_mb(-1, &show_rc, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_print_tree2file(stderr, err_rc);
+		goto out;
+	}
+
 	if (show_rc)
 		cYAML_print_tree(show_rc);
 
@@ -1643,6 +1725,20 @@ static int jt_export(int argc, char **argv)
 		err_rc = NULL;
 	}
 
+	rc = lustre_lnet_show_rtr_buffers_autotune(-1, &show_rc, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_print_tree2file(stderr, err_rc);
+		cYAML_free_tree(err_rc);
+		err_rc = NULL;
+	}
+
+	rc = lustre_lnet_show_rtr_buffers_max_mb(-1, &show_rc, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_print_tree2file(stderr, err_rc);
+		cYAML_free_tree(err_rc);
+		err_rc = NULL;
+	}
+
 	if (show_rc != NULL) {
 		cYAML_print_tree2file(f, show_rc);
 		cYAML_free_tree(show_rc);
@@ -1833,6 +1833,19 @@ LB_CHECK_EXPORT([new_sync_read], [fs/read_write.c],
 			[new_sync_[read|write] is exported by the kernel])])
 ]) # LC_HAVE_SYNC_READ_WRITE
 
+#
+# LC_HAVE_AIO_COMPLETE
+#
+# 4.1 kernel commit 04b2fa9f8f36ec6fb6fd1c9dc9df6fff0cd27323
+# fs: split generic and aio kiocb
+# aio_complete() is no longer exported, kiocb has ki_complete instead
+#
+AC_DEFUN([LC_HAVE_AIO_COMPLETE], [
+LB_CHECK_EXPORT([aio_complete], [fs/aio.c],
+	[AC_DEFINE(HAVE_AIO_COMPLETE, 1,
+			[aio_complete is exported by the kernel])])
+]) # LC_HAVE_AIO_COMPLETE
+
 #
 # LC_HAVE___BI_CNT
 #
@@ -2982,6 +2995,7 @@ AC_DEFUN([LC_PROG_LINUX], [
 	# 4.1.0
 	LC_IOV_ITER_RW
 	LC_HAVE_SYNC_READ_WRITE
+	LC_HAVE_AIO_COMPLETE
 	LC_HAVE___BI_CNT
 
 	# 4.2
@@ -1929,6 +1929,12 @@ struct cl_io {
 	 * Range of write intent. Valid if ci_need_write_intent is set.
 	 */
 	struct lu_extent	ci_write_intent;
+	/**
+	 * Direct IO anchor. If set, direct IO segments are submitted without
+	 * waiting, and the top level waits for (or asynchronously completes)
+	 * all of them at once.
+	 */
+	struct cl_dio_aio	*ci_aio;
 };
 
 /** @} cl_io */
@@ -2472,6 +2478,7 @@ void cl_req_attr_set(const struct lu_env *env, struct cl_object *obj,
  * @{ */
 
 struct cl_sync_io;
+struct cl_dio_aio;
 
 typedef void (cl_sync_io_end_t)(const struct lu_env *, struct cl_sync_io *);
 
@@ -2482,11 +2489,17 @@ int  cl_sync_io_wait(const struct lu_env *env, struct cl_sync_io *anchor,
 		     long timeout);
 void cl_sync_io_note(const struct lu_env *env, struct cl_sync_io *anchor,
 		     int ioret);
+int  cl_sync_io_wait_recycle(const struct lu_env *env,
+			     struct cl_sync_io *anchor, long timeout,
+			     int ioret);
 static inline void cl_sync_io_init(struct cl_sync_io *anchor, int nr)
 {
 	cl_sync_io_init_notify(anchor, nr, NULL);
 }
 
+struct cl_dio_aio *cl_aio_alloc(struct kiocb *iocb);
+void cl_aio_free(struct cl_dio_aio *aio);
+
 /**
  * Anchor for synchronous transfer. This is allocated on a stack by thread
  * doing synchronous transfer, and a pointer to this structure is set up in
@@ -2496,12 +2509,41 @@ static inline void cl_sync_io_init(struct cl_sync_io *anchor, int nr)
 struct cl_sync_io {
 	/** number of pages yet to be transferred. */
 	atomic_t		csi_sync_nr;
+	/** set once \a csi_end_io returned, the waiter may go on then */
+	atomic_t		csi_complete;
 	/** error code. */
 	int			csi_sync_rc;
 	/** completion to be signaled when transfer is complete. */
 	wait_queue_head_t	csi_waitq;
 	/** callback to invoke when this IO is finished */
 	cl_sync_io_end_t       *csi_end_io;
+	/**
+	 * direct IO anchor nobody waits for, it is freed by the last
+	 * cl_sync_io_note() instead of the thread which set it up.
+	 */
+	struct cl_dio_aio      *csi_aio;
+};
+
+/**
+ * Anchor for direct IO whose pages are submitted without waiting for each
+ * segment. Pages in transfer are kept in \a cda_pages and released when the
+ * whole IO is done; for asynchronous kiocb the completion is reported to the
+ * caller via aio_complete().
+ */
+struct cl_dio_aio {
+	struct cl_sync_io	cda_sync;
+	/** pages which have been submitted for transfer */
+	struct cl_page_list	cda_pages;
+	/** kiocb completed by the last page, NULL if the submitter waits */
+	struct kiocb		*cda_iocb;
+	/** bytes of the pages submitted since the anchor was waited for */
+	ssize_t			cda_submitted;
+	/** bytes reported to aio_complete() if no error happened */
+	ssize_t			cda_bytes;
+	/** nothing was submitted, the error is returned synchronously */
+	unsigned		cda_no_aio_complete:1,
+	/** data is read into user pages, dirty them when the read is done */
+				cda_read:1;
 };
 
 /** @} cl_sync_io */
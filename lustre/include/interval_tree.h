@@ -107,6 +107,8 @@ typedef enum interval_iter (*interval_callback_t)(struct interval_node *node,
 
 struct interval_node *interval_insert(struct interval_node *node,
                                       struct interval_node **root);
+void interval_insert_dup(struct interval_node *node,
+			 struct interval_node **root);
 void interval_erase(struct interval_node *node, struct interval_node **root);
 
 /* Search the extents in the tree and call @func for each overlapped
@@ -355,6 +355,10 @@ enum {
         PTLRPC_REQACTIVE_CNTR,
         PTLRPC_TIMEOUT,
         PTLRPC_REQBUF_AVAIL_CNTR,
+	PTLRPC_REQIN_BATCH_CNTR,
+	PTLRPC_REQIN_LOCK_CNTR,
+	PTLRPC_REQGET_LOCK_CNTR,
+	PTLRPC_REQ_BATCHED_CNTR,
         PTLRPC_LAST_CNTR
 };
 
@@ -380,6 +384,25 @@ enum lprocfs_extra_opc {
 };
 
 #define EXTRA_FIRST_OPC LDLM_GLIMPSE_ENQUEUE
+
+/* Per-opcode RPC latency histograms, log2 usec buckets. Servers record
+ * the time a request was queued before a thread picked it up and the time
+ * spent in the handler, clients the wall time from send to reply. */
+enum ptlrpc_lat_type {
+	PTLRPC_LAT_WAIT = 0,
+	PTLRPC_LAT_SERVICE,
+	PTLRPC_LAT_TOTAL,
+	PTLRPC_LAT_LAST
+};
+
+struct ptlrpc_lat_hist {
+	struct obd_histogram	plh_hist[PTLRPC_LAT_LAST];
+};
+
+struct ptlrpc_lat_stats {
+	/* allocated on first use, most opcodes are never seen */
+	struct ptlrpc_lat_hist	*pls_opc[LUSTRE_MAX_OPCODES];
+};
 /* class_obd.c */
 extern struct proc_dir_entry *proc_lustre_root;
 extern struct dentry *debugfs_lustre_root;
@@ -262,6 +262,14 @@ static inline struct inode *file_inode(const struct file *file)
 }
 #endif
 
+#ifndef HAVE_AIO_COMPLETE
+static inline void aio_complete(struct kiocb *iocb, ssize_t res, ssize_t res2)
+{
+	if (iocb->ki_complete)
+		iocb->ki_complete(iocb, res, res2);
+}
+#endif
+
 #ifdef HAVE_OLDSIZE_TRUNCATE_PAGECACHE
 #define ll_truncate_pagecache(inode, size) truncate_pagecache(inode, 0, size)
 #else
@@ -313,12 +313,13 @@ enum ldlm_appetite {
 };
 
 /**
- * Default values for the "max_nolock_size", "contention_time" and
- * "contended_locks" namespace tunables.
+ * Default values for the "max_nolock_size", "contention_time",
+ * "contended_locks" and "stride_locks" namespace tunables.
  */
 #define NS_DEFAULT_MAX_NOLOCK_BYTES 0
 #define NS_DEFAULT_CONTENTION_SECONDS 2
 #define NS_DEFAULT_CONTENDED_LOCKS 32
+#define NS_DEFAULT_STRIDE_LOCKS true
 
 struct ldlm_ns_bucket {
 	/** back pointer to namespace */
@@ -509,6 +510,19 @@ struct ldlm_namespace {
 	/** Limit of parallel AST RPC count. */
 	unsigned		ns_max_parallel_ast;
 
+	/**
+	 * Time how long the lr_lock of extent resources is held, see
+	 * ldlm_res_stats.
+	 */
+	bool			ns_res_timing;
+
+	/**
+	 * Learn the strided IO pattern of the clients of contended extent
+	 * resources and don't expand their locks over the blocks of the
+	 * other clients.
+	 */
+	bool			ns_stride_locks;
+
 	/**
 	 * Callback to check if a lock is good to be canceled by ELC or
 	 * during recovery.
@@ -635,6 +649,11 @@ struct ldlm_interval {
 	struct interval_node	li_node;  /* node for tree management */
 	struct list_head	li_group; /* the locks which have the same
 					   * policy - group of the policy */
+	/* The members below are only used on the server while the owning
+	 * lock is on the waiting queue, see ldlm_extent_add_waiting(). */
+	struct interval_node	li_wait_node; /* node in the waiting tree */
+	__u64			li_wait_seq;  /* order in the waiting queue */
+	ktime_t			li_wait_start; /* time the lock began waiting */
 };
 #define to_ldlm_interval(n) container_of(n, struct ldlm_interval, li_node)
 
@@ -651,6 +670,83 @@ struct ldlm_interval_tree {
 	struct interval_node	*lit_root; /* actual ldlm_interval */
 };
 
+/**
+ * Lock statistics of an extent resource on the server.
+ * Protected by lr_lock.
+ */
+struct ldlm_res_stats {
+	/** Time lr_lock was taken, if the namespace times the holders */
+	ktime_t			lrs_locked;
+	/** Number of times lr_lock was taken, and had to spin for it */
+	__u64			lrs_lock_count;
+	__u64			lrs_spin_count;
+	/** Time spent spinning on lr_lock, in nanoseconds */
+	__u64			lrs_spin_ns;
+	/** Time lr_lock was held, in nanoseconds */
+	__u64			lrs_hold_ns;
+	__u64			lrs_hold_max_ns;
+	/** Number of locks granted, and of those which had to wait */
+	__u64			lrs_granted;
+	__u64			lrs_waited;
+	/** Time granted locks spent on the waiting queue, in nanoseconds */
+	__u64			lrs_wait_ns;
+	__u64			lrs_wait_max_ns;
+	/** Locks limited to the block predicted for a strided writer */
+	__u64			lrs_stride_grants;
+};
+
+/**
+ * IO pattern of one job of a client on an extent resource, see
+ * ldlm_extent_stride_policy(). The job is expected to access runs of
+ * lss_run_len bytes every lss_period bytes.
+ */
+struct ldlm_stride_slot {
+	/** Export cookie of the client, 0 if the slot is free */
+	__u64			lss_cookie;
+	/** Contiguous run of extents the client is currently accessing */
+	__u64			lss_run_start;
+	__u64			lss_run_end;
+	/** Longest run of the pattern, and distance between the runs */
+	__u64			lss_run_len;
+	__u64			lss_period;
+	/** Number of times this pattern repeated */
+	int			lss_hits;
+	/** Jobid hash of the job, \see ldlm_lock::l_req_jobid */
+	__u32			lss_jobid;
+};
+
+#define LDLM_STRIDE_SLOTS	32
+
+/** IO patterns of the clients of a contended extent resource */
+struct ldlm_stride_hist {
+	struct ldlm_stride_slot	lsh_slots[LDLM_STRIDE_SLOTS];
+	/** Next slot to recycle */
+	int			lsh_next;
+};
+
+/**
+ * Server side state of an extent resource.
+ * Protected by lr_lock.
+ */
+struct ldlm_res_ext {
+	/**
+	 * Waiting locks indexed by extent, so that the conflicts of a lock
+	 * with the waiting queue are found without walking all of it.
+	 * GROUP locks are not indexed, the whole queue is walked as long
+	 * as any of them is waiting.
+	 */
+	struct interval_node	*lre_wait_root;
+	/** Number of waiting locks in the tree */
+	int			 lre_wait_count;
+	/** Number of waiting locks not in the tree */
+	int			 lre_wait_group;
+	/** Last waiting queue sequence, \see ldlm_interval::li_wait_seq */
+	__u64			 lre_wait_seq;
+	struct ldlm_res_stats	 lre_stats;
+	/** Client IO patterns, allocated once a lock had to wait */
+	struct ldlm_stride_hist	*lre_stride;
+};
+
 /** Whether to track references to exports by LDLM locks. */
 #define LUSTRE_TRACKS_LOCK_EXP_REFS (0)
 
@@ -881,6 +977,12 @@ struct ldlm_lock {
 	 */
 	__u64			l_client_cookie;
 
+	/**
+	 * Hash of the jobid of the enqueue request of an extent lock, which
+	 * tells the jobs of one client apart in ldlm_extent_stride_policy().
+	 */
+	__u32			l_req_jobid;
+
 	/**
 	 * List item for locks waiting for cancellation from clients.
 	 * The lists this could be linked into are:
@@ -1009,6 +1111,8 @@ struct ldlm_resource {
 	 * Interval trees (only for extent locks) for all modes of this resource
 	 */
 	struct ldlm_interval_tree *lr_itree;
+	/** Waiting queue index and lock statistics, server extent only */
+	struct ldlm_res_ext	*lr_ext;
 
 	union {
 		/**
@@ -1701,23 +1805,35 @@ enum lock_res_type {
         LRT_NEW
 };
 
+void ldlm_extent_lock_res(struct ldlm_resource *res, enum lock_res_type mode);
+void ldlm_extent_unlock_res(struct ldlm_resource *res);
+
 /** Lock resource. */
 static inline void lock_res(struct ldlm_resource *res)
 {
-	spin_lock(&res->lr_lock);
+	if (res->lr_ext != NULL)
+		ldlm_extent_lock_res(res, LRT_NORMAL);
+	else
+		spin_lock(&res->lr_lock);
 }
 
 /** Lock resource with a way to instruct lockdep code about nestedness-safe. */
 static inline void lock_res_nested(struct ldlm_resource *res,
 				   enum lock_res_type mode)
 {
-	spin_lock_nested(&res->lr_lock, mode);
+	if (res->lr_ext != NULL)
+		ldlm_extent_lock_res(res, mode);
+	else
+		spin_lock_nested(&res->lr_lock, mode);
 }
 
 /** Unlock resource. */
 static inline void unlock_res(struct ldlm_resource *res)
 {
-	spin_unlock(&res->lr_lock);
+	if (res->lr_ext != NULL)
+		ldlm_extent_unlock_res(res);
+	else
+		spin_unlock(&res->lr_lock);
 }
 
 /** Check if resource is already locked, assert if not. */
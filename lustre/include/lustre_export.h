@@ -426,6 +426,30 @@ static inline bool imp_connect_shortio(struct obd_import *imp)
 	return ocd->ocd_connect_flags & OBD_CONNECT_SHORTIO;
 }
 
+static inline bool imp_connect_compress(struct obd_import *imp)
+{
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
+
+	return (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) &&
+	       (ocd->ocd_connect_flags2 & OBD_CONNECT2_COMPRESS);
+}
+
+static inline bool imp_connect_multiobj_brw(struct obd_import *imp)
+{
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
+
+	return (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) &&
+	       (ocd->ocd_connect_flags2 & OBD_CONNECT2_MULTIOBJ_BRW);
+}
+
+static inline bool imp_connect_batch_rpc(struct obd_import *imp)
+{
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
+
+	return (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) &&
+	       (ocd->ocd_connect_flags2 & OBD_CONNECT2_BATCH_RPC);
+}
+
 static inline __u64 exp_connect_ibits(struct obd_export *exp)
 {
 	struct obd_connect_data *ocd;
@@ -449,6 +473,21 @@ static inline int exp_connect_lockahead(struct obd_export *exp)
 	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_LOCKAHEAD);
 }
 
+static inline int exp_connect_compress(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_COMPRESS);
+}
+
+static inline int exp_connect_multiobj_brw(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_MULTIOBJ_BRW);
+}
+
+static inline int exp_connect_batch_rpc(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_RPC);
+}
+
 static inline int exp_connect_overstriping(struct obd_export *exp)
 {
 	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_OVERSTRIPING);
@@ -51,6 +51,7 @@
  * @{
  */
 #include <linux/kobject.h>
+#include <linux/llist.h>
 #include <linux/uio.h>
 #include <libcfs/libcfs.h>
 #include <lnet/api.h>
@@ -64,6 +65,7 @@
 #include <lu_object.h>
 #include <lustre_req_layout.h>
 #include <obd_support.h>
+#include <uapi/linux/lustre/lustre_rpc_trace_user.h>
 #include <uapi/linux/lustre/lustre_ver.h>
 
 /* MD flags we _always_ use */
@@ -429,6 +431,15 @@
 #define MGS_MAXREQSIZE  (7 * 1024)
 #define MGS_MAXREPSIZE  (9 * 1024)
 
+/**
+ * OBD_BATCH_RPC limits. Batches are only sent to the MDS, OST and LDLM
+ * cancel portals whose request buffers take at least MDS_MAXREQSIZE, so
+ * a batch with its headers has to stay below that.
+ */
+#define PTLRPC_BATCH_MAX_REQS		16
+#define PTLRPC_BATCH_MAX_SIZE		(4 * 1024)	/* packed requests */
+#define PTLRPC_BATCH_REQ_MAX_SIZE	1024		/* one request */
+
  /*
   * OSS threads constants:
   *
@@ -465,10 +476,18 @@
 #define OSS_CR_NTHRS_BASE	8
 #define OSS_CR_NTHRS_MAX	64
 
+/**
+ * Maximum number of objects a client may pack into one OST_WRITE, see
+ * OBD_CONNECT2_MULTIOBJ_BRW. Each additional object costs one obd_ioobj
+ * and one ost_body in the request.
+ */
+#define OST_MAX_BRW_OBJS	32
+
 /**
  * OST_IO_MAXREQSIZE ~=
  * 	lustre_msg + ptlrpc_body + obdo + obd_ioobj +
- * 	DT_MAX_BRW_PAGES * niobuf_remote
+ * 	DT_MAX_BRW_PAGES * niobuf_remote +
+ * 	(OST_MAX_BRW_OBJS - 1) * (obdo + obd_ioobj)
  *
  * - single object with 16 pages is 512 bytes
  * - OST_IO_MAXREQSIZE must be at least 1 page of cookies plus some spillover
@@ -481,7 +500,10 @@
 				    sizeof(struct niobuf_remote)))
 #define _OST_MAXREQSIZE_SUM ((unsigned long)(_OST_MAXREQSIZE_BASE +	  \
 				   sizeof(struct niobuf_remote) *	  \
-				   (DT_MAX_BRW_PAGES - 1)))
+				   (DT_MAX_BRW_PAGES - 1) +		  \
+				   (sizeof(struct obdo) +		  \
+				    sizeof(struct obd_ioobj)) *		  \
+				   (OST_MAX_BRW_OBJS - 1)))
 /**
  * FIEMAP request can be 4K+ for now
  */
@@ -607,7 +629,14 @@ struct ptlrpc_request_set {
 	set_producer_func	set_producer;
 	/** opaq argument passed to the producer callback */
 	void			*set_producer_arg;
-	unsigned int		 set_allow_intr:1;
+	/**
+	 * Requests packed by ptl_send_rpc() during this ptlrpc_check_set()
+	 * pass, to be sent in OBD_BATCH_RPCs at the end of the pass
+	 */
+	struct list_head	 set_batch_reqs;
+	unsigned int		 set_allow_intr:1,
+				 /** small requests may be batched */
+				 set_batch_rpc:1;
 };
 
 struct ptlrpc_bulk_desc;
@@ -826,6 +855,8 @@ struct ptlrpc_cli_req {
 	void				*cr_cb_data;
 	/** Link to the imp->imp_unreplied_list */
 	struct list_head		 cr_unreplied_list;
+	/** Link to set_batch_reqs while waiting to go out in OBD_BATCH_RPC */
+	struct list_head		 cr_batch_chain;
 	/**
 	 * Commit callback, called when request is committed and about to be
 	 * freed.
@@ -866,6 +897,7 @@ struct ptlrpc_cli_req {
 #define rq_async_args		rq_cli.cr_async_args
 #define rq_cb_data		rq_cli.cr_cb_data
 #define rq_unreplied_list	rq_cli.cr_unreplied_list
+#define rq_batch_chain		rq_cli.cr_batch_chain
 #define rq_commit_cb		rq_cli.cr_commit_cb
 #define rq_replay_cb		rq_cli.cr_replay_cb
 
@@ -884,6 +916,8 @@ struct ptlrpc_srv_req {
 	struct list_head		 sr_exp_list;
 	/** server-side history, used for debuging purposes. */
 	struct list_head		 sr_hist_list;
+	/** linkage on ptlrpc_service_part::scp_req_staged */
+	struct llist_node		 sr_staged;
 	/** history sequence # */
 	__u64				 sr_hist_seq;
 	/** the index of service's srv_at_array into which request is linked */
@@ -923,6 +957,7 @@ struct ptlrpc_srv_req {
 #define rq_timed_list		rq_srv.sr_timed_list
 #define rq_exp_list		rq_srv.sr_exp_list
 #define rq_history_list		rq_srv.sr_hist_list
+#define rq_staged		rq_srv.sr_staged
 #define rq_history_seq		rq_srv.sr_hist_seq
 #define rq_at_index		rq_srv.sr_at_index
 #define rq_auth_uid		rq_srv.sr_auth_uid
@@ -997,7 +1032,8 @@ struct ptlrpc_request {
 	unsigned int
 		rq_hp:1,		/**< high priority RPC */
 		rq_at_linked:1,		/**< link into service's srv_at_array */
-		rq_packed_final:1;	/**< packed final reply */
+		rq_packed_final:1,	/**< packed final reply */
+		rq_batched:1;		/**< came in an OBD_BATCH_RPC */
 	/** @} */
 
 	/** one of RQ_PHASE_* */
@@ -1123,8 +1159,20 @@ struct ptlrpc_request {
 	time64_t			 rq_deadline;
 	/** request format description */
 	struct req_capsule		 rq_pill;
+	/** span timestamps if this request is sampled for RPC tracing */
+	struct rpc_trace_rec		*rq_trace;
 };
 
+/**
+ * Record that a traced request has reached point \a ev of its life.
+ */
+static inline void ptlrpc_trace_stamp(struct ptlrpc_request *req,
+				      enum rpc_trace_event ev)
+{
+	if (unlikely(req->rq_trace != NULL))
+		req->rq_trace->rtr_ts[ev] = ktime_get_real_ns();
+}
+
 /**
  * Call completion handler for rpc if any, return it's status or original
  * rc if there was no handler defined for this request.
@@ -1444,6 +1492,9 @@ struct ptlrpc_bulk_desc {
 	unsigned long bd_failure:1;
 	/** client side */
 	unsigned long bd_registered:1;
+	/** bd_enc_vec points at the pages of bd_vec, see
+	 * sptlrpc_enc_pool_get_pages_inplace() */
+	unsigned long bd_enc_inplace:1;
 	/** For serialization with callback */
 	spinlock_t bd_lock;
 	/** Import generation when request for this bulk was sent */
@@ -1507,6 +1558,8 @@ enum {
 	SVC_STARTING	= 1 << 2,
 	SVC_RUNNING	= 1 << 3,
 	SVC_EVENT	= 1 << 4,
+	/* stopped by ptlrpc_threads_adapt(), frees itself on exit */
+	SVC_SHRINK	= 1 << 5,
 };
 
 #define PTLRPC_THR_NAME_LEN		32
@@ -1576,6 +1629,11 @@ static inline int thread_is_event(struct ptlrpc_thread *thread)
         return !!(thread->t_flags & SVC_EVENT);
 }
 
+static inline int thread_is_shrink(struct ptlrpc_thread *thread)
+{
+	return !!(thread->t_flags & SVC_SHRINK);
+}
+
 static inline void thread_clear_flags(struct ptlrpc_thread *thread, __u32 flags)
 {
         thread->t_flags &= ~flags;
@@ -1666,6 +1724,20 @@ struct ptlrpc_service_ops {
  * priority request
  */
 #define PTLRPC_SVC_HP_RATIO 10
+/** default # incoming reqs taken per scp_lock acquisition */
+#define PTLRPC_SVC_REQ_IN_BATCH 16
+#define PTLRPC_SVC_REQ_IN_BATCH_MAX 256
+
+/**
+ * Defaults of the adaptive thread pool, which keeps between threads_min and
+ * threads_max threads per partition depending on the queue wait of requests
+ * and on how busy the threads are, see ptlrpc_threads_adapt()
+ */
+#define PTLRPC_THR_ADAPT_INTERVAL	1	/* seconds */
+#define PTLRPC_THR_ADAPT_INTERVAL_MAX	3600
+#define PTLRPC_THR_GROW_WAIT		5000	/* usec */
+#define PTLRPC_THR_SHRINK_UTIL		25	/* percent */
+#define PTLRPC_THR_SHRINK_DELAY		30	/* intervals */
 
 /**
  * Definition of PortalRPC service.
@@ -1695,8 +1767,21 @@ struct ptlrpc_service {
 	struct dentry		       *srv_debugfs_entry;
         /** Pointer to statistic data for this service */
         struct lprocfs_stats           *srv_stats;
+	/** per-opcode latency histograms for this service */
+	struct ptlrpc_lat_stats	       *srv_lat_stats;
         /** # hp per lp reqs to handle */
         int                             srv_hpreq_ratio;
+	/** max # incoming reqs taken per scp_lock acquisition in req_in */
+	int				srv_req_in_batch;
+	/** adaptive thread pool: seconds between adjustments, 0 disables */
+	int				srv_thr_adapt_interval;
+	/** adaptive thread pool: start a thread above this avg wait, usec */
+	int				srv_thr_grow_wait;
+	/** adaptive thread pool: threads busy below this % are under-used */
+	int				srv_thr_shrink_util;
+	/** adaptive thread pool: stop a thread after this many intervals
+	 * under-used in a row */
+	int				srv_thr_shrink_delay;
         /** biggest request to receive */
         int                             srv_max_req_size;
         /** biggest reply to send */
@@ -1777,6 +1862,15 @@ struct ptlrpc_service_part {
 	/** service threads list */
 	struct list_head		scp_threads;
 
+	/**
+	 * reqs received by LNet but not yet moved to scp_req_incoming, added
+	 * by request_in_callback() without taking scp_lock and drained in
+	 * batches by the service threads, see ptlrpc_server_drain_staged()
+	 */
+	struct llist_head		scp_req_staged __cfs_cacheline_aligned;
+	/** # reqs on scp_req_staged, reported with scp_nreqs_incoming */
+	atomic_t			scp_nreqs_staged;
+
 	/**
 	 * serialize the following fields, used for protecting
 	 * rqbd list and incoming requests waiting for preprocess,
@@ -1869,6 +1963,23 @@ struct ptlrpc_service_part {
 	wait_queue_head_t		scp_rep_waitq;
 	/** # 'difficult' replies */
 	atomic_t			scp_nreps_difficult;
+
+	/**
+	 * adaptive thread pool sizing, see ptlrpc_threads_adapt(); the
+	 * counters are reset at the start of every adapt interval
+	 */
+	/** @{ */
+	/** total queue wait of reqs started in this interval, usec */
+	atomic64_t			scp_thr_wait_usecs __cfs_cacheline_aligned;
+	/** total time threads spent handling reqs in this interval, usec */
+	atomic64_t			scp_thr_busy_usecs;
+	/** # reqs started in this interval */
+	atomic_t			scp_thr_nreqs;
+	/** start of this interval, protected by scp_lock */
+	ktime_t				scp_thr_adapt_start;
+	/** # consecutive under-used intervals, protected by scp_lock */
+	int				scp_thr_idle_intervals;
+	/** @} */
 };
 
 #define ptlrpc_service_for_each_part(part, i, svc)			\
@@ -59,6 +59,16 @@ enum ptlrpc_nrs_ctl {
 	 * in the future.
 	 */
 	PTLRPC_NRS_CTL_STOP,
+	/**
+	 * Chain another policy after the primary one; the argument is the
+	 * name of that policy, or NULL to remove the chained policy.
+	 */
+	PTLRPC_NRS_CTL_CHAIN,
+	/**
+	 * Activate the policy as the primary one, and move the current
+	 * primary policy to the chained role instead of stopping it.
+	 */
+	PTLRPC_NRS_CTL_PREPEND,
 	/**
 	 * Policies can start using opcodes from this value and onwards for
 	 * their own purposes; the assigned value itself is arbitrary.
@@ -319,6 +329,14 @@ enum ptlrpc_nrs_queue_type {
  *
  * \see nrs_resource_get_safe()
  * \see nrs_request_enqueue()
+ *
+ * A second policy may be chained after the primary one; requests that the
+ * primary policy lets through are not handled straight away, but enqueued
+ * again on the chained policy, which orders them. This way e.g. TBF limits
+ * the rate of each class of RPCs while ORR sorts the admitted RPCs by
+ * offset. Admitted requests the chained policy does not handle are enqueued
+ * on the fallback policy.
+ * \see nrs_request_chain()
  */
 struct ptlrpc_nrs {
 	spinlock_t			nrs_lock;
@@ -348,6 +366,10 @@ struct ptlrpc_nrs {
 	 * Fallback policy, which is the backup policy for handling RPCs
 	 */
 	struct ptlrpc_nrs_policy       *nrs_policy_fallback;
+	/**
+	 * Policy ordering the requests let through by the primary policy
+	 */
+	struct ptlrpc_nrs_policy       *nrs_policy_chained;
 	/**
 	 * This NRS head handles either HP or regular requests
 	 */
@@ -360,6 +382,11 @@ struct ptlrpc_nrs {
 	 * # scheduled requests from all policies in this NRS head
 	 */
 	unsigned long			nrs_req_started;
+	/**
+	 * # requests let through by the primary policy, which are queued
+	 * again on the chained or fallback policy
+	 */
+	unsigned long			nrs_req_chained;
 	/**
 	 * # policies on this NRS
 	 */
@@ -565,10 +592,21 @@ struct ptlrpc_nrs_pol_info {
 	 * # RPCs started for dispatch by the policy
 	 */
 	long				pi_req_started;
+	/**
+	 * # RPCs dequeued from the policy, and the total and longest time
+	 * they were queued, in nanoseconds
+	 */
+	__u64				pi_wait_count;
+	__u64				pi_wait_total;
+	__u64				pi_wait_max;
 	/**
 	 * Is this a fallback policy?
 	 */
 	unsigned			pi_fallback:1;
+	/**
+	 * Is this policy chained after the primary policy?
+	 */
+	unsigned			pi_chained:1;
 };
 
 /**
@@ -604,6 +642,13 @@ struct ptlrpc_nrs_policy {
 	 * # RPCs started for dispatch by the policy
 	 */
 	long				pol_req_started;
+	/**
+	 * # RPCs dequeued from the policy, and the total and longest time
+	 * they were queued, in nanoseconds
+	 */
+	__u64				pol_wait_count;
+	__u64				pol_wait_total;
+	__u64				pol_wait_max;
 	/**
 	 * Usage Reference count taken on the policy instance
 	 */
@@ -668,6 +713,7 @@ struct ptlrpc_nrs_resource {
 enum {
 	NRS_RES_FALLBACK,
 	NRS_RES_PRIMARY,
+	NRS_RES_CHAINED,
 	NRS_RES_MAX
 };
 
@@ -701,6 +747,15 @@ struct ptlrpc_nrs_request {
 	unsigned			nr_enqueued:1;
 	unsigned			nr_started:1;
 	unsigned			nr_finalized:1;
+	/**
+	 * Set while the request, let through by the primary policy, is
+	 * queued on the chained or fallback policy.
+	 */
+	unsigned			nr_chained:1;
+	/**
+	 * Time the request was enqueued on its current policy
+	 */
+	ktime_t				nr_queue_time;
 	struct cfs_binheap_node		nr_node;
 
 	/**
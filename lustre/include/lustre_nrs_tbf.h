@@ -109,6 +109,15 @@ struct nrs_tbf_client {
 	__u64				 tc_ntoken;
 	/** Token bucket depth. */
 	__u64				 tc_depth;
+	/** Limit of bulk bytes per second, 0 if unlimited. */
+	__u64				 tc_bw;
+	/**
+	 * Byte tokens, negative while the class pays off an RPC bigger than
+	 * the byte bucket.
+	 */
+	__s64				 tc_bw_ntoken;
+	/** Byte bucket depth. */
+	__u64				 tc_bw_depth;
 	/** Time check-point. */
 	__u64				 tc_check_time;
 	/** Deadline of a class */
@@ -124,6 +133,10 @@ struct nrs_tbf_client {
 	struct cfs_binheap_node		 tc_node;
 	/** Whether the client is in heap. */
 	bool				 tc_in_heap;
+	/** Linkage into nrs_tbf_head::th_drr_list while requests are queued. */
+	struct list_head		 tc_drr_link;
+	/** RPCs the class may still dispatch in its current DRR turn. */
+	__u64				 tc_deficit;
 	/** Sequence of the newest rule. */
 	__u32				 tc_rule_sequence;
 	/**
@@ -168,12 +181,18 @@ struct nrs_tbf_rule {
 	struct list_head		tr_conds;
 	/** Generic condition string of the rule. */
 	char				*tr_conds_str;
-	/** RPC/s limit. */
+	/** RPC/s limit, or the weight of the class for the DRR policy. */
 	__u64				 tr_rpc_rate;
 	/** Time to wait for next token. */
 	__u64				 tr_nsecs;
 	/** Token bucket depth. */
 	__u64				 tr_depth;
+	/** Bulk bytes/s limit, 0 if unlimited. */
+	__u64				 tr_bw;
+	/** RPCs dispatched by the classes of the rule. */
+	__u64				 tr_rpcs;
+	/** Bulk bytes dispatched by the classes of the rule. */
+	__u64				 tr_bytes;
 	/** Lock to protect the list of clients. */
 	spinlock_t			 tr_rule_lock;
 	/** List of client. */
@@ -286,6 +305,15 @@ struct nrs_tbf_head {
 	 * Index of bucket on hash table while purging.
 	 */
 	int				 th_purge_start;
+	/**
+	 * Classes are served by deficit round robin in proportion to the
+	 * weight of their rule, instead of being rate limited.
+	 */
+	bool				 th_drr;
+	/**
+	 * Round robin list of the DRR classes which have queued requests.
+	 */
+	struct list_head		 th_drr_list;
 };
 
 enum nrs_tbf_cmd_type {
@@ -300,6 +328,7 @@ struct nrs_tbf_cmd {
 	union {
 		struct nrs_tbf_cmd_start {
 			__u64			 ts_rpc_rate;
+			__u64			 ts_bw;
 			struct list_head	 ts_nids;
 			char			*ts_nids_str;
 			struct list_head	 ts_jobids;
@@ -316,6 +345,7 @@ struct nrs_tbf_cmd {
 		} tc_start;
 		struct nrs_tbf_cmd_change {
 			__u64			 tc_rpc_rate;
+			__u64			 tc_bw;
 			char			*tc_next_name;
 		} tc_change;
 	} u;
@@ -357,6 +387,10 @@ struct nrs_tbf_req {
 	 * Sequence of the request.
 	 */
 	__u64			tr_sequence;
+	/**
+	 * Bulk bytes moved by the request.
+	 */
+	__u64			tr_bytes;
 };
 
 /**
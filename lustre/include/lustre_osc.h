@@ -183,6 +183,8 @@ struct osc_thread_info {
 	struct cl_sync_io	oti_anchor;
 	struct cl_req_attr	oti_req_attr;
 	struct lu_buf		oti_ladvise_buf;
+	/** scratch obdo for the jobid lookup of osc_pack_write_objs() */
+	struct obdo		oti_oa;
 };
 
 static inline __u64 osc_enq2ldlm_flags(__u32 enqflags)
@@ -553,6 +555,9 @@ struct osc_page {
 
 struct osc_brw_async_args {
 	struct obdo		*aa_oa;
+	/* obdos of the objects after the first one of a multi-object BRW */
+	struct obdo		*aa_oas;
+	u32			 aa_obj_count;
 	int			 aa_requested_nob;
 	int			 aa_nio_count;
 	u32			 aa_page_count;
@@ -615,6 +620,11 @@ int osc_cache_wait_range(const struct lu_env *env, struct osc_object *obj,
 int osc_io_unplug0(const struct lu_env *env, struct client_obd *cli,
 		   struct osc_object *osc, int async);
 void osc_wake_cache_waiters(struct client_obd *cli);
+void osc_grant_cache_drain(struct client_obd *cli);
+int osc_grant_cache_init(struct client_obd *cli);
+void osc_grant_cache_fini(struct client_obd *cli);
+void osc_grant_cache_sum(struct client_obd *cli, unsigned long *pages,
+			 unsigned long *grant);
 
 static inline int osc_io_unplug_async(const struct lu_env *env,
 				      struct client_obd *cli,
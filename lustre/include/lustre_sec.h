@@ -1166,6 +1166,7 @@ int sptlrpc_enc_pool_add_user(void);
 int sptlrpc_enc_pool_del_user(void);
 int  sptlrpc_enc_pool_get_pages(struct ptlrpc_bulk_desc *desc);
 void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc);
+int  sptlrpc_enc_pool_get_pages_inplace(struct ptlrpc_bulk_desc *desc);
 int get_free_pages_in_pool(void);
 int pool_is_at_full_capacity(void);
 
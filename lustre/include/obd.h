@@ -46,6 +46,7 @@
 #endif
 #include <lu_ref.h>
 #include <lustre_export.h>
+#include <obd_compress.h>
 #include <lustre_fid.h>
 #include <lustre_fld.h>
 #include <lustre_handles.h>
@@ -170,6 +171,15 @@ enum obd_cl_sem_lock_class {
 
 struct mdc_rpc_lock;
 struct obd_import;
+/* credits cached for one CPU partition, see client_obd::cl_grant_cache */
+struct osc_grant_cache {
+	spinlock_t		ogc_lock;
+	/* dirty pages already counted in cl_dirty_pages/obd_dirty_pages */
+	unsigned long		ogc_pages;
+	/* grant already counted in cl_dirty_grant */
+	unsigned long		ogc_grant;
+};
+
 struct client_obd {
 	struct rw_semaphore	 cl_sem;
 	struct obd_uuid		 cl_target_uuid;
@@ -225,6 +235,10 @@ struct client_obd {
 	 * grant before trying to dirty a page and unreserve the rest.
 	 * See osc_{reserve|unreserve}_grant for details. */
 	long			cl_reserved_grant;
+	/* per-CPT dirty page and grant credits taken from the counters above
+	 * in batches, so that most pages are dirtied without loi_list_lock.
+	 * See osc_grant_cache_get() for details. */
+	struct osc_grant_cache	**cl_grant_cache;
 	struct list_head	cl_cache_waiters; /* waiting for cache/grant */
 	time64_t		cl_next_shrink_grant;	/* seconds */
 	struct list_head	cl_grant_chain;
@@ -269,6 +283,8 @@ struct client_obd {
 	u32			cl_max_pages_per_rpc;
 	u32			cl_max_rpcs_in_flight;
 	u32			cl_max_short_io_bytes;
+	/* max # of objects whose writes can be packed into one BRW RPC */
+	u32			cl_max_objs_per_rpc;
 	struct obd_histogram	cl_read_rpc_hist;
 	struct obd_histogram	cl_write_rpc_hist;
 	struct obd_histogram	cl_read_page_hist;
@@ -343,6 +359,13 @@ struct client_obd {
         /* checksum algorithm to be used */
 	enum cksum_types	 cl_cksum_type;
 
+	/* compression of bulk write data, if the server supports it */
+	enum obd_compress_type	 cl_compress_type;
+	atomic_long_t		 cl_compress_rpcs;
+	atomic_long_t		 cl_compress_skipped;
+	atomic_long_t		 cl_compress_bytes_in;
+	atomic_long_t		 cl_compress_bytes_out;
+
         /* also protected by the poorly named _loi_list_lock lock above */
         struct osc_async_rc      cl_ar;
 
@@ -460,6 +483,18 @@ struct niobuf_local {
 
 struct tgt_thread_big_cache {
 	struct niobuf_local	local[PTLRPC_MAX_BRW_PAGES];
+	/* local buffers used by each object of a multi-object write */
+	int			npages[OST_MAX_BRW_OBJS];
+	/* compressed writes, allocated on first use and kept for the next
+	 * one: transforms, the received bulk and its pages, and the data
+	 * decompressed from it */
+	struct crypto_comp	*compr_tfm[OBD_COMPRESS_MAX];
+	char			*compr_buf;
+	int			 compr_buf_size;
+	struct niobuf_local	*compr_nb;
+	int			 compr_nb_size;
+	char			*decompr_buf;
+	int			 decompr_buf_size;
 };
 
 #define LUSTRE_FLD_NAME         "fld"
@@ -721,6 +756,7 @@ struct obd_device {
 	struct proc_dir_entry	*obd_proc_exports_entry;
 	struct dentry			*obd_svc_debugfs_entry;
 	struct lprocfs_stats	*obd_svc_stats;
+	struct ptlrpc_lat_stats	*obd_svc_lat_stats;
 	const struct attribute	       **obd_attrs;
 	struct lprocfs_vars	*obd_vars;
 	atomic_t		obd_evict_inprogress;
@@ -931,6 +967,12 @@ struct md_enqueue_info {
 	struct ldlm_enqueue_info	mi_einfo;
 	md_enqueue_cb_t			mi_cb;
 	void			       *mi_cbdata;
+	/* if set, the request is collected in this set and sent when the
+	 * caller flushes it via ptlrpcd_add_rqset(), instead of being handed
+	 * to ptlrpcd immediately */
+	struct ptlrpc_request_set      *mi_set;
+	/* sends the requests collected in mi_set */
+	void			      (*mi_set_flush)(struct md_enqueue_info *);
 };
 
 struct obd_ops {
@@ -0,0 +1,94 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * Compression of bulk write data between OSC and OST.
+ *
+ * The client compresses the data of a whole BRW RPC as one stream and
+ * flags the algorithm in o_flags (OBD_FL_COMPRESS_*), with the size of
+ * the compressed bulk in o_compr_size. The niobufs still describe the
+ * uncompressed extents, so the target scatters the decompressed data
+ * into its local pages exactly as it would for an uncompressed bulk.
+ */
+
+#ifndef __OBD_COMPRESS_H
+#define __OBD_COMPRESS_H
+
+#include <linux/crypto.h>
+#include <uapi/linux/lustre/lustre_idl.h>
+
+enum obd_compress_type {
+	OBD_COMPRESS_NONE	= 0,
+	OBD_COMPRESS_LZ4	= 1,
+	OBD_COMPRESS_DEFLATE	= 2,
+	OBD_COMPRESS_MAX,
+};
+
+#define DECLARE_COMPRESS_NAME						\
+	const char *compress_name[] = { "none", "lz4", "deflate" }
+
+/* crypto API algorithm name used for \a type */
+static inline const char *obd_compress_alg(enum obd_compress_type type)
+{
+	switch (type) {
+	case OBD_COMPRESS_LZ4:
+		return "lz4";
+	case OBD_COMPRESS_DEFLATE:
+		return "deflate";
+	default:
+		return NULL;
+	}
+}
+
+static inline u32 obd_compress_type_pack(enum obd_compress_type type)
+{
+	switch (type) {
+	case OBD_COMPRESS_LZ4:
+		return OBD_FL_COMPRESS_LZ4;
+	case OBD_COMPRESS_DEFLATE:
+		return OBD_FL_COMPRESS_DEFLATE;
+	default:
+		return 0;
+	}
+}
+
+static inline enum obd_compress_type obd_compress_type_unpack(u32 o_flags)
+{
+	switch (o_flags & OBD_FL_COMPRESS_ALL) {
+	case OBD_FL_COMPRESS_LZ4:
+		return OBD_COMPRESS_LZ4;
+	case OBD_FL_COMPRESS_DEFLATE:
+		return OBD_COMPRESS_DEFLATE;
+	default:
+		return OBD_COMPRESS_NONE;
+	}
+}
+
+/* can this node (de)compress with every algorithm the protocol allows */
+static inline bool obd_compress_supported(void)
+{
+	return crypto_has_comp("lz4", 0, 0) &&
+	       crypto_has_comp("deflate", 0, 0);
+}
+
+#endif /* __OBD_COMPRESS_H */
@@ -840,6 +840,9 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_PCC		0x1000ULL /* Persistent Client Cache */
 #define OBD_CONNECT2_PLAIN_LAYOUT	0x2000ULL /* Plain Directory Layout */
 #define OBD_CONNECT2_ASYNC_DISCARD	0x4000ULL /* support async DoM data discard */
+#define OBD_CONNECT2_COMPRESS		0x8000ULL /* compressed bulk writes */
+#define OBD_CONNECT2_MULTIOBJ_BRW	0x10000ULL /* multi-object bulk writes */
+#define OBD_CONNECT2_BATCH_RPC		0x20000ULL /* OBD_BATCH_RPC */
 
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
@@ -900,7 +903,8 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_SELINUX_POLICY | \
 				OBD_CONNECT2_LSOM | \
 				OBD_CONNECT2_ASYNC_DISCARD | \
-				OBD_CONNECT2_PCC)
+				OBD_CONNECT2_PCC | \
+				OBD_CONNECT2_BATCH_RPC)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -921,7 +925,9 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_GRANT_PARAM | \
 				OBD_CONNECT_SHORTIO | OBD_CONNECT_FLAGS2)
 
-#define OST_CONNECT_SUPPORTED2 OBD_CONNECT2_LOCKAHEAD
+#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | OBD_CONNECT2_COMPRESS | \
+				OBD_CONNECT2_MULTIOBJ_BRW | \
+				OBD_CONNECT2_BATCH_RPC)
 
 #define ECHO_CONNECT_SUPPORTED (OBD_CONNECT_FID)
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -1083,6 +1089,8 @@ enum obdo_flags {
         OBD_FL_NOSPC_BLK    = 0x00100000, /* no more block space on OST */
 	OBD_FL_FLUSH	    = 0x00200000, /* flush pages on the OST */
 	OBD_FL_SHORT_IO	    = 0x00400000, /* short io request */
+	OBD_FL_COMPRESS_LZ4 = 0x00800000, /* bulk data is LZ4 compressed */
+	OBD_FL_COMPRESS_DEFLATE = 0x01000000, /* bulk data is deflated */
 	/* OBD_FL_LOCAL_MASK = 0xF0000000, was local-only flags until 2.10 */
 
 	/*
@@ -1097,6 +1105,8 @@ enum obdo_flags {
 
 	OBD_FL_NO_QUOTA_ALL = OBD_FL_NO_USRQUOTA | OBD_FL_NO_GRPQUOTA |
 			      OBD_FL_NO_PRJQUOTA,
+
+	OBD_FL_COMPRESS_ALL = OBD_FL_COMPRESS_LZ4 | OBD_FL_COMPRESS_DEFLATE,
 };
 
 /*
@@ -2647,6 +2657,7 @@ enum obd_cmd {
 /*	OBD_LOG_CANCEL	= 401, obsolete since 1.5 */
 /*	OBD_QC_CALLBACK	= 402, obsolete since 2.4 */
 	OBD_IDX_READ	= 403,
+	OBD_BATCH_RPC	= 404,
 	OBD_LAST_OPC,
 	OBD_FIRST_OPC = OBD_PING
 };
@@ -3067,8 +3078,8 @@ struct obdo {
 						 * brw: grant space consumed on
 						 * the client for the write */
 	__u32			o_projid;
-	__u32			o_padding_4;	/* also fix
-						 * lustre_swab_obdo() */
+	__u32			o_compr_size;	/* brw: size of compressed
+						 * bulk, see OBD_FL_COMPRESS_* */
 	__u64			o_padding_5;
 	__u64			o_padding_6;
 };
@@ -3230,6 +3241,16 @@ union lu_page {
 	char			lp_array[LU_PAGE_SIZE];
 };
 
+/* One request carried by an OBD_BATCH_RPC. The RMF_BATCH_SUBS array holds
+ * one of these per request, in the order the request messages follow each
+ * other (each rounded up to 8 bytes) in RMF_BATCH_MSGS. Every request keeps
+ * its own XID and is replied to on its own. */
+struct batch_rpc_sub {
+	__u64	brs_xid;	/* XID the request would have been sent with */
+	__u32	brs_len;	/* length of the request message */
+	__u32	brs_padding;
+};
+
 /* security opcodes */
 enum sec_cmd {
         SEC_CTX_INIT            = 801,
@@ -0,0 +1,95 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.  A copy is
+ * included in the COPYING file that accompanied this code.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/include/uapi/linux/lustre/lustre_rpc_trace_user.h
+ *
+ * Binary records of the RPC tracing facility, as read from the
+ * "rpc_trace" debugfs file and decoded by "lctl rpc_trace".
+ */
+#ifndef _LUSTRE_RPC_TRACE_USER_H
+# define _LUSTRE_RPC_TRACE_USER_H
+
+#include <linux/types.h>
+/*
+ * This is due to us being out of kernel and the way the OpenSFS branch
+ * handles CFLAGS.
+ */
+#ifdef __KERNEL__
+# include <uapi/linux/lustre/lustre_user.h>
+#else
+# include <linux/lustre/lustre_user.h>
+#endif
+
+#define RPC_TRACE_MAGIC		0x52504354	/* "RPCT" */
+
+/* points in the life of a request, each one is stamped at most once per
+ * record; a zero timestamp means the request never got there (or the
+ * event does not exist on that side of the connection) */
+enum rpc_trace_event {
+	RPC_TRACE_SEND		= 0,	/* client: request handed to LNet */
+	RPC_TRACE_ARRIVE	= 1,	/* server: request buffer filled */
+	RPC_TRACE_REQ_IN	= 2,	/* server: request unpacked */
+	RPC_TRACE_NRS_ENQ	= 3,	/* server: queued to NRS */
+	RPC_TRACE_NRS_DEQ	= 4,	/* server: taken by a service thread */
+	RPC_TRACE_HANDLE_START	= 5,	/* server: handler called */
+	RPC_TRACE_BULK_START	= 6,	/* server: bulk transfer started */
+	RPC_TRACE_BULK_END	= 7,	/* server: bulk transfer completed */
+	RPC_TRACE_REPLY		= 8,	/* server sent / client got reply */
+	RPC_TRACE_HANDLE_END	= 9,	/* server: handler returned */
+	RPC_TRACE_EV_LAST,
+	RPC_TRACE_EV_MAX	= 12
+};
+
+#define RPC_TRACE_EVENT_NAMES						\
+{									\
+	[RPC_TRACE_SEND]		= "send",			\
+	[RPC_TRACE_ARRIVE]		= "arrive",			\
+	[RPC_TRACE_REQ_IN]		= "req_in",			\
+	[RPC_TRACE_NRS_ENQ]		= "nrs_enq",			\
+	[RPC_TRACE_NRS_DEQ]		= "nrs_deq",			\
+	[RPC_TRACE_HANDLE_START]	= "handle_start",		\
+	[RPC_TRACE_BULK_START]		= "bulk_start",			\
+	[RPC_TRACE_BULK_END]		= "bulk_end",			\
+	[RPC_TRACE_REPLY]		= "reply",			\
+	[RPC_TRACE_HANDLE_END]		= "handle_end",			\
+}
+
+enum rpc_trace_flags {
+	RPC_TRACE_FL_SERVER	= 0x0001,	/* recorded by the server */
+	RPC_TRACE_FL_BULK	= 0x0002,	/* request had a bulk transfer */
+};
+
+struct rpc_trace_rec {
+	__u32	rtr_magic;		/* RPC_TRACE_MAGIC */
+	__u16	rtr_size;		/* sizeof(struct rpc_trace_rec) */
+	__u16	rtr_flags;		/* enum rpc_trace_flags */
+	__u32	rtr_opc;		/* RPC opcode */
+	__s32	rtr_status;		/* reply status */
+	__u64	rtr_xid;
+	__u64	rtr_peer_nid;		/* server NID on clients and vice versa */
+	__u32	rtr_peer_pid;
+	__u32	rtr_cpu;		/* CPU the record was written on */
+	__s64	rtr_ts[RPC_TRACE_EV_MAX]; /* ns since the epoch, 0 if unset */
+	char	rtr_jobid[LUSTRE_JOBID_SIZE];
+};
+
+#endif /* _LUSTRE_RPC_TRACE_USER_H */
@@ -383,8 +383,9 @@ static void interval_insert_color(struct interval_node *node,
 	EXIT;
 }
 
-struct interval_node *interval_insert(struct interval_node *node,
-                                      struct interval_node **root)
+static struct interval_node *__interval_insert(struct interval_node *node,
+					       struct interval_node **root,
+					       bool unique)
 {
 	struct interval_node **p, *parent = NULL;
 
@@ -394,7 +395,7 @@ struct interval_node *interval_insert(struct interval_node *node,
 	p = root;
         while (*p) {
                 parent = *p;
-                if (node_equal(parent, node))
+		if (unique && node_equal(parent, node))
                         RETURN(parent);
 
                 /* max_high field must be updated after each iteration */
@@ -418,8 +419,26 @@ struct interval_node *interval_insert(struct interval_node *node,
 
 	RETURN(NULL);
 }
+
+struct interval_node *interval_insert(struct interval_node *node,
+                                      struct interval_node **root)
+{
+	return __interval_insert(node, root, true);
+}
 EXPORT_SYMBOL(interval_insert);
 
+/*
+ * Insert @node even if a node with the same extent is already in the tree,
+ * nodes with equal extents are kept in insertion order. interval_find()
+ * must not be used on such a tree.
+ */
+void interval_insert_dup(struct interval_node *node,
+			 struct interval_node **root)
+{
+	__interval_insert(node, root, false);
+}
+EXPORT_SYMBOL(interval_insert_dup);
+
 static inline int node_is_black_or_0(struct interval_node *node)
 {
 	return !node || node_is_black(node);
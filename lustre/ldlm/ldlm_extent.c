@@ -264,6 +264,119 @@ ldlm_extent_internal_policy_waiting(struct ldlm_lock *req,
 }
 
 
+/**
+ * Learn the IO pattern of the job of \a req on a contended resource, and
+ * limit its lock to the block it is going to access.
+ *
+ * In N-to-1 checkpoints each client writes a block of the file, then the
+ * block one period further, while the other clients write the blocks in
+ * between. The greedy expansion above gives a client the blocks of the
+ * others, and the lock is revoked as soon as they write them. Once the
+ * period of a client repeated, its lock is limited to its block, which
+ * is the longest run of contiguous requests seen from it.
+ *
+ * Only resources on which a lock had to wait keep this history. Patterns
+ * are kept per client and jobid, so that the ranks of a job running on one
+ * client are told apart when the jobid tells them apart, e.g. with "%p" in
+ * jobid_name. Without jobids, all IO of a client is one pattern.
+ */
+static void ldlm_extent_stride_policy(struct ldlm_lock *req,
+				      struct ldlm_extent *new_ex)
+{
+	struct ldlm_resource *res = req->l_resource;
+	struct ldlm_res_ext *ext = res->lr_ext;
+	struct ldlm_stride_hist *hist;
+	struct ldlm_stride_slot *slot = NULL;
+	__u64 cookie;
+	__u32 jobid = req->l_req_jobid;
+	__u64 start = req->l_req_extent.start;
+	__u64 end = req->l_req_extent.end;
+	__u64 delta;
+	__u64 rem;
+	int i;
+
+	if (ext == NULL || req->l_export == NULL ||
+	    !ldlm_res_to_ns(res)->ns_stride_locks ||
+	    !(req->l_req_mode & (LCK_PW | LCK_CW)))
+		return;
+
+	hist = ext->lre_stride;
+	if (hist == NULL) {
+		if (ext->lre_stats.lrs_waited == 0)
+			return;
+		OBD_ALLOC_GFP(hist, sizeof(*hist), GFP_ATOMIC);
+		if (hist == NULL)
+			return;
+		ext->lre_stride = hist;
+	}
+
+	cookie = req->l_export->exp_handle.h_cookie;
+	for (i = 0; i < LDLM_STRIDE_SLOTS; i++) {
+		if (hist->lsh_slots[i].lss_cookie == cookie &&
+		    hist->lsh_slots[i].lss_jobid == jobid) {
+			slot = &hist->lsh_slots[i];
+			break;
+		}
+	}
+
+	if (slot == NULL) {
+		slot = &hist->lsh_slots[hist->lsh_next];
+		hist->lsh_next = (hist->lsh_next + 1) % LDLM_STRIDE_SLOTS;
+		memset(slot, 0, sizeof(*slot));
+		slot->lss_cookie = cookie;
+		slot->lss_jobid = jobid;
+		slot->lss_run_start = start;
+		slot->lss_run_end = end;
+		return;
+	}
+
+	if (start >= slot->lss_run_start && start <= slot->lss_run_end + 1) {
+		/* the client goes on with its current block */
+		slot->lss_run_end = max(slot->lss_run_end, end);
+	} else {
+		slot->lss_run_len = max(slot->lss_run_len, slot->lss_run_end -
+					slot->lss_run_start + 1);
+		delta = start - slot->lss_run_start;
+		if (start < slot->lss_run_start) {
+			/* another pass over the file */
+			slot->lss_run_len = 0;
+			slot->lss_period = 0;
+			slot->lss_hits = 0;
+		} else if (slot->lss_period == 0) {
+			slot->lss_period = delta;
+		} else {
+			div64_u64_rem(delta, slot->lss_period, &rem);
+			if (rem == 0) {
+				/* blocks in between were covered by the
+				 * previous lock of the client */
+				slot->lss_hits++;
+			} else {
+				div64_u64_rem(slot->lss_period, delta, &rem);
+				/* the first period spanned several blocks */
+				slot->lss_hits = rem == 0 ? 1 : 0;
+				if (rem != 0)
+					slot->lss_run_len = 0;
+				slot->lss_period = delta;
+			}
+		}
+		slot->lss_run_start = start;
+		slot->lss_run_end = end;
+	}
+
+	/* the blocks of other clients lie between those of this one */
+	if (slot->lss_hits == 0 || slot->lss_run_len == 0 ||
+	    slot->lss_run_len >= slot->lss_period)
+		return;
+
+	new_ex->start = max(new_ex->start, slot->lss_run_start);
+	new_ex->end = min(new_ex->end, max(end, slot->lss_run_start +
+					    slot->lss_run_len - 1));
+	ldlm_extent_internal_policy_fixup(req, new_ex, 0);
+	/* the client writes the rest of its block under this lock */
+	slot->lss_run_end = max(slot->lss_run_end, new_ex->end);
+	ext->lre_stats.lrs_stride_grants++;
+}
+
 /* In order to determine the largest possible extent we can grant, we need
  * to scan all of the queues. */
 static void ldlm_extent_policy(struct ldlm_resource *res,
@@ -292,6 +405,7 @@ static void ldlm_extent_policy(struct ldlm_resource *res,
 	if (likely(!(lock->l_flags & LDLM_FL_NO_EXPANSION))) {
 		ldlm_extent_internal_policy_granted(lock, &new_ex);
 		ldlm_extent_internal_policy_waiting(lock, &new_ex);
+		ldlm_extent_stride_policy(lock, &new_ex);
 	} else {
 		LDLM_DEBUG(lock, "Not expanding manually requested lock.\n");
 		new_ex.start = lock->l_policy_data.l_extent.start;
@@ -370,6 +484,144 @@ static enum interval_iter ldlm_extent_compat_cb(struct interval_node *n,
         RETURN(INTERVAL_ITER_CONT);
 }
 
+struct ldlm_extent_waiting_args {
+	struct ldlm_lock	*lwa_req;
+	struct list_head	*lwa_work_list;
+	__u64			*lwa_flags;
+	int			*lwa_locks;
+	/* only locks queued before this sequence are checked */
+	__u64			 lwa_seq;
+	int			 lwa_compat;
+};
+
+static inline struct ldlm_lock *ldlm_wait_node_lock(struct interval_node *n)
+{
+	struct ldlm_interval *node;
+
+	node = container_of(n, struct ldlm_interval, li_wait_node);
+	return list_entry(node->li_group.next, struct ldlm_lock, l_sl_policy);
+}
+
+/* Find the first waiting lock which lets a PR request skip the rest of
+ * the queue, see ldlm_extent_compat_queue() */
+static enum interval_iter ldlm_extent_cover_cb(struct interval_node *n,
+					       void *data)
+{
+	struct ldlm_extent_waiting_args *arg = data;
+	struct ldlm_lock *lock = ldlm_wait_node_lock(n);
+	struct ldlm_lock *req = arg->lwa_req;
+
+	if (lock->l_tree_node->li_wait_seq < arg->lwa_seq &&
+	    lockmode_compat(lock->l_req_mode, req->l_req_mode) &&
+	    ldlm_extent_contain(&lock->l_policy_data.l_extent,
+				&req->l_policy_data.l_extent) &&
+	    !ldlm_is_ast_sent(lock))
+		arg->lwa_seq = lock->l_tree_node->li_wait_seq;
+
+	return INTERVAL_ITER_CONT;
+}
+
+static enum interval_iter ldlm_extent_waiting_cb(struct interval_node *n,
+						 void *data)
+{
+	struct ldlm_extent_waiting_args *arg = data;
+	struct ldlm_lock *lock = ldlm_wait_node_lock(n);
+	struct ldlm_lock *req = arg->lwa_req;
+	int check_contention = 1;
+
+	/* locks queued after us don't matter, or we'd wait forever */
+	if (lock->l_tree_node->li_wait_seq >= arg->lwa_seq)
+		return INTERVAL_ITER_CONT;
+
+	/* locks are compatible, overlap doesn't matter */
+	if (lockmode_compat(lock->l_req_mode, req->l_req_mode))
+		return INTERVAL_ITER_CONT;
+
+	/* false contention, the requests doesn't really overlap */
+	if (lock->l_req_extent.end < req->l_req_extent.start ||
+	    lock->l_req_extent.start > req->l_req_extent.end)
+		check_contention = 0;
+
+	if (arg->lwa_work_list == NULL) {
+		arg->lwa_compat = 0;
+		return INTERVAL_ITER_STOP;
+	}
+
+	if (*arg->lwa_flags & LDLM_FL_SPECULATIVE) {
+		arg->lwa_compat = -EWOULDBLOCK;
+		return INTERVAL_ITER_STOP;
+	}
+
+	/* don't count conflicting glimpse locks */
+	if (lock->l_req_mode == LCK_PR &&
+	    lock->l_policy_data.l_extent.start == 0 &&
+	    lock->l_policy_data.l_extent.end == OBD_OBJECT_EOF)
+		check_contention = 0;
+
+	*arg->lwa_locks += check_contention;
+
+	arg->lwa_compat = 0;
+	if (lock->l_blocking_ast)
+		ldlm_add_ast_work_item(lock, arg->lwa_req, arg->lwa_work_list);
+
+	return INTERVAL_ITER_CONT;
+}
+
+/**
+ * Check \a req against the waiting queue through its extent index.
+ *
+ * This gives the same result as walking the waiting queue up to \a req in
+ * ldlm_extent_compat_queue(), but only visits the waiting locks that
+ * overlap \a req. It can't be used for GROUP locks, which are reordered
+ * in the queue.
+ *
+ * \retval 0 if the queue was checked, \a compat is updated
+ * \retval 1 if the check stopped early and \a compat is final
+ * \retval -EWOULDBLOCK if the request must not wait
+ */
+static int ldlm_extent_compat_waiting(struct ldlm_lock *req, __u64 *flags,
+				      struct list_head *work_list,
+				      int *contended_locks, int *compat)
+{
+	struct ldlm_res_ext *ext = req->l_resource->lr_ext;
+	struct ldlm_extent_waiting_args arg = {
+		.lwa_req	= req,
+		.lwa_work_list	= work_list,
+		.lwa_flags	= flags,
+		.lwa_locks	= contended_locks,
+		.lwa_seq	= req->l_tree_node->li_wait_seq ?: ~0ULL,
+		.lwa_compat	= *compat,
+	};
+	struct interval_node_extent ex = {
+		.start	= req->l_req_extent.start,
+		.end	= req->l_req_extent.end,
+	};
+	bool covered = false;
+
+	if (ext->lre_wait_root == NULL)
+		return 0;
+
+	/* If we meet a PR lock just like us or wider, and nobody before it
+	 * conflicts with it, the rest of the queue needn't be checked. */
+	if (req->l_req_mode == LCK_PR) {
+		__u64 seq = arg.lwa_seq;
+
+		interval_search(ext->lre_wait_root, &ex,
+				ldlm_extent_cover_cb, &arg);
+		covered = arg.lwa_seq != seq;
+	}
+
+	interval_search(ext->lre_wait_root, &ex, ldlm_extent_waiting_cb, &arg);
+	if (arg.lwa_compat < 0)
+		return arg.lwa_compat;
+
+	*compat = arg.lwa_compat;
+	if (work_list == NULL && *compat == 0)
+		return 1;
+
+	return covered;
+}
+
 /**
  * Determine if the lock is compatible with all locks on the queue.
  *
@@ -395,6 +647,7 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 	int check_contention;
 	int compat = 1;
 	int scan = 0;
+	int rc;
 	ENTRY;
 
         lockmode_verify(req_mode);
@@ -408,7 +661,7 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
                                                .compat = &compat };
                 struct interval_node_extent ex = { .start = req_start,
                                                    .end = req_end };
-                int idx, rc;
+                int idx;
 
                 for (idx = 0; idx < LCK_MODE_NUM; idx++) {
                         tree = &res->lr_itree[idx];
@@ -476,6 +729,17 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
                                         compat = 0;
                         }
                 }
+	} else if (res->lr_ext != NULL && req_mode != LCK_GROUP &&
+		   res->lr_ext->lre_wait_group == 0) {
+		/* waiting queue, indexed */
+		rc = ldlm_extent_compat_waiting(req, flags, work_list,
+						contended_locks, &compat);
+		if (rc < 0) {
+			compat = rc;
+			goto destroylock;
+		}
+		if (rc > 0)
+			RETURN(compat);
         } else { /* for waiting queue */
 		list_for_each_entry(lock, queue, l_res_link) {
                         check_contention = 1;
@@ -661,7 +925,7 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 
         RETURN(compat);
 destroylock:
-	list_del_init(&req->l_res_link);
+	ldlm_resource_unlink_lock(req);
         ldlm_lock_destroy_nolock(req);
         *err = compat;
         RETURN(compat);
@@ -985,6 +1249,7 @@ void ldlm_interval_free(struct ldlm_interval *node)
         if (node) {
 		LASSERT(list_empty(&node->li_group));
                 LASSERT(!interval_is_intree(&node->li_node));
+		LASSERT(!interval_is_intree(&node->li_wait_node));
                 OBD_SLAB_FREE(node, ldlm_interval_slab, sizeof(*node));
         }
 }
@@ -1025,6 +1290,123 @@ static inline int ldlm_mode_to_index(enum ldlm_mode mode)
 	return index;
 }
 
+/**
+ * Take lr_lock of a server extent resource.
+ *
+ * The time spent spinning on a contended lr_lock is accounted in the
+ * resource statistics, and the time it is held if the namespace asks for
+ * it. An uncontended lock costs no more than spin_lock(). \a mode is the
+ * lockdep subclass, see lock_res_nested().
+ */
+void ldlm_extent_lock_res(struct ldlm_resource *res, enum lock_res_type mode)
+{
+	struct ldlm_res_stats *stats = &res->lr_ext->lre_stats;
+	ktime_t start;
+
+	if (!spin_trylock(&res->lr_lock)) {
+		start = ktime_get();
+		spin_lock_nested(&res->lr_lock, mode);
+		stats->lrs_spin_count++;
+		stats->lrs_spin_ns += ktime_to_ns(ktime_sub(ktime_get(),
+							    start));
+	}
+	stats->lrs_lock_count++;
+
+	if (ldlm_res_to_ns(res)->ns_res_timing)
+		stats->lrs_locked = ktime_get();
+}
+EXPORT_SYMBOL(ldlm_extent_lock_res);
+
+void ldlm_extent_unlock_res(struct ldlm_resource *res)
+{
+	struct ldlm_res_stats *stats = &res->lr_ext->lre_stats;
+	__u64 held;
+
+	if (ktime_to_ns(stats->lrs_locked) != 0) {
+		held = ktime_to_ns(ktime_sub(ktime_get(), stats->lrs_locked));
+		stats->lrs_locked = ktime_set(0, 0);
+		stats->lrs_hold_ns += held;
+		if (held > stats->lrs_hold_max_ns)
+			stats->lrs_hold_max_ns = held;
+	}
+	spin_unlock(&res->lr_lock);
+}
+EXPORT_SYMBOL(ldlm_extent_unlock_res);
+
+/**
+ * Index a lock put on the waiting queue of a server extent resource.
+ *
+ * Waiting locks are ordered by a sequence taken when they join the queue.
+ * A lock only moved in the queue keeps its sequence: the GROUP lock code
+ * moving it doesn't change the order of the other locks, and the index is
+ * not used while GROUP locks are waiting.
+ */
+void ldlm_extent_add_waiting(struct ldlm_resource *res, struct ldlm_lock *lock)
+{
+	struct ldlm_res_ext *ext = res->lr_ext;
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct ldlm_extent *extent = &lock->l_policy_data.l_extent;
+	int rc;
+
+	check_res_locked(res);
+	LASSERT(node != NULL);
+
+	if (node->li_wait_seq != 0)
+		return;
+
+	/* a lock which was never granted owns its node */
+	LASSERT(!interval_is_intree(&node->li_node));
+	LASSERT(list_is_singular(&node->li_group));
+
+	node->li_wait_seq = ++ext->lre_wait_seq;
+	node->li_wait_start = ktime_get();
+
+	if (lock->l_req_mode == LCK_GROUP) {
+		ext->lre_wait_group++;
+		return;
+	}
+
+	rc = interval_set(&node->li_wait_node, extent->start, extent->end);
+	LASSERT(!rc);
+	interval_insert_dup(&node->li_wait_node, &ext->lre_wait_root);
+	ext->lre_wait_count++;
+}
+
+static void ldlm_extent_del_waiting(struct ldlm_lock *lock)
+{
+	struct ldlm_res_ext *ext = lock->l_resource->lr_ext;
+	struct ldlm_interval *node = lock->l_tree_node;
+
+	if (ext == NULL || node == NULL || node->li_wait_seq == 0)
+		return;
+
+	if (interval_is_intree(&node->li_wait_node)) {
+		interval_erase(&node->li_wait_node, &ext->lre_wait_root);
+		ext->lre_wait_count--;
+	} else {
+		ext->lre_wait_group--;
+	}
+	node->li_wait_seq = 0;
+}
+
+static void ldlm_extent_grant_stats(struct ldlm_resource *res,
+				    struct ldlm_interval *node)
+{
+	struct ldlm_res_stats *stats = &res->lr_ext->lre_stats;
+	__u64 waited;
+
+	stats->lrs_granted++;
+	if (ktime_to_ns(node->li_wait_start) == 0)
+		return;
+
+	waited = ktime_to_ns(ktime_sub(ktime_get(), node->li_wait_start));
+	node->li_wait_start = ktime_set(0, 0);
+	stats->lrs_waited++;
+	stats->lrs_wait_ns += waited;
+	if (waited > stats->lrs_wait_max_ns)
+		stats->lrs_wait_max_ns = waited;
+}
+
 /** Add newly granted lock into interval tree for the resource. */
 void ldlm_extent_add_lock(struct ldlm_resource *res,
                           struct ldlm_lock *lock)
@@ -1040,6 +1422,9 @@ void ldlm_extent_add_lock(struct ldlm_resource *res,
         LASSERT(node != NULL);
         LASSERT(!interval_is_intree(&node->li_node));
 
+	if (res->lr_ext != NULL)
+		ldlm_extent_grant_stats(res, node);
+
 	idx = ldlm_mode_to_index(lock->l_granted_mode);
 	LASSERT(lock->l_granted_mode == 1 << idx);
 	LASSERT(lock->l_granted_mode == res->lr_itree[idx].lit_mode);
@@ -1093,6 +1478,8 @@ void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
 	struct ldlm_interval_tree *tree;
 	int idx;
 
+	ldlm_extent_del_waiting(lock);
+
 	if (!node || !interval_is_intree(&node->li_node)) /* duplicate unlink */
 		return;
 
@@ -425,6 +425,12 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	cli->cl_cksum_type = cli->cl_supp_cksum_types;
 #endif
 	atomic_set(&cli->cl_resends, OSC_DEFAULT_RESENDS);
+	/* bulk compression is enabled per OSC via compress_type */
+	cli->cl_compress_type = OBD_COMPRESS_NONE;
+	atomic_long_set(&cli->cl_compress_rpcs, 0);
+	atomic_long_set(&cli->cl_compress_skipped, 0);
+	atomic_long_set(&cli->cl_compress_bytes_in, 0);
+	atomic_long_set(&cli->cl_compress_bytes_out, 0);
 
 	/*
 	 * Set it to possible maximum size. It may be reduced by ocd_brw_size
@@ -433,6 +439,7 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	cli->cl_max_pages_per_rpc = PTLRPC_MAX_BRW_PAGES;
 
 	cli->cl_max_short_io_bytes = OBD_MAX_SHORT_IO_BYTES;
+	cli->cl_max_objs_per_rpc = OST_MAX_BRW_OBJS;
 
 	/*
 	 * set cl_chunkbits default value to PAGE_SHIFT,
@@ -3335,6 +3342,7 @@ int target_bulk_io(struct obd_export *exp, struct ptlrpc_bulk_desc *desc,
 		else /* old version, bulk matchbits is rq_xid */
 			req->rq_mbits = req->rq_xid;
 
+		ptlrpc_trace_stamp(req, RPC_TRACE_BULK_START);
 		if (rc == 0)
 			rc = ptlrpc_start_bulk_transfer(desc);
 	}
@@ -3378,6 +3386,7 @@ int target_bulk_io(struct obd_export *exp, struct ptlrpc_bulk_desc *desc,
 			deadline = rq_deadline;
 	} while (rc == -ETIMEDOUT &&
 		 deadline > ktime_get_real_seconds());
+	ptlrpc_trace_stamp(req, RPC_TRACE_BULK_END);
 
 	if (rc == -ETIMEDOUT) {
 		DEBUG_REQ(D_ERROR, req, "timeout on bulk %s after %lld%+llds",
@@ -1350,8 +1350,14 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns,
 				     dlm_req->lock_desc.l_resource.lr_type,
 				     &dlm_req->lock_desc.l_policy_data,
 				     &lock->l_policy_data);
-	if (dlm_req->lock_desc.l_resource.lr_type == LDLM_EXTENT)
+	if (dlm_req->lock_desc.l_resource.lr_type == LDLM_EXTENT) {
+		char *jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+
 		lock->l_req_extent = lock->l_policy_data.l_extent;
+		if (jobid != NULL)
+			lock->l_req_jobid = cfs_hash_djb2_hash(jobid,
+					strnlen(jobid, LUSTRE_JOBID_SIZE), ~0U);
+	}
 
 existing_lock:
 	if (flags & LDLM_FL_HAS_INTENT) {
@@ -3349,6 +3355,12 @@ int ldlm_init(void)
 					0, 0, NULL);
 	if (ldlm_glimpse_work_kmem == NULL)
 		goto out_interval_tree;
+
+	ldlm_res_ext_slab = kmem_cache_create("ldlm_res_ext",
+					      sizeof(struct ldlm_res_ext),
+					      0, SLAB_HWCACHE_ALIGN, NULL);
+	if (ldlm_res_ext_slab == NULL)
+		goto out_glimpse_work;
 #endif
 
 #if LUSTRE_TRACKS_LOCK_EXP_REFS
@@ -3356,6 +3368,8 @@ int ldlm_init(void)
 #endif
 	return 0;
 #ifdef HAVE_SERVER_SUPPORT
+out_glimpse_work:
+	kmem_cache_destroy(ldlm_glimpse_work_kmem);
 out_interval_tree:
 	kmem_cache_destroy(ldlm_interval_tree_slab);
 #endif
@@ -3385,5 +3399,6 @@ void ldlm_exit(void)
 	kmem_cache_destroy(ldlm_interval_tree_slab);
 #ifdef HAVE_SERVER_SUPPORT
 	kmem_cache_destroy(ldlm_glimpse_work_kmem);
+	kmem_cache_destroy(ldlm_res_ext_slab);
 #endif
 }
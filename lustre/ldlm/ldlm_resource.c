@@ -43,6 +43,7 @@
 
 struct kmem_cache *ldlm_resource_slab, *ldlm_lock_slab;
 struct kmem_cache *ldlm_interval_tree_slab;
+struct kmem_cache *ldlm_res_ext_slab;
 
 int ldlm_srv_namespace_nr = 0;
 int ldlm_cli_namespace_nr = 0;
@@ -663,6 +664,62 @@ static ssize_t max_parallel_ast_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(max_parallel_ast);
 
+static ssize_t resource_timing_show(struct kobject *kobj,
+				    struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%u\n", ns->ns_res_timing);
+}
+
+static ssize_t resource_timing_store(struct kobject *kobj,
+				     struct attribute *attr,
+				     const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	ns->ns_res_timing = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(resource_timing);
+
+static ssize_t stride_locks_show(struct kobject *kobj,
+				 struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%u\n", ns->ns_stride_locks);
+}
+
+static ssize_t stride_locks_store(struct kobject *kobj,
+				  struct attribute *attr,
+				  const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	ns->ns_stride_locks = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(stride_locks);
+
 #endif /* HAVE_SERVER_SUPPORT */
 
 /* These are for namespaces in /sys/fs/lustre/ldlm/namespaces/ */
@@ -681,6 +738,8 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_contention_seconds.attr,
 	&lustre_attr_contended_locks.attr,
 	&lustre_attr_max_parallel_ast.attr,
+	&lustre_attr_resource_timing.attr,
+	&lustre_attr_stride_locks.attr,
 #endif
 	NULL,
 };
@@ -737,6 +796,67 @@ int ldlm_namespace_sysfs_register(struct ldlm_namespace *ns)
 	return err;
 }
 
+#ifdef HAVE_SERVER_SUPPORT
+static int ldlm_res_stats_seq_hash(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+				   struct hlist_node *hnode, void *arg)
+{
+	struct ldlm_resource *res = cfs_hash_object(hs, hnode);
+	struct seq_file *m = arg;
+	struct ldlm_res_stats stats;
+	int granted = 0;
+	int waiting;
+	int idx;
+
+	if (res->lr_ext == NULL)
+		return 0;
+
+	lock_res(res);
+	stats = res->lr_ext->lre_stats;
+	for (idx = 0; idx < LCK_MODE_NUM; idx++)
+		granted += res->lr_itree[idx].lit_size;
+	waiting = res->lr_ext->lre_wait_count + res->lr_ext->lre_wait_group;
+	unlock_res(res);
+
+	/* only the resources which saw some contention */
+	if (stats.lrs_waited == 0 && stats.lrs_spin_count == 0)
+		return 0;
+
+	seq_printf(m, "- resource: "DLDLMRES"\n"
+		   "  granted_locks: %d\n"
+		   "  waiting_locks: %d\n"
+		   "  lock_grants: %llu\n"
+		   "  lock_waits: %llu\n"
+		   "  lock_wait_us: { total: %llu, max: %llu }\n"
+		   "  lr_lock_count: %llu\n"
+		   "  lr_lock_spins: %llu\n"
+		   "  lr_lock_spin_us: %llu\n"
+		   "  lr_lock_hold_us: { total: %llu, max: %llu }\n"
+		   "  stride_grants: %llu\n",
+		   PLDLMRES(res), granted, waiting,
+		   stats.lrs_granted, stats.lrs_waited,
+		   div_u64(stats.lrs_wait_ns, NSEC_PER_USEC),
+		   div_u64(stats.lrs_wait_max_ns, NSEC_PER_USEC),
+		   stats.lrs_lock_count, stats.lrs_spin_count,
+		   div_u64(stats.lrs_spin_ns, NSEC_PER_USEC),
+		   div_u64(stats.lrs_hold_ns, NSEC_PER_USEC),
+		   div_u64(stats.lrs_hold_max_ns, NSEC_PER_USEC),
+		   stats.lrs_stride_grants);
+
+	return 0;
+}
+
+/* Lock statistics of the contended extent resources of a namespace */
+static int ldlm_res_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct ldlm_namespace *ns = m->private;
+
+	cfs_hash_for_each_nolock(ns->ns_rs_hash, ldlm_res_stats_seq_hash,
+				 m, 0);
+	return 0;
+}
+LDEBUGFS_SEQ_FOPS_RO(ldlm_res_stats);
+#endif /* HAVE_SERVER_SUPPORT */
+
 static int ldlm_namespace_debugfs_register(struct ldlm_namespace *ns)
 {
 	struct dentry *ns_entry;
@@ -751,6 +871,16 @@ static int ldlm_namespace_debugfs_register(struct ldlm_namespace *ns)
 		ns->ns_debugfs_entry = ns_entry;
 	}
 
+#ifdef HAVE_SERVER_SUPPORT
+	if (ns_is_server(ns)) {
+		struct lprocfs_vars res_vars[2];
+
+		memset(res_vars, 0, sizeof(res_vars));
+		ldlm_add_var(&res_vars[0], ns_entry, "resource_stats", ns,
+			     &ldlm_res_stats_fops);
+	}
+#endif
+
 	return 0;
 }
 #undef MAX_STRING_SIZE
@@ -984,6 +1114,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_max_nolock_size    = NS_DEFAULT_MAX_NOLOCK_BYTES;
 	ns->ns_contention_time    = NS_DEFAULT_CONTENTION_SECONDS;
 	ns->ns_contended_locks    = NS_DEFAULT_CONTENDED_LOCKS;
+	ns->ns_stride_locks       = NS_DEFAULT_STRIDE_LOCKS;
 
 	ns->ns_max_parallel_ast   = LDLM_DEFAULT_PARALLEL_AST_LIMIT;
 	ns->ns_nr_unused          = 0;
@@ -1401,8 +1532,22 @@ struct ldlm_namespace *ldlm_namespace_first_locked(enum ldlm_side client)
 			    struct ldlm_namespace, ns_list_chain);
 }
 
+static void ldlm_resource_free(struct ldlm_resource *res)
+{
+	if (res->lr_itree != NULL)
+		OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
+			      sizeof(*res->lr_itree) * LCK_MODE_NUM);
+	if (res->lr_ext != NULL) {
+		if (res->lr_ext->lre_stride != NULL)
+			OBD_FREE_PTR(res->lr_ext->lre_stride);
+		OBD_SLAB_FREE_PTR(res->lr_ext, ldlm_res_ext_slab);
+	}
+	OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+}
+
 /** Create and initialize new resource. */
-static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
+static struct ldlm_resource *ldlm_resource_new(struct ldlm_namespace *ns,
+					       enum ldlm_type ldlm_type)
 {
 	struct ldlm_resource *res;
 	int idx;
@@ -1424,6 +1569,17 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 			res->lr_itree[idx].lit_mode = 1 << idx;
 			res->lr_itree[idx].lit_root = NULL;
 		}
+#ifdef HAVE_SERVER_SUPPORT
+		/* Only the server checks conflicts with the waiting queue */
+		if (ns_is_server(ns)) {
+			OBD_SLAB_ALLOC_PTR_GFP(res->lr_ext, ldlm_res_ext_slab,
+					       GFP_NOFS);
+			if (res->lr_ext == NULL) {
+				ldlm_resource_free(res);
+				return NULL;
+			}
+		}
+#endif
 	}
 
 	INIT_LIST_HEAD(&res->lr_granted);
@@ -1478,7 +1634,7 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 
 	LASSERTF(type >= LDLM_MIN_TYPE && type < LDLM_MAX_TYPE,
 		 "type: %d\n", type);
-	res = ldlm_resource_new(type);
+	res = ldlm_resource_new(ns, type);
 	if (res == NULL)
 		return ERR_PTR(-ENOMEM);
 
@@ -1495,10 +1651,7 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
 		/* Clean lu_ref for failed resource. */
 		lu_ref_fini(&res->lr_reference);
-		if (res->lr_itree != NULL)
-			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
 found:
 		res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
 		return res;
@@ -1574,10 +1727,7 @@ int ldlm_resource_putref(struct ldlm_resource *res)
 		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
 		if (ns->ns_lvbo && ns->ns_lvbo->lvbo_free)
 			ns->ns_lvbo->lvbo_free(res);
-		if (res->lr_itree != NULL)
-			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+		ldlm_resource_free(res);
 		return 1;
 	}
 	return 0;
@@ -1602,6 +1752,9 @@ void ldlm_resource_add_lock(struct ldlm_resource *res, struct list_head *head,
 	LASSERT(list_empty(&lock->l_res_link));
 
 	list_add_tail(&lock->l_res_link, head);
+
+	if (res->lr_ext != NULL && head == &res->lr_waiting)
+		ldlm_extent_add_waiting(res, lock);
 }
 
 /**
@@ -1627,6 +1780,10 @@ void ldlm_resource_insert_lock_after(struct ldlm_lock *original,
 	LASSERT(list_empty(&new->l_res_link));
 
 	list_add(&new->l_res_link, &original->l_res_link);
+
+	/* only used to order the waiting queue */
+	if (res->lr_ext != NULL)
+		ldlm_extent_add_waiting(res, new);
  out:;
 }
 
@@ -1745,5 +1902,19 @@ void ldlm_resource_dump(int level, struct ldlm_resource *res)
 		list_for_each_entry(lock, &res->lr_waiting, l_res_link)
 			LDLM_DEBUG_LIMIT(level, lock, "###");
 	}
+
+	if (res->lr_ext != NULL) {
+		struct ldlm_res_stats *stats = &res->lr_ext->lre_stats;
+
+		CDEBUG(level, "Lock stats: grants %llu waits %llu wait %llu/%lluus lr_lock %llu spins %llu spin %lluus hold %llu/%lluus stride grants %llu\n",
+		       stats->lrs_granted, stats->lrs_waited,
+		       div_u64(stats->lrs_wait_ns, NSEC_PER_USEC),
+		       div_u64(stats->lrs_wait_max_ns, NSEC_PER_USEC),
+		       stats->lrs_lock_count, stats->lrs_spin_count,
+		       div_u64(stats->lrs_spin_ns, NSEC_PER_USEC),
+		       div_u64(stats->lrs_hold_ns, NSEC_PER_USEC),
+		       div_u64(stats->lrs_hold_max_ns, NSEC_PER_USEC),
+		       stats->lrs_stride_grants);
+	}
 }
 EXPORT_SYMBOL(ldlm_resource_dump);
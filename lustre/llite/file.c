@@ -1397,7 +1397,8 @@ void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot,
 #ifdef HAVE_GENERIC_WRITE_SYNC_2ARGS
 		io->u.ci_wr.wr_sync  |= !!(args &&
 					   args->via_io_subtype == IO_NORMAL &&
-					   args->u.normal.via_iocb->ki_flags & IOCB_DSYNC);
+					   args->u.normal.via_iocb->ki_flags &
+					   (IOCB_DSYNC | IOCB_DIRECT));
 #endif
 	}
 
@@ -1450,6 +1451,75 @@ static void ll_heat_add(struct inode *inode, enum cl_io_type iot,
 	spin_unlock(&lli->lli_heat_lock);
 }
 
+/* synced direct IO must be on disk before generic_write_sync() is called */
+static bool ll_dio_sync_required(struct kiocb *iocb)
+{
+	struct file *file = iocb->ki_filp;
+
+	if (file->f_flags & O_DSYNC || IS_SYNC(file_inode(file)))
+		return true;
+#ifdef HAVE_GENERIC_WRITE_SYNC_2ARGS
+	if (iocb->ki_flags & IOCB_DSYNC)
+		return true;
+#endif
+	return false;
+}
+
+/*
+ * Large buffered IO is switched to direct IO to save the copy through the page
+ * cache, as long as it can't conflict with any cached page of the file.
+ * Returns true if IOCB_DIRECT was set, ll_hybrid_io_end() has to clear it.
+ */
+static bool ll_hybrid_io_start(struct file *file, enum cl_io_type iot,
+			       struct vvp_io_args *args, loff_t pos,
+			       size_t count)
+{
+#ifdef IOCB_DIRECT
+	struct inode *inode = file_inode(file);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_file_data *fd = LUSTRE_FPRIVATE(file);
+	struct kiocb *iocb;
+	unsigned long threshold;
+
+	if (args->via_io_subtype != IO_NORMAL || file->f_flags & O_DIRECT ||
+	    fd->fd_designated_mirror > 0)
+		return false;
+
+	if (iot == CIT_READ)
+		threshold = sbi->ll_hybrid_read_threshold;
+	else if (iot == CIT_WRITE)
+		threshold = sbi->ll_hybrid_write_threshold;
+	else
+		return false;
+	if (threshold == 0 || count < threshold)
+		return false;
+
+	/* IOCB_DIRECT has to be cleared before an AIO could complete */
+	iocb = args->u.normal.via_iocb;
+	if (!is_sync_kiocb(iocb))
+		return false;
+
+	/* only page aligned IO is sent zero-copy */
+	if ((pos | iov_iter_alignment(args->u.normal.via_iter)) & ~PAGE_MASK)
+		return false;
+
+	if (inode->i_mapping->nrpages != 0)
+		return false;
+
+	iocb->ki_flags |= IOCB_DIRECT;
+	return true;
+#else
+	return false;
+#endif
+}
+
+static void ll_hybrid_io_end(struct vvp_io_args *args)
+{
+#ifdef IOCB_DIRECT
+	args->u.normal.via_iocb->ki_flags &= ~IOCB_DIRECT;
+#endif
+}
+
 static ssize_t
 ll_file_io_generic(const struct lu_env *env, struct vvp_io_args *args,
 		   struct file *file, enum cl_io_type iot,
@@ -1461,21 +1531,49 @@ ll_file_io_generic(const struct lu_env *env, struct vvp_io_args *args,
 	struct ll_file_data	*fd  = LUSTRE_FPRIVATE(file);
 	struct range_lock	range;
 	struct cl_io		*io;
+	struct cl_dio_aio	*aio = NULL;
 	ssize_t			result = 0;
 	int			rc = 0;
 	unsigned		retried = 0;
 	bool			restarted = false;
+	bool			hybrid;
+	bool			dio;
 
 	ENTRY;
 
-	CDEBUG(D_VFSTRACE, "%s: %s ppos: %llu, count: %zu\n",
+	hybrid = ll_hybrid_io_start(file, iot, args, *ppos, count);
+	dio = file->f_flags & O_DIRECT || hybrid;
+
+	CDEBUG(D_VFSTRACE, "%s: %s ppos: %llu, count: %zu%s\n",
 		file_dentry(file)->d_name.name,
-		iot == CIT_READ ? "read" : "write", *ppos, count);
+		iot == CIT_READ ? "read" : "write", *ppos, count,
+		hybrid ? ", switched to direct IO" : "");
+
+	/* Submit all direct IO segments before waiting for any of them, so
+	 * that all stripes are written or read in parallel. If allocation
+	 * fails, every segment is simply waited for in ll_direct_IO().
+	 *
+	 * The range lock must be held until the transfer is done, so only a
+	 * group locked file, which takes no range lock, completes an AIO
+	 * kiocb from the last page. Any other kiocb is waited for here. */
+	if (dio && args->via_io_subtype == IO_NORMAL &&
+	    ll_sbi_has_parallel_dio(ll_i2sbi(inode)) &&
+	    !ll_dio_sync_required(args->u.normal.via_iocb)) {
+		struct kiocb *iocb = args->u.normal.via_iocb;
+
+		if (is_sync_kiocb(iocb) ||
+		    !(fd->fd_flags & LL_FILE_GROUP_LOCKED))
+			iocb = NULL;
+		aio = cl_aio_alloc(iocb);
+		if (aio != NULL)
+			aio->cda_read = iot == CIT_READ;
+	}
 
 restart:
 	io = vvp_env_thread_io(env);
 	ll_io_init(io, file, iot, args);
 	io->ci_ndelay_tried = retried;
+	io->ci_aio = aio;
 
 	if (cl_io_rw_init(env, io, iot, *ppos, count) == 0) {
 		bool range_locked = false;
@@ -1496,7 +1594,7 @@ restart:
 			 * or multiple reads will try to work on the same pages
 			 * See LU-6227 for details. */
 			if (((iot == CIT_WRITE) ||
-			    (iot == CIT_READ && (file->f_flags & O_DIRECT))) &&
+			    (iot == CIT_READ && dio)) &&
 			    !(vio->vui_fd->fd_flags & LL_FILE_GROUP_LOCKED)) {
 				CDEBUG(D_VFSTRACE, "Range lock "RL_FMT"\n",
 				       RL_PARA(&range));
@@ -1520,6 +1618,22 @@ restart:
 		rc = cl_io_loop(env, io);
 		ll_cl_remove(file, env);
 
+		/* wait for direct IO while range lock is still held */
+		if (aio != NULL && aio->cda_iocb == NULL) {
+			int rc2;
+
+			rc2 = cl_sync_io_wait_recycle(env, &aio->cda_sync, 0,
+						      0);
+			if (rc2 < 0 && rc == 0)
+				rc = rc2;
+			/* the pages submitted in this round may not have been
+			 * transferred, unlike the bounced parts of the IO */
+			if (rc2 < 0)
+				io->ci_nob -= min_t(size_t, io->ci_nob,
+						    aio->cda_submitted);
+			aio->cda_submitted = 0;
+		}
+
 		if (range_locked) {
 			CDEBUG(D_VFSTRACE, "Range unlock "RL_FMT"\n",
 			       RL_PARA(&range));
@@ -1579,10 +1693,36 @@ out:
 		}
 	}
 
+	if (hybrid) {
+		ll_hybrid_io_end(args);
+		if (result > 0)
+			ll_stats_ops_tally(ll_i2sbi(inode), iot == CIT_READ ?
+					   LPROC_LL_HYBRID_READ_BYTES :
+					   LPROC_LL_HYBRID_WRITE_BYTES,
+					   result);
+	}
+
 	CDEBUG(D_VFSTRACE, "iot: %d, result: %zd\n", iot, result);
 	if (result > 0)
 		ll_heat_add(inode, iot, result);
 
+	if (aio != NULL) {
+		if (aio->cda_iocb == NULL) {
+			/* all pages were released by last wait */
+			cl_aio_free(aio);
+		} else {
+			/* The iocb is completed by the last page of the IO,
+			 * unless nothing was submitted at all. Can't access
+			 * aio after the reference is dropped. */
+			aio->cda_bytes = result;
+			if (result <= 0)
+				aio->cda_no_aio_complete = 1;
+			cl_sync_io_note(env, &aio->cda_sync, 0);
+			if (result > 0)
+				RETURN(-EIOCBQUEUED);
+		}
+	}
+
 	RETURN(result > 0 ? result : rc);
 }
 
@@ -1681,7 +1821,7 @@ static ssize_t ll_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	if (cached)
 		return result;
 
-	ll_ras_enter(iocb->ki_filp);
+	ll_ras_enter(iocb->ki_filp, iocb->ki_pos, iov_iter_count(to));
 
 	result = ll_do_fast_read(iocb, to);
 	if (result < 0 || iov_iter_count(to) == 0)
@@ -1999,7 +2139,7 @@ static ssize_t ll_file_splice_read(struct file *in_file, loff_t *ppos,
 	if (cached)
 		RETURN(result);
 
-	ll_ras_enter(in_file);
+	ll_ras_enter(in_file, *ppos, count);
 
 	env = cl_env_get(&refcheck);
         if (IS_ERR(env))
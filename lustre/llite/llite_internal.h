@@ -240,6 +240,13 @@ struct ll_inode_info {
 	struct rw_semaphore		lli_xattrs_list_rwsem;
 	struct mutex			lli_xattrs_enq_lock;
 	struct list_head		lli_xattrs; /* ll_xattr_entry->xe_list */
+	/* ll_xattr_entry->xe_hash, 1 << lli_xattrs_hash_bits buckets */
+	struct hlist_head	       *lli_xattrs_hash;
+	unsigned int			lli_xattrs_hash_bits;
+	/* memory used by the cached xattrs, accounted to the superblock */
+	unsigned int			lli_xattrs_bytes;
+	/* on ll_sb_info::ll_xattr_lru while the xattr cache is valid */
+	struct list_head		lli_xattrs_lru;
 };
 
 static inline __u32 ll_layout_version_get(struct ll_inode_info *lli)
@@ -269,6 +276,8 @@ enum ll_file_flags {
 	LLIF_XATTR_CACHE	= 2,
 	/* Project inherit */
 	LLIF_PROJECT_INHERIT	= 3,
+	/* Xattr cache was used since the LRU last looked at it */
+	LLIF_XATTR_REFERENCED	= 4,
 };
 
 static inline void ll_file_set_flag(struct ll_inode_info *lli,
@@ -374,6 +383,8 @@ enum ra_stat {
 	RA_STAT_FAILED_REACH_END,
 	RA_STAT_ASYNC,
 	RA_STAT_FAILED_FAST_READ,
+	RA_STAT_STREAM_SWITCH,
+	RA_STAT_REVERSE,
 	_NR_RA_STAT,
 };
 
@@ -481,6 +492,8 @@ enum stats_track_type {
 					 2.10, abandoned */
 #define LL_SBI_TINY_WRITE   0x2000000 /* tiny write support */
 #define LL_SBI_FILE_HEAT    0x4000000 /* file heat support */
+#define LL_SBI_PARALLEL_DIO 0x8000000 /* parallel (async) submission of DIO */
+#define LL_SBI_UNALIGNED_DIO 0x10000000 /* bounce unaligned DIO */
 #define LL_SBI_FLAGS { 	\
 	"nolck",	\
 	"checksum",	\
@@ -509,6 +522,8 @@ enum stats_track_type {
 	"pio",		\
 	"tiny_write",	\
 	"file_heat",	\
+	"parallel_dio",	\
+	"unaligned_dio",\
 }
 
 /* This is embedded into llite super-blocks to keep track of connect
@@ -578,6 +593,8 @@ struct ll_sb_info {
 	unsigned int		  ll_sa_running_max;/* max concurrent
 						     * statahead instances */
 	unsigned int		  ll_sa_max;     /* max statahead RPCs */
+	unsigned int		  ll_sa_batch_max;/* max statahead RPCs sent
+						   * in one batch */
 	atomic_t		  ll_sa_total;   /* statahead thread started
 						  * count */
 	atomic_t		  ll_sa_wrong;   /* statahead thread stopped for
@@ -585,6 +602,9 @@ struct ll_sb_info {
 	atomic_t		  ll_sa_running; /* running statahead thread
 						  * count */
 	atomic_t		  ll_agl_total;  /* AGL thread started count */
+	atomic_t		  ll_sa_batch_total; /* statahead batches sent */
+	atomic64_t		  ll_sa_batch_rpcs;  /* statahead RPCs sent in
+						      * batches */
 
 	dev_t			  ll_sdev_orig; /* save s_dev before assign for
 						 * clustred nfs */
@@ -605,6 +625,18 @@ struct ll_sb_info {
 	unsigned int		  ll_heat_decay_weight;
 	unsigned int		  ll_heat_period_second;
 
+	/* buffered IO of at least this many bytes is done as direct IO,
+	 * 0 disables it */
+	unsigned long		  ll_hybrid_read_threshold;
+	unsigned long		  ll_hybrid_write_threshold;
+
+	/* inodes with a valid xattr cache, oldest first */
+	spinlock_t		  ll_xattr_lru_lock;
+	struct list_head	  ll_xattr_lru;
+	/* memory used by all xattr caches, and its limit (0 = no limit) */
+	atomic_long_t		  ll_xattr_cache_bytes;
+	unsigned long		  ll_xattr_cache_max_bytes;
+
 	/* filesystem fsname */
 	char			  ll_fsname[LUSTRE_MAXFSNAME + 1];
 
@@ -612,11 +644,30 @@ struct ll_sb_info {
 	struct pcc_super	  ll_pcc_super;
 };
 
+#define SBI_DEFAULT_XATTR_CACHE_MAX_MB	64
 #define SBI_DEFAULT_HEAT_DECAY_WEIGHT	((80 * 256 + 50) / 100)
 #define SBI_DEFAULT_HEAT_PERIOD_SECOND	(60)
 /*
  * per file-descriptor read-ahead data.
  */
+/* number of other sequential streams remembered per open file */
+#define LL_RA_STREAMS	4
+
+/*
+ * Read-ahead window of a sequential stream which was interleaved with the
+ * current one, see ras_stream_switch().
+ */
+struct ll_ra_stream {
+	unsigned long	rst_last_readpage;
+	unsigned long	rst_consecutive_pages;
+	unsigned long	rst_consecutive_requests;
+	unsigned long	rst_window_start;
+	unsigned long	rst_window_len;
+	unsigned long	rst_next_readahead;
+	/* ->ras_requests when the stream was saved, 0 if the slot is unused */
+	unsigned long	rst_requests;
+};
+
 struct ll_readahead_state {
 	spinlock_t  ras_lock;
         /*
@@ -699,6 +750,17 @@ struct ll_readahead_state {
         unsigned long   ras_consecutive_stride_requests;
 	/* index of the last page that async readahead starts */
 	unsigned long	ras_async_last_readpage;
+	/*
+	 * Reverse read detection: first page of the previous read request,
+	 * and the number of consecutive requests which ended just before the
+	 * previous one started. ras_reverse_low is the lowest page which
+	 * was already read ahead backwards.
+	 */
+	unsigned long	ras_prev_request_start;
+	unsigned long	ras_reverse_requests;
+	unsigned long	ras_reverse_low;
+	/* other sequential streams interleaved on this file descriptor */
+	struct ll_ra_stream ras_streams[LL_RA_STREAMS];
 };
 
 struct ll_readahead_work {
@@ -791,7 +853,17 @@ static inline bool ll_sbi_has_file_heat(struct ll_sb_info *sbi)
 	return !!(sbi->ll_flags & LL_SBI_FILE_HEAT);
 }
 
-void ll_ras_enter(struct file *f);
+static inline bool ll_sbi_has_parallel_dio(struct ll_sb_info *sbi)
+{
+	return !!(sbi->ll_flags & LL_SBI_PARALLEL_DIO);
+}
+
+static inline bool ll_sbi_has_unaligned_dio(struct ll_sb_info *sbi)
+{
+	return !!(sbi->ll_flags & LL_SBI_UNALIGNED_DIO);
+}
+
+void ll_ras_enter(struct file *f, loff_t pos, size_t count);
 
 /* llite/lcommon_misc.c */
 int cl_ocd_update(struct obd_device *host, struct obd_device *watched,
@@ -808,6 +880,8 @@ void ll_stats_ops_tally(struct ll_sb_info *sbi, int op, int count);
 enum {
 	LPROC_LL_READ_BYTES,
 	LPROC_LL_WRITE_BYTES,
+	LPROC_LL_HYBRID_READ_BYTES,
+	LPROC_LL_HYBRID_WRITE_BYTES,
 	LPROC_LL_IOCTL,
 	LPROC_LL_OPEN,
 	LPROC_LL_RELEASE,
@@ -834,6 +908,9 @@ enum {
 	LPROC_LL_SETXATTR,
 	LPROC_LL_GETXATTR,
 	LPROC_LL_GETXATTR_HITS,
+	LPROC_LL_GETXATTR_MISSES,
+	LPROC_LL_GETXATTR_NEGATIVE,
+	LPROC_LL_XATTR_CACHE_EVICT,
 	LPROC_LL_LISTXATTR,
 	LPROC_LL_REMOVEXATTR,
 	LPROC_LL_INODE_PERM,
@@ -896,6 +973,9 @@ struct ll_cl_context *ll_cl_find(struct file *file);
 
 extern const struct address_space_operations ll_aops;
 
+/* llite/rw26.c */
+void ll_dio_bounce_fini(void);
+
 /* llite/file.c */
 extern struct file_operations ll_file_operations;
 extern struct file_operations ll_file_operations_flock;
@@ -1232,6 +1312,11 @@ void ll_ra_stats_inc(struct inode *inode, enum ra_stat which);
 #define LL_SA_RPC_DEF           32
 #define LL_SA_RPC_MAX           512
 
+/* statahead RPCs collected before they are handed to ptlrpcd together,
+ * 0 or 1 sends each RPC as soon as it is prepared. ptlrpcd packs up to
+ * PTLRPC_BATCH_MAX_REQS of them into one OBD_BATCH_RPC to the MDT */
+#define LL_SA_BATCH_DEF		PTLRPC_BATCH_MAX_REQS
+
 /* XXX: If want to support more concurrent statahead instances,
  *	please consider to decentralize the RPC lists attached
  *	on related import, such as imp_{sending,delayed}_list.
@@ -1273,6 +1358,8 @@ struct ll_statahead_info {
 						 * hidden entries */
 				sai_agl_valid:1,/* AGL is valid for the dir */
 				sai_in_readpage:1;/* statahead is in readdir()*/
+	struct ptlrpc_request_set *sai_batch_set; /* async stat RPCs which
+						   * are not sent yet */
 	wait_queue_head_t	sai_waitq;	/* stat-ahead wait queue */
 	struct ptlrpc_thread	sai_thread;	/* stat-ahead thread */
 	struct ptlrpc_thread	sai_agl_thread;	/* AGL thread */
@@ -1490,6 +1577,7 @@ int ll_layout_write_intent(struct inode *inode, enum layout_intent_opc opc,
 
 int ll_xattr_init(void);
 void ll_xattr_fini(void);
+void ll_xattr_cache_shrink(struct ll_sb_info *sbi, bool all);
 
 int ll_page_sync_io(const struct lu_env *env, struct cl_io *io,
 		    struct cl_page *page, enum cl_req_type crt);
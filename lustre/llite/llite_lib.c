@@ -143,13 +143,18 @@ static struct ll_sb_info *ll_init_sbi(void)
 	/* metadata statahead is enabled by default */
 	sbi->ll_sa_running_max = LL_SA_RUNNING_DEF;
 	sbi->ll_sa_max = LL_SA_RPC_DEF;
+	sbi->ll_sa_batch_max = LL_SA_BATCH_DEF;
 	atomic_set(&sbi->ll_sa_total, 0);
 	atomic_set(&sbi->ll_sa_wrong, 0);
 	atomic_set(&sbi->ll_sa_running, 0);
 	atomic_set(&sbi->ll_agl_total, 0);
+	atomic_set(&sbi->ll_sa_batch_total, 0);
+	atomic64_set(&sbi->ll_sa_batch_rpcs, 0);
 	sbi->ll_flags |= LL_SBI_AGL_ENABLED;
 	sbi->ll_flags |= LL_SBI_FAST_READ;
 	sbi->ll_flags |= LL_SBI_TINY_WRITE;
+	sbi->ll_flags |= LL_SBI_PARALLEL_DIO;
+	sbi->ll_flags |= LL_SBI_UNALIGNED_DIO;
 
 	/* root squash */
 	sbi->ll_squash.rsi_uid = 0;
@@ -160,6 +165,12 @@ static struct ll_sb_info *ll_init_sbi(void)
 	/* Per-filesystem file heat */
 	sbi->ll_heat_decay_weight = SBI_DEFAULT_HEAT_DECAY_WEIGHT;
 	sbi->ll_heat_period_second = SBI_DEFAULT_HEAT_PERIOD_SECOND;
+
+	/* Per-filesystem xattr cache limit */
+	spin_lock_init(&sbi->ll_xattr_lru_lock);
+	INIT_LIST_HEAD(&sbi->ll_xattr_lru);
+	atomic_long_set(&sbi->ll_xattr_cache_bytes, 0);
+	sbi->ll_xattr_cache_max_bytes = SBI_DEFAULT_XATTR_CACHE_MAX_MB << 20;
 	RETURN(sbi);
 out_destroy_ra:
 	destroy_workqueue(sbi->ll_ra_info.ll_readahead_wq);
@@ -257,7 +268,8 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 				   OBD_CONNECT2_ARCHIVE_ID_ARRAY |
 				   OBD_CONNECT2_LSOM |
 				   OBD_CONNECT2_ASYNC_DISCARD |
-				   OBD_CONNECT2_PCC;
+				   OBD_CONNECT2_PCC |
+				   OBD_CONNECT2_BATCH_RPC;
 
 #ifdef HAVE_LRU_RESIZE_SUPPORT
         if (sbi->ll_flags & LL_SBI_LRU_RESIZE)
@@ -464,7 +476,10 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 	data->ocd_connect_flags |= OBD_CONNECT_LOCKAHEAD_OLD;
 #endif
 
-	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD;
+	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD |
+				   OBD_CONNECT2_COMPRESS |
+				   OBD_CONNECT2_MULTIOBJ_BRW |
+				   OBD_CONNECT2_BATCH_RPC;
 
 	if (!OBD_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
@@ -980,6 +995,7 @@ void ll_lli_init(struct ll_inode_info *lli)
 
 	init_rwsem(&lli->lli_xattrs_list_rwsem);
 	mutex_init(&lli->lli_xattrs_enq_lock);
+	INIT_LIST_HEAD(&lli->lli_xattrs_lru);
 
 	LASSERT(lli->lli_vfs_inode.i_mode != 0);
 	if (S_ISDIR(lli->lli_vfs_inode.i_mode)) {
@@ -793,6 +793,42 @@ static ssize_t statahead_max_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(statahead_max);
 
+static ssize_t statahead_batch_max_show(struct kobject *kobj,
+					struct attribute *attr,
+					char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_sa_batch_max);
+}
+
+static ssize_t statahead_batch_max_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer,
+					 size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > LL_SA_RPC_MAX) {
+		CERROR("Bad statahead_batch_max value %lu. Valid values are in the range [0, %d]\n",
+		       val, LL_SA_RPC_MAX);
+		return -ERANGE;
+	}
+
+	sbi->ll_sa_batch_max = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(statahead_batch_max);
+
 static ssize_t statahead_agl_show(struct kobject *kobj,
 				  struct attribute *attr,
 				  char *buf)
@@ -833,10 +869,14 @@ static int ll_statahead_stats_seq_show(struct seq_file *m, void *v)
 
 	seq_printf(m, "statahead total: %u\n"
 		      "statahead wrong: %u\n"
-		      "agl total: %u\n",
+		      "agl total: %u\n"
+		      "batch total: %u\n"
+		      "batch rpcs: %lld\n",
 		   atomic_read(&sbi->ll_sa_total),
 		   atomic_read(&sbi->ll_sa_wrong),
-		   atomic_read(&sbi->ll_agl_total));
+		   atomic_read(&sbi->ll_agl_total),
+		   atomic_read(&sbi->ll_sa_batch_total),
+		   (long long)atomic64_read(&sbi->ll_sa_batch_rpcs));
 	return 0;
 }
 
@@ -1049,6 +1089,53 @@ static ssize_t xattr_cache_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(xattr_cache);
 
+static ssize_t xattr_cache_max_mb_show(struct kobject *kobj,
+				       struct attribute *attr,
+				       char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%lu\n", sbi->ll_xattr_cache_max_bytes >> 20);
+}
+
+static ssize_t xattr_cache_max_mb_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer,
+					size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	/* 0 means no limit */
+	if (val > PAGES_TO_MiB(cfs_totalram_pages()))
+		return -ERANGE;
+
+	sbi->ll_xattr_cache_max_bytes = val << 20;
+	ll_xattr_cache_shrink(sbi, true);
+
+	return count;
+}
+LUSTRE_RW_ATTR(xattr_cache_max_mb);
+
+static ssize_t xattr_cache_bytes_show(struct kobject *kobj,
+				      struct attribute *attr,
+				      char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%ld\n",
+		       atomic_long_read(&sbi->ll_xattr_cache_bytes));
+}
+LUSTRE_RO_ATTR(xattr_cache_bytes);
+
 static ssize_t tiny_write_show(struct kobject *kobj,
 			       struct attribute *attr,
 			       char *buf)
@@ -1200,6 +1287,144 @@ static ssize_t fast_read_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(fast_read);
 
+static ssize_t parallel_dio_show(struct kobject *kobj,
+				 struct attribute *attr,
+				 char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", !!(sbi->ll_flags & LL_SBI_PARALLEL_DIO));
+}
+
+static ssize_t parallel_dio_store(struct kobject *kobj,
+				  struct attribute *attr,
+				  const char *buffer,
+				  size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		sbi->ll_flags |= LL_SBI_PARALLEL_DIO;
+	else
+		sbi->ll_flags &= ~LL_SBI_PARALLEL_DIO;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(parallel_dio);
+
+static ssize_t unaligned_dio_show(struct kobject *kobj,
+				  struct attribute *attr,
+				  char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", !!(sbi->ll_flags & LL_SBI_UNALIGNED_DIO));
+}
+
+static ssize_t unaligned_dio_store(struct kobject *kobj,
+				   struct attribute *attr,
+				   const char *buffer,
+				   size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		sbi->ll_flags |= LL_SBI_UNALIGNED_DIO;
+	else
+		sbi->ll_flags &= ~LL_SBI_UNALIGNED_DIO;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(unaligned_dio);
+
+static ssize_t hybrid_io_read_threshold_mb_show(struct kobject *kobj,
+						struct attribute *attr,
+						char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n",
+			sbi->ll_hybrid_read_threshold >> 20);
+}
+
+static ssize_t hybrid_io_read_threshold_mb_store(struct kobject *kobj,
+						 struct attribute *attr,
+						 const char *buffer,
+						 size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val > (ULONG_MAX >> 20))
+		return -ERANGE;
+
+	sbi->ll_hybrid_read_threshold = val << 20;
+
+	return count;
+}
+LUSTRE_RW_ATTR(hybrid_io_read_threshold_mb);
+
+static ssize_t hybrid_io_write_threshold_mb_show(struct kobject *kobj,
+						 struct attribute *attr,
+						 char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n",
+			sbi->ll_hybrid_write_threshold >> 20);
+}
+
+static ssize_t hybrid_io_write_threshold_mb_store(struct kobject *kobj,
+						  struct attribute *attr,
+						  const char *buffer,
+						  size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val > (ULONG_MAX >> 20))
+		return -ERANGE;
+
+	sbi->ll_hybrid_write_threshold = val << 20;
+
+	return count;
+}
+LUSTRE_RW_ATTR(hybrid_io_write_threshold_mb);
+
 static ssize_t file_heat_show(struct kobject *kobj,
 			      struct attribute *attr,
 			      char *buf)
@@ -1505,13 +1730,20 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_stats_track_gid.attr,
 	&lustre_attr_statahead_running_max.attr,
 	&lustre_attr_statahead_max.attr,
+	&lustre_attr_statahead_batch_max.attr,
 	&lustre_attr_statahead_agl.attr,
 	&lustre_attr_lazystatfs.attr,
 	&lustre_attr_statfs_max_age.attr,
 	&lustre_attr_max_easize.attr,
 	&lustre_attr_default_easize.attr,
 	&lustre_attr_xattr_cache.attr,
+	&lustre_attr_xattr_cache_max_mb.attr,
+	&lustre_attr_xattr_cache_bytes.attr,
 	&lustre_attr_fast_read.attr,
+	&lustre_attr_parallel_dio.attr,
+	&lustre_attr_unaligned_dio.attr,
+	&lustre_attr_hybrid_io_read_threshold_mb.attr,
+	&lustre_attr_hybrid_io_write_threshold_mb.attr,
 	&lustre_attr_tiny_write.attr,
 	&lustre_attr_file_heat.attr,
 	&lustre_attr_heat_decay_percentage.attr,
@@ -1544,6 +1776,10 @@ static const struct llite_file_opcode {
                                    "read_bytes" },
         { LPROC_LL_WRITE_BYTES,    LPROCFS_CNTR_AVGMINMAX|LPROCFS_TYPE_BYTES,
                                    "write_bytes" },
+	{ LPROC_LL_HYBRID_READ_BYTES, LPROCFS_CNTR_AVGMINMAX |
+				      LPROCFS_TYPE_BYTES, "hybrid_read_bytes" },
+	{ LPROC_LL_HYBRID_WRITE_BYTES, LPROCFS_CNTR_AVGMINMAX |
+				       LPROCFS_TYPE_BYTES, "hybrid_write_bytes" },
         { LPROC_LL_IOCTL,          LPROCFS_TYPE_REGS, "ioctl" },
         { LPROC_LL_OPEN,           LPROCFS_TYPE_REGS, "open" },
         { LPROC_LL_RELEASE,        LPROCFS_TYPE_REGS, "close" },
@@ -1573,6 +1809,9 @@ static const struct llite_file_opcode {
 	{ LPROC_LL_SETXATTR,       LPROCFS_TYPE_REGS, "setxattr" },
 	{ LPROC_LL_GETXATTR,       LPROCFS_TYPE_REGS, "getxattr" },
 	{ LPROC_LL_GETXATTR_HITS,  LPROCFS_TYPE_REGS, "getxattr_hits" },
+	{ LPROC_LL_GETXATTR_MISSES, LPROCFS_TYPE_REGS, "getxattr_misses" },
+	{ LPROC_LL_GETXATTR_NEGATIVE, LPROCFS_TYPE_REGS, "getxattr_negative" },
+	{ LPROC_LL_XATTR_CACHE_EVICT, LPROCFS_TYPE_REGS, "xattr_cache_evict" },
 	{ LPROC_LL_LISTXATTR,      LPROCFS_TYPE_REGS, "listxattr" },
 	{ LPROC_LL_REMOVEXATTR,    LPROCFS_TYPE_REGS, "removexattr" },
 	{ LPROC_LL_INODE_PERM,     LPROCFS_TYPE_REGS, "inode_permission" },
@@ -1613,6 +1852,8 @@ static const char *ra_stat_string[] = {
 	[RA_STAT_FAILED_REACH_END] = "failed to reach end",
 	[RA_STAT_ASYNC] = "async readahead",
 	[RA_STAT_FAILED_FAST_READ] = "failed to fast read",
+	[RA_STAT_STREAM_SWITCH] = "stream switch",
+	[RA_STAT_REVERSE] = "reverse read-ahead",
 };
 
 int ll_debugfs_register_super(struct super_block *sb, const char *name)
@@ -154,7 +154,25 @@ static int index_in_window(unsigned long index, unsigned long point,
         return start <= index && index <= end;
 }
 
-void ll_ras_enter(struct file *f)
+/* called with the ras_lock held */
+static void ras_reverse_update(struct ll_readahead_state *ras, loff_t pos,
+			       size_t count)
+{
+	unsigned long start = pos >> PAGE_SHIFT;
+	unsigned long end = (pos + count - 1) >> PAGE_SHIFT;
+	unsigned long prev = ras->ras_prev_request_start;
+
+	/* the request ends where the previous one started */
+	if (count > 0 && start < prev && end <= prev && end + 1 >= prev) {
+		ras->ras_reverse_requests++;
+	} else {
+		ras->ras_reverse_requests = 0;
+		ras->ras_reverse_low = start;
+	}
+	ras->ras_prev_request_start = start;
+}
+
+void ll_ras_enter(struct file *f, loff_t pos, size_t count)
 {
 	struct ll_file_data *fd = LUSTRE_FPRIVATE(f);
 	struct ll_readahead_state *ras = &fd->fd_ras;
@@ -163,6 +181,7 @@ void ll_ras_enter(struct file *f)
 	ras->ras_requests++;
 	ras->ras_request_index = 0;
 	ras->ras_consecutive_requests++;
+	ras_reverse_update(ras, pos, count);
 	spin_unlock(&ras->ras_lock);
 }
 
@@ -251,6 +270,11 @@ static inline int stride_io_mode(struct ll_readahead_state *ras)
         return ras->ras_consecutive_stride_requests > 1;
 }
 
+static inline bool ras_reverse_mode(struct ll_readahead_state *ras)
+{
+	return ras->ras_reverse_requests > 1 && !stride_io_mode(ras);
+}
+
 /* The function calculates how much pages will be read in
  * [off, off + length], in such stride IO area,
  * stride_offset = st_off, stride_lengh = st_len,
@@ -598,6 +622,7 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 	struct inode *inode;
 	struct ra_io_arg *ria = &lti->lti_ria;
 	struct cl_object *clob;
+	bool reverse;
 	int ret = 0;
 	__u64 kms;
 	ENTRY;
@@ -617,25 +642,44 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 
 	spin_lock(&ras->ras_lock);
 
-	/**
-	 * Note: other thread might rollback the ras_next_readahead,
-	 * if it can not get the full size of prepared pages, see the
-	 * end of this function. For stride read ahead, it needs to
-	 * make sure the offset is no less than ras_stride_offset,
-	 * so that stride read ahead can work correctly.
-	 */
-	if (stride_io_mode(ras))
-		start = max(ras->ras_next_readahead, ras->ras_stride_offset);
-	else
-		start = ras->ras_next_readahead;
-
-	if (ras->ras_window_len > 0)
-		end = ras->ras_window_start + ras->ras_window_len - 1;
+	reverse = ras_reverse_mode(ras) && vio->vui_ra_valid;
+	if (reverse) {
+		struct ll_ra_info *ra = &ll_i2sbi(inode)->ll_ra_info;
+		unsigned long len;
 
-	/* Enlarge the RA window to encompass the full read */
-	if (vio->vui_ra_valid &&
-	    end < vio->vui_ra_start + vio->vui_ra_count - 1)
+		/* Read backwards from the current request, the window grows
+		 * with the number of consecutive reverse requests. */
+		len = min(vio->vui_ra_count * ras->ras_reverse_requests,
+			  ra->ra_max_pages_per_file);
+		len = max(len, ras->ras_rpc_size);
 		end = vio->vui_ra_start + vio->vui_ra_count - 1;
+		start = vio->vui_ra_start > len ? vio->vui_ra_start - len : 0;
+		start = ras_align(ras, start, NULL);
+		/* already read ahead by an earlier request */
+		if (start >= ras->ras_reverse_low)
+			start = vio->vui_ra_start;
+	} else {
+		/**
+		 * Note: other thread might rollback the ras_next_readahead,
+		 * if it can not get the full size of prepared pages, see the
+		 * end of this function. For stride read ahead, it needs to
+		 * make sure the offset is no less than ras_stride_offset,
+		 * so that stride read ahead can work correctly.
+		 */
+		if (stride_io_mode(ras))
+			start = max(ras->ras_next_readahead,
+				    ras->ras_stride_offset);
+		else
+			start = ras->ras_next_readahead;
+
+		if (ras->ras_window_len > 0)
+			end = ras->ras_window_start + ras->ras_window_len - 1;
+
+		/* Enlarge the RA window to encompass the full read */
+		if (vio->vui_ra_valid &&
+		    end < vio->vui_ra_start + vio->vui_ra_count - 1)
+			end = vio->vui_ra_start + vio->vui_ra_count - 1;
+	}
 
         if (end != 0) {
 		unsigned long end_index;
@@ -676,7 +720,7 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 	       hit);
 
 	/* at least to extend the readahead window to cover current read */
-	if (!hit && vio->vui_ra_valid &&
+	if ((!hit || reverse) && vio->vui_ra_valid &&
 	    vio->vui_ra_start + vio->vui_ra_count > ria->ria_start)
 		ria->ria_end_min = vio->vui_ra_start + vio->vui_ra_count - 1;
 
@@ -702,7 +746,15 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 
 	if (ra_end != end)
 		ll_ra_stats_inc(inode, RA_STAT_FAILED_REACH_END);
-	if (ra_end > 0) {
+	if (ra_end > 0 && reverse) {
+		ll_ra_stats_inc(inode, RA_STAT_REVERSE);
+		/* the next request only needs to read below this window */
+		spin_lock(&ras->ras_lock);
+		if (ra_end == ria->ria_end && start < ras->ras_reverse_low)
+			ras->ras_reverse_low = start;
+		spin_unlock(&ras->ras_lock);
+		RAS_CDEBUG(ras);
+	} else if (ra_end > 0) {
 		/* update the ras so that the next read-ahead tries from
 		 * where we left off. */
 		spin_lock(&ras->ras_lock);
@@ -749,6 +801,77 @@ void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
 	ras->ras_rpc_size = PTLRPC_MAX_BRW_PAGES;
 	ras_reset(inode, ras, 0);
 	ras->ras_requests = 0;
+	ras->ras_prev_request_start = 0;
+	ras->ras_reverse_requests = 0;
+	ras->ras_reverse_low = 0;
+	memset(ras->ras_streams, 0, sizeof(ras->ras_streams));
+}
+
+static void ras_stream_save(struct ll_readahead_state *ras,
+			    struct ll_ra_stream *rst)
+{
+	rst->rst_last_readpage = ras->ras_last_readpage;
+	rst->rst_consecutive_pages = ras->ras_consecutive_pages;
+	rst->rst_consecutive_requests = ras->ras_consecutive_requests;
+	rst->rst_window_start = ras->ras_window_start;
+	rst->rst_window_len = ras->ras_window_len;
+	rst->rst_next_readahead = ras->ras_next_readahead;
+	rst->rst_requests = ras->ras_requests;
+}
+
+static void ras_stream_load(struct ll_readahead_state *ras,
+			    struct ll_ra_stream *rst)
+{
+	ras->ras_last_readpage = rst->rst_last_readpage;
+	ras->ras_consecutive_pages = rst->rst_consecutive_pages;
+	ras->ras_consecutive_requests = rst->rst_consecutive_requests;
+	ras->ras_window_start = rst->rst_window_start;
+	ras->ras_window_len = rst->rst_window_len;
+	ras->ras_next_readahead = rst->rst_next_readahead;
+}
+
+/*
+ * A read which is distant from the current stream may continue one of the
+ * other streams read through this file descriptor, as happens when several
+ * sequential readers are interleaved. If so, swap the window of that stream
+ * in and keep the current one, instead of resetting read-ahead. Otherwise
+ * the current stream replaces the least recently used saved one.
+ *
+ * Called with the ras_lock held. Returns true if streams were switched.
+ */
+static bool ras_stream_switch(struct ll_readahead_state *ras,
+			      unsigned long index)
+{
+	struct ll_ra_stream *victim = NULL;
+	struct ll_ra_stream *rst;
+	struct ll_ra_stream cur;
+	int i;
+
+	for (i = 0; i < LL_RA_STREAMS; i++) {
+		rst = &ras->ras_streams[i];
+		if (rst->rst_requests != 0 &&
+		    index_in_window(index, rst->rst_last_readpage, 8, 8)) {
+			ras_stream_save(ras, &cur);
+			ras_stream_load(ras, rst);
+			*rst = cur;
+			/* this request was accounted to the wrong stream */
+			if (ras->ras_request_index == 0) {
+				ras->ras_consecutive_requests++;
+				if (rst->rst_consecutive_requests > 0)
+					rst->rst_consecutive_requests--;
+			}
+			RAS_CDEBUG(ras);
+			return true;
+		}
+
+		if (victim == NULL || rst->rst_requests < victim->rst_requests)
+			victim = rst;
+	}
+
+	if (ras->ras_consecutive_pages > 0)
+		ras_stream_save(ras, victim);
+
+	return false;
 }
 
 /*
@@ -928,7 +1051,11 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
         }
 	if (zero) {
 		/* check whether it is in stride I/O mode*/
-		if (!index_in_stride_window(ras, index)) {
+		if (!index_in_stride_window(ras, index) &&
+		    ras_stream_switch(ras, index)) {
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_STREAM_SWITCH);
+			ras_stride_reset(ras);
+		} else if (!index_in_stride_window(ras, index)) {
 			if (ras->ras_consecutive_stride_requests == 0 &&
 			    ras->ras_request_index == 0) {
 				ras_update_stride_detector(ras, index);
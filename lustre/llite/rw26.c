@@ -174,6 +174,43 @@ static int ll_releasepage(struct page *vmpage, RELEASEPAGE_ARG_TYPE gfp_mask)
 
 #define MAX_DIRECTIO_SIZE 2*1024*1024*1024UL
 
+/*
+ * Submit direct IO pages without waiting for them, the completion is tracked
+ * by io->ci_aio, which also keeps the pages in transfer until the whole IO is
+ * done.
+ */
+static int ll_direct_IO_submit(const struct lu_env *env, struct cl_io *io,
+			       enum cl_req_type iot, struct cl_2queue *queue)
+{
+	struct cl_dio_aio *aio = io->ci_aio;
+	struct cl_sync_io *anchor = &aio->cda_sync;
+	struct cl_page *clp;
+	int rc;
+
+	cl_page_list_for_each(clp, &queue->c2_qin) {
+		LASSERT(clp->cp_sync_io == NULL);
+		clp->cp_sync_io = anchor;
+	}
+	atomic_add(queue->c2_qin.pl_nr, &anchor->csi_sync_nr);
+
+	rc = cl_io_submit_rw(env, io, iot, queue);
+	if (rc == 0) {
+		/* pages which weren't sent are counted as completed */
+		cl_page_list_for_each(clp, &queue->c2_qin) {
+			clp->cp_sync_io = NULL;
+			cl_sync_io_note(env, anchor, 1);
+		}
+		cl_page_list_splice(&queue->c2_qout, &aio->cda_pages);
+	} else {
+		LASSERT(list_empty(&queue->c2_qout.pl_pages));
+		cl_page_list_for_each(clp, &queue->c2_qin)
+			clp->cp_sync_io = NULL;
+		atomic_sub(queue->c2_qin.pl_nr, &anchor->csi_sync_nr);
+	}
+
+	return rc;
+}
+
 static ssize_t
 ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
 		 struct inode *inode, size_t size, loff_t file_offset,
@@ -264,9 +301,12 @@ ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
 	}
 
 	if (rc == 0 && io_pages) {
-		rc = cl_io_submit_sync(env, io,
-				       rw == READ ? CRT_READ : CRT_WRITE,
-				       queue, 0);
+		enum cl_req_type iot = rw == READ ? CRT_READ : CRT_WRITE;
+
+		if (io->ci_aio == NULL)
+			rc = cl_io_submit_sync(env, io, iot, queue, 0);
+		else
+			rc = ll_direct_IO_submit(env, io, iot, queue);
 	}
 	if (rc == 0)
 		rc = orig_size;
@@ -316,7 +356,181 @@ static void ll_free_user_pages(struct page **pages, int npages, int do_dirty)
 # define iov_iter_rw(iter)	rw
 #endif
 
+/* Pages used to stage the unaligned parts of direct IO are kept in a small
+ * pool, so that odd-sized records don't cost a page allocation each. */
+#define LL_DIO_BOUNCE_POOL_MAX	256
+
+static LIST_HEAD(ll_dio_bounce_list);
+static DEFINE_SPINLOCK(ll_dio_bounce_lock);
+static unsigned int ll_dio_bounce_count;
+
+void ll_dio_bounce_fini(void)
+{
+	struct page *page;
+	struct page *tmp;
+
+	spin_lock(&ll_dio_bounce_lock);
+	list_for_each_entry_safe(page, tmp, &ll_dio_bounce_list, lru) {
+		list_del_init(&page->lru);
+		__free_page(page);
+	}
+	ll_dio_bounce_count = 0;
+	spin_unlock(&ll_dio_bounce_lock);
+}
+
 #if defined(HAVE_DIRECTIO_ITER) || defined(HAVE_IOV_ITER_RW)
+static struct page *ll_dio_bounce_get(void)
+{
+	struct page *page = NULL;
+
+	spin_lock(&ll_dio_bounce_lock);
+	if (!list_empty(&ll_dio_bounce_list)) {
+		page = list_entry(ll_dio_bounce_list.next, struct page, lru);
+		list_del_init(&page->lru);
+		ll_dio_bounce_count--;
+	}
+	spin_unlock(&ll_dio_bounce_lock);
+
+	if (page == NULL)
+		page = alloc_page(GFP_NOFS);
+
+	return page;
+}
+
+static void ll_dio_bounce_put(struct page *page)
+{
+	spin_lock(&ll_dio_bounce_lock);
+	if (ll_dio_bounce_count < LL_DIO_BOUNCE_POOL_MAX) {
+		list_add(&page->lru, &ll_dio_bounce_list);
+		ll_dio_bounce_count++;
+		page = NULL;
+	}
+	spin_unlock(&ll_dio_bounce_lock);
+
+	if (page != NULL)
+		__free_page(page);
+}
+
+/* maximum number of pages staged by a single ll_direct_IO_bounce() call */
+#define LL_DIO_BOUNCE_PAGES	16
+
+/*
+ * Transfer [file_offset, file_offset + size) through bounce pages. Only the
+ * covered part of each page is sent, so no read-modify-write is needed for
+ * the partial head and tail pages of an unaligned write.
+ *
+ * The bounce pages are always waited for, because read data has to be copied
+ * to the user buffer before returning. @iter isn't advanced.
+ */
+static ssize_t
+ll_direct_IO_bounce(const struct lu_env *env, struct cl_io *io, int rw,
+		    struct iov_iter *iter, loff_t file_offset, size_t size)
+{
+	struct cl_object *obj = io->ci_obj;
+	struct cl_2queue *queue = &io->ci_queue;
+	struct page *pages[LL_DIO_BOUNCE_PAGES];
+	struct iov_iter data = *iter;
+	struct cl_page *clp;
+	int page_count;
+	loff_t pos;
+	size_t left;
+	size_t from;
+	size_t bytes;
+	ssize_t rc = 0;
+	int i;
+
+	ENTRY;
+	page_count = DIV_ROUND_UP((file_offset & ~PAGE_MASK) + size,
+				  PAGE_SIZE);
+	LASSERT(page_count <= LL_DIO_BOUNCE_PAGES);
+
+	for (i = 0; i < page_count; i++) {
+		pages[i] = ll_dio_bounce_get();
+		if (pages[i] == NULL) {
+			page_count = i;
+			GOTO(out_free, rc = -ENOMEM);
+		}
+	}
+
+	cl_2queue_init(queue);
+	for (i = 0, pos = file_offset, left = size; i < page_count;
+	     i++, pos += bytes, left -= bytes) {
+		from = pos & ~PAGE_MASK;
+		bytes = min_t(size_t, PAGE_SIZE - from, left);
+
+		if (rw == WRITE &&
+		    copy_page_from_iter(pages[i], from, bytes, &data) != bytes)
+			GOTO(out_queue, rc = -EFAULT);
+
+		clp = cl_page_find(env, obj, cl_index(obj, pos), pages[i],
+				   CPT_TRANSIENT);
+		if (IS_ERR(clp))
+			GOTO(out_queue, rc = PTR_ERR(clp));
+
+		rc = cl_page_own(env, io, clp);
+		if (rc) {
+			LASSERT(clp->cp_state == CPS_FREEING);
+			cl_page_put(env, clp);
+			GOTO(out_queue, rc);
+		}
+
+		cl_2queue_add(queue, clp);
+		cl_page_clip(env, clp, from, from + bytes);
+		/* drop the reference count for cl_page_find */
+		cl_page_put(env, clp);
+	}
+
+	rc = cl_io_submit_sync(env, io, rw == READ ? CRT_READ : CRT_WRITE,
+			       queue, 0);
+	if (rc == 0 && rw == READ) {
+		for (i = 0, pos = file_offset, left = size; i < page_count;
+		     i++, pos += bytes, left -= bytes) {
+			from = pos & ~PAGE_MASK;
+			bytes = min_t(size_t, PAGE_SIZE - from, left);
+
+			if (copy_page_to_iter(pages[i], from, bytes,
+					      &data) != bytes)
+				GOTO(out_queue, rc = -EFAULT);
+		}
+	}
+	if (rc == 0)
+		rc = size;
+
+out_queue:
+	cl_2queue_discard(env, io, queue);
+	cl_2queue_disown(env, io, queue);
+	cl_2queue_fini(env, queue);
+out_free:
+	for (i = 0; i < page_count; i++)
+		ll_dio_bounce_put(pages[i]);
+
+	RETURN(rc);
+}
+
+/*
+ * Return the number of bytes at the head of @iter which have to be staged
+ * through bounce pages, or 0 if the next chunk can be sent zero-copy. That is
+ * the case when both the file offset and the user buffer are page aligned.
+ */
+static size_t ll_dio_bounce_bytes(struct iov_iter *iter, loff_t file_offset,
+				  size_t count)
+{
+	struct iov_iter tmp = *iter;
+
+	if (file_offset & ~PAGE_MASK)
+		return min_t(size_t, count,
+			     PAGE_SIZE - (file_offset & ~PAGE_MASK));
+	if (count < PAGE_SIZE)
+		return count;
+
+	iov_iter_truncate(&tmp, count & PAGE_MASK);
+	if (iov_iter_alignment(&tmp) & ~PAGE_MASK)
+		return min_t(size_t, count & PAGE_MASK,
+			     LL_DIO_BOUNCE_PAGES << PAGE_SHIFT);
+
+	return 0;
+}
+
 static ssize_t
 ll_direct_IO(
 # ifndef HAVE_IOV_ITER_RW
@@ -339,23 +553,24 @@ ll_direct_IO(
 	ssize_t count = iov_iter_count(iter);
 	ssize_t tot_bytes = 0, result = 0;
 	size_t size = MAX_DIO_SIZE;
+	bool unaligned;
 
 	/* Check EOF by ourselves */
 	if (iov_iter_rw(iter) == READ && file_offset >= i_size_read(inode))
 		return 0;
-	/* FIXME: io smaller than PAGE_SIZE is broken on ia64 ??? */
-	if ((file_offset & ~PAGE_MASK) || (count & ~PAGE_MASK))
+
+	/* Unaligned parts of the IO, including those where the user buffer
+	 * isn't aligned to the file offset, are staged via bounce pages. */
+	unaligned = (file_offset & ~PAGE_MASK) || (count & ~PAGE_MASK) ||
+		    (iov_iter_alignment(iter) & ~PAGE_MASK);
+	if (unaligned && !ll_sbi_has_unaligned_dio(ll_i2sbi(inode)))
 		return -EINVAL;
 
 	CDEBUG(D_VFSTRACE, "VFS Op:inode="DFID"(%p), size=%zd (max %lu), "
-	       "offset=%lld=%llx, pages %zd (max %lu)\n",
+	       "offset=%lld=%llx, pages %zd (max %lu)%s\n",
 	       PFID(ll_inode2fid(inode)), inode, count, MAX_DIO_SIZE,
 	       file_offset, file_offset, count >> PAGE_SHIFT,
-	       MAX_DIO_SIZE >> PAGE_SHIFT);
-
-	/* Check that all user buffers are aligned as well */
-	if (iov_iter_alignment(iter) & ~PAGE_MASK)
-		return -EINVAL;
+	       MAX_DIO_SIZE >> PAGE_SHIFT, unaligned ? ", unaligned" : "");
 
 	lcc = ll_cl_find(file);
 	if (lcc == NULL)
@@ -386,6 +601,27 @@ ll_direct_IO(
 				count = i_size_read(inode) - file_offset;
 		}
 
+		if (unaligned) {
+			size_t bytes;
+
+			bytes = ll_dio_bounce_bytes(iter, file_offset, count);
+			if (bytes > 0) {
+				result = ll_direct_IO_bounce(env, io,
+							     iov_iter_rw(iter),
+							     iter, file_offset,
+							     bytes);
+				if (unlikely(result <= 0))
+					GOTO(out, result);
+
+				iov_iter_advance(iter, result);
+				tot_bytes += result;
+				file_offset += result;
+				continue;
+			}
+			/* the partial tail page is left for the next round */
+			count &= PAGE_MASK;
+		}
+
 		result = iov_iter_get_pages_alloc(iter, &pages, count, &offs);
 		if (likely(result > 0)) {
 			int n = DIV_ROUND_UP(result + offs, PAGE_SIZE);
@@ -393,9 +629,14 @@ ll_direct_IO(
 			result = ll_direct_IO_seg(env, io, iov_iter_rw(iter),
 						  inode, result, file_offset,
 						  pages, n);
+			/* with io->ci_aio the read may still be in flight,
+			 * cl_aio_end() dirties the pages once it is done,
+			 * the cl_pages keep them pinned until then */
 			ll_free_user_pages(pages, n,
-					   iov_iter_rw(iter) == READ);
-
+					   iov_iter_rw(iter) == READ &&
+					   io->ci_aio == NULL);
+			if (io->ci_aio != NULL && result > 0)
+				io->ci_aio->cda_submitted += result;
 		}
 		if (unlikely(result <= 0)) {
 			/* If we can't allocate a large enough buffer
@@ -531,7 +772,9 @@ ll_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
 				result = ll_direct_IO_seg(env, io, rw, inode,
 							  bytes, file_offset,
 							  pages, page_count);
-                                ll_free_user_pages(pages, max_pages, rw==READ);
+				ll_free_user_pages(pages, max_pages,
+						   rw == READ &&
+						   io->ci_aio == NULL);
                         } else if (page_count == 0) {
                                 GOTO(out, result = -EFAULT);
                         } else {
@@ -344,6 +344,7 @@ static void sa_fini_data(struct md_enqueue_info *minfo)
 
 static int ll_statahead_interpret(struct ptlrpc_request *req,
 				  struct md_enqueue_info *minfo, int rc);
+static void ll_statahead_batch_flush(struct md_enqueue_info *minfo);
 
 /*
  * prepare arguments for async stat RPC.
@@ -374,6 +375,8 @@ sa_prep_data(struct inode *dir, struct inode *child, struct sa_entry *entry)
 	minfo->mi_dir = igrab(dir);
 	minfo->mi_cb = ll_statahead_interpret;
 	minfo->mi_cbdata = entry;
+	minfo->mi_set = ll_i2info(dir)->lli_sai->sai_batch_set;
+	minfo->mi_set_flush = ll_statahead_batch_flush;
 
 	einfo = &minfo->mi_einfo;
 	einfo->ei_type   = LDLM_IBITS;
@@ -840,6 +843,39 @@ static int sa_revalidate(struct inode *dir, struct sa_entry *entry,
 	RETURN(rc);
 }
 
+/*
+ * send async stat RPCs collected in the batch, this is called when the batch
+ * is full, and before statahead thread may block, because the scanner process
+ * may be waiting for one of the collected entries.
+ *
+ * The whole batch is handed to one ptlrpcd thread, which sends all of it in
+ * the same ptlrpc_check_set() pass, so ptl_send_rpc_batch() packs the RPCs
+ * into OBD_BATCH_RPCs if the MDT supports them.
+ */
+static void sa_batch_flush(struct ll_statahead_info *sai)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(sai->sai_dentry->d_inode);
+	int count;
+
+	if (sai->sai_batch_set == NULL)
+		return;
+
+	count = atomic_read(&sai->sai_batch_set->set_remaining);
+	if (count == 0)
+		return;
+
+	ptlrpcd_add_rqset(sai->sai_batch_set);
+	atomic_inc(&sbi->ll_sa_batch_total);
+	atomic64_add(count, &sbi->ll_sa_batch_rpcs);
+	CDEBUG(D_READA, "sai %p sent batch of %d stat RPCs\n", sai, count);
+}
+
+/* mdc flushes the batch before it waits for a request slot */
+static void ll_statahead_batch_flush(struct md_enqueue_info *minfo)
+{
+	sa_batch_flush(ll_i2info(minfo->mi_dir)->lli_sai);
+}
+
 /* async stat for file with @name */
 static void sa_statahead(struct dentry *parent, const char *name, int len,
 			 const struct lu_fid *fid)
@@ -875,6 +911,11 @@ static void sa_statahead(struct dentry *parent, const char *name, int len,
 
 	sai->sai_index++;
 
+	if (sai->sai_batch_set != NULL &&
+	    atomic_read(&sai->sai_batch_set->set_remaining) >=
+	    ll_i2sbi(dir)->ll_sa_batch_max)
+		sa_batch_flush(sai);
+
 	EXIT;
 }
 
@@ -1011,6 +1052,10 @@ static int ll_statahead_thread(void *arg)
 	if (sbi->ll_flags & LL_SBI_AGL_ENABLED)
 		ll_start_agl(parent, sai);
 
+	/* without batch set, async stat RPCs are sent one by one */
+	if (sbi->ll_sa_batch_max > 1)
+		sai->sai_batch_set = ptlrpc_prep_set();
+
 	atomic_inc(&sbi->ll_sa_total);
 	spin_lock(&lli->lli_sa_lock);
 	if (thread_is_init(sa_thread))
@@ -1099,6 +1144,10 @@ static int ll_statahead_thread(void *arg)
 
 			fid_le_to_cpu(&fid, &ent->lde_fid);
 
+			/* replies won't come for unsent RPCs */
+			if (sa_sent_full(sai))
+				sa_batch_flush(sai);
+
 			/* wait for spare statahead window */
 			do {
 				l_wait_event(sa_thread->t_ctl_waitq,
@@ -1131,6 +1180,9 @@ static int ll_statahead_thread(void *arg)
 			sa_statahead(parent, name, namelen, &fid);
 		}
 
+		/* send the rest before reading next page, which may block */
+		sa_batch_flush(sai);
+
 		pos = le64_to_cpu(dp->ldp_hash_end);
 		ll_release_page(dir, page,
 				le32_to_cpu(dp->ldp_flags) & LDF_COLLIDE);
@@ -1151,6 +1203,12 @@ static int ll_statahead_thread(void *arg)
 	ll_dir_chain_fini(&chain);
 	ll_finish_md_op_data(op_data);
 
+	if (sai->sai_batch_set != NULL) {
+		sa_batch_flush(sai);
+		ptlrpc_set_destroy(sai->sai_batch_set);
+		sai->sai_batch_set = NULL;
+	}
+
 	if (rc < 0) {
 		spin_lock(&lli->lli_sa_lock);
 		thread_set_flags(sa_thread, SVC_STOPPING);
@@ -170,6 +170,7 @@ static void __exit lustre_exit(void)
 	ll_xattr_fini();
 	cl_env_put(cl_inode_fini_env, &cl_inode_fini_refcheck);
 	vvp_global_fini();
+	ll_dio_bounce_fini();
 
 	/*
 	 * Make sure all delayed rcu free inodes are flushed before we
@@ -33,24 +33,42 @@
 #define DEBUG_SUBSYSTEM S_LLITE
 
 #include <linux/fs.h>
+#include <linux/hash.h>
 #include <linux/sched.h>
 #include <linux/mm.h>
 #include <obd_support.h>
 #include <lustre_dlm.h>
 #include "llite_internal.h"
 
-/* If we ever have hundreds of extended attributes, we might want to consider
- * using a hash or a tree structure instead of list for faster lookups.
+/* Inodes with more cached xattrs than this also get a hash table, so that
+ * lookups do not have to walk the whole list.
  */
+#define XATTR_CACHE_HASH_MIN		8
+#define XATTR_CACHE_HASH_MAX_BITS	10
+/* how many LRU entries a single shrink pass may look at */
+#define XATTR_CACHE_SHRINK_BATCH	64
+
 struct ll_xattr_entry {
 	struct list_head	xe_list;    /* protected with
 					     * lli_xattrs_list_rwsem */
+	struct hlist_node	xe_hash;    /* lli_xattrs_hash bucket */
 	char			*xe_name;   /* xattr name, \0-terminated */
 	char			*xe_value;  /* xattr value */
 	unsigned		xe_namelen; /* strlen(xe_name) + 1 */
 	unsigned		xe_vallen;  /* xattr value length */
+	unsigned		xe_hashval; /* hash of xe_name */
 };
 
+static inline unsigned int ll_xattr_entry_size(struct ll_xattr_entry *xattr)
+{
+	return sizeof(*xattr) + xattr->xe_namelen + xattr->xe_vallen;
+}
+
+static inline unsigned int ll_xattr_name_hash(const char *name)
+{
+	return ll_full_name_hash(NULL, name, strlen(name));
+}
+
 static struct kmem_cache *xattr_kmem;
 static struct lu_kmem_descr xattr_caches[] = {
 	{
@@ -76,48 +94,99 @@ void ll_xattr_fini(void)
 /**
  * Initializes xattr cache for an inode.
  *
- * This initializes the xattr list and marks cache presence.
+ * This initializes the xattr list and marks cache presence. If the
+ * inode is going to hold more than a few xattrs (@count is the number
+ * the MDT returned), a hash table is set up for the lookups too.
+ *
+ * \retval 0       success
+ * \retval -ENOMEM if the hash table could not be allocated
  */
-static void ll_xattr_cache_init(struct ll_inode_info *lli)
+static int ll_xattr_cache_init(struct ll_inode_info *lli, unsigned int count)
 {
+	struct ll_sb_info *sbi = ll_i2sbi(ll_info2i(lli));
+	unsigned int bits;
+	int i;
+
 	ENTRY;
 
 	LASSERT(lli != NULL);
 
 	INIT_LIST_HEAD(&lli->lli_xattrs);
+	lli->lli_xattrs_hash = NULL;
+	lli->lli_xattrs_hash_bits = 0;
+	lli->lli_xattrs_bytes = 0;
+
+	if (count > XATTR_CACHE_HASH_MIN) {
+		bits = min_t(unsigned int, ilog2(roundup_pow_of_two(count)),
+			     XATTR_CACHE_HASH_MAX_BITS);
+		OBD_ALLOC_LARGE(lli->lli_xattrs_hash,
+				sizeof(struct hlist_head) << bits);
+		if (lli->lli_xattrs_hash == NULL)
+			RETURN(-ENOMEM);
+		for (i = 0; i < (1 << bits); i++)
+			INIT_HLIST_HEAD(&lli->lli_xattrs_hash[i]);
+		lli->lli_xattrs_hash_bits = bits;
+		atomic_long_add(sizeof(struct hlist_head) << bits,
+				&sbi->ll_xattr_cache_bytes);
+	}
+
 	ll_file_set_flag(lli, LLIF_XATTR_CACHE);
+	RETURN(0);
 }
 
 /**
  *  This looks for a specific extended attribute.
  *
- *  Find in @cache and return @xattr_name attribute in @xattr,
+ *  Find in the @lli cache and return @xattr_name attribute in @xattr,
  *  for the NULL @xattr_name return the first cached @xattr.
  *
  *  \retval 0        success
  *  \retval -ENODATA if not found
  */
-static int ll_xattr_cache_find(struct list_head *cache,
+static int ll_xattr_cache_find(struct ll_inode_info *lli,
 			       const char *xattr_name,
 			       struct ll_xattr_entry **xattr)
 {
 	struct ll_xattr_entry *entry;
+	unsigned int hashval;
 
 	ENTRY;
 
-	list_for_each_entry(entry, cache, xe_list) {
-		/* xattr_name == NULL means look for any entry */
-		if (xattr_name == NULL ||
-		    strcmp(xattr_name, entry->xe_name) == 0) {
-			*xattr = entry;
-			CDEBUG(D_CACHE, "find: [%s]=%.*s\n",
-			       entry->xe_name, entry->xe_vallen,
-			       entry->xe_value);
-			RETURN(0);
+	/* xattr_name == NULL means look for any entry */
+	if (xattr_name == NULL) {
+		if (list_empty(&lli->lli_xattrs))
+			RETURN(-ENODATA);
+		*xattr = list_first_entry(&lli->lli_xattrs,
+					  struct ll_xattr_entry, xe_list);
+		RETURN(0);
+	}
+
+	hashval = ll_xattr_name_hash(xattr_name);
+	if (lli->lli_xattrs_hash != NULL) {
+		struct hlist_head *head;
+
+		head = &lli->lli_xattrs_hash[hash_32(hashval,
+					lli->lli_xattrs_hash_bits)];
+		hlist_for_each_entry(entry, head, xe_hash) {
+			if (entry->xe_hashval == hashval &&
+			    strcmp(xattr_name, entry->xe_name) == 0)
+				goto found;
 		}
+		RETURN(-ENODATA);
+	}
+
+	list_for_each_entry(entry, &lli->lli_xattrs, xe_list) {
+		if (entry->xe_hashval == hashval &&
+		    strcmp(xattr_name, entry->xe_name) == 0)
+			goto found;
 	}
 
 	RETURN(-ENODATA);
+found:
+	*xattr = entry;
+	CDEBUG(D_CACHE, "find: [%s]=%.*s\n",
+	       entry->xe_name, entry->xe_vallen, entry->xe_value);
+	RETURN(0);
 }
 
 /**
@@ -129,16 +198,17 @@ static int ll_xattr_cache_find(struct list_head *cache,
  * \retval -ENOMEM if no memory could be allocated for the cached attr
  * \retval -EPROTO if duplicate xattr is being added
  */
-static int ll_xattr_cache_add(struct list_head *cache,
+static int ll_xattr_cache_add(struct ll_inode_info *lli,
 			      const char *xattr_name,
 			      const char *xattr_val,
 			      unsigned xattr_val_len)
 {
+	struct ll_sb_info *sbi = ll_i2sbi(ll_info2i(lli));
 	struct ll_xattr_entry *xattr;
 
 	ENTRY;
 
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
+	if (ll_xattr_cache_find(lli, xattr_name, &xattr) == 0) {
 		CDEBUG(D_CACHE, "duplicate xattr: [%s]\n", xattr_name);
 		RETURN(-EPROTO);
 	}
@@ -167,7 +237,14 @@ static int ll_xattr_cache_add(struct list_head *cache,
 	memcpy(xattr->xe_name, xattr_name, xattr->xe_namelen);
 	memcpy(xattr->xe_value, xattr_val, xattr_val_len);
 	xattr->xe_vallen = xattr_val_len;
-	list_add(&xattr->xe_list, cache);
+	xattr->xe_hashval = ll_xattr_name_hash(xattr_name);
+	list_add(&xattr->xe_list, &lli->lli_xattrs);
+	if (lli->lli_xattrs_hash != NULL)
+		hlist_add_head(&xattr->xe_hash,
+			       &lli->lli_xattrs_hash[hash_32(xattr->xe_hashval,
+						lli->lli_xattrs_hash_bits)]);
+	lli->lli_xattrs_bytes += ll_xattr_entry_size(xattr);
+	atomic_long_add(ll_xattr_entry_size(xattr), &sbi->ll_xattr_cache_bytes);
 
 	CDEBUG(D_CACHE, "set: [%s]=%.*s\n", xattr_name,
 		xattr_val_len, xattr_val);
@@ -189,17 +266,23 @@ err_name:
  * \retval 0        success
  * \retval -ENODATA if @xattr_name is not cached
  */
-static int ll_xattr_cache_del(struct list_head *cache,
+static int ll_xattr_cache_del(struct ll_inode_info *lli,
 			      const char *xattr_name)
 {
+	struct ll_sb_info *sbi = ll_i2sbi(ll_info2i(lli));
 	struct ll_xattr_entry *xattr;
 
 	ENTRY;
 
 	CDEBUG(D_CACHE, "del xattr: %s\n", xattr_name);
 
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
+	if (ll_xattr_cache_find(lli, xattr_name, &xattr) == 0) {
+		lli->lli_xattrs_bytes -= ll_xattr_entry_size(xattr);
+		atomic_long_sub(ll_xattr_entry_size(xattr),
+				&sbi->ll_xattr_cache_bytes);
 		list_del(&xattr->xe_list);
+		if (lli->lli_xattrs_hash != NULL)
+			hlist_del(&xattr->xe_hash);
 		OBD_FREE(xattr->xe_name, xattr->xe_namelen);
 		OBD_FREE(xattr->xe_value, xattr->xe_vallen);
 		OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
@@ -220,7 +303,7 @@ static int ll_xattr_cache_del(struct list_head *cache,
  * \retval >= 0     buffer list size
  * \retval -ENODATA if the list cannot fit @xld_size buffer
  */
-static int ll_xattr_cache_list(struct list_head *cache,
+static int ll_xattr_cache_list(struct ll_inode_info *lli,
 			       char *xld_buffer,
 			       int xld_size)
 {
@@ -229,7 +312,7 @@ static int ll_xattr_cache_list(struct list_head *cache,
 
 	ENTRY;
 
-	list_for_each_entry_safe(xattr, tmp, cache, xe_list) {
+	list_for_each_entry_safe(xattr, tmp, &lli->lli_xattrs, xe_list) {
 		CDEBUG(D_CACHE, "list: buffer=%p[%d] name=%s\n",
 			xld_buffer, xld_tail, xattr->xe_name);
 
@@ -269,15 +352,37 @@ static int ll_xattr_cache_valid(struct ll_inode_info *lli)
  */
 static int ll_xattr_cache_destroy_locked(struct ll_inode_info *lli)
 {
+	struct ll_sb_info *sbi = ll_i2sbi(ll_info2i(lli));
+
 	ENTRY;
 
 	if (!ll_xattr_cache_valid(lli))
 		RETURN(0);
 
-	while (ll_xattr_cache_del(&lli->lli_xattrs, NULL) == 0)
+	if (!list_empty(&lli->lli_xattrs_lru)) {
+		spin_lock(&sbi->ll_xattr_lru_lock);
+		list_del_init(&lli->lli_xattrs_lru);
+		spin_unlock(&sbi->ll_xattr_lru_lock);
+	}
+
+	while (ll_xattr_cache_del(lli, NULL) == 0)
 		/* empty loop */ ;
 
+	if (lli->lli_xattrs_hash != NULL) {
+		atomic_long_sub(sizeof(struct hlist_head) <<
+				lli->lli_xattrs_hash_bits,
+				&sbi->ll_xattr_cache_bytes);
+		OBD_FREE_LARGE(lli->lli_xattrs_hash,
+			       sizeof(struct hlist_head) <<
+			       lli->lli_xattrs_hash_bits);
+		lli->lli_xattrs_hash = NULL;
+		lli->lli_xattrs_hash_bits = 0;
+	}
+	LASSERTF(lli->lli_xattrs_bytes == 0, "%u bytes left\n",
+		 lli->lli_xattrs_bytes);
+
 	ll_file_clear_flag(lli, LLIF_XATTR_CACHE);
+	ll_file_clear_flag(lli, LLIF_XATTR_REFERENCED);
 
 	RETURN(0);
 }
@@ -296,6 +401,57 @@ int ll_xattr_cache_destroy(struct inode *inode)
 	RETURN(rc);
 }
 
+/**
+ * Keep the xattr caches of @sbi under ll_xattr_cache_max_bytes.
+ *
+ * The LRU is scanned from its cold end with a second chance (CLOCK)
+ * policy: caches used since the last pass are only rotated to the tail.
+ * Inodes whose cache is busy are skipped rather than waited for, so this
+ * can be called with the xattr lock of another inode held. At most
+ * XATTR_CACHE_SHRINK_BATCH entries are looked at per call, unless @all
+ * is set, e.g. when the limit was lowered, then the caches are shrunk
+ * until they fit.
+ */
+void ll_xattr_cache_shrink(struct ll_sb_info *sbi, bool all)
+{
+	struct ll_inode_info *lli;
+	int budget = XATTR_CACHE_SHRINK_BATCH;
+
+	ENTRY;
+
+	while (sbi->ll_xattr_cache_max_bytes != 0 &&
+	       atomic_long_read(&sbi->ll_xattr_cache_bytes) >
+	       sbi->ll_xattr_cache_max_bytes && (all || budget-- > 0)) {
+		if (all)
+			cond_resched();
+
+		spin_lock(&sbi->ll_xattr_lru_lock);
+		if (list_empty(&sbi->ll_xattr_lru)) {
+			spin_unlock(&sbi->ll_xattr_lru_lock);
+			break;
+		}
+		lli = list_first_entry(&sbi->ll_xattr_lru, struct ll_inode_info,
+				       lli_xattrs_lru);
+		if (ll_file_test_and_clear_flag(lli, LLIF_XATTR_REFERENCED) ||
+		    !down_write_trylock(&lli->lli_xattrs_list_rwsem)) {
+			list_move_tail(&lli->lli_xattrs_lru, &sbi->ll_xattr_lru);
+			spin_unlock(&sbi->ll_xattr_lru_lock);
+			continue;
+		}
+		/* the rwsem keeps the inode from being cleared under us */
+		list_del_init(&lli->lli_xattrs_lru);
+		spin_unlock(&sbi->ll_xattr_lru_lock);
+
+		CDEBUG(D_CACHE, "evict xattr cache of "DFID", %u bytes\n",
+		       PFID(&lli->lli_fid), lli->lli_xattrs_bytes);
+		ll_xattr_cache_destroy_locked(lli);
+		up_write(&lli->lli_xattrs_list_rwsem);
+		ll_stats_ops_tally(sbi, LPROC_LL_XATTR_CACHE_EVICT, 1);
+	}
+
+	EXIT;
+}
+
 /**
  * Match or enqueue a PR lock.
  *
@@ -404,6 +560,8 @@ static int ll_xattr_cache_refill(struct inode *inode)
 		GOTO(err_unlock, rc = -EAGAIN);
 	}
 
+	ll_stats_ops_tally(sbi, LPROC_LL_GETXATTR_MISSES, 1);
+
 	body = req_capsule_server_get(&req->rq_pill, &RMF_MDT_BODY);
 	if (body == NULL) {
 		CERROR("no MDT BODY in the refill xattr reply\n");
@@ -427,7 +585,9 @@ static int ll_xattr_cache_refill(struct inode *inode)
 
 	CDEBUG(D_CACHE, "caching: xdata=%p xtail=%p\n", xdata, xtail);
 
-	ll_xattr_cache_init(lli);
+	rc = ll_xattr_cache_init(lli, body->mbo_max_mdsize);
+	if (rc < 0)
+		GOTO(err_cancel, rc);
 
 	for (i = 0; i < body->mbo_max_mdsize; i++) {
 		CDEBUG(D_CACHE, "caching [%s]=%.*s\n", xdata, *xsizes, xval);
@@ -450,8 +610,7 @@ static int ll_xattr_cache_refill(struct inode *inode)
 			CDEBUG(D_CACHE, "not caching security.selinux\n");
 			rc = 0;
 		} else {
-			rc = ll_xattr_cache_add(&lli->lli_xattrs, xdata, xval,
-						*xsizes);
+			rc = ll_xattr_cache_add(lli, xdata, xval, *xsizes);
 		}
 		if (rc < 0) {
 			ll_xattr_cache_destroy_locked(lli);
@@ -468,6 +627,11 @@ static int ll_xattr_cache_refill(struct inode *inode)
 	ll_set_lock_data(sbi->ll_md_exp, inode, &oit, NULL);
 	ll_intent_drop_lock(&oit);
 
+	spin_lock(&sbi->ll_xattr_lru_lock);
+	list_add_tail(&lli->lli_xattrs_lru, &sbi->ll_xattr_lru);
+	spin_unlock(&sbi->ll_xattr_lru_lock);
+	ll_xattr_cache_shrink(sbi, false);
+
 	ptlrpc_req_finished(req);
 	RETURN(0);
 
@@ -521,12 +685,19 @@ int ll_xattr_cache_get(struct inode *inode,
 		downgrade_write(&lli->lli_xattrs_list_rwsem);
 	} else {
 		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_GETXATTR_HITS, 1);
+		if (!ll_file_test_flag(lli, LLIF_XATTR_REFERENCED))
+			ll_file_set_flag(lli, LLIF_XATTR_REFERENCED);
 	}
 
 	if (valid & OBD_MD_FLXATTR) {
 		struct ll_xattr_entry *xattr;
 
-		rc = ll_xattr_cache_find(&lli->lli_xattrs, name, &xattr);
+		/* The cache holds every xattr of the inode for as long as
+		 * the XATTR ibits lock is granted, so a miss is final. */
+		rc = ll_xattr_cache_find(lli, name, &xattr);
+		if (rc == -ENODATA)
+			ll_stats_ops_tally(ll_i2sbi(inode),
+					   LPROC_LL_GETXATTR_NEGATIVE, 1);
 		if (rc == 0) {
 			rc = xattr->xe_vallen;
 			/* zero size means we are only requested size in rc */
@@ -539,7 +710,7 @@ int ll_xattr_cache_get(struct inode *inode,
 			}
 		}
 	} else if (valid & OBD_MD_FLXATTRLS) {
-		rc = ll_xattr_cache_list(&lli->lli_xattrs,
+		rc = ll_xattr_cache_list(lli,
 					 size ? buffer : NULL, size);
 	}
 
@@ -182,6 +182,7 @@ static ssize_t mdc_max_dirty_mb_seq_write(struct file *file,
 
 	spin_lock(&cli->cl_loi_list_lock);
 	cli->cl_dirty_max_pages = pages_number;
+	osc_grant_cache_drain(cli);
 	osc_wake_cache_waiters(cli);
 	spin_unlock(&cli->cl_loi_list_lock);
 
@@ -1404,6 +1404,14 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 	if (IS_ERR(req))
 		RETURN(PTR_ERR(req));
 
+	/* Requests collected in a batch hold their request slots but are not
+	 * sent until the batch is flushed, so flush the batch before waiting
+	 * for a slot, otherwise we could wait for our own unsent requests. */
+	if (minfo->mi_set != NULL &&
+	    obddev->u.cli.cl_rpcs_in_flight >=
+	    obddev->u.cli.cl_max_rpcs_in_flight)
+		minfo->mi_set_flush(minfo);
+
 	rc = obd_get_request_slot(&obddev->u.cli);
 	if (rc != 0) {
 		ptlrpc_req_finished(req);
@@ -1431,7 +1439,10 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 	ga->ga_minfo = minfo;
 
 	req->rq_interpret_reply = mdc_intent_getattr_async_interpret;
-	ptlrpcd_add_req(req);
+	if (minfo->mi_set != NULL)
+		ptlrpc_set_add_req(minfo->mi_set, req);
+	else
+		ptlrpcd_add_req(req);
 
 	RETURN(0);
 }
@@ -2660,6 +2660,7 @@ static int mdc_import_event(struct obd_device *obd, struct obd_import *imp,
 	switch (event) {
 	case IMP_EVENT_DISCON:
 		spin_lock(&cli->cl_loi_list_lock);
+		osc_grant_cache_drain(cli);
 		cli->cl_avail_grant = 0;
 		cli->cl_lost_grant = 0;
 		spin_unlock(&cli->cl_loi_list_lock);
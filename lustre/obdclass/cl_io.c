@@ -43,6 +43,7 @@
 #include <obd_class.h>
 #include <obd_support.h>
 #include <lustre_fid.h>
+#include <lustre_compat.h>
 #include <cl_object.h>
 #include "cl_internal.h"
 
@@ -1118,7 +1119,7 @@ EXPORT_SYMBOL(cl_req_attr_set);
  * \param nr number of pages initally pending in sync.
  * \param end optional callback sync_io completion, can be used to
  *  trigger erasure coding, integrity, dedupe, or similar operation.
- * \q end is called with a spinlock on anchor->csi_waitq.lock
+ * \q end is called without any lock held, before the waiter is woken up.
  */
 
 void cl_sync_io_init_notify(struct cl_sync_io *anchor, int nr,
@@ -1128,6 +1129,7 @@ void cl_sync_io_init_notify(struct cl_sync_io *anchor, int nr,
 	memset(anchor, 0, sizeof(*anchor));
 	init_waitqueue_head(&anchor->csi_waitq);
 	atomic_set(&anchor->csi_sync_nr, nr);
+	atomic_set(&anchor->csi_complete, 0);
 	anchor->csi_sync_rc = 0;
 	anchor->csi_end_io = end;
 	EXIT;
@@ -1149,7 +1151,7 @@ int cl_sync_io_wait(const struct lu_env *env, struct cl_sync_io *anchor,
 	LASSERT(timeout >= 0);
 
 	rc = l_wait_event(anchor->csi_waitq,
-			  atomic_read(&anchor->csi_sync_nr) == 0,
+			  atomic_read(&anchor->csi_complete) == 1,
 			  &lwi);
 	if (rc < 0) {
 		CERROR("IO failed: %d, still wait for %d remaining entries\n",
@@ -1157,7 +1159,7 @@ int cl_sync_io_wait(const struct lu_env *env, struct cl_sync_io *anchor,
 
 		lwi = (struct l_wait_info) { 0 };
 		(void)l_wait_event(anchor->csi_waitq,
-				   atomic_read(&anchor->csi_sync_nr) == 0,
+				   atomic_read(&anchor->csi_complete) == 1,
 				   &lwi);
 	} else {
 		rc = anchor->csi_sync_rc;
@@ -1171,6 +1173,90 @@ int cl_sync_io_wait(const struct lu_env *env, struct cl_sync_io *anchor,
 }
 EXPORT_SYMBOL(cl_sync_io_wait);
 
+/**
+ * Wait until all IO of a reusable anchor completes.
+ *
+ * The anchor is set up with one extra reference held by the submitter, so
+ * that it is not completed before all pages are submitted. Drop it, wait for
+ * the transfer, and take it again so that the anchor can be used for more
+ * pages.
+ */
+int cl_sync_io_wait_recycle(const struct lu_env *env,
+			    struct cl_sync_io *anchor, long timeout,
+			    int ioret)
+{
+	int rc;
+
+	cl_sync_io_note(env, anchor, ioret);
+	rc = cl_sync_io_wait(env, anchor, timeout);
+	atomic_inc(&anchor->csi_sync_nr);
+	atomic_set(&anchor->csi_complete, 0);
+
+	return rc;
+}
+EXPORT_SYMBOL(cl_sync_io_wait_recycle);
+
+/**
+ * Release direct IO pages and complete asynchronous kiocb, this is called
+ * when all pages of \a anchor finished transfer.
+ *
+ * The user pages read into are dirtied only here, since the data doesn't
+ * land in them until the transfer is done.
+ */
+static void cl_aio_end(const struct lu_env *env, struct cl_sync_io *anchor)
+{
+	struct cl_dio_aio *aio = container_of(anchor, typeof(*aio), cda_sync);
+	ssize_t ret = anchor->csi_sync_rc;
+	struct cl_page *page;
+	struct cl_page *temp;
+
+	ENTRY;
+	/* pages are not owned by any IO after transfer, and the owner of
+	 * the list may be another thread, release them directly */
+	cl_page_list_for_each_safe(page, temp, &aio->cda_pages) {
+		list_del_init(&page->cp_batch);
+		--aio->cda_pages.pl_nr;
+		lu_ref_del_at(&page->cp_reference, &page->cp_queue_ref,
+			      "queue", &aio->cda_pages);
+		if (aio->cda_read)
+			set_page_dirty_lock(cl_page_vmpage(page));
+		cl_page_delete(env, page);
+		cl_page_put(env, page);
+	}
+	LASSERT(aio->cda_pages.pl_nr == 0);
+
+	if (aio->cda_iocb != NULL && !aio->cda_no_aio_complete)
+		aio_complete(aio->cda_iocb, ret ?: aio->cda_bytes, 0);
+
+	EXIT;
+}
+
+struct cl_dio_aio *cl_aio_alloc(struct kiocb *iocb)
+{
+	struct cl_dio_aio *aio;
+
+	OBD_ALLOC_PTR(aio);
+	if (aio != NULL) {
+		/* Hold one reference so that it won't be completed until
+		 * every page is submitted. */
+		cl_sync_io_init_notify(&aio->cda_sync, 1, cl_aio_end);
+		cl_page_list_init(&aio->cda_pages);
+		aio->cda_iocb = iocb;
+		/* nobody waits for asynchronous kiocb */
+		if (iocb != NULL)
+			aio->cda_sync.csi_aio = aio;
+	}
+	return aio;
+}
+EXPORT_SYMBOL(cl_aio_alloc);
+
+void cl_aio_free(struct cl_dio_aio *aio)
+{
+	if (aio != NULL)
+		OBD_FREE_PTR(aio);
+}
+EXPORT_SYMBOL(cl_aio_free);
+
 /**
  * Indicate that transfer of a single page completed.
  */
@@ -1189,21 +1275,34 @@ void cl_sync_io_note(const struct lu_env *env, struct cl_sync_io *anchor,
 	if (atomic_dec_and_lock(&anchor->csi_sync_nr,
 				&anchor->csi_waitq.lock)) {
 		cl_sync_io_end_t *end_io = anchor->csi_end_io;
+		struct cl_dio_aio *aio = anchor->csi_aio;
+
+		/* end_io may sleep, e.g. to dirty the pages of a direct
+		 * read, so call it without the lock. The waiter doesn't
+		 * return until csi_complete is set below. */
+		spin_unlock(&anchor->csi_waitq.lock);
+		if (end_io)
+			end_io(env, anchor);
 
 		/*
-		 * Holding the lock across both the decrement and
+		 * Holding the lock across both the completion and
 		 * the wakeup ensures cl_sync_io_wait() doesn't complete
 		 * before the wakeup completes and the contents of
 		 * of anchor become unsafe to access as the owner is free
 		 * to immediately reclaim anchor when cl_sync_io_wait()
 		 * completes.
 		 */
+		spin_lock(&anchor->csi_waitq.lock);
+		atomic_set(&anchor->csi_complete, 1);
 		wake_up_all_locked(&anchor->csi_waitq);
-		if (end_io)
-			end_io(env, anchor);
 		spin_unlock(&anchor->csi_waitq.lock);
 
 		/* Can't access anchor any more */
+
+		/* nobody waits for asynchronous direct IO, so it is freed
+		 * here instead of after cl_sync_io_wait() */
+		if (aio != NULL)
+			cl_aio_free(aio);
 	}
 	EXIT;
 }
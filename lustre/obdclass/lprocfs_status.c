@@ -786,6 +786,9 @@ static const char *obd_connect_names[] = {
 	"pcc",			/* 0x1000 */
 	"plain_layout",		/* 0x2000 */
 	"async_discard",	/* 0x4000 */
+	"compress",		/* 0x8000 */
+	"multiobj_brw",		/* 0x10000 */
+	"batch_rpc",		/* 0x20000 */
 	NULL
 };
 
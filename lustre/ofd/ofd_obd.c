@@ -45,6 +45,7 @@
 
 #include "ofd_internal.h"
 #include <obd_cksum.h>
+#include <obd_compress.h>
 #include <uapi/linux/lustre/lustre_ioctl.h>
 #include <lustre_quota.h>
 #include <lustre_lfsck.h>
@@ -250,6 +251,12 @@ static int ofd_parse_connect_data(const struct lu_env *env,
 	if (data->ocd_connect_flags & OBD_CONNECT_FLAGS2)
 		data->ocd_connect_flags2 &= OST_CONNECT_SUPPORTED2;
 
+	/* compressed writes are unpacked in tgt_brw_write(), so only accept
+	 * them if every algorithm the client may pick is available here */
+	if (data->ocd_connect_flags2 & OBD_CONNECT2_COMPRESS &&
+	    !obd_compress_supported())
+		data->ocd_connect_flags2 &= ~OBD_CONNECT2_COMPRESS;
+
 	/* Kindly make sure the SKIP_ORPHAN flag is from MDS. */
 	if (data->ocd_connect_flags & OBD_CONNECT_MDS)
 		CDEBUG(D_HA, "%s: Received MDS connection for group %u\n",
@@ -176,6 +176,7 @@ static ssize_t max_dirty_mb_store(struct kobject *kobj,
 
 	spin_lock(&cli->cl_loi_list_lock);
 	cli->cl_dirty_max_pages = pages_number;
+	osc_grant_cache_drain(cli);
 	osc_wake_cache_waiters(cli);
 	spin_unlock(&cli->cl_loi_list_lock);
 
@@ -258,10 +259,14 @@ static ssize_t cur_dirty_bytes_show(struct kobject *kobj,
 	struct obd_device *dev = container_of(kobj, struct obd_device,
 					      obd_kset.kobj);
 	struct client_obd *cli = &dev->u.cli;
+	unsigned long pages, grant;
 	ssize_t len;
 
+	/* pages cached by the CPTs are accounted but not dirty yet */
 	spin_lock(&cli->cl_loi_list_lock);
-	len = sprintf(buf, "%lu\n", cli->cl_dirty_pages << PAGE_SHIFT);
+	osc_grant_cache_sum(cli, &pages, &grant);
+	len = sprintf(buf, "%lu\n",
+		      (cli->cl_dirty_pages - pages) << PAGE_SHIFT);
 	spin_unlock(&cli->cl_loi_list_lock);
 
 	return len;
@@ -272,9 +277,12 @@ static int osc_cur_grant_bytes_seq_show(struct seq_file *m, void *v)
 {
 	struct obd_device *dev = m->private;
 	struct client_obd *cli = &dev->u.cli;
+	unsigned long pages, grant;
 
+	/* grant cached by the CPTs is still available */
 	spin_lock(&cli->cl_loi_list_lock);
-	seq_printf(m, "%lu\n", cli->cl_avail_grant);
+	osc_grant_cache_sum(cli, &pages, &grant);
+	seq_printf(m, "%lu\n", cli->cl_avail_grant + grant);
 	spin_unlock(&cli->cl_loi_list_lock);
 	return 0;
 }
@@ -299,6 +307,7 @@ static ssize_t osc_cur_grant_bytes_seq_write(struct file *file,
 
 	/* this is only for shrinking grant */
 	spin_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
 	if (val >= cli->cl_avail_grant) {
 		spin_unlock(&cli->cl_loi_list_lock);
 		return 0;
@@ -450,6 +459,97 @@ static ssize_t osc_checksum_type_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(osc_checksum_type);
 
+static int osc_compress_type_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *obd = m->private;
+	int i;
+	DECLARE_COMPRESS_NAME;
+
+	if (obd == NULL)
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(compress_name); i++) {
+		if (obd->u.cli.cl_compress_type == i)
+			seq_printf(m, "[%s] ", compress_name[i]);
+		else
+			seq_printf(m, "%s ", compress_name[i]);
+	}
+	seq_printf(m, "\n");
+	return 0;
+}
+
+static ssize_t osc_compress_type_seq_write(struct file *file,
+					   const char __user *buffer,
+					   size_t count, loff_t *off)
+{
+	struct obd_device *obd = ((struct seq_file *)file->private_data)->private;
+	const char *alg;
+	int i;
+	DECLARE_COMPRESS_NAME;
+	char kernbuf[10];
+
+	if (obd == NULL)
+		return 0;
+
+	if (count > sizeof(kernbuf) - 1)
+		return -EINVAL;
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+	if (count > 0 && kernbuf[count - 1] == '\n')
+		kernbuf[count - 1] = '\0';
+	else
+		kernbuf[count] = '\0';
+
+	for (i = 0; i < ARRAY_SIZE(compress_name); i++) {
+		if (strcmp(kernbuf, compress_name[i]) != 0)
+			continue;
+
+		alg = obd_compress_alg(i);
+		if (alg != NULL && !crypto_has_comp(alg, 0, 0))
+			return -EOPNOTSUPP;
+
+		obd->u.cli.cl_compress_type = i;
+		return count;
+	}
+	return -EINVAL;
+}
+LPROC_SEQ_FOPS(osc_compress_type);
+
+static int osc_compress_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct client_obd *cli = &dev->u.cli;
+	long in = atomic_long_read(&cli->cl_compress_bytes_in);
+	long out = atomic_long_read(&cli->cl_compress_bytes_out);
+
+	seq_printf(m, "compressed_rpcs:    %20ld\n"
+		   "skipped_rpcs:       %20ld\n"
+		   "uncompressed_bytes: %20ld\n"
+		   "compressed_bytes:   %20ld\n"
+		   "ratio_pct:          %20ld\n",
+		   atomic_long_read(&cli->cl_compress_rpcs),
+		   atomic_long_read(&cli->cl_compress_skipped),
+		   in, out, in ? out * 100 / in : 0);
+	return 0;
+}
+
+static ssize_t osc_compress_stats_seq_write(struct file *file,
+					    const char __user *buffer,
+					    size_t count, loff_t *off)
+{
+	struct seq_file *seq = file->private_data;
+	struct obd_device *dev = seq->private;
+	struct client_obd *cli = &dev->u.cli;
+
+	atomic_long_set(&cli->cl_compress_rpcs, 0);
+	atomic_long_set(&cli->cl_compress_skipped, 0);
+	atomic_long_set(&cli->cl_compress_bytes_in, 0);
+	atomic_long_set(&cli->cl_compress_bytes_out, 0);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osc_compress_stats);
+
 static ssize_t resend_count_show(struct kobject *kobj,
 				 struct attribute *attr,
 				 char *buf)
@@ -590,6 +690,39 @@ LPROC_SEQ_FOPS_RW_TYPE(osc, obd_max_pages_per_rpc);
 
 LUSTRE_RW_ATTR(short_io_bytes);
 
+static ssize_t max_objs_per_rpc_show(struct kobject *kobj,
+				     struct attribute *attr,
+				     char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.cli.cl_max_objs_per_rpc);
+}
+
+static ssize_t max_objs_per_rpc_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer,
+				      size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > OST_MAX_BRW_OBJS)
+		return -ERANGE;
+
+	obd->u.cli.cl_max_objs_per_rpc = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(max_objs_per_rpc);
+
 #ifdef CONFIG_PROC_FS
 static int osc_unstable_stats_seq_show(struct seq_file *m, void *v)
 {
@@ -767,6 +900,10 @@ struct lprocfs_vars lprocfs_osc_obd_vars[] = {
 	  .fops =	&osc_cur_grant_bytes_fops	},
 	{ .name	=	"checksum_type",
 	  .fops	=	&osc_checksum_type_fops		},
+	{ .name	=	"compress_type",
+	  .fops	=	&osc_compress_type_fops		},
+	{ .name	=	"compress_stats",
+	  .fops	=	&osc_compress_stats_fops	},
 	{ .name	=	"timeouts",
 	  .fops	=	&osc_timeouts_fops		},
 	{ .name	=	"import",
@@ -955,6 +1092,7 @@ static struct attribute *osc_attrs[] = {
 	&lustre_attr_lockless_truncate.attr,
 	&lustre_attr_max_dirty_mb.attr,
 	&lustre_attr_max_rpcs_in_flight.attr,
+	&lustre_attr_max_objs_per_rpc.attr,
 	&lustre_attr_short_io_bytes.attr,
 	&lustre_attr_resend_count.attr,
 	&lustre_attr_ost_conn_uuid.attr,
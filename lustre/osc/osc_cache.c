@@ -1574,6 +1574,220 @@ out:
 	return rc;
 }
 
+/* number of dirty pages each CPT takes from the shared pool at once */
+#define OSC_GRANT_CACHE_PAGES	32
+
+int osc_grant_cache_init(struct client_obd *cli)
+{
+	struct osc_grant_cache *ogc;
+	int i;
+
+	cli->cl_grant_cache = cfs_percpt_alloc(cfs_cpt_table, sizeof(*ogc));
+	if (cli->cl_grant_cache == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(ogc, i, cli->cl_grant_cache)
+		spin_lock_init(&ogc->ogc_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(osc_grant_cache_init);
+
+void osc_grant_cache_fini(struct client_obd *cli)
+{
+	if (cli->cl_grant_cache == NULL)
+		return;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	cfs_percpt_free(cli->cl_grant_cache);
+	cli->cl_grant_cache = NULL;
+}
+EXPORT_SYMBOL(osc_grant_cache_fini);
+
+/**
+ * Return all cached credits to the shared counters of \a cli.
+ *
+ * This has to be done before anybody relies on cl_avail_grant or
+ * cl_dirty_pages being exact: before waiting for grant, before shrinking
+ * or resetting grant and when the dirty limit changes.
+ *
+ * client_obd_list_lock held by caller
+ */
+void osc_grant_cache_drain(struct client_obd *cli)
+{
+	struct osc_grant_cache *ogc;
+	unsigned long pages = 0;
+	unsigned long grant = 0;
+	int i;
+
+	assert_spin_locked(&cli->cl_loi_list_lock);
+	if (cli->cl_grant_cache == NULL)
+		return;
+
+	cfs_percpt_for_each(ogc, i, cli->cl_grant_cache) {
+		spin_lock(&ogc->ogc_lock);
+		pages += ogc->ogc_pages;
+		grant += ogc->ogc_grant;
+		ogc->ogc_pages = 0;
+		ogc->ogc_grant = 0;
+		spin_unlock(&ogc->ogc_lock);
+	}
+
+	if (pages == 0 && grant == 0)
+		return;
+
+	atomic_long_sub(pages, &obd_dirty_pages);
+	cli->cl_dirty_pages -= pages;
+	cli->cl_dirty_grant -= grant;
+	cli->cl_avail_grant += grant;
+	CDEBUG(D_CACHE, "%s: drained %lu pages and %lu grant\n",
+	       cli_name(cli), pages, grant);
+}
+EXPORT_SYMBOL(osc_grant_cache_drain);
+
+/* credits currently held in the per-CPT caches, for reporting only */
+void osc_grant_cache_sum(struct client_obd *cli, unsigned long *pages,
+			 unsigned long *grant)
+{
+	struct osc_grant_cache *ogc;
+	int i;
+
+	*pages = 0;
+	*grant = 0;
+	if (cli->cl_grant_cache == NULL)
+		return;
+
+	cfs_percpt_for_each(ogc, i, cli->cl_grant_cache) {
+		*pages += READ_ONCE(ogc->ogc_pages);
+		*grant += READ_ONCE(ogc->ogc_grant);
+	}
+}
+EXPORT_SYMBOL(osc_grant_cache_sum);
+
+/**
+ * Move a batch of credits from the shared pool into \a ogc.
+ *
+ * The batch is counted as dirty right away, both in pages and in grant, so
+ * that taking one credit from the cache does not touch the shared counters.
+ * Nothing is taken if somebody waits for grant or if the pool would drop
+ * below one more batch, so that the CPTs cannot starve each other.
+ *
+ * client_obd_list_lock held by caller
+ */
+static void osc_grant_cache_fill(struct client_obd *cli,
+				 struct osc_grant_cache *ogc,
+				 unsigned int bytes)
+{
+	unsigned long pages = OSC_GRANT_CACHE_PAGES;
+	unsigned long grant = (OSC_GRANT_CACHE_PAGES << PAGE_SHIFT) + bytes;
+
+	assert_spin_locked(&cli->cl_loi_list_lock);
+	if (!list_empty(&cli->cl_cache_waiters) ||
+	    cli->cl_dirty_pages + 2 * pages > cli->cl_dirty_max_pages ||
+	    cli->cl_avail_grant < 2 * grant)
+		return;
+
+	if (atomic_long_add_return(pages, &obd_dirty_pages) + pages >
+	    obd_max_dirty_pages) {
+		atomic_long_sub(pages, &obd_dirty_pages);
+		return;
+	}
+
+	cli->cl_dirty_pages += pages;
+	cli->cl_avail_grant -= grant;
+	cli->cl_dirty_grant += grant;
+	osc_update_next_shrink(cli);
+
+	spin_lock(&ogc->ogc_lock);
+	ogc->ogc_pages += pages;
+	ogc->ogc_grant += grant;
+	spin_unlock(&ogc->ogc_lock);
+}
+
+static int osc_grant_cache_take(struct osc_grant_cache *ogc,
+				struct osc_async_page *oap, unsigned int bytes)
+{
+	int rc = 0;
+
+	spin_lock(&ogc->ogc_lock);
+	if (ogc->ogc_pages > 0 && ogc->ogc_grant >= bytes) {
+		LASSERT(!(oap->oap_brw_flags & OBD_BRW_FROM_GRANT));
+		ogc->ogc_pages--;
+		ogc->ogc_grant -= bytes;
+		oap->oap_brw_flags |= OBD_BRW_FROM_GRANT;
+		rc = 1;
+	}
+	spin_unlock(&ogc->ogc_lock);
+
+	return rc;
+}
+
+/**
+ * Account a dirty page and \a bytes of grant for \a oap from the cache of
+ * the current CPT, refilling it from the shared pool if it runs dry.
+ *
+ * In contrast to osc_enter_cache_try() the grant is returned as consumed
+ * (it is already part of cl_dirty_grant) and what is left unused must be
+ * given back by osc_grant_cache_put().
+ *
+ * \retval 1	credits were taken
+ * \retval 0	not enough credits, the caller has to use the slow path
+ */
+static int osc_grant_cache_get(struct client_obd *cli,
+			       struct osc_async_page *oap, unsigned int bytes)
+{
+	struct osc_grant_cache *ogc;
+	int rc;
+
+	if (cli->cl_grant_cache == NULL)
+		return 0;
+
+	ogc = cli->cl_grant_cache[cfs_cpt_current(cfs_cpt_table, 1)];
+	rc = osc_grant_cache_take(ogc, oap, bytes);
+	if (rc)
+		return rc;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_fill(cli, ogc, bytes);
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	return osc_grant_cache_take(ogc, oap, bytes);
+}
+
+/* the companion of osc_grant_cache_get(), see osc_unreserve_grant() */
+static void osc_grant_cache_put(struct client_obd *cli, unsigned int reserved,
+				unsigned int unused)
+{
+	struct osc_grant_cache *ogc;
+
+	/* give the grant to the waiters rather than keeping it locally */
+	if (unused > reserved || !list_empty(&cli->cl_cache_waiters)) {
+		spin_lock(&cli->cl_loi_list_lock);
+		cli->cl_dirty_grant -= unused;
+		if (unused > reserved) {
+			cli->cl_avail_grant += reserved;
+			cli->cl_lost_grant  += unused - reserved;
+		} else {
+			cli->cl_avail_grant += unused;
+		}
+		if (unused > 0)
+			osc_wake_cache_waiters(cli);
+		spin_unlock(&cli->cl_loi_list_lock);
+		return;
+	}
+
+	if (unused == 0)
+		return;
+
+	ogc = cli->cl_grant_cache[cfs_cpt_current(cfs_cpt_table, 1)];
+	spin_lock(&ogc->ogc_lock);
+	ogc->ogc_grant += unused;
+	spin_unlock(&ogc->ogc_lock);
+}
+
 static int ocw_granted(struct client_obd *cli, struct osc_cache_waiter *ocw)
 {
 	int rc;
@@ -1623,6 +1837,14 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 		GOTO(out, rc = 0);
 	}
 
+	/* the credits cached by the CPTs may be just what is missing */
+	osc_grant_cache_drain(cli);
+	if (list_empty(&cli->cl_cache_waiters) &&
+	    osc_enter_cache_try(cli, oap, bytes, 0)) {
+		OSC_DUMP_GRANT(D_CACHE, cli, "granted from CPT caches\n");
+		GOTO(out, rc = 0);
+	}
+
 	/* We can get here for two reasons: too many dirty pages in cache, or
 	 * run out of grants. In both cases we should write dirty pages out.
 	 * Adding a cache waiter will trigger urgent write-out no matter what
@@ -1656,6 +1878,7 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 
 		if (rc != -EDQUOT)
 			break;
+		osc_grant_cache_drain(cli);
 		if (osc_enter_cache_try(cli, oap, bytes, 0)) {
 			rc = 0;
 			break;
@@ -1701,6 +1924,9 @@ void osc_wake_cache_waiters(struct client_obd *cli)
 	struct osc_cache_waiter *ocw;
 
 	ENTRY;
+	if (!list_empty(&cli->cl_cache_waiters))
+		osc_grant_cache_drain(cli);
+
 	list_for_each_safe(l, tmp, &cli->cl_cache_waiters) {
 		ocw = list_entry(l, struct osc_cache_waiter, ocw_entry);
 
@@ -2016,38 +2242,31 @@ static int try_to_add_extent_for_io(struct client_obd *cli,
  * 6. Above steps exit if there is no space in this RPC.
  */
 static unsigned int get_write_extents(struct osc_object *obj,
-				      struct list_head *rpclist)
+				      struct extent_rpc_data *data)
 {
 	struct client_obd *cli = osc_cli(obj);
 	struct osc_extent *ext;
-	struct extent_rpc_data data = {
-		.erd_rpc_list	= rpclist,
-		.erd_page_count	= 0,
-		.erd_max_pages	= cli->cl_max_pages_per_rpc,
-		.erd_max_chunks	= osc_max_write_chunks(cli),
-		.erd_max_extents = 256,
-	};
 
 	LASSERT(osc_object_is_locked(obj));
 	while (!list_empty(&obj->oo_hp_exts)) {
 		ext = list_entry(obj->oo_hp_exts.next, struct osc_extent,
 				 oe_link);
 		LASSERT(ext->oe_state == OES_CACHE);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
-		EASSERT(ext->oe_nr_pages <= data.erd_max_pages, ext);
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
+		EASSERT(ext->oe_nr_pages <= data->erd_max_pages, ext);
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	while (!list_empty(&obj->oo_urgent_exts)) {
 		ext = list_entry(obj->oo_urgent_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	/* One key difference between full extents and other extents: full
 	 * extents can usually only be added if the rpclist was empty, so if we
@@ -2057,11 +2276,11 @@ static unsigned int get_write_extents(struct osc_object *obj,
 	while (!list_empty(&obj->oo_full_exts)) {
 		ext = list_entry(obj->oo_full_exts.next,
 				 struct osc_extent, oe_link);
-		if (!try_to_add_extent_for_io(cli, ext, &data))
+		if (!try_to_add_extent_for_io(cli, ext, data))
 			break;
 	}
-	if (data.erd_page_count == data.erd_max_pages)
-		return data.erd_page_count;
+	if (data->erd_page_count == data->erd_max_pages)
+		return data->erd_page_count;
 
 	ext = first_extent(obj);
 	while (ext != NULL) {
@@ -2072,12 +2291,153 @@ static unsigned int get_write_extents(struct osc_object *obj,
 			continue;
 		}
 
-		if (!try_to_add_extent_for_io(cli, ext, &data))
-			return data.erd_page_count;
+		if (!try_to_add_extent_for_io(cli, ext, data))
+			return data->erd_page_count;
 
 		ext = next_extent(ext);
 	}
-	return data.erd_page_count;
+	return data->erd_page_count;
+}
+
+/**
+ * Add the write extents of \a osc to the RPC described by \a data and
+ * mark them for IO.
+ *
+ * \return the number of pages of \a osc added to the RPC
+ */
+static unsigned int osc_prep_write_extents(struct osc_object *osc,
+					   struct extent_rpc_data *data)
+{
+	struct list_head *last = data->erd_rpc_list->prev;
+	struct osc_extent *ext;
+	unsigned int page_count;
+
+	LASSERT(osc_object_is_locked(osc));
+
+	get_write_extents(osc, data);
+	if (last == data->erd_rpc_list->prev)
+		return 0;
+
+	ext = list_entry(last->next, struct osc_extent, oe_link);
+	page_count = 0;
+	list_for_each_entry_from(ext, data->erd_rpc_list, oe_link) {
+		LASSERT(ext->oe_state == OES_CACHE ||
+			ext->oe_state == OES_LOCK_DONE);
+		if (ext->oe_state == OES_CACHE)
+			osc_extent_state_set(ext, OES_LOCKING);
+		else
+			osc_extent_state_set(ext, OES_RPC);
+		page_count += ext->oe_nr_pages;
+	}
+	osc_update_pending(osc, OBD_BRW_WRITE, -page_count);
+
+	return page_count;
+}
+
+#define list_to_obj(list, item) ({					      \
+	struct list_head *__tmp = (list)->next;				      \
+	list_del_init(__tmp);					      \
+	list_entry(__tmp, struct osc_object, oo_##item);		      \
+})
+
+static bool osc_rpclist_has_obj(struct list_head *rpclist,
+				struct osc_object *osc)
+{
+	struct osc_extent *ext;
+
+	list_for_each_entry(ext, rpclist, oe_link)
+		if (ext->oe_obj == osc)
+			return true;
+	return false;
+}
+
+/**
+ * Copy the jobid which an RPC for the pages of \a osc is tagged with into
+ * \a jobid, see osc_build_rpc().
+ */
+static void osc_obj_jobid(const struct lu_env *env, struct osc_object *osc,
+			  char *jobid)
+{
+	struct osc_thread_info *info = osc_env_info(env);
+	struct cl_req_attr *attr = &info->oti_req_attr;
+
+	memset(attr, 0, sizeof(*attr));
+	attr->cra_type = CRT_WRITE;
+	attr->cra_oa = &info->oti_oa;
+	cl_req_attr_set(env, osc2cl(osc), attr);
+	memcpy(jobid, attr->cra_jobid, sizeof(attr->cra_jobid));
+}
+
+/**
+ * Fill a write RPC which its own object could not fill with the extents
+ * of other objects ready for IO, so that many small files do not need
+ * one RPC each. The extents stay grouped by object in the RPC list, see
+ * osc_build_rpc(). The RPC is tagged with a single jobid, so only objects
+ * written by the same job as the first one are packed.
+ *
+ * Only one object lock is held at a time, hence objects are taken off
+ * the ready list one by one under cl_loi_list_lock.
+ */
+static void osc_pack_write_objs(const struct lu_env *env,
+				struct client_obd *cli,
+				struct extent_rpc_data *data)
+{
+	struct osc_extent *first;
+	char jobid[LUSTRE_JOBID_SIZE];
+	char obj_jobid[LUSTRE_JOBID_SIZE];
+	unsigned int nr_objs = 1;
+
+	if (cli->cl_max_objs_per_rpc <= 1 || cli->cl_import == NULL ||
+	    !imp_connect_multiobj_brw(cli->cl_import))
+		return;
+
+	/* lockless and memory pressure IO is sent object by object */
+	first = list_first_entry(data->erd_rpc_list, struct osc_extent,
+				 oe_link);
+	if (first->oe_srvlock || first->oe_memalloc)
+		return;
+	osc_obj_jobid(env, first->oe_obj, jobid);
+
+	spin_lock(&cli->cl_loi_list_lock);
+	while (nr_objs < cli->cl_max_objs_per_rpc &&
+	       data->erd_page_count < data->erd_max_pages &&
+	       !list_empty(&cli->cl_loi_ready_list)) {
+		struct osc_object *osc;
+		struct cl_object *obj;
+		unsigned int page_count = 0;
+
+		osc = list_to_obj(&cli->cl_loi_ready_list, ready_item);
+		if (osc_rpclist_has_obj(data->erd_rpc_list, osc)) {
+			/* put back by somebody else while we were packing */
+			__osc_list_maint(cli, osc);
+			break;
+		}
+
+		obj = osc2cl(osc);
+		cl_object_get(obj);
+		spin_unlock(&cli->cl_loi_list_lock);
+
+		osc_obj_jobid(env, osc, obj_jobid);
+		if (strncmp(jobid, obj_jobid, sizeof(jobid)) == 0) {
+			osc_object_lock(osc);
+			if (osc_makes_rpc(cli, osc, OBD_BRW_WRITE))
+				page_count = osc_prep_write_extents(osc, data);
+			osc_object_unlock(osc);
+		}
+
+		osc_list_maint(cli, osc);
+		cl_object_put(env, obj);
+
+		spin_lock(&cli->cl_loi_list_lock);
+		if (page_count == 0)
+			break;
+		nr_objs++;
+	}
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	if (nr_objs > 1)
+		CDEBUG(D_CACHE, "%s: packed %u objects, %u pages in one RPC\n",
+		       cli_name(cli), nr_objs, data->erd_page_count);
 }
 
 static int
@@ -2086,6 +2446,13 @@ osc_send_write_rpc(const struct lu_env *env, struct client_obd *cli,
 __must_hold(osc)
 {
 	struct list_head   rpclist = LIST_HEAD_INIT(rpclist);
+	struct extent_rpc_data data = {
+		.erd_rpc_list	= &rpclist,
+		.erd_page_count	= 0,
+		.erd_max_pages	= cli->cl_max_pages_per_rpc,
+		.erd_max_chunks	= osc_max_write_chunks(cli),
+		.erd_max_extents = 256,
+	};
 	struct osc_extent *ext;
 	struct osc_extent *tmp;
 	struct osc_extent *first = NULL;
@@ -2096,27 +2463,20 @@ __must_hold(osc)
 
 	LASSERT(osc_object_is_locked(osc));
 
-	page_count = get_write_extents(osc, &rpclist);
+	page_count = osc_prep_write_extents(osc, &data);
 	LASSERT(equi(page_count == 0, list_empty(&rpclist)));
 
 	if (list_empty(&rpclist))
 		RETURN(0);
 
-	osc_update_pending(osc, OBD_BRW_WRITE, -page_count);
-
-	list_for_each_entry(ext, &rpclist, oe_link) {
-		LASSERT(ext->oe_state == OES_CACHE ||
-			ext->oe_state == OES_LOCK_DONE);
-		if (ext->oe_state == OES_CACHE)
-			osc_extent_state_set(ext, OES_LOCKING);
-		else
-			osc_extent_state_set(ext, OES_RPC);
-	}
-
 	/* we're going to grab page lock, so release object lock because
 	 * lock order is page lock -> object lock. */
 	osc_object_unlock(osc);
 
+	if (data.erd_page_count < data.erd_max_pages)
+		osc_pack_write_objs(env, cli, &data);
+	page_count = data.erd_page_count;
+
 	list_for_each_entry_safe(ext, tmp, &rpclist, oe_link) {
 		if (ext->oe_state == OES_LOCKING) {
 			rc = osc_extent_make_ready(env, ext);
@@ -2195,12 +2555,6 @@ __must_hold(osc)
 	RETURN(rc);
 }
 
-#define list_to_obj(list, item) ({					      \
-	struct list_head *__tmp = (list)->next;				      \
-	list_del_init(__tmp);					      \
-	list_entry(__tmp, struct osc_object, oo_##item);		      \
-})
-
 /* This is called by osc_check_rpcs() to find which objects have pages that
  * we could be sending.  These lists are maintained by osc_makes_rpc(). */
 static struct osc_object *osc_next_obj(struct client_obd *cli)
@@ -2365,6 +2719,7 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 	pgoff_t index;
 	unsigned int tmp;
 	unsigned int grants = 0;
+	bool grant_cached = false;
 	u32    brw_flags = OBD_BRW_ASYNC;
 	int    cmd = OBD_BRW_WRITE;
 	int    need_release = 0;
@@ -2438,8 +2793,7 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 			grants = 0;
 
 		/* it doesn't need any grant to dirty this page */
-		spin_lock(&cli->cl_loi_list_lock);
-		rc = osc_enter_cache_try(cli, oap, grants, 0);
+		rc = osc_grant_cache_get(cli, oap, grants);
 		if (rc == 0) { /* try failed */
 			grants = 0;
 			need_release = 1;
@@ -2450,14 +2804,14 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 			if (rc < 0) {
 				need_release = 1;
 				/* don't free reserved grant */
+				grant_cached = true;
 			} else {
 				OSC_EXTENT_DUMP(D_CACHE, ext,
 						"expanded for %lu.\n", index);
-				osc_unreserve_grant_nolock(cli, grants, tmp);
+				osc_grant_cache_put(cli, grants, tmp);
 				grants = 0;
 			}
 		}
-		spin_unlock(&cli->cl_loi_list_lock);
 		rc = 0;
 	} else if (ext != NULL) {
 		/* index is located outside of active extent */
@@ -2498,7 +2852,9 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 				oio->oi_active = ext;
 			}
 		}
-		if (grants > 0)
+		if (grants > 0 && grant_cached)
+			osc_grant_cache_put(cli, grants, tmp);
+		else if (grants > 0)
 			osc_unreserve_grant(cli, grants, tmp);
 	}
 
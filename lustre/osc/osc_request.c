@@ -640,15 +640,23 @@ static void osc_announce_cached(struct client_obd *cli, struct obdo *oa,
                                 long writing_bytes)
 {
 	u64 bits = OBD_MD_FLBLOCKS | OBD_MD_FLGRANT;
+	unsigned long cached_pages;
+	unsigned long cached_grant;
 
 	LASSERT(!(oa->o_valid & bits));
 
 	oa->o_valid |= bits;
 	spin_lock(&cli->cl_loi_list_lock);
+	/* credits cached per CPT are charged as dirty, but no page is using
+	 * them yet, so they are reported to the OST as available grant */
+	osc_grant_cache_sum(cli, &cached_pages, &cached_grant);
+	cached_pages = min(cached_pages, cli->cl_dirty_pages);
+	cached_grant = min(cached_grant, cli->cl_dirty_grant);
 	if (OCD_HAS_FLAG(&cli->cl_import->imp_connect_data, GRANT_PARAM))
-		oa->o_dirty = cli->cl_dirty_grant;
+		oa->o_dirty = cli->cl_dirty_grant - cached_grant;
 	else
-		oa->o_dirty = cli->cl_dirty_pages << PAGE_SHIFT;
+		oa->o_dirty = (cli->cl_dirty_pages - cached_pages) <<
+			      PAGE_SHIFT;
 	if (unlikely(cli->cl_dirty_pages - cli->cl_dirty_transit >
 		     cli->cl_dirty_max_pages)) {
 		CERROR("dirty %lu - %lu > dirty_max %lu\n",
@@ -695,7 +703,8 @@ static void osc_announce_cached(struct client_obd *cli, struct obdo *oa,
 		oa->o_undirty = min(undirty, OBD_MAX_GRANT &
 				    ~(PTLRPC_MAX_BRW_SIZE * 4UL));
         }
-	oa->o_grant = cli->cl_avail_grant + cli->cl_reserved_grant;
+	oa->o_grant = cli->cl_avail_grant + cli->cl_reserved_grant +
+		      cached_grant;
         oa->o_dropped = cli->cl_lost_grant;
         cli->cl_lost_grant = 0;
 	spin_unlock(&cli->cl_loi_list_lock);
@@ -762,6 +771,7 @@ out:
 static void osc_shrink_grant_local(struct client_obd *cli, struct obdo *oa)
 {
 	spin_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
 	oa->o_grant = cli->cl_avail_grant / 4;
 	cli->cl_avail_grant -= oa->o_grant;
 	spin_unlock(&cli->cl_loi_list_lock);
@@ -797,6 +807,7 @@ int osc_shrink_grant_to_target(struct client_obd *cli, __u64 target_bytes)
 	ENTRY;
 
 	spin_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
 	/* Don't shrink if we are already above or below the desired limit
 	 * We don't want to shrink below a single RPC, as that will negatively
 	 * impact block allocation and long-term performance. */
@@ -967,6 +978,7 @@ void osc_init_grant(struct client_obd *cli, struct obd_connect_data *ocd)
 	 * left EVICTED state, then cl_dirty_pages must be 0 already.
 	 */
 	spin_lock(&cli->cl_loi_list_lock);
+	osc_grant_cache_drain(cli);
 	cli->cl_avail_grant = ocd->ocd_grant;
 	if (cli->cl_import->imp_state != LUSTRE_IMP_EVICTED) {
 		cli->cl_avail_grant -= cli->cl_reserved_grant;
@@ -1111,6 +1123,25 @@ static inline int can_merge_pages(struct brw_page *p1, struct brw_page *p2)
         return (p1->off + p1->count == p2->off);
 }
 
+/* number of pages at the head of \a pga which belong to the same object */
+static u32 osc_brw_obj_pages(struct brw_page **pga, u32 page_count)
+{
+	struct osc_object *obj = brw_page2oap(pga[0])->oap_obj;
+	u32 i;
+
+	for (i = 1; i < page_count; i++)
+		if (brw_page2oap(pga[i])->oap_obj != obj)
+			break;
+
+	return i;
+}
+
+static inline struct obdo *osc_brw_obj_oa(struct obdo *oa, struct obdo *oas,
+					  u32 i)
+{
+	return i == 0 ? oa : &oas[i - 1];
+}
+
 #if IS_ENABLED(CONFIG_CRC_T10DIF)
 static int osc_checksum_bulk_t10pi(const char *obd_name, int nob,
 				   size_t pg_count, struct brw_page **pga,
@@ -1293,22 +1324,263 @@ static int osc_checksum_bulk_rw(const char *obd_name,
 	RETURN(rc);
 }
 
+/*
+ * A compression transform and buffers for the data of a whole RPC. Setting
+ * them up costs more than compressing the RPC, so idle contexts are kept
+ * for the next one, up to one per CPU for all OSCs together.
+ */
+struct osc_compress_ctx {
+	struct list_head	 occ_list;
+	enum obd_compress_type	 occ_type;
+	struct crypto_comp	*occ_tfm;
+	char			*occ_src;
+	char			*occ_dst;
+	int			 occ_size;
+};
+
+static DEFINE_SPINLOCK(osc_compress_lock);
+static LIST_HEAD(osc_compress_idle);
+static int osc_compress_nidle;
+
+static void osc_compress_ctx_free(struct osc_compress_ctx *ctx)
+{
+	if (ctx->occ_tfm != NULL)
+		crypto_free_comp(ctx->occ_tfm);
+	if (ctx->occ_src != NULL)
+		OBD_FREE_LARGE(ctx->occ_src, ctx->occ_size);
+	if (ctx->occ_dst != NULL)
+		OBD_FREE_LARGE(ctx->occ_dst, ctx->occ_size);
+	OBD_FREE_PTR(ctx);
+}
+
+/* get a context to compress \a nob bytes with \a type */
+static struct osc_compress_ctx *
+osc_compress_ctx_get(enum obd_compress_type type, int nob)
+{
+	struct osc_compress_ctx *ctx = NULL;
+	struct osc_compress_ctx *tmp;
+	struct crypto_comp *tfm;
+
+	spin_lock(&osc_compress_lock);
+	list_for_each_entry(tmp, &osc_compress_idle, occ_list) {
+		ctx = tmp;
+		if (tmp->occ_type == type)
+			break;
+	}
+	if (ctx != NULL) {
+		list_del(&ctx->occ_list);
+		osc_compress_nidle--;
+	}
+	spin_unlock(&osc_compress_lock);
+
+	if (ctx == NULL) {
+		OBD_ALLOC_PTR(ctx);
+		if (ctx == NULL)
+			return ERR_PTR(-ENOMEM);
+	}
+
+	if (ctx->occ_tfm == NULL || ctx->occ_type != type) {
+		tfm = crypto_alloc_comp(obd_compress_alg(type), 0, 0);
+		if (IS_ERR(tfm)) {
+			osc_compress_ctx_free(ctx);
+			return ERR_CAST(tfm);
+		}
+		if (ctx->occ_tfm != NULL)
+			crypto_free_comp(ctx->occ_tfm);
+		ctx->occ_tfm = tfm;
+		ctx->occ_type = type;
+	}
+
+	if (ctx->occ_size < nob) {
+		if (ctx->occ_src != NULL)
+			OBD_FREE_LARGE(ctx->occ_src, ctx->occ_size);
+		if (ctx->occ_dst != NULL)
+			OBD_FREE_LARGE(ctx->occ_dst, ctx->occ_size);
+		ctx->occ_size = nob;
+		OBD_ALLOC_LARGE(ctx->occ_src, nob);
+		OBD_ALLOC_LARGE(ctx->occ_dst, nob);
+		if (ctx->occ_src == NULL || ctx->occ_dst == NULL) {
+			osc_compress_ctx_free(ctx);
+			return ERR_PTR(-ENOMEM);
+		}
+	}
+
+	return ctx;
+}
+
+static void osc_compress_ctx_put(struct osc_compress_ctx *ctx)
+{
+	spin_lock(&osc_compress_lock);
+	if (osc_compress_nidle < num_online_cpus()) {
+		list_add(&ctx->occ_list, &osc_compress_idle);
+		osc_compress_nidle++;
+		ctx = NULL;
+	}
+	spin_unlock(&osc_compress_lock);
+
+	if (ctx != NULL)
+		osc_compress_ctx_free(ctx);
+}
+
+static void osc_compress_ctx_fini(void)
+{
+	struct osc_compress_ctx *ctx;
+
+	while (!list_empty(&osc_compress_idle)) {
+		ctx = list_first_entry(&osc_compress_idle,
+				       struct osc_compress_ctx, occ_list);
+		list_del(&ctx->occ_list);
+		osc_compress_ctx_free(ctx);
+	}
+	osc_compress_nidle = 0;
+}
+
+static void osc_brw_compress_free(struct brw_page **cppga, u32 cpage_count)
+{
+	u32 i;
+
+	/* the bulk descriptor holds its own reference on each page */
+	for (i = 0; i < cpage_count; i++)
+		put_page(cppga[i]->pg);
+	OBD_FREE_LARGE(cppga[0], cpage_count * sizeof(**cppga));
+	OBD_FREE_LARGE(cppga, cpage_count * sizeof(*cppga));
+}
+
+/**
+ * Compress the data of a bulk write into newly allocated pages.
+ *
+ * The pages of a BRW RPC are contiguous within each niobuf, so the data is
+ * gathered into a linear buffer and compressed as one stream. The niobufs
+ * are sent unchanged and describe the uncompressed extents, so the target
+ * only has to decompress the bulk before the usual per-page processing.
+ *
+ * \param[in] type		compression algorithm to use
+ * \param[in] page_count	number of pages in \a pga
+ * \param[in] pga		pages of the write RPC
+ * \param[out] cppga		compressed pages, for bulk and checksum
+ * \param[out] cpage_count	number of pages in \a cppga
+ * \param[out] csize		number of bytes of compressed data
+ *
+ * \retval 1		data was compressed
+ * \retval 0		data is not worth compressing
+ * \retval negative	errno on failure
+ */
+static int osc_brw_compress(enum obd_compress_type type, u32 page_count,
+			    struct brw_page **pga, struct brw_page ***cppga,
+			    u32 *cpage_count, u32 *csize)
+{
+	struct osc_compress_ctx *ctx;
+	struct brw_page *cpg = NULL;
+	struct brw_page **cppg = NULL;
+	char *src;
+	char *dst;
+	unsigned int dlen;
+	u32 count = 0;
+	int nob = 0;
+	int rc;
+	u32 i;
+
+	ENTRY;
+	for (i = 0; i < page_count; i++)
+		nob += pga[i]->count;
+
+	/* there is nothing to gain unless at least one page is saved */
+	if (nob <= PAGE_SIZE)
+		RETURN(0);
+
+	ctx = osc_compress_ctx_get(type, nob);
+	if (IS_ERR(ctx))
+		RETURN(PTR_ERR(ctx));
+	src = ctx->occ_src;
+	dst = ctx->occ_dst;
+
+	for (nob = i = 0; i < page_count; i++) {
+		char *ptr = ll_kmap_atomic(pga[i]->pg, KM_USER0);
+
+		memcpy(src + nob, ptr + (pga[i]->off & ~PAGE_MASK),
+		       pga[i]->count);
+		ll_kunmap_atomic(ptr, KM_USER0);
+		nob += pga[i]->count;
+	}
+
+	/* the compressor fails if the output would not fit into \a dst,
+	 * which just means the data is not compressible */
+	dlen = nob;
+	rc = crypto_comp_compress(ctx->occ_tfm, src, nob, dst, &dlen);
+	if (rc != 0 || dlen + PAGE_SIZE > nob)
+		GOTO(out, rc = 0);
+
+	count = DIV_ROUND_UP(dlen, PAGE_SIZE);
+	OBD_ALLOC_LARGE(cpg, count * sizeof(*cpg));
+	OBD_ALLOC_LARGE(cppg, count * sizeof(*cppg));
+	if (cpg == NULL || cppg == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (i = 0; i < count; i++) {
+		char *ptr;
+
+		cpg[i].pg = alloc_page(GFP_NOFS);
+		if (cpg[i].pg == NULL)
+			GOTO(out, rc = -ENOMEM);
+
+		cpg[i].off = (u64)i << PAGE_SHIFT;
+		cpg[i].count = min_t(u32, dlen - cpg[i].off, PAGE_SIZE);
+		cpg[i].flag = pga[0]->flag;
+		cppg[i] = &cpg[i];
+
+		ptr = ll_kmap_atomic(cpg[i].pg, KM_USER0);
+		memcpy(ptr, dst + cpg[i].off, cpg[i].count);
+		ll_kunmap_atomic(ptr, KM_USER0);
+	}
+
+	*cppga = cppg;
+	*cpage_count = count;
+	*csize = dlen;
+	rc = 1;
+out:
+	if (rc <= 0 && cpg != NULL) {
+		for (i = 0; i < count && cpg[i].pg != NULL; i++)
+			__free_page(cpg[i].pg);
+		OBD_FREE_LARGE(cpg, count * sizeof(*cpg));
+	}
+	if (rc <= 0 && cppg != NULL)
+		OBD_FREE_LARGE(cppg, count * sizeof(*cppg));
+	osc_compress_ctx_put(ctx);
+
+	RETURN(rc);
+}
+
+/**
+ * Pack a BRW RPC for \a page_count pages in \a pga.
+ *
+ * The pages may belong to \a obj_count objects if the import supports
+ * OBD_CONNECT2_MULTIOBJ_BRW. Then the pages of each object are contiguous
+ * in \a pga, \a oa describes the first object and \a oas the others.
+ */
 static int
 osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
+		     struct obdo *oas, u32 obj_count,
 		     u32 page_count, struct brw_page **pga,
 		     struct ptlrpc_request **reqp, int resend)
 {
         struct ptlrpc_request   *req;
         struct ptlrpc_bulk_desc *desc;
         struct ost_body         *body;
+	struct ost_body		*bodies = NULL;
         struct obd_ioobj        *ioobj;
         struct niobuf_remote    *niobuf;
 	int niocount, i, requested_nob, opc, rc, short_io_size = 0;
+	u32 obj_start = 0, obj_end = 0;
+	u32 k;
         struct osc_brw_async_args *aa;
         struct req_capsule      *pill;
         struct brw_page *pg_prev;
 	void *short_io_buf;
 	const char *obd_name = cli->cl_import->imp_obd->obd_name;
+	enum obd_compress_type compress_type;
+	struct brw_page **cppga = NULL;
+	u32 cpage_count = 0;
+	u32 csize = 0;
 
         ENTRY;
         if (OBD_FAIL_CHECK(OBD_FAIL_OSC_BRW_PREP_REQ))
@@ -1316,10 +1588,14 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         if (OBD_FAIL_CHECK(OBD_FAIL_OSC_BRW_PREP_REQ2))
                 RETURN(-EINVAL); /* Fatal */
 
+	LASSERT(obj_count == 1 || (cmd & OBD_BRW_WRITE));
 	if ((cmd & OBD_BRW_WRITE) != 0) {
+		/* OST_IO_MAXREQSIZE, the size of the pool requests, allows
+		 * for OST_MAX_BRW_OBJS objects */
 		opc = OST_WRITE;
 		req = ptlrpc_request_alloc_pool(cli->cl_import,
-						osc_rq_pool,
+						osc_rq_pool, obj_count > 1 ?
+						&RQF_OST_BRW_WRITE_MULTI :
 						&RQF_OST_BRW_WRITE);
 	} else {
 		opc = OST_READ;
@@ -1328,16 +1604,30 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         if (req == NULL)
                 RETURN(-ENOMEM);
 
-        for (niocount = i = 1; i < page_count; i++) {
-                if (!can_merge_pages(pga[i - 1], pga[i]))
-                        niocount++;
-        }
+	obj_end = obj_count > 1 ? osc_brw_obj_pages(pga, page_count) :
+				  page_count;
+	for (niocount = i = 1; i < page_count; i++) {
+		if (i == obj_end) {
+			/* pages of different objects are never merged */
+			obj_end = i + osc_brw_obj_pages(pga + i,
+							page_count - i);
+			niocount++;
+		} else if (!can_merge_pages(pga[i - 1], pga[i])) {
+			niocount++;
+		}
+	}
 
         pill = &req->rq_pill;
         req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
-                             sizeof(*ioobj));
+			     obj_count * sizeof(*ioobj));
         req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
                              niocount * sizeof(*niobuf));
+	if (obj_count > 1) {
+		req_capsule_set_size(pill, &RMF_OST_BODIES, RCL_CLIENT,
+				     (obj_count - 1) * sizeof(*bodies));
+		req_capsule_set_size(pill, &RMF_OST_BODIES, RCL_SERVER,
+				     (obj_count - 1) * sizeof(*bodies));
+	}
 
 	for (i = 0; i < page_count; i++)
 		short_io_size += pga[i]->count;
@@ -1371,7 +1661,23 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 		goto no_bulk;
 	}
 
-	desc = ptlrpc_prep_bulk_imp(req, page_count,
+	/* store cl_compress_type in a local variable since
+	 * it can be changed via lprocfs */
+	compress_type = cli->cl_compress_type;
+	if (opc == OST_WRITE && compress_type != OBD_COMPRESS_NONE &&
+	    imp_connect_compress(cli->cl_import)) {
+		rc = osc_brw_compress(compress_type, page_count, pga,
+				      &cppga, &cpage_count, &csize);
+		if (rc < 0)
+			CDEBUG(D_CACHE,
+			       "%s: cannot compress bulk, sending it as is: rc = %d\n",
+			       obd_name, rc);
+		if (rc <= 0)
+			atomic_long_inc(&cli->cl_compress_skipped);
+	}
+
+	desc = ptlrpc_prep_bulk_imp(req,
+		cppga != NULL ? cpage_count : page_count,
 		cli->cl_import->imp_connect_data.ocd_brw_size >> LNET_MTU_BITS,
 		(opc == OST_WRITE ? PTLRPC_BULK_GET_SOURCE :
 			PTLRPC_BULK_PUT_SINK) |
@@ -1399,8 +1705,24 @@ no_bulk:
 	body->oa.o_uid = oa->o_uid;
 	body->oa.o_gid = oa->o_gid;
 
+	/* ioo_bufcnt of each object is counted when packing the niobufs */
 	obdo_to_ioobj(oa, ioobj);
-	ioobj->ioo_bufcnt = niocount;
+	ioobj->ioo_bufcnt = 0;
+
+	if (obj_count > 1) {
+		bodies = req_capsule_client_get(pill, &RMF_OST_BODIES);
+		LASSERT(bodies != NULL);
+	}
+	for (k = 1; k < obj_count; k++) {
+		struct obdo *obj_oa = &oas[k - 1];
+
+		lustre_set_wire_obdo(&req->rq_import->imp_connect_data,
+				     &bodies[k - 1].oa, obj_oa);
+		bodies[k - 1].oa.o_uid = obj_oa->o_uid;
+		bodies[k - 1].oa.o_gid = obj_oa->o_gid;
+		obdo_to_ioobj(obj_oa, &ioobj[k]);
+		ioobj[k].ioo_bufcnt = 0;
+	}
 	/* The high bits of ioo_max_brw tells server _maximum_ number of bulks
 	 * that might be send for this request.  The actual number is decided
 	 * when the RPC is finally sent in ptlrpc_register_bulk(). It sends
@@ -1419,6 +1741,10 @@ no_bulk:
 		body->oa.o_flags |= OBD_FL_SHORT_IO;
 		CDEBUG(D_CACHE, "Using short io for data transfer, size = %d\n",
 		       short_io_size);
+		if (opc == OST_WRITE &&
+		    OBD_FAIL_CHECK(OBD_FAIL_OSC_COMPRESS_SHORT_IO))
+			body->oa.o_flags |=
+				obd_compress_type_pack(OBD_COMPRESS_LZ4);
 		if (opc == OST_WRITE) {
 			short_io_buf = req_capsule_client_get(pill,
 							      &RMF_SHORT_IO);
@@ -1426,22 +1752,45 @@ no_bulk:
 		}
 	}
 
+	if (cppga != NULL) {
+		if ((body->oa.o_valid & OBD_MD_FLFLAGS) == 0) {
+			body->oa.o_valid |= OBD_MD_FLFLAGS;
+			body->oa.o_flags = 0;
+		}
+		body->oa.o_flags |= obd_compress_type_pack(compress_type);
+		body->oa.o_compr_size = csize;
+		CDEBUG(D_CACHE, "Compressed bulk with %s, size = %u\n",
+		       obd_compress_alg(compress_type), csize);
+	}
+
 	LASSERT(page_count > 0);
 	pg_prev = pga[0];
+	obj_end = 0;
+	k = 0;
         for (requested_nob = i = 0; i < page_count; i++, niobuf++) {
                 struct brw_page *pg = pga[i];
 		int poff = pg->off & ~PAGE_MASK;
 
+		if (i == obj_end) {
+			/* first page of the next object */
+			if (i > 0)
+				k++;
+			obj_start = i;
+			obj_end = obj_count == 1 ? page_count :
+				  i + osc_brw_obj_pages(pga + i,
+							page_count - i);
+		}
+
                 LASSERT(pg->count > 0);
                 /* make sure there is no gap in the middle of page array */
-		LASSERTF(page_count == 1 ||
-			 (ergo(i == 0, poff + pg->count == PAGE_SIZE) &&
-			  ergo(i > 0 && i < page_count - 1,
+		LASSERTF(obj_end - obj_start == 1 ||
+			 (ergo(i == obj_start, poff + pg->count == PAGE_SIZE) &&
+			  ergo(i > obj_start && i < obj_end - 1,
 			       poff == 0 && pg->count == PAGE_SIZE)   &&
-			  ergo(i == page_count - 1, poff == 0)),
+			  ergo(i == obj_end - 1, poff == 0)),
 			 "i: %d/%d pg: %p off: %llu, count: %u\n",
 			 i, page_count, pg, pg->off, pg->count);
-                LASSERTF(i == 0 || pg->off > pg_prev->off,
+		LASSERTF(i == obj_start || pg->off > pg_prev->off,
 			 "i %d p_c %u pg %p [pri %lu ind %lu] off %llu"
 			 " prev_pg %p [pri %lu ind %lu] off %llu\n",
                          i, page_count,
@@ -1458,19 +1807,20 @@ no_bulk:
 			       ptr + poff,
 			       pg->count);
 			ll_kunmap_atomic(ptr, KM_USER0);
-		} else if (short_io_size == 0) {
+		} else if (short_io_size == 0 && cppga == NULL) {
 			desc->bd_frag_ops->add_kiov_frag(desc, pg->pg, poff,
 							 pg->count);
 		}
 		requested_nob += pg->count;
 
-                if (i > 0 && can_merge_pages(pg_prev, pg)) {
+		if (i > obj_start && can_merge_pages(pg_prev, pg)) {
                         niobuf--;
 			niobuf->rnb_len += pg->count;
 		} else {
 			niobuf->rnb_offset = pg->off;
 			niobuf->rnb_len    = pg->count;
 			niobuf->rnb_flags  = pg->flag;
+			ioobj[k].ioo_bufcnt++;
                 }
                 pg_prev = pg;
         }
@@ -1479,6 +1829,12 @@ no_bulk:
                 req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE),
                 "want %p - real %p\n", req_capsule_client_get(&req->rq_pill,
                 &RMF_NIOBUF_REMOTE), (void *)(niobuf - niocount));
+	LASSERT(k == obj_count - 1);
+
+	/* the bulk only carries the compressed data, niobufs are unchanged */
+	for (i = 0; i < cpage_count; i++)
+		desc->bd_frag_ops->add_kiov_frag(desc, cppga[i]->pg, 0,
+						 cppga[i]->count);
 
         osc_announce_cached(cli, &body->oa, opc == OST_WRITE ? requested_nob:0);
         if (resend) {
@@ -1487,6 +1843,16 @@ no_bulk:
                         body->oa.o_flags = 0;
                 }
                 body->oa.o_flags |= OBD_FL_RECOV_RESEND;
+		/* no grant accounting for the other objects either */
+		for (k = 1; k < obj_count; k++) {
+			struct obdo *obj_oa = &bodies[k - 1].oa;
+
+			if ((obj_oa->o_valid & OBD_MD_FLFLAGS) == 0) {
+				obj_oa->o_valid |= OBD_MD_FLFLAGS;
+				obj_oa->o_flags = 0;
+			}
+			obj_oa->o_flags |= OBD_FL_RECOV_RESEND;
+		}
         }
 
         if (osc_should_shrink_grant(cli))
@@ -1507,10 +1873,18 @@ no_bulk:
 								cksum_type);
                         body->oa.o_valid |= OBD_MD_FLCKSUM | OBD_MD_FLFLAGS;
 
-			rc = osc_checksum_bulk_rw(obd_name, cksum_type,
-						  requested_nob, page_count,
-						  pga, OST_WRITE,
-						  &body->oa.o_cksum);
+			/* a compressed bulk is checksummed as it is sent */
+			if (cppga != NULL)
+				rc = osc_checksum_bulk_rw(obd_name, cksum_type,
+							  csize, cpage_count,
+							  cppga, OST_WRITE,
+							  &body->oa.o_cksum);
+			else
+				rc = osc_checksum_bulk_rw(obd_name, cksum_type,
+							  requested_nob,
+							  page_count, pga,
+							  OST_WRITE,
+							  &body->oa.o_cksum);
 			if (rc < 0) {
 				CDEBUG(D_PAGE, "failed to checksum, rc = %d\n",
 				       rc);
@@ -1552,6 +1926,8 @@ no_bulk:
 	CLASSERT(sizeof(*aa) <= sizeof(req->rq_async_args));
 	aa = ptlrpc_req_async_args(req);
 	aa->aa_oa = oa;
+	aa->aa_oas = oas;
+	aa->aa_obj_count = obj_count;
 	aa->aa_requested_nob = requested_nob;
 	aa->aa_nio_count = niocount;
 	aa->aa_page_count = page_count;
@@ -1560,14 +1936,24 @@ no_bulk:
 	aa->aa_cli = cli;
 	INIT_LIST_HEAD(&aa->aa_oaps);
 
+	if (cppga != NULL) {
+		atomic_long_inc(&cli->cl_compress_rpcs);
+		atomic_long_add(requested_nob, &cli->cl_compress_bytes_in);
+		atomic_long_add(csize, &cli->cl_compress_bytes_out);
+		osc_brw_compress_free(cppga, cpage_count);
+	}
+
 	*reqp = req;
 	niobuf = req_capsule_client_get(pill, &RMF_NIOBUF_REMOTE);
-	CDEBUG(D_RPCTRACE, "brw rpc %p - object "DOSTID" offset %lld<>%lld\n",
+	CDEBUG(D_RPCTRACE, "brw rpc %p - object "DOSTID" offset %lld<>%lld, %u objects\n",
 		req, POSTID(&oa->o_oi), niobuf[0].rnb_offset,
-		niobuf[niocount - 1].rnb_offset + niobuf[niocount - 1].rnb_len);
+		niobuf[niocount - 1].rnb_offset + niobuf[niocount - 1].rnb_len,
+		obj_count);
         RETURN(0);
 
  out:
+	if (cppga != NULL)
+		osc_brw_compress_free(cppga, cpage_count);
         ptlrpc_req_finished(req);
         RETURN(rc);
 }
@@ -1644,6 +2030,7 @@ check_write_checksum(struct obdo *oa, const struct lnet_process_id *peer,
 	enum cksum_types cksum_type;
 	obd_dif_csum_fn *fn = NULL;
 	int sector_size = 0;
+	bool uncompressible = false;
 	__u32 new_cksum;
 	char *msg;
 	int rc;
@@ -1681,18 +2068,43 @@ check_write_checksum(struct obdo *oa, const struct lnet_process_id *peer,
 		break;
 	}
 
-	if (fn)
+	/* the checksum of a compressed write covers the compressed bulk,
+	 * which is not kept; compressing the pages again gives the same
+	 * stream unless they changed after they were sent */
+	if (oa->o_valid & OBD_MD_FLFLAGS && oa->o_flags & OBD_FL_COMPRESS_ALL) {
+		struct brw_page **cppga = NULL;
+		u32 cpage_count = 0;
+		u32 csize = 0;
+
+		rc = osc_brw_compress(obd_compress_type_unpack(oa->o_flags),
+				      aa->aa_page_count, aa->aa_ppga,
+				      &cppga, &cpage_count, &csize);
+		if (rc > 0) {
+			rc = osc_checksum_bulk_rw(obd_name, cksum_type, csize,
+						  cpage_count, cppga,
+						  OST_WRITE, &new_cksum);
+			osc_brw_compress_free(cppga, cpage_count);
+		} else if (rc == 0) {
+			/* not compressible any more, so it did change */
+			uncompressible = true;
+			new_cksum = 0;
+		}
+	} else if (fn) {
 		rc = osc_checksum_bulk_t10pi(obd_name, aa->aa_requested_nob,
 					     aa->aa_page_count, aa->aa_ppga,
 					     OST_WRITE, fn, sector_size,
 					     &new_cksum);
-	else
+	} else {
 		rc = osc_checksum_bulk(aa->aa_requested_nob, aa->aa_page_count,
 				       aa->aa_ppga, OST_WRITE, cksum_type,
 				       &new_cksum);
+	}
 
 	if (rc < 0)
 		msg = "failed to calculate the client write checksum";
+	else if (uncompressible)
+		msg = "changed on the client after we compressed it - "
+		      "likely false positive due to mmap IO (bug 11742)";
 	else if (cksum_type != obd_cksum_type_unpack(aa->aa_oa->o_flags))
                 msg = "the server did not use the checksum type specified in "
                       "the original request - likely a protocol problem";
@@ -1723,6 +2135,20 @@ check_write_checksum(struct obdo *oa, const struct lnet_process_id *peer,
 }
 
 /* Note rc enters this function as number of bytes transferred */
+/* set/clear over quota flag for a uid/gid/projid */
+static void osc_brw_setdq(struct client_obd *cli, struct ptlrpc_request *req,
+			  struct obdo *oa)
+{
+	unsigned qid[LL_MAXQUOTAS] = { oa->o_uid, oa->o_gid, oa->o_projid };
+
+	if (!(oa->o_valid & OBD_MD_FLALLQUOTA))
+		return;
+
+	CDEBUG(D_QUOTA, "setdq for [%u %u %u] with valid %#llx, flags %x\n",
+	       oa->o_uid, oa->o_gid, oa->o_projid, oa->o_valid, oa->o_flags);
+	osc_quota_setdq(cli, req->rq_xid, qid, oa->o_valid, oa->o_flags);
+}
+
 static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 {
 	struct osc_brw_async_args *aa = (void *)&req->rq_async_args;
@@ -1731,7 +2157,9 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 	const struct lnet_process_id *peer =
 		&req->rq_import->imp_connection->c_peer;
 	struct ost_body *body;
+	struct ost_body *bodies = NULL;
 	u32 client_cksum = 0;
+	u32 k;
         ENTRY;
 
         if (rc < 0 && rc != -EDQUOT) {
@@ -1746,18 +2174,22 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
                 RETURN(-EPROTO);
         }
 
-	/* set/clear over quota flag for a uid/gid/projid */
-	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE &&
-	    body->oa.o_valid & (OBD_MD_FLALLQUOTA)) {
-		unsigned qid[LL_MAXQUOTAS] = {
-					 body->oa.o_uid, body->oa.o_gid,
-					 body->oa.o_projid };
-		CDEBUG(D_QUOTA, "setdq for [%u %u %u] with valid %#llx, flags %x\n",
-		       body->oa.o_uid, body->oa.o_gid, body->oa.o_projid,
-		       body->oa.o_valid, body->oa.o_flags);
-		       osc_quota_setdq(cli, req->rq_xid, qid, body->oa.o_valid,
-				       body->oa.o_flags);
-        }
+	if (aa->aa_obj_count > 1) {
+		bodies = req_capsule_server_sized_get(&req->rq_pill,
+						      &RMF_OST_BODIES,
+						      (aa->aa_obj_count - 1) *
+						      sizeof(*bodies));
+		if (bodies == NULL) {
+			DEBUG_REQ(D_INFO, req, "Can't unpack object bodies\n");
+			RETURN(-EPROTO);
+		}
+	}
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+		osc_brw_setdq(cli, req, &body->oa);
+		for (k = 1; k < aa->aa_obj_count; k++)
+			osc_brw_setdq(cli, req, &bodies[k - 1].oa);
+	}
 
         osc_update_grant(cli, body);
 
@@ -1915,9 +2347,14 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
                 rc = 0;
         }
 out:
-	if (rc >= 0)
+	if (rc >= 0) {
 		lustre_get_wire_obdo(&req->rq_import->imp_connect_data,
 				     aa->aa_oa, &body->oa);
+		for (k = 1; k < aa->aa_obj_count; k++)
+			lustre_get_wire_obdo(&req->rq_import->imp_connect_data,
+					     &aa->aa_oas[k - 1],
+					     &bodies[k - 1].oa);
+	}
 
         RETURN(rc);
 }
@@ -1935,7 +2372,8 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
 
 	rc = osc_brw_prep_request(lustre_msg_get_opc(request->rq_reqmsg) ==
 				OST_WRITE ? OBD_BRW_WRITE : OBD_BRW_READ,
-				  aa->aa_cli, aa->aa_oa, aa->aa_page_count,
+				  aa->aa_cli, aa->aa_oa, aa->aa_oas,
+				  aa->aa_obj_count, aa->aa_page_count,
 				  aa->aa_ppga, &new_req, 1);
         if (rc)
                 RETURN(rc);
@@ -2030,6 +2468,57 @@ static void osc_release_ppga(struct brw_page **ppga, size_t count)
         OBD_FREE(ppga, sizeof(*ppga) * count);
 }
 
+/* update the attributes of the object of page \a last after a BRW */
+static void osc_brw_update_attr(const struct lu_env *env,
+				struct ptlrpc_request *req, struct obdo *oa,
+				struct osc_async_page *last)
+{
+	struct cl_attr *attr = &osc_env_info(env)->oti_attr;
+	struct cl_object *obj = osc2cl(last->oap_obj);
+	unsigned long valid = 0;
+
+	cl_object_attr_lock(obj);
+	if (oa->o_valid & OBD_MD_FLBLOCKS) {
+		attr->cat_blocks = oa->o_blocks;
+		valid |= CAT_BLOCKS;
+	}
+	if (oa->o_valid & OBD_MD_FLMTIME) {
+		attr->cat_mtime = oa->o_mtime;
+		valid |= CAT_MTIME;
+	}
+	if (oa->o_valid & OBD_MD_FLATIME) {
+		attr->cat_atime = oa->o_atime;
+		valid |= CAT_ATIME;
+	}
+	if (oa->o_valid & OBD_MD_FLCTIME) {
+		attr->cat_ctime = oa->o_ctime;
+		valid |= CAT_CTIME;
+	}
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+		struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
+		loff_t last_off = last->oap_count + last->oap_obj_off +
+			last->oap_page_off;
+
+		/* Change file size if this is an out of quota or
+		 * direct IO write and it extends the file size */
+		if (loi->loi_lvb.lvb_size < last_off) {
+			attr->cat_size = last_off;
+			valid |= CAT_SIZE;
+		}
+		/* Extend KMS if it's not a lockless write */
+		if (loi->loi_kms < last_off &&
+		    oap2osc_page(last)->ops_srvlock == 0) {
+			attr->cat_kms = last_off;
+			valid |= CAT_KMS;
+		}
+	}
+
+	if (valid != 0)
+		cl_object_attr_update(env, obj, attr, valid);
+	cl_object_attr_unlock(obj);
+}
+
 static int brw_interpret(const struct lu_env *env,
 			 struct ptlrpc_request *req, void *args, int rc)
 {
@@ -2071,57 +2560,22 @@ static int brw_interpret(const struct lu_env *env,
 	}
 
 	if (rc == 0) {
-		struct obdo *oa = aa->aa_oa;
-		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
-		unsigned long valid = 0;
-		struct cl_object *obj;
-		struct osc_async_page *last;
-
-		last = brw_page2oap(aa->aa_ppga[aa->aa_page_count - 1]);
-		obj = osc2cl(last->oap_obj);
-
-		cl_object_attr_lock(obj);
-		if (oa->o_valid & OBD_MD_FLBLOCKS) {
-			attr->cat_blocks = oa->o_blocks;
-			valid |= CAT_BLOCKS;
-		}
-		if (oa->o_valid & OBD_MD_FLMTIME) {
-			attr->cat_mtime = oa->o_mtime;
-			valid |= CAT_MTIME;
-		}
-		if (oa->o_valid & OBD_MD_FLATIME) {
-			attr->cat_atime = oa->o_atime;
-			valid |= CAT_ATIME;
-		}
-		if (oa->o_valid & OBD_MD_FLCTIME) {
-			attr->cat_ctime = oa->o_ctime;
-			valid |= CAT_CTIME;
+		u32 i, n, k;
+
+		for (i = k = 0; i < aa->aa_page_count; i += n, k++) {
+			n = aa->aa_obj_count == 1 ? aa->aa_page_count :
+			    osc_brw_obj_pages(aa->aa_ppga + i,
+					      aa->aa_page_count - i);
+			osc_brw_update_attr(env, req,
+					    osc_brw_obj_oa(aa->aa_oa,
+							   aa->aa_oas, k),
+					    brw_page2oap(aa->aa_ppga[i + n - 1]));
 		}
-
-		if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
-			struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
-			loff_t last_off = last->oap_count + last->oap_obj_off +
-				last->oap_page_off;
-
-			/* Change file size if this is an out of quota or
-			 * direct IO write and it extends the file size */
-			if (loi->loi_lvb.lvb_size < last_off) {
-				attr->cat_size = last_off;
-				valid |= CAT_SIZE;
-			}
-			/* Extend KMS if it's not a lockless write */
-			if (loi->loi_kms < last_off &&
-			    oap2osc_page(last)->ops_srvlock == 0) {
-				attr->cat_kms = last_off;
-				valid |= CAT_KMS;
-			}
-		}
-
-		if (valid != 0)
-			cl_object_attr_update(env, obj, attr, valid);
-		cl_object_attr_unlock(obj);
 	}
 	OBD_SLAB_FREE_PTR(aa->aa_oa, osc_obdo_kmem);
+	if (aa->aa_oas != NULL)
+		OBD_FREE_LARGE(aa->aa_oas,
+			       (aa->aa_obj_count - 1) * sizeof(*aa->aa_oas));
 
 	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE && rc == 0)
 		osc_inc_unstable_pages(req);
@@ -2174,10 +2628,55 @@ static void brw_commit(struct ptlrpc_request *req)
 	}
 }
 
+/**
+ * Fill the obdo \a oa of the object of extent \a first, which is the first
+ * extent of this object in \a ext_list.
+ */
+static void osc_brw_attr_set(const struct lu_env *env, int cmd,
+			     struct list_head *ext_list,
+			     struct osc_extent *first, struct obdo *oa)
+{
+	struct cl_req_attr *crattr = &osc_env_info(env)->oti_req_attr;
+	struct osc_object *obj = first->oe_obj;
+	struct osc_extent *ext = first;
+	struct osc_async_page *oap;
+	__u32 layout_version = 0;
+	int grant = 0;
+
+	list_for_each_entry_from(ext, ext_list, oe_link) {
+		if (ext->oe_obj != obj)
+			break;
+		grant += ext->oe_grants;
+		layout_version = MAX(layout_version, ext->oe_layout_version);
+	}
+
+	oap = list_first_entry(&first->oe_pages, struct osc_async_page,
+			       oap_pending_item);
+
+	memset(crattr, 0, sizeof(*crattr));
+	crattr->cra_type = (cmd & OBD_BRW_WRITE) ? CRT_WRITE : CRT_READ;
+	crattr->cra_flags = ~0ULL;
+	crattr->cra_page = oap2cl_page(oap);
+	crattr->cra_oa = oa;
+	cl_req_attr_set(env, osc2cl(obj), crattr);
+
+	if (cmd == OBD_BRW_WRITE) {
+		oa->o_grant_used = grant;
+		if (layout_version > 0) {
+			CDEBUG(D_LAYOUT, DFID": write with layout version %u\n",
+			       PFID(&oa->o_oi.oi_fid), layout_version);
+
+			oa->o_layout_version = layout_version;
+			oa->o_valid |= OBD_MD_LAYOUT_VERSION;
+		}
+	}
+}
+
 /**
  * Build an RPC by the list of extent @ext_list. The caller must ensure
  * that the total pages in this list are NOT over max pages per RPC.
- * Extents in the list must be in OES_RPC state.
+ * Extents in the list must be in OES_RPC state. Write extents may belong
+ * to several objects, grouped by object, see osc_pack_write_objs().
  */
 int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  struct list_head *ext_list, int cmd)
@@ -2187,8 +2686,9 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	struct brw_page			**pga = NULL;
 	struct osc_brw_async_args	*aa = NULL;
 	struct obdo			*oa = NULL;
+	struct obdo			*oas = NULL;
 	struct osc_async_page		*oap;
-	struct osc_object		*obj = NULL;
+	struct osc_object		*cur = NULL;
 	struct cl_req_attr		*crattr = NULL;
 	loff_t				starting_offset = OBD_OBJECT_EOF;
 	loff_t				ending_offset = 0;
@@ -2199,11 +2699,12 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	bool				interrupted = false;
 	bool				ndelay = false;
 	int				i;
-	int				grant = 0;
+	u32				k;
+	u32				obj_count = 0;
 	int				rc;
-	__u32				layout_version = 0;
 	struct list_head		rpc_list = LIST_HEAD_INIT(rpc_list);
 	struct ost_body			*body;
+	struct ost_body			*bodies = NULL;
 	ENTRY;
 	LASSERT(!list_empty(ext_list));
 
@@ -2211,12 +2712,13 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	list_for_each_entry(ext, ext_list, oe_link) {
 		LASSERT(ext->oe_state == OES_RPC);
 		mem_tight |= ext->oe_memalloc;
-		grant += ext->oe_grants;
 		page_count += ext->oe_nr_pages;
-		layout_version = MAX(layout_version, ext->oe_layout_version);
-		if (obj == NULL)
-			obj = ext->oe_obj;
+		if (ext->oe_obj != cur) {
+			cur = ext->oe_obj;
+			obj_count++;
+		}
 	}
+	LASSERT(obj_count <= OST_MAX_BRW_OBJS);
 
 	soft_sync = osc_over_unstable_soft_limit(cli);
 	if (mem_tight)
@@ -2230,8 +2732,21 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	if (oa == NULL)
 		GOTO(out, rc = -ENOMEM);
 
+	if (obj_count > 1) {
+		OBD_ALLOC_LARGE(oas, (obj_count - 1) * sizeof(*oas));
+		if (oas == NULL)
+			GOTO(out, rc = -ENOMEM);
+	}
+
 	i = 0;
+	cur = NULL;
 	list_for_each_entry(ext, ext_list, oe_link) {
+		if (ext->oe_obj != cur) {
+			/* offsets are checked per object */
+			cur = ext->oe_obj;
+			starting_offset = OBD_OBJECT_EOF;
+			ending_offset = 0;
+		}
 		list_for_each_entry(oap, &ext->oe_pages, oap_pending_item) {
 			if (mem_tight)
 				oap->oap_brw_flags |= OBD_BRW_MEMALLOC;
@@ -2263,27 +2778,26 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	/* first page in the list */
 	oap = list_entry(rpc_list.next, typeof(*oap), oap_rpc_item);
 
-	crattr = &osc_env_info(env)->oti_req_attr;
-	memset(crattr, 0, sizeof(*crattr));
-	crattr->cra_type = (cmd & OBD_BRW_WRITE) ? CRT_WRITE : CRT_READ;
-	crattr->cra_flags = ~0ULL;
-	crattr->cra_page = oap2cl_page(oap);
-	crattr->cra_oa = oa;
-	cl_req_attr_set(env, osc2cl(obj), crattr);
-
-	if (cmd == OBD_BRW_WRITE) {
-		oa->o_grant_used = grant;
-		if (layout_version > 0) {
-			CDEBUG(D_LAYOUT, DFID": write with layout version %u\n",
-			       PFID(&oa->o_oi.oi_fid), layout_version);
+	cur = NULL;
+	k = 0;
+	list_for_each_entry(ext, ext_list, oe_link) {
+		if (ext->oe_obj == cur)
+			continue;
+		cur = ext->oe_obj;
+		osc_brw_attr_set(env, cmd, ext_list, ext,
+				 osc_brw_obj_oa(oa, oas, k++));
+	}
 
-			oa->o_layout_version = layout_version;
-			oa->o_valid |= OBD_MD_LAYOUT_VERSION;
-		}
+	/* pages are sorted within each object, objects keep their order */
+	for (i = 0; i < page_count; i += k) {
+		k = obj_count == 1 ? page_count :
+		    osc_brw_obj_pages(pga + i, page_count - i);
+		sort_brw_pages(pga + i, k);
 	}
+	starting_offset = pga[0]->off;
 
-	sort_brw_pages(pga, page_count);
-	rc = osc_brw_prep_request(cmd, cli, oa, page_count, pga, &req, 0);
+	rc = osc_brw_prep_request(cmd, cli, oa, oas, obj_count, page_count,
+				  pga, &req, 0);
 	if (rc != 0) {
 		CERROR("prep_req failed: %d\n", rc);
 		GOTO(out, rc);
@@ -2308,10 +2822,28 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	 * the OST will not use BRW timestamps.  Sadly, there is no obvious
 	 * way to do this in a single call.  bug 10150 */
 	body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
-	crattr->cra_oa = &body->oa;
-	crattr->cra_flags = OBD_MD_FLMTIME | OBD_MD_FLCTIME | OBD_MD_FLATIME;
-	cl_req_attr_set(env, osc2cl(obj), crattr);
-	lustre_msg_set_jobid(req->rq_reqmsg, crattr->cra_jobid);
+	if (obj_count > 1)
+		bodies = req_capsule_client_get(&req->rq_pill,
+						&RMF_OST_BODIES);
+	crattr = &osc_env_info(env)->oti_req_attr;
+	cur = NULL;
+	k = 0;
+	list_for_each_entry(ext, ext_list, oe_link) {
+		if (ext->oe_obj == cur)
+			continue;
+		cur = ext->oe_obj;
+		crattr->cra_oa = k == 0 ? &body->oa : &bodies[k - 1].oa;
+		crattr->cra_flags = OBD_MD_FLMTIME | OBD_MD_FLCTIME |
+				    OBD_MD_FLATIME;
+		crattr->cra_page = oap2cl_page(list_first_entry(&ext->oe_pages,
+						struct osc_async_page,
+						oap_pending_item));
+		cl_req_attr_set(env, osc2cl(cur), crattr);
+		/* all objects belong to one job, see osc_pack_write_objs() */
+		if (k++ == 0)
+			lustre_msg_set_jobid(req->rq_reqmsg,
+					     crattr->cra_jobid);
+	}
 
 	CLASSERT(sizeof(*aa) <= sizeof(req->rq_async_args));
 	aa = ptlrpc_req_async_args(req);
@@ -2355,6 +2887,8 @@ out:
 
 		if (oa)
 			OBD_SLAB_FREE_PTR(oa, osc_obdo_kmem);
+		if (oas)
+			OBD_FREE_LARGE(oas, (obj_count - 1) * sizeof(*oas));
 		if (pga)
 			OBD_FREE(pga, sizeof(*pga) * page_count);
 		/* this should happen rarely and is pretty bad, it makes the
@@ -3091,6 +3625,7 @@ static int osc_import_event(struct obd_device *obd,
         case IMP_EVENT_DISCON: {
                 cli = &obd->u.cli;
 		spin_lock(&cli->cl_loi_list_lock);
+		osc_grant_cache_drain(cli);
 		cli->cl_avail_grant = 0;
 		cli->cl_lost_grant = 0;
 		spin_unlock(&cli->cl_loi_list_lock);
@@ -3214,6 +3749,12 @@ int osc_setup_common(struct obd_device *obd, struct lustre_cfg *lcfg)
 	if (rc)
 		GOTO(out_ptlrpcd_work, rc);
 
+	rc = osc_grant_cache_init(cli);
+	if (rc) {
+		osc_quota_cleanup(obd);
+		GOTO(out_ptlrpcd_work, rc);
+	}
+
 	cli->cl_grant_shrink_interval = GRANT_SHRINK_INTERVAL;
 	osc_update_next_shrink(cli);
 
@@ -3344,6 +3885,8 @@ int osc_cleanup_common(struct obd_device *obd)
 	/* free memory of osc quota cache */
 	osc_quota_cleanup(obd);
 
+	osc_grant_cache_fini(cli);
+
 	rc = client_obd_cleanup(obd);
 
 	ptlrpcd_decref();
@@ -3467,6 +4010,7 @@ static void __exit osc_exit(void)
 	class_unregister_type(LUSTRE_OSC_NAME);
 	lu_kmem_fini(osc_caches);
 	ptlrpc_free_rq_pool(osc_rq_pool);
+	osc_compress_ctx_fini();
 }
 
 MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
@@ -1041,6 +1041,7 @@ struct ptlrpc_request_set *ptlrpc_prep_set(void)
 	atomic_set(&set->set_remaining, 0);
 	spin_lock_init(&set->set_new_req_lock);
 	INIT_LIST_HEAD(&set->set_new_requests);
+	INIT_LIST_HEAD(&set->set_batch_reqs);
 	set->set_max_inflight = UINT_MAX;
 	set->set_producer     = NULL;
 	set->set_producer_arg = NULL;
@@ -1443,6 +1444,7 @@ static int after_reply(struct ptlrpc_request *req)
 
 	work_start = ktime_get_real();
 	timediff = ktime_us_delta(work_start, req->rq_sent_ns);
+	ptlrpc_trace_stamp(req, RPC_TRACE_REPLY);
 
 	/*
 	 * NB Until this point, the whole of the incoming message,
@@ -1501,6 +1503,7 @@ static int after_reply(struct ptlrpc_request *req)
 				    timediff);
 		ptlrpc_lprocfs_rpc_sent(req, timediff);
 	}
+	ptlrpc_trace_end(req, lustre_msg_get_status(req->rq_repmsg));
 
 	if (lustre_msg_get_type(req->rq_repmsg) != PTL_RPC_MSG_REPLY &&
 	    lustre_msg_get_type(req->rq_repmsg) != PTL_RPC_MSG_ERR) {
@@ -2197,6 +2200,10 @@ interpret:
 		}
 	}
 
+	/* send the requests ptl_send_rpc() kept back to be batched */
+	if (!list_empty(&set->set_batch_reqs))
+		ptl_send_rpc_batch(set);
+
 	/*
 	 * move completed request at the head of list so it's easier for
 	 * caller to find them
@@ -2601,6 +2608,8 @@ static void __ptlrpc_free_req(struct ptlrpc_request *request, int locked)
 	if (request->rq_cli_ctx)
 		sptlrpc_req_put_ctx(request, !locked);
 
+	ptlrpc_trace_free(request);
+
 	if (request->rq_pool)
 		__ptlrpc_free_req_to_pool(request);
 	else
@@ -248,8 +248,8 @@ void client_bulk_callback(struct lnet_event *ev)
 #define REQS_USEC_SHIFT		16
 #define REQS_SEQ_SHIFT(svcpt)	REQS_CPT_BITS(svcpt)
 
-static void ptlrpc_req_add_history(struct ptlrpc_service_part *svcpt,
-				   struct ptlrpc_request *req)
+void ptlrpc_req_add_history(struct ptlrpc_service_part *svcpt,
+			    struct ptlrpc_request *req)
 {
 	u64 sec = req->rq_arrival_time.tv_sec;
 	u32 usec = req->rq_arrival_time.tv_nsec / NSEC_PER_USEC / 16; /* usec / 16 */
@@ -318,6 +318,11 @@ void request_in_callback(struct lnet_event *ev)
                         /* We moaned above already... */
                         return;
                 }
+		/* The last PUT into the buffer comes with unlinked set, as
+		 * LNet serialises the events of an MD and flags the last one,
+		 * so it never depends on this allocation. Only an explicit
+		 * unlink, when the service stops, ends a buffer with a
+		 * separate LNET_EVENT_UNLINK. */
 		req = ptlrpc_request_cache_alloc(GFP_ATOMIC);
                 if (req == NULL) {
                         CERROR("Can't allocate incoming request descriptor: "
@@ -350,34 +355,36 @@ void request_in_callback(struct lnet_event *ev)
 	CDEBUG(D_RPCTRACE, "peer: %s (source: %s)\n",
 		libcfs_id2str(req->rq_peer), libcfs_id2str(req->rq_source));
 
-	spin_lock(&svcpt->scp_lock);
+	/* History, the rqbd reference and scp_req_incoming are all updated
+	 * under scp_lock when a service thread drains scp_req_staged, so the
+	 * common case takes no lock here.  The network's ref on rqbd pins it
+	 * until then: LNet serialises the events of one MD, so the request
+	 * which takes that ref over is always staged after the others. */
+	atomic_inc(&svcpt->scp_nreqs_staged);
+	llist_add(&req->rq_staged, &svcpt->scp_req_staged);
+
+	if (!ev->unlinked) {
+		wake_up(&svcpt->scp_waitq);
+		EXIT;
+		return;
+	}
 
-	ptlrpc_req_add_history(svcpt, req);
+	spin_lock(&svcpt->scp_lock);
 
-	if (ev->unlinked) {
-		svcpt->scp_nrqbds_posted--;
-		CDEBUG(D_INFO, "Buffer complete: %d buffers still posted\n",
-		       svcpt->scp_nrqbds_posted);
-
-		/* Normally, don't complain about 0 buffers posted; LNET won't
-		 * drop incoming reqs since we set the portal lazy */
-		if (test_req_buffer_pressure &&
-		    ev->type != LNET_EVENT_UNLINK &&
-		    svcpt->scp_nrqbds_posted == 0)
-                        CWARN("All %s request buffers busy\n",
-                              service->srv_name);
-
-                /* req takes over the network's ref on rqbd */
-        } else {
-                /* req takes a ref on rqbd */
-                rqbd->rqbd_refcount++;
-        }
+	svcpt->scp_nrqbds_posted--;
+	CDEBUG(D_INFO, "Buffer complete: %d buffers still posted\n",
+	       svcpt->scp_nrqbds_posted);
 
-	list_add_tail(&req->rq_list, &svcpt->scp_req_incoming);
-	svcpt->scp_nreqs_incoming++;
+	/* Normally, don't complain about 0 buffers posted; LNET won't
+	 * drop incoming reqs since we set the portal lazy. Buffers are
+	 * only unlinked explicitly when the service stops. */
+	if (test_req_buffer_pressure && !service->srv_is_stopping &&
+	    svcpt->scp_nrqbds_posted == 0)
+		CWARN("All %s request buffers busy\n",
+		      service->srv_name);
 
-	/* NB everything can disappear under us once the request
-	 * has been queued and we unlock, so do the wake now... */
+	/* NB everything can disappear under us once the last buffer
+	 * is unlinked and we unlock, so do the wake now... */
 	wake_up(&svcpt->scp_waitq);
 
 	spin_unlock(&svcpt->scp_lock);
@@ -297,15 +297,22 @@ int gss_cli_ctx_unwrap_bulk(struct ptlrpc_cli_ctx *ctx,
         RETURN(0);
 }
 
+/*
+ * \a inplace: the bulk pages are private to the request, so the cipher text
+ * can be received and decrypted right in them.
+ */
 static int gss_prep_bulk(struct ptlrpc_bulk_desc *desc,
-                         struct gss_ctx *mechctx)
+			 struct gss_ctx *mechctx, bool inplace)
 {
         int     rc;
 
         if (desc->bd_iov_count == 0)
                 return 0;
 
-        rc = sptlrpc_enc_pool_get_pages(desc);
+	if (inplace)
+		rc = sptlrpc_enc_pool_get_pages_inplace(desc);
+	else
+		rc = sptlrpc_enc_pool_get_pages(desc);
         if (rc)
                 return rc;
 
@@ -328,7 +335,9 @@ int gss_cli_prep_bulk(struct ptlrpc_request *req,
         if (SPTLRPC_FLVR_BULK_SVC(req->rq_flvr.sf_rpc) != SPTLRPC_BULK_SVC_PRIV)
                 RETURN(0);
 
-        rc = gss_prep_bulk(desc, ctx2gctx(req->rq_cli_ctx)->gc_mechctx);
+	/* pages being read are not visible to anybody else until the read
+	 * completes */
+	rc = gss_prep_bulk(desc, ctx2gctx(req->rq_cli_ctx)->gc_mechctx, true);
         if (rc)
                 CERROR("bulk read: failed to prepare encryption "
                        "pages: %d\n", rc);
@@ -358,7 +367,7 @@ int gss_svc_prep_bulk(struct ptlrpc_request *req,
         if (bsd->bsd_svc != SPTLRPC_BULK_SVC_PRIV)
                 RETURN(0);
 
-        rc = gss_prep_bulk(desc, grctx->src_ctx->gsc_mechctx);
+	rc = gss_prep_bulk(desc, grctx->src_ctx->gsc_mechctx, false);
         if (rc)
                 CERROR("bulk write: failed to prepare encryption "
                        "pages: %d\n", rc);
@@ -895,7 +895,10 @@ int krb5_decrypt_bulk(struct crypto_blkcipher *tfm,
                         return rc;
                 }
 
-		if (BD_GET_KIOV(desc, i).kiov_len % blocksize != 0) {
+		/* nothing to copy when decrypted in place */
+		if (BD_GET_KIOV(desc, i).kiov_len % blocksize != 0 &&
+		    BD_GET_KIOV(desc, i).kiov_page !=
+		    BD_GET_ENC_KIOV(desc, i).kiov_page) {
 			memcpy(page_address(BD_GET_KIOV(desc, i).kiov_page) +
 			       BD_GET_KIOV(desc, i).kiov_offset,
 			       page_address(BD_GET_ENC_KIOV(desc, i).
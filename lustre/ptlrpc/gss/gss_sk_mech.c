@@ -756,7 +756,9 @@ static __u32 sk_decrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
 			return GSS_S_FAILURE;
 		}
 
-		if (piov->kiov_len % blocksize != 0) {
+		/* nothing to copy when decrypted in place */
+		if (piov->kiov_len % blocksize != 0 &&
+		    piov->kiov_page != ciov->kiov_page) {
 			memcpy(page_address(piov->kiov_page) +
 			       piov->kiov_offset,
 			       page_address(ciov->kiov_page) +
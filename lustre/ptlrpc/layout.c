@@ -613,6 +613,12 @@ static const struct req_msg_field *obd_idx_read_server[] = {
 	&RMF_IDX_INFO
 };
 
+static const struct req_msg_field *obd_batch_rpc_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_BATCH_SUBS,
+	&RMF_BATCH_MSGS
+};
+
 static const struct req_msg_field *ost_body_only[] = {
         &RMF_PTLRPC_BODY,
         &RMF_OST_BODY
@@ -653,6 +659,23 @@ static const struct req_msg_field *ost_brw_write_server[] = {
         &RMF_RCS
 };
 
+static const struct req_msg_field *ost_brw_multi_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BODY,
+	&RMF_OBD_IOOBJ,
+	&RMF_NIOBUF_REMOTE,
+	&RMF_CAPA1,
+	&RMF_SHORT_IO,
+	&RMF_OST_BODIES
+};
+
+static const struct req_msg_field *ost_brw_multi_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BODY,
+	&RMF_RCS,
+	&RMF_OST_BODIES
+};
+
 static const struct req_msg_field *ost_get_info_generic_server[] = {
         &RMF_PTLRPC_BODY,
         &RMF_GENERIC_DATA,
@@ -755,6 +778,7 @@ static struct req_format *req_formats[] = {
 	&RQF_OBD_PING,
 	&RQF_OBD_SET_INFO,
 	&RQF_OBD_IDX_READ,
+	&RQF_OBD_BATCH_RPC,
 	&RQF_SEC_CTX,
 	&RQF_MGS_TARGET_REG,
 #if LUSTRE_VERSION_CODE < OBD_OCD_VERSION(2, 13, 53, 0)
@@ -812,6 +836,7 @@ static struct req_format *req_formats[] = {
 	&RQF_OST_DESTROY,
 	&RQF_OST_BRW_READ,
 	&RQF_OST_BRW_WRITE,
+	&RQF_OST_BRW_WRITE_MULTI,
 	&RQF_OST_STATFS,
 	&RQF_OST_SET_GRANT_INFO,
 	&RQF_OST_GET_INFO,
@@ -1155,6 +1180,13 @@ struct req_msg_field RMF_OST_BODY =
 		    dump_ost_body);
 EXPORT_SYMBOL(RMF_OST_BODY);
 
+/* bodies of the objects following the first one in a multi-object BRW */
+struct req_msg_field RMF_OST_BODIES =
+	DEFINE_MSGF("ost_bodies", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ost_body), lustre_swab_ost_body,
+		    dump_ost_body);
+EXPORT_SYMBOL(RMF_OST_BODIES);
+
 struct req_msg_field RMF_OBD_IOOBJ =
         DEFINE_MSGF("obd_ioobj", RMF_F_STRUCT_ARRAY,
                     sizeof(struct obd_ioobj), lustre_swab_obd_ioobj, dump_ioo);
@@ -1210,6 +1242,17 @@ struct req_msg_field RMF_IDX_INFO =
 	DEFINE_MSGF("idx_info", 0, sizeof(struct idx_info),
 		    lustre_swab_idx_info, NULL);
 EXPORT_SYMBOL(RMF_IDX_INFO);
+
+struct req_msg_field RMF_BATCH_SUBS =
+	DEFINE_MSGF("batch_subs", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct batch_rpc_sub), lustre_swab_batch_rpc_sub,
+		    NULL);
+EXPORT_SYMBOL(RMF_BATCH_SUBS);
+
+struct req_msg_field RMF_BATCH_MSGS =
+	DEFINE_MSGF("batch_msgs", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_BATCH_MSGS);
+
 struct req_msg_field RMF_SHORT_IO =
 	DEFINE_MSGF("short_io", 0, -1, NULL, NULL);
 EXPORT_SYMBOL(RMF_SHORT_IO);
@@ -1338,6 +1381,12 @@ struct req_format RQF_OBD_IDX_READ =
 			obd_idx_read_client, obd_idx_read_server);
 EXPORT_SYMBOL(RQF_OBD_IDX_READ);
 
+/* Several small requests to the same target sent as one message; there is
+ * no reply to the batch itself, each request is replied to on its own */
+struct req_format RQF_OBD_BATCH_RPC =
+	DEFINE_REQ_FMT0("OBD_BATCH_RPC", obd_batch_rpc_client, empty);
+EXPORT_SYMBOL(RQF_OBD_BATCH_RPC);
+
 struct req_format RQF_SEC_CTX =
         DEFINE_REQ_FMT0("SEC_CTX", empty, empty);
 EXPORT_SYMBOL(RQF_SEC_CTX);
@@ -1712,6 +1761,11 @@ struct req_format RQF_OST_BRW_WRITE =
         DEFINE_REQ_FMT0("OST_BRW_WRITE", ost_brw_client, ost_brw_write_server);
 EXPORT_SYMBOL(RQF_OST_BRW_WRITE);
 
+struct req_format RQF_OST_BRW_WRITE_MULTI =
+	DEFINE_REQ_FMT0("OST_BRW_WRITE_MULTI", ost_brw_multi_client,
+			ost_brw_multi_server);
+EXPORT_SYMBOL(RQF_OST_BRW_WRITE_MULTI);
+
 struct req_format RQF_OST_STATFS =
         DEFINE_REQ_FMT0("OST_STATFS", empty, obd_statfs_server);
 EXPORT_SYMBOL(RQF_OST_STATFS);
@@ -114,6 +114,7 @@ static struct ll_rpc_opcode {
 	{ 401, /* was OBD_LOG_CANCEL */	 "llog_cancel" },
 	{ 402, /* was OBD_QC_CALLBACK */ "obd_quota_callback" },
 	{ OBD_IDX_READ,			 "dt_index_read" },
+	{ OBD_BATCH_RPC,		 "obd_batch_rpc" },
 	{ LLOG_ORIGIN_HANDLE_CREATE,	 "llog_origin_handle_open" },
         { LLOG_ORIGIN_HANDLE_NEXT_BLOCK, "llog_origin_handle_next_block" },
         { LLOG_ORIGIN_HANDLE_READ_HEADER,"llog_origin_handle_read_header" },
@@ -234,6 +235,14 @@ ptlrpc_ldebugfs_register(struct dentry *root, char *dir, char *name,
                              svc_counter_config, "req_timeout", "sec");
         lprocfs_counter_init(svc_stats, PTLRPC_REQBUF_AVAIL_CNTR,
                              svc_counter_config, "reqbuf_avail", "bufs");
+	lprocfs_counter_init(svc_stats, PTLRPC_REQIN_BATCH_CNTR,
+			     svc_counter_config, "req_in_batch", "reqs");
+	lprocfs_counter_init(svc_stats, PTLRPC_REQIN_LOCK_CNTR,
+			     svc_counter_config, "req_in_lock_wait", "usec");
+	lprocfs_counter_init(svc_stats, PTLRPC_REQGET_LOCK_CNTR,
+			     svc_counter_config, "req_get_lock_wait", "usec");
+	lprocfs_counter_init(svc_stats, PTLRPC_REQ_BATCHED_CNTR,
+			     svc_counter_config, "req_batched", "reqs");
         for (i = 0; i < EXTRA_LAST_OPC; i++) {
                 char *units;
 
@@ -479,6 +488,138 @@ static ssize_t threads_max_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(threads_max);
 
+static ssize_t threads_adapt_interval_show(struct kobject *kobj,
+					   struct attribute *attr, char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_thr_adapt_interval);
+}
+
+static ssize_t threads_adapt_interval_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > PTLRPC_THR_ADAPT_INTERVAL_MAX)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_thr_adapt_interval = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(threads_adapt_interval);
+
+static ssize_t threads_grow_wait_us_show(struct kobject *kobj,
+					 struct attribute *attr, char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_thr_grow_wait);
+}
+
+static ssize_t threads_grow_wait_us_store(struct kobject *kobj,
+					  struct attribute *attr,
+					  const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > INT_MAX)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_thr_grow_wait = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(threads_grow_wait_us);
+
+static ssize_t threads_shrink_util_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_thr_shrink_util);
+}
+
+static ssize_t threads_shrink_util_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > 100)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_thr_shrink_util = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(threads_shrink_util);
+
+static ssize_t threads_shrink_delay_show(struct kobject *kobj,
+					 struct attribute *attr, char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_thr_shrink_delay);
+}
+
+static ssize_t threads_shrink_delay_store(struct kobject *kobj,
+					  struct attribute *attr,
+					  const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val < 1 || val > INT_MAX)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_thr_shrink_delay = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(threads_shrink_delay);
+
 /**
  * Translates \e ptlrpc_nrs_pol_state values to human-readable strings.
  *
@@ -522,6 +663,7 @@ void nrs_policy_get_info_locked(struct ptlrpc_nrs_policy *policy,
 	memcpy(info->pi_arg, policy->pol_arg, sizeof(policy->pol_arg));
 
 	info->pi_fallback    = !!(policy->pol_flags & PTLRPC_NRS_FL_FALLBACK);
+	info->pi_chained     = policy == policy->pol_nrs->nrs_policy_chained;
 	info->pi_state	     = policy->pol_state;
 	/**
 	 * XXX: These are accessed without holding
@@ -529,6 +671,9 @@ void nrs_policy_get_info_locked(struct ptlrpc_nrs_policy *policy,
 	 */
 	info->pi_req_queued  = policy->pol_req_queued;
 	info->pi_req_started = policy->pol_req_started;
+	info->pi_wait_count  = policy->pol_wait_count;
+	info->pi_wait_total  = policy->pol_wait_total;
+	info->pi_wait_max    = policy->pol_wait_max;
 }
 
 /**
@@ -595,6 +740,7 @@ again:
 				memcpy(&infos[pol_idx].pi_state, &tmp.pi_state,
 				       sizeof(tmp.pi_state));
 				infos[pol_idx].pi_fallback = tmp.pi_fallback;
+				infos[pol_idx].pi_chained = tmp.pi_chained;
 				/**
 				 * For the rest of the service partitions
 				 * sanity-check the values we get.
@@ -618,6 +764,10 @@ again:
 
 			infos[pol_idx].pi_req_queued += tmp.pi_req_queued;
 			infos[pol_idx].pi_req_started += tmp.pi_req_started;
+			infos[pol_idx].pi_wait_count += tmp.pi_wait_count;
+			infos[pol_idx].pi_wait_total += tmp.pi_wait_total;
+			if (tmp.pi_wait_max > infos[pol_idx].pi_wait_max)
+				infos[pol_idx].pi_wait_max = tmp.pi_wait_max;
 
 			pol_idx++;
 		}
@@ -632,27 +782,39 @@ again:
 	 *	  - name: fifo
 	 *	    state: started
 	 *	    fallback: yes
+	 *	    chained: no
 	 *	    queued: 0
 	 *	    active: 0
+	 *	    wait_us: { avg: 0, max: 0 }
 	 *
 	 *	  - name: crrn
 	 *	    state: started
 	 *	    fallback: no
+	 *	    chained: no
 	 *	    queued: 2015
 	 *	    active: 384
+	 *	    wait_us: { avg: 1830, max: 20104 }
 	 *
 	 *	high_priority_requests:
 	 *	  - name: fifo
 	 *	    state: started
 	 *	    fallback: yes
+	 *	    chained: no
 	 *	    queued: 0
 	 *	    active: 2
+	 *	    wait_us: { avg: 12, max: 310 }
 	 *
 	 *	  - name: crrn
 	 *	    state: stopped
 	 *	    fallback: no
+	 *	    chained: no
 	 *	    queued: 0
 	 *	    active: 0
+	 *	    wait_us: { avg: 0, max: 0 }
+	 *
+	 * For a policy chained after the primary one, "queued" counts the
+	 * requests let through by the primary policy and waiting to be
+	 * ordered, and "wait_us" the time they waited there.
 	 */
 	seq_printf(m, "%s\n", !hp ? "\nregular_requests:" :
 		   "high_priority_requests:");
@@ -669,12 +831,21 @@ again:
 
 		seq_printf(m, "    state: %s\n"
 			   "    fallback: %s\n"
+			   "    chained: %s\n"
 			   "    queued: %-20d\n"
-			   "    active: %-20d\n\n",
+			   "    active: %-20d\n"
+			   "    wait_us: { avg: %llu, max: %llu }\n\n",
 			   nrs_state2str(infos[pol_idx].pi_state),
 			   infos[pol_idx].pi_fallback ? "yes" : "no",
+			   infos[pol_idx].pi_chained ? "yes" : "no",
 			   (int)infos[pol_idx].pi_req_queued,
-			   (int)infos[pol_idx].pi_req_started);
+			   (int)infos[pol_idx].pi_req_started,
+			   infos[pol_idx].pi_wait_count == 0 ? 0 :
+			   div64_u64(infos[pol_idx].pi_wait_total,
+				     infos[pol_idx].pi_wait_count *
+				     NSEC_PER_USEC),
+			   div_u64(infos[pol_idx].pi_wait_max,
+				   NSEC_PER_USEC));
 	}
 
 	if (!hp && nrs_svc_has_hp(svc)) {
@@ -699,10 +870,10 @@ out:
 
 #define LPROCFS_NRS_WR_MAX_ARG (1024)
 /**
- * The longest valid command string is the maxium policy name size, plus the
- * length of the " reg" substring, plus the lenght of argument
+ * The longest valid command string is twice the maxium policy name size, plus
+ * the length of the " reg" substring, plus the lenght of argument
  */
-#define LPROCFS_NRS_WR_MAX_CMD	(NRS_POL_NAME_MAX + sizeof(" reg") - 1 \
+#define LPROCFS_NRS_WR_MAX_CMD	(2 * NRS_POL_NAME_MAX + sizeof(" reg") - 1 \
 				 + LPROCFS_NRS_WR_MAX_ARG)
 
 /**
@@ -711,6 +882,13 @@ out:
  * Commands consist of the policy name, followed by an optional [reg|hp] token;
  * if the optional token is omitted, the operation is performed on both the
  * regular and high-priority (if the service has one) NRS head.
+ *
+ * The policy name may be followed by "+" and the name of a policy to chain
+ * after it, e.g. "tbf+orr jobid" to order the RPCs let through by TBF by
+ * their offsets; arguments always follow the whole chain and are passed to
+ * the primary policy. A command without a chained policy removes the
+ * current one. If the primary policy cannot be started, the previous chain
+ * is restored.
  */
 static ssize_t
 ptlrpc_lprocfs_nrs_seq_write(struct file *file, const char __user *buffer,
@@ -722,7 +900,10 @@ ptlrpc_lprocfs_nrs_seq_write(struct file *file, const char __user *buffer,
 	char			       *cmd;
 	char			       *cmd_copy = NULL;
 	char			       *policy_name;
+	char			       *chained_name;
 	char			       *queue_name;
+	char				prev_chained[NRS_POL_NAME_MAX] = "";
+	bool				was_primary = false;
 	int				rc = 0;
 	ENTRY;
 
@@ -742,11 +923,18 @@ ptlrpc_lprocfs_nrs_seq_write(struct file *file, const char __user *buffer,
 
 	cmd[count] = '\0';
 
-	policy_name = strsep(&cmd, " ");
+	chained_name = strsep(&cmd, " ");
+	policy_name = strsep(&chained_name, "+");
 
 	if (strlen(policy_name) > NRS_POL_NAME_MAX - 1)
 		GOTO(out, rc = -EINVAL);
 
+	if (chained_name != NULL &&
+	    (strlen(chained_name) == 0 ||
+	     strlen(chained_name) > NRS_POL_NAME_MAX - 1 ||
+	     strcmp(chained_name, policy_name) == 0))
+		GOTO(out, rc = -EINVAL);
+
 	/**
 	 * No [reg|hp] token has been specified
 	 */
@@ -781,10 +969,60 @@ default_queue:
 	 */
 	mutex_lock(&nrs_core.nrs_mutex);
 
+	/**
+	 * Set up the chained policy first. If it is the current primary one,
+	 * the new primary policy is started in front of it instead, so that
+	 * the head keeps a primary policy. Remember the current chain, all
+	 * partitions are set up the same way.
+	 */
+	if (chained_name != NULL) {
+		struct ptlrpc_nrs *nrs;
+
+		nrs = nrs_svcpt2nrs(svc->srv_parts[0],
+				    queue == PTLRPC_NRS_QUEUE_HP);
+		spin_lock(&nrs->nrs_lock);
+		if (nrs->nrs_policy_chained != NULL)
+			strlcpy(prev_chained,
+				nrs->nrs_policy_chained->pol_desc->pd_name,
+				sizeof(prev_chained));
+		if (nrs->nrs_policy_primary != NULL &&
+		    strcmp(nrs->nrs_policy_primary->pol_desc->pd_name,
+			   chained_name) == 0)
+			was_primary = true;
+		spin_unlock(&nrs->nrs_lock);
+
+		if (was_primary) {
+			rc = ptlrpc_nrs_policy_control(svc, queue, policy_name,
+						       PTLRPC_NRS_CTL_PREPEND,
+						       false, cmd);
+			GOTO(out_unlock, rc);
+		}
+
+		rc = ptlrpc_nrs_policy_control(svc, queue, chained_name,
+					       PTLRPC_NRS_CTL_CHAIN,
+					       false, NULL);
+		if (rc != 0)
+			GOTO(out_unlock, rc);
+	}
+
 	rc = ptlrpc_nrs_policy_control(svc, queue, policy_name,
 				       PTLRPC_NRS_CTL_START,
 				       false, cmd);
 
+	if (rc != 0 && chained_name != NULL) {
+		/**
+		 * Roll the chain back
+		 */
+		ptlrpc_nrs_policy_control(svc, queue,
+					  prev_chained[0] != '\0' ?
+					  prev_chained : NULL,
+					  PTLRPC_NRS_CTL_CHAIN, false, NULL);
+	} else if (rc == 0 && chained_name == NULL)
+		rc = ptlrpc_nrs_policy_control(svc, queue, NULL,
+					       PTLRPC_NRS_CTL_CHAIN,
+					       false, NULL);
+out_unlock:
+
 	mutex_unlock(&nrs_core.nrs_mutex);
 out:
 	if (cmd_copy)
@@ -1154,11 +1392,48 @@ static ssize_t high_priority_ratio_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(high_priority_ratio);
 
+static ssize_t req_in_batch_show(struct kobject *kobj, struct attribute *attr,
+				 char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_req_in_batch);
+}
+
+static ssize_t req_in_batch_store(struct kobject *kobj, struct attribute *attr,
+				  const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val < 1 || val > PTLRPC_SVC_REQ_IN_BATCH_MAX)
+		return -ERANGE;
+
+	spin_lock(&svc->srv_lock);
+	svc->srv_req_in_batch = val;
+	spin_unlock(&svc->srv_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(req_in_batch);
+
 static struct attribute *ptlrpc_svc_attrs[] = {
 	&lustre_attr_threads_min.attr,
 	&lustre_attr_threads_started.attr,
 	&lustre_attr_threads_max.attr,
+	&lustre_attr_threads_adapt_interval.attr,
+	&lustre_attr_threads_grow_wait_us.attr,
+	&lustre_attr_threads_shrink_util.attr,
+	&lustre_attr_threads_shrink_delay.attr,
 	&lustre_attr_high_priority_ratio.attr,
+	&lustre_attr_req_in_batch.attr,
 	NULL,
 };
 
@@ -1194,6 +1469,182 @@ int ptlrpc_sysfs_register_service(struct kset *parent,
 				    &parent->kobj, "%s", svc->srv_name);
 }
 
+static struct ptlrpc_lat_stats *ptlrpc_lat_stats_alloc(void)
+{
+	struct ptlrpc_lat_stats *ls;
+
+	OBD_ALLOC_PTR(ls);
+	return ls;
+}
+
+static void ptlrpc_lat_stats_free(struct ptlrpc_lat_stats **lsp)
+{
+	struct ptlrpc_lat_stats *ls = *lsp;
+	int i;
+
+	if (ls == NULL)
+		return;
+
+	*lsp = NULL;
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++)
+		if (ls->pls_opc[i] != NULL)
+			OBD_FREE_PTR(ls->pls_opc[i]);
+	OBD_FREE_PTR(ls);
+}
+
+/**
+ * Account \a usecs of latency of kind \a type for an RPC with opcode \a op.
+ *
+ * The per-opcode histograms are allocated on the first sample so that
+ * clients, which only ever send a handful of opcodes to each target, do
+ * not pay for the whole table. This may be called from reply processing,
+ * so the allocation must not sleep; a failure just drops the sample.
+ */
+void ptlrpc_lprocfs_lat_tally(struct ptlrpc_lat_stats *ls, __u32 op,
+			      enum ptlrpc_lat_type type, s64 usecs)
+{
+	struct ptlrpc_lat_hist *lh;
+	int opc = opcode_offset(op);
+	int i;
+
+	if (ls == NULL || opc < 0)
+		return;
+	LASSERT(opc < LUSTRE_MAX_OPCODES);
+
+	lh = READ_ONCE(ls->pls_opc[opc]);
+	if (unlikely(lh == NULL)) {
+		OBD_ALLOC_GFP(lh, sizeof(*lh), GFP_ATOMIC);
+		if (lh == NULL)
+			return;
+		for (i = 0; i < PTLRPC_LAT_LAST; i++)
+			spin_lock_init(&lh->plh_hist[i].oh_lock);
+		if (cmpxchg(&ls->pls_opc[opc], NULL, lh) != NULL) {
+			OBD_FREE_PTR(lh);
+			lh = ls->pls_opc[opc];
+		}
+	}
+
+	lprocfs_oh_tally_log2(&lh->plh_hist[type],
+			      (unsigned int)min_t(s64, max_t(s64, usecs, 0),
+						  UINT_MAX));
+}
+
+static const char * const ptlrpc_lat_names[PTLRPC_LAT_LAST] = {
+	[PTLRPC_LAT_WAIT]	= "wait",
+	[PTLRPC_LAT_SERVICE]	= "service",
+	[PTLRPC_LAT_TOTAL]	= "total",
+};
+
+/* upper bound in usec of the smallest bucket holding \a pct of samples */
+static unsigned long ptlrpc_lat_pct(unsigned long *buckets,
+				    unsigned long count, unsigned int pct)
+{
+	unsigned long target = (count * pct + 99) / 100;
+	unsigned long sum = 0;
+	int i;
+
+	for (i = 0; i < OBD_HIST_MAX; i++) {
+		sum += buckets[i];
+		if (sum >= target)
+			break;
+	}
+
+	return 1UL << min(i, OBD_HIST_MAX - 1);
+}
+
+static void ptlrpc_lat_hist_seq_show(struct seq_file *m,
+				     struct obd_histogram *oh,
+				     const char *name)
+{
+	unsigned long buckets[OBD_HIST_MAX];
+	unsigned long count = 0;
+	const char *sep = "";
+	int i;
+
+	spin_lock(&oh->oh_lock);
+	memcpy(buckets, oh->oh_buckets, sizeof(buckets));
+	spin_unlock(&oh->oh_lock);
+
+	for (i = 0; i < OBD_HIST_MAX; i++)
+		count += buckets[i];
+	if (count == 0)
+		return;
+
+	seq_printf(m, "    %s: { samples: %lu, unit: usec, p50: %lu, p90: %lu, p99: %lu, hist: {",
+		   name, count, ptlrpc_lat_pct(buckets, count, 50),
+		   ptlrpc_lat_pct(buckets, count, 90),
+		   ptlrpc_lat_pct(buckets, count, 99));
+	for (i = 0; i < OBD_HIST_MAX; i++) {
+		if (buckets[i] == 0)
+			continue;
+		seq_printf(m, "%s %lu: %lu", sep, 1UL << i, buckets[i]);
+		sep = ",";
+	}
+	seq_puts(m, " } }\n");
+}
+
+/*
+ * Latency histograms in YAML, one entry per opcode seen since the last
+ * reset. Each bucket is keyed by its upper bound, percentiles report the
+ * bound of the bucket they fall into. Writing anything clears them.
+ */
+static int ptlrpc_lprocfs_req_latency_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_lat_stats *ls = m->private;
+	struct timespec64 now;
+	int i, j;
+
+	ktime_get_real_ts64(&now);
+	seq_printf(m, "%-15s %llu.%09lu\n", "snapshot_time:",
+		   (s64)now.tv_sec, now.tv_nsec);
+	seq_puts(m, "req_latency:\n");
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		struct ptlrpc_lat_hist *lh = READ_ONCE(ls->pls_opc[i]);
+
+		if (lh == NULL)
+			continue;
+
+		/* skip opcodes not seen since the last reset */
+		for (j = 0; j < PTLRPC_LAT_LAST; j++)
+			if (lprocfs_oh_sum(&lh->plh_hist[j]) != 0)
+				break;
+		if (j == PTLRPC_LAT_LAST)
+			continue;
+
+		seq_printf(m, "  - %-8s %s\n", "opcode:",
+			   ll_rpc_opcode_table[i].opname);
+		for (j = 0; j < PTLRPC_LAT_LAST; j++)
+			ptlrpc_lat_hist_seq_show(m, &lh->plh_hist[j],
+						 ptlrpc_lat_names[j]);
+	}
+
+	return 0;
+}
+
+static ssize_t
+ptlrpc_lprocfs_req_latency_seq_write(struct file *file,
+				     const char __user *buffer,
+				     size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_lat_stats *ls = m->private;
+	int i, j;
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		struct ptlrpc_lat_hist *lh = READ_ONCE(ls->pls_opc[i]);
+
+		if (lh == NULL)
+			continue;
+		for (j = 0; j < PTLRPC_LAT_LAST; j++)
+			lprocfs_oh_clear(&lh->plh_hist[j]);
+	}
+
+	return count;
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_req_latency);
+
 void ptlrpc_ldebugfs_register_service(struct dentry *entry,
 				      struct ptlrpc_service *svc)
 {
@@ -1236,13 +1687,38 @@ void ptlrpc_ldebugfs_register_service(struct dentry *entry,
 				 0400, &req_history_fops, svc);
 	if (rc)
 		CWARN("Error adding the req_history file\n");
+
+	svc->srv_lat_stats = ptlrpc_lat_stats_alloc();
+	if (svc->srv_lat_stats == NULL)
+		return;
+
+	rc = ldebugfs_seq_create(svc->srv_debugfs_entry, "req_latency",
+				 0644, &ptlrpc_lprocfs_req_latency_fops,
+				 svc->srv_lat_stats);
+	if (rc)
+		CWARN("Error adding the req_latency file\n");
 }
 
 void ptlrpc_lprocfs_register_obd(struct obd_device *obddev)
 {
+	int rc;
+
 	ptlrpc_ldebugfs_register(obddev->obd_debugfs_entry, NULL, "stats",
 				 &obddev->obd_svc_debugfs_entry,
 				 &obddev->obd_svc_stats);
+	if (IS_ERR_OR_NULL(obddev->obd_debugfs_entry))
+		return;
+
+	obddev->obd_svc_lat_stats = ptlrpc_lat_stats_alloc();
+	if (obddev->obd_svc_lat_stats == NULL)
+		return;
+
+	rc = ldebugfs_seq_create(obddev->obd_debugfs_entry, "req_latency",
+				 0644, &ptlrpc_lprocfs_req_latency_fops,
+				 obddev->obd_svc_lat_stats);
+	if (rc)
+		CWARN("%s: error adding the req_latency file: rc = %d\n",
+		      obddev->obd_name, rc);
 }
 EXPORT_SYMBOL(ptlrpc_lprocfs_register_obd);
 
@@ -1252,6 +1728,9 @@ void ptlrpc_lprocfs_rpc_sent(struct ptlrpc_request *req, long amount)
         __u32 op = lustre_msg_get_opc(req->rq_reqmsg);
         int opc = opcode_offset(op);
 
+	ptlrpc_lprocfs_lat_tally(req->rq_import->imp_obd->obd_svc_lat_stats,
+				 op, PTLRPC_LAT_TOTAL, amount);
+
         svc_stats = req->rq_import->imp_obd->obd_svc_stats;
         if (svc_stats == NULL || opc <= 0)
                 return;
@@ -1295,6 +1774,7 @@ void ptlrpc_lprocfs_unregister_service(struct ptlrpc_service *svc)
 
         if (svc->srv_stats)
                 lprocfs_free_stats(&svc->srv_stats);
+	ptlrpc_lat_stats_free(&svc->srv_lat_stats);
 }
 
 void ptlrpc_lprocfs_unregister_obd(struct obd_device *obd)
@@ -1309,6 +1789,7 @@ void ptlrpc_lprocfs_unregister_obd(struct obd_device *obd)
 
         if (obd->obd_svc_stats)
                 lprocfs_free_stats(&obd->obd_svc_stats);
+	ptlrpc_lat_stats_free(&obd->obd_svc_lat_stats);
 }
 EXPORT_SYMBOL(ptlrpc_lprocfs_unregister_obd);
 
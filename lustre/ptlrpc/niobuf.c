@@ -632,6 +632,7 @@ int ptlrpc_send_reply(struct ptlrpc_request *req, int flags)
                 goto out;
 
 	req->rq_sent = ktime_get_real_seconds();
+	ptlrpc_trace_stamp(req, RPC_TRACE_REPLY);
 
 	rc = ptl_send_buf(&rs->rs_md_h, rs->rs_repbuf, rs->rs_repdata_len,
 			  (rs->rs_difficult && !rs->rs_no_ack) ?
@@ -686,6 +687,43 @@ int ptlrpc_error(struct ptlrpc_request *req)
         return ptlrpc_send_error(req, 0);
 }
 
+/**
+ * Check whether \a req, packed and with its reply buffer set up, may be kept
+ * back and sent in an OBD_BATCH_RPC together with other small requests to
+ * the same target found by the same ptlrpc_check_set() pass.
+ *
+ * Requests with bulk, replayable or resent requests and requests not using
+ * the null flavor are always sent on their own.
+ */
+static bool ptl_send_rpc_batchable(struct ptlrpc_request *req, int noreply)
+{
+	struct ptlrpc_request_set *set = req->rq_set;
+	struct obd_import *imp = req->rq_import;
+
+	if (noreply || set == NULL || !set->set_batch_rpc ||
+	    !ptlrpcd_batch_rpc)
+		return false;
+
+	if (req->rq_bulk != NULL || req->rq_replay || req->rq_resend ||
+	    req->rq_nr_resend != 0 || req->rq_send_state != LUSTRE_IMP_FULL ||
+	    req->rq_reqdata_len > PTLRPC_BATCH_REQ_MAX_SIZE)
+		return false;
+
+	if (SPTLRPC_FLVR_POLICY(req->rq_flvr.sf_rpc) != SPTLRPC_POLICY_NULL)
+		return false;
+
+	switch (req->rq_request_portal) {
+	case MDS_REQUEST_PORTAL:
+	case OST_REQUEST_PORTAL:
+	case LDLM_CANCEL_REQUEST_PORTAL:
+		break;
+	default:
+		return false;
+	}
+
+	return imp->imp_state == LUSTRE_IMP_FULL && imp_connect_batch_rpc(imp);
+}
+
 /**
  * Send request \a request.
  * if \a noreply is set, don't expect any reply back and don't set up
@@ -892,6 +930,8 @@ int ptl_send_rpc(struct ptlrpc_request *request, int noreply)
 
 	request->rq_sent_ns = ktime_get_real();
 	request->rq_sent = ktime_get_real_seconds();
+	ptlrpc_trace_start(request, false);
+	ptlrpc_trace_stamp(request, RPC_TRACE_SEND);
 	/* We give the server rq_timeout secs to process the req, and
 	   add the network latency for our local timeout. */
         request->rq_deadline = request->rq_sent + request->rq_timeout +
@@ -899,6 +939,23 @@ int ptl_send_rpc(struct ptlrpc_request *request, int noreply)
 
 	ptlrpc_pinger_sending_on_import(imp);
 
+	if (ptl_send_rpc_batchable(request, noreply)) {
+		/*
+		 * The message is copied into an OBD_BATCH_RPC by
+		 * ptl_send_rpc_batch() at the end of this ptlrpc_check_set()
+		 * pass, so request_out_callback() won't be called for it;
+		 * its reference pins the request until then.
+		 */
+		DEBUG_REQ(D_INFO, request, "batch flg=%x",
+			  lustre_msg_get_flags(request->rq_reqmsg));
+		spin_lock(&request->rq_lock);
+		request->rq_req_unlinked = 1;
+		spin_unlock(&request->rq_lock);
+		list_add_tail(&request->rq_batch_chain,
+			      &request->rq_set->set_batch_reqs);
+		GOTO(out, rc = 0);
+	}
+
 	DEBUG_REQ(D_INFO, request, "send flg=%x",
 		  lustre_msg_get_flags(request->rq_reqmsg));
 	rc = ptl_send_buf(&request->rq_req_md_h,
@@ -942,6 +999,138 @@ int ptl_send_rpc(struct ptlrpc_request *request, int noreply)
 }
 EXPORT_SYMBOL(ptl_send_rpc);
 
+/**
+ * Send the \a nr requests on \a reqs, all to the same import and portal,
+ * in one OBD_BATCH_RPC. \a len is the size of their packed messages.
+ * A single request is sent on its own.
+ *
+ * Each request keeps its own XID and reply buffer, and the target replies
+ * to each of them separately. Nothing is expected back for the batch: if it
+ * can't be sent the requests are marked with rq_net_err and resent on their
+ * own by ptlrpc_check_set().
+ */
+static void ptl_send_rpc_batch_one(struct list_head *reqs, int nr, int len)
+{
+	struct ptlrpc_request *req;
+	struct ptlrpc_request *next;
+	struct ptlrpc_request *batch;
+	struct batch_rpc_sub *subs;
+	struct obd_import *imp;
+	char *msgs;
+	int rc;
+
+	ENTRY;
+	req = list_entry(reqs->next, struct ptlrpc_request, rq_batch_chain);
+	imp = req->rq_import;
+
+	if (nr == 1) {
+		/* the reference taken in ptl_send_rpc() goes to
+		 * request_out_callback() now */
+		list_del_init(&req->rq_batch_chain);
+		spin_lock(&req->rq_lock);
+		req->rq_req_unlinked = 0;
+		spin_unlock(&req->rq_lock);
+		rc = ptl_send_buf(&req->rq_req_md_h, req->rq_reqbuf,
+				  req->rq_reqdata_len, LNET_NOACK_REQ,
+				  &req->rq_req_cbid, LNET_NID_ANY,
+				  imp->imp_connection->c_peer,
+				  req->rq_request_portal, req->rq_xid, 0, NULL);
+		if (likely(rc == 0))
+			RETURN_EXIT;
+
+		spin_lock(&req->rq_lock);
+		req->rq_req_unlinked = 1;
+		req->rq_net_err = 1;
+		spin_unlock(&req->rq_lock);
+		DEBUG_REQ(D_HA, req, "send failed (%d); expect timeout", rc);
+		ptlrpc_req_finished(req);
+		RETURN_EXIT;
+	}
+
+	batch = ptlrpc_request_alloc(imp, &RQF_OBD_BATCH_RPC);
+	if (batch == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	req_capsule_set_size(&batch->rq_pill, &RMF_BATCH_SUBS, RCL_CLIENT,
+			     nr * sizeof(*subs));
+	req_capsule_set_size(&batch->rq_pill, &RMF_BATCH_MSGS, RCL_CLIENT,
+			     len);
+	rc = ptlrpc_request_pack(batch, LUSTRE_OBD_VERSION, OBD_BATCH_RPC);
+	if (rc) {
+		ptlrpc_request_free(batch);
+		GOTO(out, rc);
+	}
+
+	subs = req_capsule_client_get(&batch->rq_pill, &RMF_BATCH_SUBS);
+	msgs = req_capsule_client_get(&batch->rq_pill, &RMF_BATCH_MSGS);
+	list_for_each_entry(req, reqs, rq_batch_chain) {
+		subs->brs_xid = req->rq_xid;
+		subs->brs_len = req->rq_reqdata_len;
+		memcpy(msgs, req->rq_reqbuf, req->rq_reqdata_len);
+		msgs += cfs_size_round(req->rq_reqdata_len);
+		subs++;
+		DEBUG_REQ(D_RPCTRACE, req, "batched in x%llu", batch->rq_xid);
+	}
+
+	req = list_entry(reqs->next, struct ptlrpc_request, rq_batch_chain);
+	batch->rq_request_portal = req->rq_request_portal;
+	batch->rq_no_resend = batch->rq_no_delay = 1;
+	batch->rq_phase = RQ_PHASE_RPC;
+	rc = ptl_send_rpc(batch, 1);
+	ptlrpc_req_finished(batch);
+	EXIT;
+out:
+	list_for_each_entry_safe(req, next, reqs, rq_batch_chain) {
+		list_del_init(&req->rq_batch_chain);
+		if (rc) {
+			DEBUG_REQ(D_HA, req, "batch send failed (%d); expect timeout",
+				  rc);
+			spin_lock(&req->rq_lock);
+			req->rq_net_err = 1;
+			spin_unlock(&req->rq_lock);
+		}
+		/* drop the reference taken in ptl_send_rpc() */
+		ptlrpc_req_finished(req);
+	}
+}
+
+/**
+ * Send the requests that ptl_send_rpc() kept back on \a set, grouped by
+ * import and request portal into OBD_BATCH_RPCs of up to
+ * PTLRPC_BATCH_MAX_REQS requests and PTLRPC_BATCH_MAX_SIZE bytes.
+ */
+void ptl_send_rpc_batch(struct ptlrpc_request_set *set)
+{
+	while (!list_empty(&set->set_batch_reqs)) {
+		struct ptlrpc_request *first;
+		struct ptlrpc_request *req;
+		struct ptlrpc_request *next;
+		LIST_HEAD(reqs);
+		int nr = 0;
+		int len = 0;
+
+		first = list_entry(set->set_batch_reqs.next,
+				   struct ptlrpc_request, rq_batch_chain);
+		list_for_each_entry_safe(req, next, &set->set_batch_reqs,
+					 rq_batch_chain) {
+			int size = cfs_size_round(req->rq_reqdata_len);
+
+			if (req->rq_import != first->rq_import ||
+			    req->rq_request_portal != first->rq_request_portal)
+				continue;
+			if (nr == PTLRPC_BATCH_MAX_REQS ||
+			    len + size > PTLRPC_BATCH_MAX_SIZE)
+				break;
+
+			list_move_tail(&req->rq_batch_chain, &reqs);
+			nr++;
+			len += size;
+		}
+
+		ptl_send_rpc_batch_one(&reqs, nr, len);
+	}
+}
+
 /**
  * Register request buffer descriptor for request receiving.
  */
@@ -126,6 +126,9 @@ static int nrs_policy_stop_locked(struct ptlrpc_nrs_policy *policy)
 	if (nrs->nrs_policy_primary == policy) {
 		nrs->nrs_policy_primary = NULL;
 
+	} else if (nrs->nrs_policy_chained == policy) {
+		nrs->nrs_policy_chained = NULL;
+
 	} else {
 		LASSERT(nrs->nrs_policy_fallback == policy);
 		nrs->nrs_policy_fallback = NULL;
@@ -170,6 +173,29 @@ static void nrs_policy_stop_primary(struct ptlrpc_nrs *nrs)
 	EXIT;
 }
 
+/**
+ * Transitions the \a nrs NRS head's chained policy to
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING and if the policy has no
+ * pending usage references, to ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED.
+ *
+ * \param[in] nrs the NRS head to carry out this operation on
+ */
+static void nrs_policy_stop_chained(struct ptlrpc_nrs *nrs)
+{
+	struct ptlrpc_nrs_policy *tmp = nrs->nrs_policy_chained;
+
+	if (tmp == NULL)
+		return;
+
+	nrs->nrs_policy_chained = NULL;
+
+	LASSERT(tmp->pol_state == NRS_POL_STATE_STARTED);
+	tmp->pol_state = NRS_POL_STATE_STOPPING;
+
+	if (tmp->pol_ref == 0)
+		nrs_policy_stop0(tmp);
+}
+
 /**
  * Transitions a policy across the ptlrpc_nrs_pol_state range of values, in
  * response to an lprocfs command to start a policy.
@@ -188,10 +214,21 @@ static void nrs_policy_stop_primary(struct ptlrpc_nrs *nrs)
  * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING, and if there are no outstanding
  * references on the policy to ptlrpc_nrs_pol_stae::NRS_POL_STATE_STOPPED. In
  * this case, the fallback policy is only left active in the NRS head.
+ *
+ * If \a opc is PTLRPC_NRS_CTL_CHAIN, the policy is started as the chained
+ * policy of the NRS head instead, replacing the current chained policy. If
+ * \a opc is PTLRPC_NRS_CTL_PREPEND, the current primary policy is moved to
+ * the chained role instead of being stopped. A policy which is already
+ * started as primary or chained policy just changes its role; the new
+ * primary policy is always set before the old one is demoted or stopped,
+ * so that the head is never left without a primary policy on the way.
  */
-static int nrs_policy_start_locked(struct ptlrpc_nrs_policy *policy, char *arg)
+static int nrs_policy_start_locked(struct ptlrpc_nrs_policy *policy, char *arg,
+				   enum ptlrpc_nrs_ctl opc)
 {
 	struct ptlrpc_nrs      *nrs = policy->pol_nrs;
+	struct ptlrpc_nrs_policy *old;
+	bool			chained = opc == PTLRPC_NRS_CTL_CHAIN;
 	int			rc = 0;
 	ENTRY;
 
@@ -215,6 +252,7 @@ static int nrs_policy_start_locked(struct ptlrpc_nrs_policy *policy, char *arg)
 		 * primary policy, if any.
 		 */
 		if (policy == nrs->nrs_policy_fallback) {
+			nrs_policy_stop_chained(nrs);
 			nrs_policy_stop_primary(nrs);
 			RETURN(0);
 		}
@@ -243,8 +281,25 @@ static int nrs_policy_start_locked(struct ptlrpc_nrs_policy *policy, char *arg)
 				return -EINVAL;
 
 			if ((arg == NULL && strlen(policy->pol_arg) == 0) ||
-			    (arg != NULL && strcmp(policy->pol_arg, arg) == 0))
+			    (arg != NULL && strcmp(policy->pol_arg, arg) == 0)) {
+				/**
+				 * Chaining the primary policy would leave the
+				 * head without one, it is moved to the chained
+				 * role by prepending another policy instead.
+				 */
+				if (chained && policy == nrs->nrs_policy_primary)
+					RETURN(-EBUSY);
+
+				if (!chained &&
+				    policy == nrs->nrs_policy_chained) {
+					old = nrs->nrs_policy_primary;
+					nrs->nrs_policy_primary = policy;
+					nrs->nrs_policy_chained = old;
+					if (opc != PTLRPC_NRS_CTL_PREPEND)
+						nrs_policy_stop_chained(nrs);
+				}
 				RETURN(0);
+			}
 
 			rc = nrs_policy_stop_locked(policy);
 			if (rc)
@@ -303,6 +358,19 @@ static int nrs_policy_start_locked(struct ptlrpc_nrs_policy *policy, char *arg)
 		 * This path is only used at PTLRPC service setup time.
 		 */
 		nrs->nrs_policy_fallback = policy;
+	} else if (chained) {
+		nrs_policy_stop_chained(nrs);
+		nrs->nrs_policy_chained = policy;
+	} else if (opc == PTLRPC_NRS_CTL_PREPEND &&
+		   nrs->nrs_policy_primary != NULL) {
+		/**
+		 * Set the newly-started policy as the primary one, then move
+		 * the old primary policy to the chained role.
+		 */
+		old = nrs->nrs_policy_primary;
+		nrs->nrs_policy_primary = policy;
+		nrs_policy_stop_chained(nrs);
+		nrs->nrs_policy_chained = old;
 	} else {
 		/*
 		 * Try to stop the current primary policy if there is one.
@@ -463,6 +531,7 @@ static void nrs_resource_get_safe(struct ptlrpc_nrs *nrs,
 {
 	struct ptlrpc_nrs_policy   *primary = NULL;
 	struct ptlrpc_nrs_policy   *fallback = NULL;
+	struct ptlrpc_nrs_policy   *chained = NULL;
 
 	memset(resp, 0, sizeof(resp[0]) * NRS_RES_MAX);
 
@@ -475,9 +544,14 @@ static void nrs_resource_get_safe(struct ptlrpc_nrs *nrs,
 	nrs_policy_get_locked(fallback);
 
 	primary = nrs->nrs_policy_primary;
-	if (primary != NULL)
+	if (primary != NULL) {
 		nrs_policy_get_locked(primary);
 
+		chained = nrs->nrs_policy_chained;
+		if (chained != NULL)
+			nrs_policy_get_locked(chained);
+	}
+
 	spin_unlock(&nrs->nrs_lock);
 
 	/**
@@ -498,6 +572,14 @@ static void nrs_resource_get_safe(struct ptlrpc_nrs *nrs,
 		if (resp[NRS_RES_PRIMARY] == NULL)
 			nrs_policy_put(primary);
 	}
+
+	if (chained != NULL) {
+		if (resp[NRS_RES_PRIMARY] != NULL)
+			resp[NRS_RES_CHAINED] = nrs_resource_get(chained, nrq,
+								 moving_req);
+		if (resp[NRS_RES_CHAINED] == NULL)
+			nrs_policy_put(chained);
+	}
 }
 
 /**
@@ -590,9 +672,10 @@ static inline void nrs_request_enqueue(struct ptlrpc_nrs_request *nrq)
 
 	/**
 	 * Try in descending order, because the primary policy (if any) is
-	 * the preferred choice.
+	 * the preferred choice. The chained policy only gets requests from
+	 * the primary one.
 	 */
-	for (i = NRS_RES_MAX - 1; i >= 0; i--) {
+	for (i = NRS_RES_PRIMARY; i >= 0; i--) {
 		if (nrq->nr_res_ptrs[i] == NULL)
 			continue;
 
@@ -603,6 +686,7 @@ static inline void nrs_request_enqueue(struct ptlrpc_nrs_request *nrq)
 		if (rc == 0) {
 			policy->pol_nrs->nrs_req_queued++;
 			policy->pol_req_queued++;
+			nrq->nr_queue_time = ktime_get();
 			return;
 		}
 	}
@@ -644,7 +728,8 @@ static inline void nrs_request_stop(struct ptlrpc_nrs_request *nrq)
  *
  * \param[in]	  nrs  the NRS head this policy belongs to.
  * \param[in]	  name the human-readable policy name; should be the same as
- *		       ptlrpc_nrs_pol_desc::pd_name.
+ *		       ptlrpc_nrs_pol_desc::pd_name. May be NULL for
+ *		       \e PTLRPC_NRS_CTL_CHAIN, to remove the chained policy.
  * \param[in]	  opc  the opcode of the operation being carried out.
  * \param[in,out] arg  can be used to pass information in and out between when
  *		       carrying an operation; usually data that is private to
@@ -657,12 +742,17 @@ static inline void nrs_request_stop(struct ptlrpc_nrs_request *nrq)
 static int nrs_policy_ctl(struct ptlrpc_nrs *nrs, char *name,
 			  enum ptlrpc_nrs_ctl opc, void *arg)
 {
-	struct ptlrpc_nrs_policy       *policy;
+	struct ptlrpc_nrs_policy       *policy = NULL;
 	int				rc = 0;
 	ENTRY;
 
 	spin_lock(&nrs->nrs_lock);
 
+	if (opc == PTLRPC_NRS_CTL_CHAIN && name == NULL) {
+		nrs_policy_stop_chained(nrs);
+		GOTO(out, rc = 0);
+	}
+
 	policy = nrs_policy_find_locked(nrs, name);
 	if (policy == NULL)
 		GOTO(out, rc = -ENOENT);
@@ -684,7 +774,25 @@ static int nrs_policy_ctl(struct ptlrpc_nrs *nrs, char *name,
 		 * Start \e policy
 		 */
 	case PTLRPC_NRS_CTL_START:
-		rc = nrs_policy_start_locked(policy, arg);
+		rc = nrs_policy_start_locked(policy, arg, opc);
+		break;
+
+		/**
+		 * Start \e policy in front of the primary policy, which then
+		 * becomes the chained one
+		 */
+	case PTLRPC_NRS_CTL_PREPEND:
+		rc = nrs_policy_start_locked(policy, arg, opc);
+		break;
+
+		/**
+		 * Start \e policy after the primary policy
+		 */
+	case PTLRPC_NRS_CTL_CHAIN:
+		if (policy->pol_flags & PTLRPC_NRS_FL_FALLBACK)
+			nrs_policy_stop_chained(nrs);
+		else
+			rc = nrs_policy_start_locked(policy, NULL, opc);
 		break;
 	}
 out:
@@ -819,7 +927,8 @@ static int nrs_policy_register(struct ptlrpc_nrs *nrs,
 	nrs->nrs_num_pols++;
 
 	if (policy->pol_flags & PTLRPC_NRS_FL_REG_START)
-		rc = nrs_policy_start_locked(policy, NULL);
+		rc = nrs_policy_start_locked(policy, NULL,
+					     PTLRPC_NRS_CTL_START);
 
 	spin_unlock(&nrs->nrs_lock);
 
@@ -1526,6 +1635,7 @@ void ptlrpc_nrs_req_stop_nolock(struct ptlrpc_request *req)
 void ptlrpc_nrs_req_add(struct ptlrpc_service_part *svcpt,
 			struct ptlrpc_request *req, bool hp)
 {
+	ptlrpc_trace_stamp(req, RPC_TRACE_NRS_ENQ);
 	spin_lock(&svcpt->scp_req_lock);
 
 	if (hp)
@@ -1536,14 +1646,29 @@ void ptlrpc_nrs_req_add(struct ptlrpc_service_part *svcpt,
 	spin_unlock(&svcpt->scp_req_lock);
 }
 
-static void nrs_request_removed(struct ptlrpc_nrs_policy *policy)
+static void nrs_request_removed(struct ptlrpc_nrs_policy *policy,
+				struct ptlrpc_nrs_request *nrq)
 {
+	__u64 wait;
+
 	LASSERT(policy->pol_nrs->nrs_req_queued > 0);
 	LASSERT(policy->pol_req_queued > 0);
 
 	policy->pol_nrs->nrs_req_queued--;
 	policy->pol_req_queued--;
 
+	if (nrq->nr_chained) {
+		LASSERT(policy->pol_nrs->nrs_req_chained > 0);
+		policy->pol_nrs->nrs_req_chained--;
+		nrq->nr_chained = 0;
+	}
+
+	wait = ktime_to_ns(ktime_sub(ktime_get(), nrq->nr_queue_time));
+	policy->pol_wait_count++;
+	policy->pol_wait_total += wait;
+	if (wait > policy->pol_wait_max)
+		policy->pol_wait_max = wait;
+
 	/**
 	 * If the policy has no more requests queued, remove it from
 	 * ptlrpc_nrs::nrs_policy_queued.
@@ -1565,6 +1690,89 @@ static void nrs_request_removed(struct ptlrpc_nrs_policy *policy)
 	}
 }
 
+/**
+ * Enqueues request \a nrq, which has just been let through by the primary
+ * policy, on the chained policy; or on the fallback policy, if the chained
+ * policy does not handle the request.
+ *
+ * \param[in] nrq the request
+ */
+static void nrs_request_chain(struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_nrs_policy *policy = nrs_request_policy(nrq);
+	int			  i;
+	int			  rc;
+
+	/* the primary policy is done with the request */
+	if (policy->pol_desc->pd_ops->op_req_stop)
+		policy->pol_desc->pd_ops->op_req_stop(policy, nrq);
+
+	i = nrq->nr_res_ptrs[NRS_RES_CHAINED] != NULL ? NRS_RES_CHAINED :
+							 NRS_RES_FALLBACK;
+	for (;; i = NRS_RES_FALLBACK) {
+		nrq->nr_res_idx = i;
+		policy = nrq->nr_res_ptrs[i]->res_policy;
+
+		rc = policy->pol_desc->pd_ops->op_req_enqueue(policy, nrq);
+		if (rc == 0)
+			break;
+		/* the fallback policy always accepts requests */
+		LASSERT(i != NRS_RES_FALLBACK);
+	}
+
+	policy->pol_nrs->nrs_req_queued++;
+	policy->pol_nrs->nrs_req_chained++;
+	policy->pol_req_queued++;
+	nrq->nr_chained = 1;
+	nrq->nr_queue_time = ktime_get();
+
+	if (unlikely(list_empty(&policy->pol_list_queued)))
+		list_add_tail(&policy->pol_list_queued,
+			      &policy->pol_nrs->nrs_policy_queued);
+}
+
+/**
+ * Whether request \a nrq, obtained from its policy, has to go through the
+ * chained policy before it is handled.
+ */
+static inline bool nrs_request_chainable(struct ptlrpc_nrs_request *nrq)
+{
+	return nrq->nr_res_idx == NRS_RES_PRIMARY &&
+	       nrq->nr_res_ptrs[NRS_RES_CHAINED] != NULL;
+}
+
+/**
+ * The maximum number of requests moved from the primary to the chained
+ * policy each time a request is obtained from an NRS head.
+ */
+#define NRS_CHAIN_BATCH_MAX	32
+
+/**
+ * Moves the requests which the primary policy of \a nrs lets through to the
+ * chained policy, so that the chained policy has requests to order.
+ *
+ * \param[in] nrs the NRS head
+ */
+static void nrs_chain_admit(struct ptlrpc_nrs *nrs)
+{
+	struct ptlrpc_nrs_policy  *policy = nrs->nrs_policy_primary;
+	struct ptlrpc_nrs_request *nrq;
+	int			   i;
+
+	if (policy == NULL || nrs->nrs_policy_chained == NULL)
+		return;
+
+	for (i = 0; i < NRS_CHAIN_BATCH_MAX && policy->pol_req_queued > 0;
+	     i++) {
+		nrq = nrs_request_get(policy, false, false);
+		if (nrq == NULL)
+			break;
+
+		nrs_request_removed(policy, nrq);
+		nrs_request_chain(nrq);
+	}
+}
+
 /**
  * Obtains a request for handling from an NRS head of service partition
  * \a svcpt.
@@ -1589,6 +1797,9 @@ ptlrpc_nrs_req_get_nolock0(struct ptlrpc_service_part *svcpt, bool hp,
 	struct ptlrpc_nrs_policy  *policy;
 	struct ptlrpc_nrs_request *nrq;
 
+	if (likely(!peek))
+		nrs_chain_admit(nrs);
+again:
 	/**
 	 * Always try to drain requests from all NRS polices even if they are
 	 * inactive, because the user can change policy status at runtime.
@@ -1598,12 +1809,21 @@ ptlrpc_nrs_req_get_nolock0(struct ptlrpc_service_part *svcpt, bool hp,
 		nrq = nrs_request_get(policy, peek, force);
 		if (nrq != NULL) {
 			if (likely(!peek)) {
+				nrs_request_removed(policy, nrq);
+
+				/**
+				 * Let through by the primary policy after
+				 * nrs_chain_admit() moved its batch.
+				 */
+				if (nrs_request_chainable(nrq)) {
+					nrs_request_chain(nrq);
+					goto again;
+				}
+
 				nrq->nr_started = 1;
 
 				policy->pol_req_started++;
 				policy->pol_nrs->nrs_req_started++;
-
-				nrs_request_removed(policy);
 			}
 
 			return container_of(nrq, struct ptlrpc_request, rq_nrq);
@@ -1626,7 +1846,7 @@ void ptlrpc_nrs_req_del_nolock(struct ptlrpc_request *req)
 
 	req->rq_nrq.nr_enqueued = 0;
 
-	nrs_request_removed(policy);
+	nrs_request_removed(policy, &req->rq_nrq);
 }
 
 /**
@@ -1664,7 +1884,8 @@ bool ptlrpc_nrs_req_throttling_nolock(struct ptlrpc_service_part *svcpt,
 {
 	struct ptlrpc_nrs *nrs = nrs_svcpt2nrs(svcpt, hp);
 
-	return !!nrs->nrs_throttling;
+	/* requests already let through are not held back */
+	return nrs->nrs_throttling && nrs->nrs_req_chained == 0;
 };
 
 /**
@@ -1814,6 +2035,10 @@ int ptlrpc_nrs_init(void)
 	if (rc != 0)
 		GOTO(fail, rc);
 
+	rc = ptlrpc_nrs_policy_register(&nrs_conf_drr);
+	if (rc != 0)
+		GOTO(fail, rc);
+
 	rc = ptlrpc_nrs_policy_register(&nrs_conf_delay);
 	if (rc != 0)
 		GOTO(fail, rc);
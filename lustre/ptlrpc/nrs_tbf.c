@@ -27,7 +27,8 @@
 /*
  * lustre/ptlrpc/nrs_tbf.c
  *
- * Network Request Scheduler (NRS) Token Bucket Filter(TBF) policy
+ * Network Request Scheduler (NRS) Token Bucket Filter(TBF) policy, and the
+ * Deficit Round Robin(DRR) policy sharing its rules
  *
  */
 
@@ -54,6 +55,7 @@
  */
 
 #define NRS_POL_NAME_TBF	"tbf"
+#define NRS_POL_NAME_DRR	"drr"
 
 static int tbf_jobid_cache_size = 8192;
 module_param(tbf_jobid_cache_size, int, 0644);
@@ -67,6 +69,40 @@ static int tbf_depth = 3;
 module_param(tbf_depth, int, 0644);
 MODULE_PARM_DESC(tbf_depth, "How many tokens that a client can save up");
 
+static unsigned int drr_weight = 1;
+static int drr_weight_set(const char *val, cfs_kernel_param_arg_t *kp);
+#ifdef HAVE_KERNEL_PARAM_OPS
+static struct kernel_param_ops param_ops_drr_weight = {
+	.set = drr_weight_set,
+	.get = param_get_uint,
+};
+#define param_check_drr_weight(name, p) \
+		__param_check(name, p, unsigned int)
+module_param(drr_weight, drr_weight, 0644);
+#else
+module_param_call(drr_weight, drr_weight_set, param_get_uint,
+		  &drr_weight, 0644);
+#endif
+MODULE_PARM_DESC(drr_weight, "Default weight of a DRR class in RPCs per round");
+
+static int drr_weight_set(const char *val, cfs_kernel_param_arg_t *kp)
+{
+	unsigned int weight;
+	int rc;
+
+	rc = kstrtouint(val, 0, &weight);
+	if (rc)
+		return rc;
+
+	/* a class with no weight would never have its deficit refilled */
+	if (weight < 1)
+		return -EINVAL;
+
+	*(unsigned int *)kp->arg = weight;
+
+	return 0;
+}
+
 static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 {
 	struct nrs_tbf_head *head = container_of(timer, struct nrs_tbf_head,
@@ -82,6 +118,11 @@ static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 
 #define NRS_TBF_DEFAULT_RULE "default"
 
+/**
+ * The byte bucket of a class holds 1/8 second worth of its bandwidth.
+ */
+#define NRS_TBF_BW_DEPTH_SHIFT	3
+
 static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
 {
 	LASSERT(atomic_read(&rule->tr_ref) == 0);
@@ -112,6 +153,15 @@ static inline void nrs_tbf_rule_get(struct nrs_tbf_rule *rule)
 	atomic_inc(&rule->tr_ref);
 }
 
+/**
+ * The value of a rule started without an explicit one: an RPC rate for TBF,
+ * a weight for DRR.
+ */
+static inline __u64 nrs_tbf_default_rate(struct nrs_tbf_head *head)
+{
+	return head->th_drr ? drr_weight : tbf_rate;
+}
+
 static void
 nrs_tbf_cli_rule_put(struct nrs_tbf_client *cli)
 {
@@ -135,9 +185,15 @@ nrs_tbf_cli_reset_value(struct nrs_tbf_head *head,
 	cli->tc_nsecs = rule->tr_nsecs;
 	cli->tc_depth = rule->tr_depth;
 	cli->tc_ntoken = rule->tr_depth;
+	cli->tc_bw = rule->tr_bw;
+	cli->tc_bw_depth = max_t(__u64, rule->tr_bw >> NRS_TBF_BW_DEPTH_SHIFT,
+				 1);
+	cli->tc_bw_ntoken = cli->tc_bw_depth;
 	cli->tc_check_time = ktime_to_ns(ktime_get());
 	cli->tc_rule_sequence = atomic_read(&head->th_rule_sequence);
 	cli->tc_rule_generation = rule->tr_generation;
+	if (cli->tc_deficit > cli->tc_rpc_rate)
+		cli->tc_deficit = cli->tc_rpc_rate;
 
 	if (cli->tc_in_heap)
 		cfs_binheap_relocate(head->th_binheap,
@@ -168,7 +224,17 @@ nrs_tbf_cli_reset(struct nrs_tbf_head *head,
 static int
 nrs_tbf_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	return rule->tr_head->th_ops->o_rule_dump(rule, m);
+	int rc;
+
+	rc = rule->tr_head->th_ops->o_rule_dump(rule, m);
+	if (rc)
+		return rc;
+
+	if (rule->tr_bw != 0)
+		seq_printf(m, ", bw %llu", rule->tr_bw);
+	seq_printf(m, ", rpcs %llu, bytes %llu\n", rule->tr_rpcs,
+		   rule->tr_bytes);
+	return 0;
 }
 
 static int
@@ -260,6 +326,7 @@ nrs_tbf_cli_init(struct nrs_tbf_head *head,
 	head->th_ops->o_cli_init(cli, req);
 	INIT_LIST_HEAD(&cli->tc_list);
 	INIT_LIST_HEAD(&cli->tc_linkage);
+	INIT_LIST_HEAD(&cli->tc_drr_link);
 	spin_lock_init(&cli->tc_rule_lock);
 	atomic_set(&cli->tc_ref, 1);
 	rule = nrs_tbf_rule_match(head, cli);
@@ -271,6 +338,7 @@ nrs_tbf_cli_fini(struct nrs_tbf_client *cli)
 {
 	LASSERT(list_empty(&cli->tc_list));
 	LASSERT(!cli->tc_in_heap);
+	LASSERT(list_empty(&cli->tc_drr_link));
 	LASSERT(atomic_read(&cli->tc_ref) == 0);
 	spin_lock(&cli->tc_rule_lock);
 	nrs_tbf_cli_rule_put(cli);
@@ -305,6 +373,7 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	rule->tr_nsecs = NSEC_PER_SEC;
 	do_div(rule->tr_nsecs, rule->tr_rpc_rate);
 	rule->tr_depth = tbf_depth;
+	rule->tr_bw = start->u.tc_start.ts_bw;
 	atomic_set(&rule->tr_ref, 1);
 	INIT_LIST_HEAD(&rule->tr_cli_list);
 	INIT_LIST_HEAD(&rule->tr_nids);
@@ -350,8 +419,8 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		head->th_rule = rule;
 	}
 
-	CDEBUG(D_RPCTRACE, "TBF starts rule@%p rate %llu gen %llu\n",
-	       rule, rule->tr_rpc_rate, rule->tr_generation);
+	CDEBUG(D_RPCTRACE, "TBF starts rule@%p rate %llu bw %llu gen %llu\n",
+	       rule, rule->tr_rpc_rate, rule->tr_bw, rule->tr_generation);
 
 	return 0;
 }
@@ -406,7 +475,7 @@ static int
 nrs_tbf_rule_change_rate(struct ptlrpc_nrs_policy *policy,
 			 struct nrs_tbf_head *head,
 			 char *name,
-			 __u64 rate)
+			 __u64 rate, __u64 bw)
 {
 	struct nrs_tbf_rule *rule;
 
@@ -416,9 +485,13 @@ nrs_tbf_rule_change_rate(struct ptlrpc_nrs_policy *policy,
 	if (rule == NULL)
 		return -ENOENT;
 
-	rule->tr_rpc_rate = rate;
-	rule->tr_nsecs = NSEC_PER_SEC;
-	do_div(rule->tr_nsecs, rule->tr_rpc_rate);
+	if (rate != 0) {
+		rule->tr_rpc_rate = rate;
+		rule->tr_nsecs = NSEC_PER_SEC;
+		do_div(rule->tr_nsecs, rule->tr_rpc_rate);
+	}
+	if (bw != 0)
+		rule->tr_bw = bw;
 	rule->tr_generation++;
 	nrs_tbf_rule_put(rule);
 
@@ -431,12 +504,13 @@ nrs_tbf_rule_change(struct ptlrpc_nrs_policy *policy,
 		    struct nrs_tbf_cmd *change)
 {
 	__u64	 rate = change->u.tc_change.tc_rpc_rate;
+	__u64	 bw = change->u.tc_change.tc_bw;
 	char	*next_name = change->u.tc_change.tc_next_name;
 	int	 rc;
 
-	if (rate != 0) {
+	if (rate != 0 || bw != 0) {
 		rc = nrs_tbf_rule_change_rate(policy, head, change->tc_name,
-					      rate);
+					      rate, bw);
 		if (rc)
 			return rc;
 	}
@@ -782,7 +856,7 @@ nrs_tbf_jobid_startup(struct ptlrpc_nrs_policy *policy,
 	memset(&start, 0, sizeof(start));
 	start.u.tc_start.ts_jobids_str = "*";
 
-	start.u.tc_start.ts_rpc_rate = tbf_rate;
+	start.u.tc_start.ts_rpc_rate = nrs_tbf_default_rate(head);
 	start.u.tc_start.ts_rule_flags = NTRS_DEFAULT;
 	start.tc_name = NRS_TBF_DEFAULT_RULE;
 	INIT_LIST_HEAD(&start.u.tc_start.ts_jobids);
@@ -1003,7 +1077,7 @@ static int nrs_tbf_jobid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_jobid_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_jobids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -1156,7 +1230,7 @@ nrs_tbf_nid_startup(struct ptlrpc_nrs_policy *policy,
 	memset(&start, 0, sizeof(start));
 	start.u.tc_start.ts_nids_str = "*";
 
-	start.u.tc_start.ts_rpc_rate = tbf_rate;
+	start.u.tc_start.ts_rpc_rate = nrs_tbf_default_rate(head);
 	start.u.tc_start.ts_rule_flags = NTRS_DEFAULT;
 	start.tc_name = NRS_TBF_DEFAULT_RULE;
 	INIT_LIST_HEAD(&start.u.tc_start.ts_nids);
@@ -1208,7 +1282,7 @@ static int nrs_tbf_nid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_nid_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_nids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -1377,7 +1451,7 @@ nrs_tbf_startup(struct ptlrpc_nrs_policy *policy, struct nrs_tbf_head *head)
 	memset(&start, 0, sizeof(start));
 	start.u.tc_start.ts_conds_str = "*";
 
-	start.u.tc_start.ts_rpc_rate = tbf_rate;
+	start.u.tc_start.ts_rpc_rate = nrs_tbf_default_rate(head);
 	start.u.tc_start.ts_rule_flags = NTRS_DEFAULT;
 	start.tc_name = NRS_TBF_DEFAULT_RULE;
 	INIT_LIST_HEAD(&start.u.tc_start.ts_conds);
@@ -1626,6 +1700,48 @@ static int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
 	return rc;
 }
 
+/**
+ * Returns the bulk bytes moved by BRW request \a req, which is the sum of
+ * the lengths of its remote niobufs, or 0 for any other request.
+ *
+ * The request is queued before tgt_brw_read()/tgt_brw_write() validate the
+ * niobufs, so the lengths come straight from the client. The charge is
+ * capped at the largest BRW the target accepts, a bogus request cannot put
+ * its class into debt for longer than a valid one.
+ */
+static __u64 nrs_tbf_req_bytes(struct ptlrpc_request *req)
+{
+	u32 opc = lustre_msg_get_opc(req->rq_reqmsg);
+	struct niobuf_remote *nb;
+	bool fmt_unset = false;
+	__u64 bytes = 0;
+	int niocount;
+	int i;
+
+	if (opc != OST_READ && opc != OST_WRITE)
+		return 0;
+
+	req_capsule_init(&req->rq_pill, req, RCL_SERVER);
+	if (req->rq_pill.rc_fmt == NULL) {
+		req_capsule_set(&req->rq_pill, req_fmt(opc));
+		fmt_unset = true;
+	}
+
+	nb = req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE);
+	if (nb != NULL) {
+		niocount = req_capsule_get_size(&req->rq_pill,
+						&RMF_NIOBUF_REMOTE,
+						RCL_CLIENT) / sizeof(*nb);
+		for (i = 0; i < niocount; i++)
+			bytes += nb[i].rnb_len;
+	}
+
+	/* restore it to the initialized state */
+	if (fmt_unset)
+		req->rq_pill.rc_fmt = NULL;
+	return min_t(__u64, bytes, PTLRPC_MAX_BRW_SIZE);
+}
+
 static inline void nrs_tbf_cli_gen_key(struct nrs_tbf_client *cli,
 				       struct ptlrpc_request *req,
 				       char *keystr, size_t keystr_sz)
@@ -2063,7 +2179,7 @@ nrs_tbf_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_generic_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s %s %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s %s %llu, ref %d", rule->tr_name,
 		   rule->tr_conds_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -2189,7 +2305,7 @@ nrs_tbf_opcode_startup(struct ptlrpc_nrs_policy *policy,
 	start.u.tc_start.ts_opcodes = NULL;
 	start.u.tc_start.ts_opcodes_str = "*";
 
-	start.u.tc_start.ts_rpc_rate = tbf_rate;
+	start.u.tc_start.ts_rpc_rate = nrs_tbf_default_rate(head);
 	start.u.tc_start.ts_rule_flags = NTRS_DEFAULT;
 	start.tc_name = NRS_TBF_DEFAULT_RULE;
 	rc = nrs_tbf_rule_start(policy, head, &start);
@@ -2357,7 +2473,7 @@ static int nrs_tbf_opcode_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_opcode_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_opcodes_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -2468,7 +2584,7 @@ nrs_tbf_id_startup(struct ptlrpc_nrs_policy *policy,
 
 	memset(&start, 0, sizeof(start));
 	start.u.tc_start.ts_ids_str = "*";
-	start.u.tc_start.ts_rpc_rate = tbf_rate;
+	start.u.tc_start.ts_rpc_rate = nrs_tbf_default_rate(head);
 	start.u.tc_start.ts_rule_flags = NTRS_DEFAULT;
 	start.tc_name = NRS_TBF_DEFAULT_RULE;
 	INIT_LIST_HEAD(&start.u.tc_start.ts_ids);
@@ -2672,7 +2788,7 @@ nrs_tbf_id_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_id_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_ids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -2793,6 +2909,9 @@ static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	head->th_type[strlen(name)] = '\0';
 	head->th_ops = ops;
 	head->th_type_flag = type;
+	head->th_drr = strncmp(policy->pol_desc->pd_name, NRS_POL_NAME_DRR,
+			       NRS_POL_NAME_MAX) == 0;
+	INIT_LIST_HEAD(&head->th_drr_list);
 
 	head->th_binheap = cfs_binheap_create(&nrs_tbf_heap_ops,
 					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
@@ -2847,6 +2966,7 @@ static void nrs_tbf_stop(struct ptlrpc_nrs_policy *policy)
 	LASSERT(list_empty(&head->th_list));
 	LASSERT(head->th_binheap != NULL);
 	LASSERT(cfs_binheap_is_empty(head->th_binheap));
+	LASSERT(list_empty(&head->th_drr_list));
 	cfs_binheap_destroy(head->th_binheap);
 	OBD_FREE_PTR(head);
 	nrs->nrs_throttling = 0;
@@ -3028,6 +3148,20 @@ static void nrs_tbf_res_put(struct ptlrpc_nrs_policy *policy,
 	head->th_ops->o_cli_put(head, cli);
 }
 
+/**
+ * Returns the byte tokens of class \a cli after \a passed nanoseconds since
+ * its last dispatch, at most the depth of its byte bucket.
+ */
+static __s64 nrs_tbf_bw_ntoken(struct nrs_tbf_client *cli, __u64 passed)
+{
+	__u64 missing = cli->tc_bw_depth - cli->tc_bw_ntoken;
+
+	if (passed >= div64_u64(missing * NSEC_PER_SEC, cli->tc_bw))
+		return cli->tc_bw_depth;
+
+	return cli->tc_bw_ntoken + div_u64(passed * cli->tc_bw, NSEC_PER_SEC);
+}
+
 /**
  * Called when getting a request from the TBF policy for handling, or just
  * peeking; removes the request from the policy when it is to be handled.
@@ -3076,6 +3210,8 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		__u64 ntoken;
 		__u64 deadline;
 		__u64 old_resid = 0;
+		__s64 bw_ntoken = 0;
+		bool bw_wait = false;
 
 		deadline = cli->tc_check_time +
 			  cli->tc_nsecs;
@@ -3096,7 +3232,18 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		} else if (ntoken > cli->tc_depth)
 			ntoken = cli->tc_depth;
 
-		if (ntoken > 0) {
+		if (cli->tc_bw != 0) {
+			bw_ntoken = nrs_tbf_bw_ntoken(cli, passed);
+			if (bw_ntoken <= 0) {
+				bw_wait = true;
+				deadline = max(deadline, now +
+					       div64_u64((1 - bw_ntoken) *
+							 NSEC_PER_SEC,
+							 cli->tc_bw));
+			}
+		}
+
+		if (ntoken > 0 && !bw_wait) {
 			struct ptlrpc_request *req;
 			nrq = list_entry(cli->tc_list.next,
 					     struct ptlrpc_nrs_request,
@@ -3106,7 +3253,12 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 					   rq_nrq);
 			ntoken--;
 			cli->tc_ntoken = ntoken;
+			if (cli->tc_bw != 0)
+				cli->tc_bw_ntoken = bw_ntoken -
+						    nrq->nr_u.tbf.tr_bytes;
 			cli->tc_check_time = now;
+			rule->tr_rpcs++;
+			rule->tr_bytes += nrq->nr_u.tbf.tr_bytes;
 			list_del_init(&nrq->nr_u.tbf.tr_list);
 			if (list_empty(&cli->tc_list)) {
 				cfs_binheap_remove(head->th_binheap,
@@ -3128,9 +3280,14 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		} else {
 			ktime_t time;
 
-			if (rule->tr_flags & NTRS_REALTIME) {
+			/*
+			 * A class waiting for byte tokens may be behind other
+			 * classes which are ready now.
+			 */
+			if (rule->tr_flags & NTRS_REALTIME || bw_wait) {
 				cli->tc_deadline = deadline;
-				cli->tc_nsecs_resid = old_resid;
+				if (rule->tr_flags & NTRS_REALTIME)
+					cli->tc_nsecs_resid = old_resid;
 				cfs_binheap_relocate(head->th_binheap,
 						     &cli->tc_node);
 				if (node != cfs_binheap_root(head->th_binheap))
@@ -3170,6 +3327,9 @@ static int nrs_tbf_req_add(struct ptlrpc_nrs_policy *policy,
 			   struct nrs_tbf_client, tc_res);
 	head = container_of(nrs_request_resource(nrq)->res_parent,
 			    struct nrs_tbf_head, th_res);
+	nrq->nr_u.tbf.tr_bytes =
+		nrs_tbf_req_bytes(container_of(nrq, struct ptlrpc_request,
+					       rq_nrq));
 	if (list_empty(&cli->tc_list)) {
 		LASSERT(!cli->tc_in_heap);
 		cli->tc_deadline = cli->tc_check_time + cli->tc_nsecs;
@@ -3266,6 +3426,148 @@ static void nrs_tbf_req_stop(struct ptlrpc_nrs_policy *policy,
 	       nrq->nr_u.tbf.tr_sequence);
 }
 
+/**
+ * DRR, Deficit Round Robin policy
+ *
+ * DRR reuses the rules, the classification and the resource hierarchy of TBF,
+ * but it is work conserving: instead of limiting the RPC rate of a class, the
+ * value of the rule matching the class is used as its weight. The classes
+ * with queued requests are served in turns, and a class may dispatch as many
+ * RPCs as its weight in each turn, so that every class gets a share of the
+ * service proportional to its weight whenever there is contention, and any
+ * class can use all of the service when it is alone.
+ */
+
+/**
+ * Called when getting a request from the DRR policy for handling, or just
+ * peeking; removes the request from the policy when it is to be handled.
+ *
+ * \param[in] policy The policy
+ * \param[in] peek   When set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  Force the policy to return a request; unused in this
+ *		     policy
+ *
+ * \retval The request to be handled; this is the next request of the class
+ *	   whose turn it is
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_drr_req_get(struct ptlrpc_nrs_policy *policy,
+					   bool peek, bool force)
+{
+	struct nrs_tbf_head	  *head = policy->pol_private;
+	struct ptlrpc_nrs_request *nrq;
+	struct nrs_tbf_client     *cli;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_svcpt->scp_req_lock);
+
+	if (list_empty(&head->th_drr_list))
+		return NULL;
+
+	cli = list_entry(head->th_drr_list.next, struct nrs_tbf_client,
+			 tc_drr_link);
+	LASSERT(!list_empty(&cli->tc_list));
+	nrq = list_entry(cli->tc_list.next, struct ptlrpc_nrs_request,
+			 nr_u.tbf.tr_list);
+	if (peek)
+		return nrq;
+
+	/* Start a new turn of the class */
+	if (cli->tc_deficit == 0)
+		cli->tc_deficit = cli->tc_rpc_rate;
+
+	cli->tc_deficit--;
+	cli->tc_rule->tr_rpcs++;
+	cli->tc_rule->tr_bytes += nrq->nr_u.tbf.tr_bytes;
+	list_del_init(&nrq->nr_u.tbf.tr_list);
+	if (list_empty(&cli->tc_list)) {
+		list_del_init(&cli->tc_drr_link);
+		cli->tc_deficit = 0;
+	} else if (cli->tc_deficit == 0) {
+		list_move_tail(&cli->tc_drr_link, &head->th_drr_list);
+	}
+
+	CDEBUG(D_RPCTRACE,
+	       "DRR dequeues: class@%p weight %llu gen %llu deficit %llu, "
+	       "rule@%p weight %llu gen %llu\n",
+	       cli, cli->tc_rpc_rate, cli->tc_rule_generation,
+	       cli->tc_deficit, cli->tc_rule, cli->tc_rule->tr_rpc_rate,
+	       cli->tc_rule->tr_generation);
+
+	return nrq;
+}
+
+/**
+ * Adds request \a nrq to \a policy's list of queued requests
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to add
+ *
+ * \retval 0 success; nrs_request_enqueue() assumes this function will always
+ *		      succeed
+ */
+static int nrs_drr_req_add(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_tbf_head   *head;
+	struct nrs_tbf_client *cli;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_svcpt->scp_req_lock);
+
+	cli = container_of(nrs_request_resource(nrq),
+			   struct nrs_tbf_client, tc_res);
+	head = container_of(nrs_request_resource(nrq)->res_parent,
+			    struct nrs_tbf_head, th_res);
+
+	nrq->nr_u.tbf.tr_bytes =
+		nrs_tbf_req_bytes(container_of(nrq, struct ptlrpc_request,
+					       rq_nrq));
+	/* A class becoming active waits for its turn behind the others */
+	if (list_empty(&cli->tc_list)) {
+		LASSERT(list_empty(&cli->tc_drr_link));
+		list_add_tail(&cli->tc_drr_link, &head->th_drr_list);
+	}
+	nrq->nr_u.tbf.tr_sequence = head->th_sequence++;
+	list_add_tail(&nrq->nr_u.tbf.tr_list, &cli->tc_list);
+
+	CDEBUG(D_RPCTRACE,
+	       "DRR enqueues: class@%p weight %llu gen %llu deficit %llu, "
+	       "rule@%p weight %llu gen %llu\n",
+	       cli, cli->tc_rpc_rate, cli->tc_rule_generation,
+	       cli->tc_deficit, cli->tc_rule, cli->tc_rule->tr_rpc_rate,
+	       cli->tc_rule->tr_generation);
+
+	return 0;
+}
+
+/**
+ * Removes request \a nrq from \a policy's list of queued requests.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to remove
+ */
+static void nrs_drr_req_del(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_tbf_client *cli;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_svcpt->scp_req_lock);
+
+	cli = container_of(nrs_request_resource(nrq),
+			   struct nrs_tbf_client, tc_res);
+
+	LASSERT(!list_empty(&nrq->nr_u.tbf.tr_list));
+	list_del_init(&nrq->nr_u.tbf.tr_list);
+	if (list_empty(&cli->tc_list)) {
+		list_del_init(&cli->tc_drr_link);
+		cli->tc_deficit = 0;
+	}
+}
+
 /**
  * debugfs interface
  */
@@ -3275,8 +3577,14 @@ static void nrs_tbf_req_stop(struct ptlrpc_nrs_policy *policy,
  */
 #define LPROCFS_NRS_RATE_MAX		65535
 
+/**
+ * The maximum bandwidth in bytes per second, which keeps the byte token
+ * arithmetic within 64 bits.
+ */
+#define LPROCFS_NRS_BW_MAX		(16ULL << 30)
+
 static int
-ptlrpc_lprocfs_nrs_tbf_rule_seq_show(struct seq_file *m, void *data)
+nrs_tbf_rule_seq_show(struct seq_file *m, char *name)
 {
 	struct ptlrpc_service	    *svc = m->private;
 	int			     rc;
@@ -3288,8 +3596,7 @@ ptlrpc_lprocfs_nrs_tbf_rule_seq_show(struct seq_file *m, void *data)
 	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING state.
 	 */
 	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
-				       NRS_POL_NAME_TBF,
-				       NRS_CTL_TBF_RD_RULE,
+				       name, NRS_CTL_TBF_RD_RULE,
 				       false, m);
 	if (rc == 0) {
 		/**
@@ -3313,8 +3620,7 @@ ptlrpc_lprocfs_nrs_tbf_rule_seq_show(struct seq_file *m, void *data)
 
 	seq_printf(m, "high_priority_requests:\n");
 	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
-				       NRS_POL_NAME_TBF,
-				       NRS_CTL_TBF_RD_RULE,
+				       name, NRS_CTL_TBF_RD_RULE,
 				       false, m);
 	if (rc == 0) {
 		/**
@@ -3331,6 +3637,18 @@ no_hp:
 	return rc;
 }
 
+static int
+ptlrpc_lprocfs_nrs_tbf_rule_seq_show(struct seq_file *m, void *data)
+{
+	return nrs_tbf_rule_seq_show(m, NRS_POL_NAME_TBF);
+}
+
+static int
+ptlrpc_lprocfs_nrs_drr_rule_seq_show(struct seq_file *m, void *data)
+{
+	return nrs_tbf_rule_seq_show(m, NRS_POL_NAME_DRR);
+}
+
 static int nrs_tbf_id_parse(struct nrs_tbf_cmd *cmd, char *token)
 {
 	int rc;
@@ -3399,8 +3717,12 @@ static bool name_is_valid(const char *name)
 	return true;
 }
 
+/**
+ * Parses a "key=value" pair of a rule command; DRR rules take a weight
+ * instead of a rate, and have no bandwidth limit nor realtime mode.
+ */
 static int
-nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
+nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer, bool drr)
 {
 	char	*key;
 	char	*val;
@@ -3413,7 +3735,7 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 		return -EINVAL;
 
 	/* Key of the value pair */
-	if (strcmp(key, "rate") == 0) {
+	if (strcmp(key, drr ? "weight" : "rate") == 0) {
 		rc = kstrtoull(val, 10, &rate);
 		if (rc)
 			return rc;
@@ -3427,6 +3749,21 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 			cmd->u.tc_change.tc_rpc_rate = rate;
 		else
 			return -EINVAL;
+	} else if (strcmp(key, "bw") == 0 && !drr) {
+		char *end;
+		__u64 bw;
+
+		bw = memparse(val, &end);
+		if ((*end != '\0' && *end != '\n') || bw == 0 ||
+		    bw > LPROCFS_NRS_BW_MAX)
+			return -EINVAL;
+
+		if (cmd->tc_cmd == NRS_CTL_TBF_START_RULE)
+			cmd->u.tc_start.ts_bw = bw;
+		else if (cmd->tc_cmd == NRS_CTL_TBF_CHANGE_RULE)
+			cmd->u.tc_change.tc_bw = bw;
+		else
+			return -EINVAL;
 	}  else if (strcmp(key, "rank") == 0) {
 		if (!name_is_valid(val))
 			return -EINVAL;
@@ -3437,7 +3774,7 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 			cmd->u.tc_change.tc_next_name = val;
 		else
 			return -EINVAL;
-	} else if (strcmp(key, "realtime") == 0) {
+	} else if (strcmp(key, "realtime") == 0 && !drr) {
 		unsigned long realtime;
 
 		rc = kstrtoul(val, 10, &realtime);
@@ -3453,16 +3790,17 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 }
 
 static int
-nrs_tbf_parse_value_pairs(struct nrs_tbf_cmd *cmd, char *buffer)
+nrs_tbf_parse_value_pairs(struct nrs_tbf_cmd *cmd, char *buffer, bool drr)
 {
 	char	*val;
 	char	*token;
 	int	 rc;
 
+	/* Pairs are separated by spaces or commas, as in "rate=500,bw=2G" */
 	val = buffer;
 	while (val != NULL && strlen(val) != 0) {
-		token = strsep(&val, " ");
-		rc = nrs_tbf_parse_value_pair(cmd, token);
+		token = strsep(&val, " ,");
+		rc = nrs_tbf_parse_value_pair(cmd, token, drr);
 		if (rc)
 			return rc;
 	}
@@ -3470,10 +3808,12 @@ nrs_tbf_parse_value_pairs(struct nrs_tbf_cmd *cmd, char *buffer)
 	switch (cmd->tc_cmd) {
 	case NRS_CTL_TBF_START_RULE:
 		if (cmd->u.tc_start.ts_rpc_rate == 0)
-			cmd->u.tc_start.ts_rpc_rate = tbf_rate;
+			cmd->u.tc_start.ts_rpc_rate = drr ? drr_weight :
+							    tbf_rate;
 		break;
 	case NRS_CTL_TBF_CHANGE_RULE:
 		if (cmd->u.tc_change.tc_rpc_rate == 0 &&
+		    cmd->u.tc_change.tc_bw == 0 &&
 		    cmd->u.tc_change.tc_next_name == NULL)
 			return -EINVAL;
 		break;
@@ -3486,7 +3826,8 @@ nrs_tbf_parse_value_pairs(struct nrs_tbf_cmd *cmd, char *buffer)
 }
 
 static struct nrs_tbf_cmd *
-nrs_tbf_parse_cmd(char *buffer, unsigned long count, __u32 type_flag)
+nrs_tbf_parse_cmd(char *buffer, unsigned long count, __u32 type_flag,
+		  bool drr)
 {
 	static struct nrs_tbf_cmd	*cmd;
 	char				*token;
@@ -3544,7 +3885,7 @@ nrs_tbf_parse_cmd(char *buffer, unsigned long count, __u32 type_flag)
 			GOTO(out_free_cmd, rc);
 	}
 
-	rc = nrs_tbf_parse_value_pairs(cmd, val);
+	rc = nrs_tbf_parse_value_pairs(cmd, val, drr);
 	if (rc)
 		GOTO(out_cmd_fini, rc = -EINVAL);
 	goto out;
@@ -3564,17 +3905,18 @@ out:
  *
  * \param[in] svc the PTLRPC service
  * \param[in] queue the NRS queue type
+ * \param[in] name the policy name, TBF or DRR
  *
  * \retval the preset TBF policy type flag
  */
 static __u32
-nrs_tbf_type_flag(struct ptlrpc_service *svc, enum ptlrpc_nrs_queue_type queue)
+nrs_tbf_type_flag(struct ptlrpc_service *svc, enum ptlrpc_nrs_queue_type queue,
+		  char *name)
 {
 	__u32	type;
 	int	rc;
 
-	rc = ptlrpc_nrs_policy_control(svc, queue,
-				       NRS_POL_NAME_TBF,
+	rc = ptlrpc_nrs_policy_control(svc, queue, name,
 				       NRS_CTL_TBF_RD_TYPE_FLAG,
 				       true, &type);
 	if (rc != 0)
@@ -3585,9 +3927,8 @@ nrs_tbf_type_flag(struct ptlrpc_service *svc, enum ptlrpc_nrs_queue_type queue)
 
 #define LPROCFS_WR_NRS_TBF_MAX_CMD (4096)
 static ssize_t
-ptlrpc_lprocfs_nrs_tbf_rule_seq_write(struct file *file,
-				      const char __user *buffer,
-				      size_t count, loff_t *off)
+nrs_tbf_rule_seq_write(struct file *file, const char __user *buffer,
+		       size_t count, char *name)
 {
 	struct seq_file		  *m = file->private_data;
 	struct ptlrpc_service	  *svc = m->private;
@@ -3632,7 +3973,8 @@ ptlrpc_lprocfs_nrs_tbf_rule_seq_write(struct file *file,
 	else if (queue == PTLRPC_NRS_QUEUE_BOTH && !nrs_svc_has_hp(svc))
 		queue = PTLRPC_NRS_QUEUE_REG;
 
-	cmd = nrs_tbf_parse_cmd(val, length, nrs_tbf_type_flag(svc, queue));
+	cmd = nrs_tbf_parse_cmd(val, length, nrs_tbf_type_flag(svc, queue, name),
+				strcmp(name, NRS_POL_NAME_DRR) == 0);
 	if (IS_ERR(cmd))
 		GOTO(out_free_kernbuff, rc = PTR_ERR(cmd));
 
@@ -3641,8 +3983,7 @@ ptlrpc_lprocfs_nrs_tbf_rule_seq_write(struct file *file,
 	 * unregistration.
 	 */
 	mutex_lock(&nrs_core.nrs_mutex);
-	rc = ptlrpc_nrs_policy_control(svc, queue,
-				       NRS_POL_NAME_TBF,
+	rc = ptlrpc_nrs_policy_control(svc, queue, name,
 				       NRS_CTL_TBF_WR_RULE,
 				       false, cmd);
 	mutex_unlock(&nrs_core.nrs_mutex);
@@ -3655,8 +3996,26 @@ out:
 	return rc ? rc : count;
 }
 
+static ssize_t
+ptlrpc_lprocfs_nrs_tbf_rule_seq_write(struct file *file,
+				      const char __user *buffer,
+				      size_t count, loff_t *off)
+{
+	return nrs_tbf_rule_seq_write(file, buffer, count, NRS_POL_NAME_TBF);
+}
+
 LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_tbf_rule);
 
+static ssize_t
+ptlrpc_lprocfs_nrs_drr_rule_seq_write(struct file *file,
+				      const char __user *buffer,
+				      size_t count, loff_t *off)
+{
+	return nrs_tbf_rule_seq_write(file, buffer, count, NRS_POL_NAME_DRR);
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_drr_rule);
+
 /**
  * Initializes a TBF policy's lprocfs interface for service \a svc
  *
@@ -3706,6 +4065,55 @@ struct ptlrpc_nrs_pol_conf nrs_conf_tbf = {
 	.nc_compat		= nrs_policy_compat_all,
 };
 
+/**
+ * Initializes a DRR policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ *
+ * \retval 0	success
+ * \retval != 0	error
+ */
+static int nrs_drr_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_vars nrs_drr_lprocfs_vars[] = {
+		{ .name		= "nrs_drr_rule",
+		  .fops		= &ptlrpc_lprocfs_nrs_drr_rule_fops,
+		  .data = svc },
+		{ NULL }
+	};
+
+	if (IS_ERR_OR_NULL(svc->srv_debugfs_entry))
+		return 0;
+
+	return ldebugfs_add_vars(svc->srv_debugfs_entry, nrs_drr_lprocfs_vars,
+				 NULL);
+}
+
+/**
+ * Reuse the TBF rules and classification for DRR.
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_drr_ops = {
+	.op_policy_start	= nrs_tbf_start,
+	.op_policy_stop		= nrs_tbf_stop,
+	.op_policy_ctl		= nrs_tbf_ctl,
+	.op_res_get		= nrs_tbf_res_get,
+	.op_res_put		= nrs_tbf_res_put,
+	.op_req_get		= nrs_drr_req_get,
+	.op_req_enqueue		= nrs_drr_req_add,
+	.op_req_dequeue		= nrs_drr_req_del,
+	.op_req_stop		= nrs_tbf_req_stop,
+	.op_lprocfs_init	= nrs_drr_lprocfs_init,
+};
+
+/**
+ * DRR policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_drr = {
+	.nc_name		= NRS_POL_NAME_DRR,
+	.nc_ops			= &nrs_drr_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
 /** @} tbf */
 
 /** @} nrs */
@@ -1737,7 +1737,7 @@ void lustre_swab_obdo (struct obdo  *o)
 	__swab32s(&o->o_gid_h);
 	__swab64s(&o->o_data_version);
 	__swab32s(&o->o_projid);
-	CLASSERT(offsetof(typeof(*o), o_padding_4) != 0);
+	__swab32s(&o->o_compr_size);
 	CLASSERT(offsetof(typeof(*o), o_padding_5) != 0);
 	CLASSERT(offsetof(typeof(*o), o_padding_6) != 0);
 
@@ -2035,6 +2035,13 @@ void lustre_swab_idx_info(struct idx_info *ii)
 	__swab16s(&ii->ii_recsize);
 }
 
+void lustre_swab_batch_rpc_sub(struct batch_rpc_sub *brs)
+{
+	__swab64s(&brs->brs_xid);
+	__swab32s(&brs->brs_len);
+	CLASSERT(offsetof(typeof(*brs), brs_padding) != 0);
+}
+
 void lustre_swab_lip_header(struct lu_idxpage *lip)
 {
 	/* swab header */
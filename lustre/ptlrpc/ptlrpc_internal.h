@@ -51,6 +51,7 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_crrn;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_drr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_delay;
 #endif /* HAVE_SERVER_SUPPORT */
 
@@ -65,6 +66,7 @@ extern struct mutex pinger_mutex;
 
 int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait);
 /* ptlrpcd.c */
+extern int ptlrpcd_batch_rpc;
 int ptlrpcd_start(struct ptlrpcd_ctl *pc);
 
 /* client.c */
@@ -93,6 +95,11 @@ void ptlrpc_add_unreplied(struct ptlrpc_request *req);
 /* events.c */
 int ptlrpc_init_portals(void);
 void ptlrpc_exit_portals(void);
+void ptlrpc_req_add_history(struct ptlrpc_service_part *svcpt,
+			    struct ptlrpc_request *req);
+
+/* niobuf.c */
+void ptl_send_rpc_batch(struct ptlrpc_request_set *set);
 
 void ptlrpc_request_handle_notconn(struct ptlrpc_request *);
 void lustre_assert_wire_constants(void);
@@ -114,11 +121,14 @@ void ptlrpc_ldebugfs_register_service(struct dentry *debugfs_entry,
 #ifdef CONFIG_PROC_FS
 void ptlrpc_lprocfs_unregister_service(struct ptlrpc_service *svc);
 void ptlrpc_lprocfs_rpc_sent(struct ptlrpc_request *req, long amount);
+void ptlrpc_lprocfs_lat_tally(struct ptlrpc_lat_stats *ls, __u32 op,
+			      enum ptlrpc_lat_type type, s64 usecs);
 void ptlrpc_lprocfs_do_request_stat (struct ptlrpc_request *req,
                                      long q_usec, long work_usec);
 #else
 #define ptlrpc_lprocfs_unregister_service(params...) do{}while(0)
 #define ptlrpc_lprocfs_rpc_sent(params...) do{}while(0)
+#define ptlrpc_lprocfs_lat_tally(params...) do{}while(0)
 #define ptlrpc_lprocfs_do_request_stat(params...) do{}while(0)
 #endif /* CONFIG_PROC_FS */
 
@@ -278,6 +288,14 @@ void ptlrpc_pinger_wake_up(void);
 void ptlrpc_ping_import_soon(struct obd_import *imp);
 int ping_evictor_wake(struct obd_export *exp);
 
+/* rpc_trace.c */
+extern unsigned int ptlrpc_trace_sample;
+int ptlrpc_trace_init(void);
+void ptlrpc_trace_fini(void);
+void ptlrpc_trace_start(struct ptlrpc_request *req, bool server);
+void ptlrpc_trace_end(struct ptlrpc_request *req, int status);
+void ptlrpc_trace_free(struct ptlrpc_request *req);
+
 /* sec_null.c */
 int  sptlrpc_null_init(void);
 void sptlrpc_null_fini(void);
@@ -378,6 +396,7 @@ static inline void ptlrpc_cli_req_init(struct ptlrpc_request *req)
 	INIT_LIST_HEAD(&cr->cr_set_chain);
 	INIT_LIST_HEAD(&cr->cr_ctx_chain);
 	INIT_LIST_HEAD(&cr->cr_unreplied_list);
+	INIT_LIST_HEAD(&cr->cr_batch_chain);
 	init_waitqueue_head(&cr->cr_reply_waitq);
 	init_waitqueue_head(&cr->cr_set_waitq);
 }
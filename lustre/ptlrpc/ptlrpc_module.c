@@ -102,7 +102,13 @@ static __init int ptlrpc_init(void)
 	if (rc)
 		GOTO(err_nrs, rc);
 
+	rc = ptlrpc_trace_init();
+	if (rc)
+		GOTO(err_nodemap, rc);
+
 	RETURN(0);
+err_nodemap:
+	nodemap_mod_exit();
 err_nrs:
 	ptlrpc_nrs_fini();
 err_sptlrpc:
@@ -128,6 +134,7 @@ err_layout:
 
 static void __exit ptlrpc_exit(void)
 {
+	ptlrpc_trace_fini();
 	nodemap_mod_exit();
 	ptlrpc_nrs_fini();
 	sptlrpc_fini();
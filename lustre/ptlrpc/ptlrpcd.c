@@ -137,6 +137,16 @@ module_param(ptlrpcd_cpts, charp, 0644);
 MODULE_PARM_DESC(ptlrpcd_cpts,
 		 "CPU partitions ptlrpcd threads should run in");
 
+/*
+ * ptlrpcd_batch_rpc: Send the small requests that a ptlrpcd thread finds
+ * ready for the same target in one pass as a single OBD_BATCH_RPC message,
+ * if the target supports it.
+ */
+int ptlrpcd_batch_rpc = 1;
+module_param(ptlrpcd_batch_rpc, int, 0644);
+MODULE_PARM_DESC(ptlrpcd_batch_rpc,
+		 "Batch small async RPCs to the same target (0=disable)");
+
 /* ptlrpcds_cpt_idx maps cpt numbers to an index in the ptlrpcds array. */
 static int		*ptlrpcds_cpt_idx;
 
@@ -456,6 +466,7 @@ static int ptlrpcd(void *arg)
 	set = ptlrpc_prep_set();
 	if (set == NULL)
 		GOTO(failed, rc = -ENOMEM);
+	set->set_batch_rpc = 1;
 	spin_lock(&pc->pc_lock);
 	pc->pc_set = set;
 	spin_unlock(&pc->pc_lock);
@@ -0,0 +1,408 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/rpc_trace.c
+ *
+ * RPC tracing: a sampled subset of requests carries a struct rpc_trace_rec
+ * that is stamped as the request goes through the client and server paths,
+ * and is written to a per-CPU ring buffer once the request is done.
+ *
+ * Requests are sampled by XID, so that with the same rpc_trace_sample on
+ * clients and servers both sides of a traced RPC are recorded. The rings
+ * are read as binary records from debugfs "rpc_trace", which is what
+ * "lctl rpc_trace" decodes. Writing to that file discards the records.
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+
+#include <linux/debugfs.h>
+#include <linux/percpu.h>
+#include <linux/uaccess.h>
+
+#include <obd_support.h>
+#include <obd_class.h>
+#include <lustre_net.h>
+#include <lprocfs_status.h>
+
+#include "ptlrpc_internal.h"
+
+static unsigned int rpc_trace_records = 4096;
+module_param(rpc_trace_records, uint, 0444);
+MODULE_PARM_DESC(rpc_trace_records,
+		 "RPC trace records kept per CPU (rounded up to a power of 2)");
+
+/* trace one request in every ptlrpc_trace_sample, 0 disables tracing */
+unsigned int ptlrpc_trace_sample;
+
+struct ptlrpc_trace_slot {
+	/* 2 * index + 1 while the record is written, 2 * index + 2 after */
+	u64			pts_seq;
+	struct rpc_trace_rec	pts_rec;
+};
+
+struct ptlrpc_trace_ring {
+	/* index of the next record to write */
+	u64			 ptr_head;
+	/* records below this index were discarded */
+	u64			 ptr_tail;
+	struct ptlrpc_trace_slot *ptr_slots;
+};
+
+static struct ptlrpc_trace_ring __percpu *ptlrpc_trace_rings;
+static unsigned int ptlrpc_trace_nslots;
+static DEFINE_MUTEX(ptlrpc_trace_mutex);
+static struct dentry *ptlrpc_trace_dentry;
+static struct dentry *ptlrpc_trace_sample_dentry;
+
+static void ptlrpc_trace_rings_free(struct ptlrpc_trace_ring __percpu *rings)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ptlrpc_trace_ring *ring = per_cpu_ptr(rings, cpu);
+
+		if (ring->ptr_slots != NULL)
+			OBD_FREE_LARGE(ring->ptr_slots, ptlrpc_trace_nslots *
+				       sizeof(*ring->ptr_slots));
+	}
+	free_percpu(rings);
+}
+
+/*
+ * The rings are allocated when tracing is first enabled and kept until
+ * the module is unloaded, so that writers never race with their release.
+ */
+static int ptlrpc_trace_rings_alloc(void)
+{
+	struct ptlrpc_trace_ring __percpu *rings;
+	int cpu;
+	int rc = 0;
+
+	mutex_lock(&ptlrpc_trace_mutex);
+	if (ptlrpc_trace_rings != NULL)
+		GOTO(out, rc);
+
+	ptlrpc_trace_nslots = roundup_pow_of_two(max(rpc_trace_records, 1U));
+	rings = alloc_percpu(struct ptlrpc_trace_ring);
+	if (rings == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for_each_possible_cpu(cpu) {
+		struct ptlrpc_trace_ring *ring = per_cpu_ptr(rings, cpu);
+
+		OBD_ALLOC_LARGE(ring->ptr_slots, ptlrpc_trace_nslots *
+				sizeof(*ring->ptr_slots));
+		if (ring->ptr_slots == NULL) {
+			ptlrpc_trace_rings_free(rings);
+			GOTO(out, rc = -ENOMEM);
+		}
+	}
+	smp_store_release(&ptlrpc_trace_rings, rings);
+out:
+	mutex_unlock(&ptlrpc_trace_mutex);
+	return rc;
+}
+
+/**
+ * Decide whether \a req is traced, and if so attach its trace record.
+ *
+ * Called on the client when the request is first sent, and on the server
+ * once the incoming request has been unpacked.
+ */
+void ptlrpc_trace_start(struct ptlrpc_request *req, bool server)
+{
+	unsigned int sample = READ_ONCE(ptlrpc_trace_sample);
+	struct rpc_trace_rec *rec;
+	u64 xid = req->rq_xid;
+	char *jobid;
+
+	if (likely(sample == 0) || req->rq_trace != NULL ||
+	    do_div(xid, sample) != 0)
+		return;
+	if (smp_load_acquire(&ptlrpc_trace_rings) == NULL)
+		return;
+
+	OBD_ALLOC_GFP(rec, sizeof(*rec), GFP_ATOMIC);
+	if (rec == NULL)
+		return;
+
+	rec->rtr_magic = RPC_TRACE_MAGIC;
+	rec->rtr_size = sizeof(*rec);
+	rec->rtr_opc = lustre_msg_get_opc(req->rq_reqmsg);
+	if (server) {
+		rec->rtr_peer_nid = req->rq_peer.nid;
+		rec->rtr_peer_pid = req->rq_peer.pid;
+	} else if (req->rq_import != NULL &&
+		   req->rq_import->imp_connection != NULL) {
+		rec->rtr_peer_nid = req->rq_import->imp_connection->c_peer.nid;
+		rec->rtr_peer_pid = req->rq_import->imp_connection->c_peer.pid;
+	}
+	jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+	if (jobid != NULL)
+		strlcpy(rec->rtr_jobid, jobid, sizeof(rec->rtr_jobid));
+	if (server) {
+		rec->rtr_flags |= RPC_TRACE_FL_SERVER;
+		rec->rtr_ts[RPC_TRACE_ARRIVE] =
+			timespec64_to_ns(&req->rq_arrival_time);
+	}
+	req->rq_trace = rec;
+}
+
+/**
+ * Write the trace record of \a req to the ring of the current CPU and
+ * release it.
+ *
+ * Records are only written from thread context, so disabling preemption
+ * is enough to own the ring of the current CPU.
+ */
+void ptlrpc_trace_end(struct ptlrpc_request *req, int status)
+{
+	struct rpc_trace_rec *rec = req->rq_trace;
+	struct ptlrpc_trace_ring *ring;
+	struct ptlrpc_trace_slot *slot;
+	u64 idx;
+
+	if (likely(rec == NULL))
+		return;
+
+	req->rq_trace = NULL;
+	rec->rtr_xid = req->rq_xid;
+	rec->rtr_status = status;
+	if (rec->rtr_flags & RPC_TRACE_FL_SERVER) {
+		if (rec->rtr_ts[RPC_TRACE_BULK_START] != 0)
+			rec->rtr_flags |= RPC_TRACE_FL_BULK;
+	} else if (req->rq_bulk != NULL) {
+		rec->rtr_flags |= RPC_TRACE_FL_BULK;
+	}
+
+	ring = get_cpu_ptr(ptlrpc_trace_rings);
+	rec->rtr_cpu = smp_processor_id();
+	idx = ring->ptr_head;
+	slot = &ring->ptr_slots[idx & (ptlrpc_trace_nslots - 1)];
+
+	WRITE_ONCE(slot->pts_seq, 2 * idx + 1);
+	smp_wmb();
+	slot->pts_rec = *rec;
+	smp_wmb();
+	WRITE_ONCE(slot->pts_seq, 2 * idx + 2);
+	WRITE_ONCE(ring->ptr_head, idx + 1);
+	put_cpu_ptr(ptlrpc_trace_rings);
+
+	OBD_FREE_PTR(rec);
+}
+
+/** Drop the trace record of a request that is freed without finishing. */
+void ptlrpc_trace_free(struct ptlrpc_request *req)
+{
+	if (unlikely(req->rq_trace != NULL)) {
+		OBD_FREE_PTR(req->rq_trace);
+		req->rq_trace = NULL;
+	}
+}
+
+/* read position of one open of the "rpc_trace" file */
+struct ptlrpc_trace_cursor {
+	int	ptc_cpu;
+	u64	ptc_pos;
+	u64	ptc_end;
+};
+
+static int ptlrpc_trace_open(struct inode *inode, struct file *file)
+{
+	struct ptlrpc_trace_cursor *cur;
+
+	OBD_ALLOC_PTR(cur);
+	if (cur == NULL)
+		return -ENOMEM;
+
+	cur->ptc_cpu = -1;
+	file->private_data = cur;
+	return nonseekable_open(inode, file);
+}
+
+static int ptlrpc_trace_release(struct inode *inode, struct file *file)
+{
+	struct ptlrpc_trace_cursor *cur = file->private_data;
+
+	OBD_FREE_PTR(cur);
+	return 0;
+}
+
+/* move \a cur to the first record of the next CPU, false when done */
+static bool ptlrpc_trace_next_cpu(struct ptlrpc_trace_cursor *cur)
+{
+	struct ptlrpc_trace_ring *ring;
+	u64 head;
+
+	cur->ptc_cpu = cpumask_next(cur->ptc_cpu, cpu_possible_mask);
+	if (cur->ptc_cpu >= nr_cpu_ids)
+		return false;
+
+	ring = per_cpu_ptr(ptlrpc_trace_rings, cur->ptc_cpu);
+	head = READ_ONCE(ring->ptr_head);
+	cur->ptc_end = head;
+	cur->ptc_pos = max(READ_ONCE(ring->ptr_tail),
+			   head > ptlrpc_trace_nslots ?
+			   head - ptlrpc_trace_nslots : 0);
+	return true;
+}
+
+/*
+ * Copy out whole records from where the last read stopped. Records
+ * overwritten while they are being copied are skipped.
+ */
+static ssize_t ptlrpc_trace_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct ptlrpc_trace_cursor *cur = file->private_data;
+	struct ptlrpc_trace_slot *slot;
+	struct ptlrpc_trace_ring *ring;
+	struct rpc_trace_rec rec;
+	ssize_t done = 0;
+	u64 seq;
+
+	if (count < sizeof(rec))
+		return -EINVAL;
+	if (smp_load_acquire(&ptlrpc_trace_rings) == NULL)
+		return 0;
+
+	if (cur->ptc_cpu < 0 && !ptlrpc_trace_next_cpu(cur))
+		return 0;
+
+	while (count - done >= sizeof(rec)) {
+		if (cur->ptc_pos >= cur->ptc_end) {
+			if (!ptlrpc_trace_next_cpu(cur))
+				break;
+			continue;
+		}
+
+		ring = per_cpu_ptr(ptlrpc_trace_rings, cur->ptc_cpu);
+		slot = &ring->ptr_slots[cur->ptc_pos &
+					(ptlrpc_trace_nslots - 1)];
+		seq = READ_ONCE(slot->pts_seq);
+		smp_rmb();
+		rec = slot->pts_rec;
+		smp_rmb();
+		if (seq != 2 * cur->ptc_pos + 2 ||
+		    READ_ONCE(slot->pts_seq) != seq) {
+			cur->ptc_pos++;
+			continue;
+		}
+		cur->ptc_pos++;
+
+		if (copy_to_user(buf + done, &rec, sizeof(rec)))
+			return done > 0 ? done : -EFAULT;
+		done += sizeof(rec);
+
+		if (fatal_signal_pending(current))
+			break;
+	}
+
+	*ppos += done;
+	return done;
+}
+
+static ssize_t ptlrpc_trace_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	struct ptlrpc_trace_ring *ring;
+	int cpu;
+
+	if (smp_load_acquire(&ptlrpc_trace_rings) == NULL)
+		return count;
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(ptlrpc_trace_rings, cpu);
+		WRITE_ONCE(ring->ptr_tail, READ_ONCE(ring->ptr_head));
+	}
+
+	return count;
+}
+
+static const struct file_operations ptlrpc_trace_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ptlrpc_trace_open,
+	.read		= ptlrpc_trace_read,
+	.write		= ptlrpc_trace_write,
+	.llseek		= no_llseek,
+	.release	= ptlrpc_trace_release,
+};
+
+static int ptlrpc_trace_sample_seq_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%u\n", ptlrpc_trace_sample);
+	return 0;
+}
+
+static ssize_t ptlrpc_trace_sample_seq_write(struct file *file,
+					     const char __user *buffer,
+					     size_t count, loff_t *off)
+{
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val != 0) {
+		rc = ptlrpc_trace_rings_alloc();
+		if (rc < 0)
+			return rc;
+	}
+	WRITE_ONCE(ptlrpc_trace_sample, val);
+
+	return count;
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_trace_sample);
+
+int ptlrpc_trace_init(void)
+{
+	struct dentry *entry;
+
+	entry = debugfs_create_file("rpc_trace", 0600, debugfs_lustre_root,
+				    NULL, &ptlrpc_trace_fops);
+	if (IS_ERR_OR_NULL(entry))
+		return entry ? PTR_ERR(entry) : -ENOMEM;
+	ptlrpc_trace_dentry = entry;
+
+	entry = debugfs_create_file("rpc_trace_sample", 0644,
+				    debugfs_lustre_root, NULL,
+				    &ptlrpc_trace_sample_fops);
+	if (IS_ERR_OR_NULL(entry)) {
+		debugfs_remove(ptlrpc_trace_dentry);
+		ptlrpc_trace_dentry = NULL;
+		return entry ? PTR_ERR(entry) : -ENOMEM;
+	}
+	ptlrpc_trace_sample_dentry = entry;
+
+	return 0;
+}
+
+void ptlrpc_trace_fini(void)
+{
+	debugfs_remove(ptlrpc_trace_sample_dentry);
+	debugfs_remove(ptlrpc_trace_dentry);
+	if (ptlrpc_trace_rings != NULL)
+		ptlrpc_trace_rings_free(ptlrpc_trace_rings);
+}
@@ -54,6 +54,10 @@ static int enc_pool_max_memory_mb;
 module_param(enc_pool_max_memory_mb, int, 0644);
 MODULE_PARM_DESC(enc_pool_max_memory_mb,
 		 "Encoding pool max memory (MB), 1/8 of total physical memory by default");
+static int enc_pool_inplace_read = 1;
+module_param(enc_pool_inplace_read, int, 0644);
+MODULE_PARM_DESC(enc_pool_inplace_read,
+		 "Decrypt bulk reads in place rather than through the encoding pool");
 
 /*
  * bulk encryption page pools
@@ -114,6 +118,25 @@ static struct ptlrpc_enc_page_pool {
 	struct page ***epp_pools;
 } page_pools;
 
+/*
+ * per-CPT caches of free pages in front of the pools above, so that getting
+ * and putting back the pages of a bulk does not take epp_lock most of the
+ * time.  The pages in the caches are counted in epp_total_pages but not in
+ * epp_free_pages, and go back to the pools when those run short, when the
+ * pools are shrunk and when anybody waits for pages.
+ */
+#define ENC_POOL_CPT_PAGES	(2 * PTLRPC_MAX_BRW_PAGES)
+
+struct enc_pool_cpt {
+	spinlock_t	 epc_lock;
+	unsigned int	 epc_npages;
+	/* # of gets served from this cache */
+	unsigned long	 epc_st_hits;
+	struct page	*epc_pages[ENC_POOL_CPT_PAGES];
+};
+
+static struct enc_pool_cpt **enc_pool_cpts;
+
 /*
  * memory shrinker
  */
@@ -121,6 +144,66 @@ static const int pools_shrinker_seeks = DEFAULT_SEEKS;
 static struct shrinker *pools_shrinker;
 
 
+/* # of pages in the per-CPT caches, racy */
+static unsigned long enc_pools_cpt_pages(void)
+{
+	struct enc_pool_cpt *epc;
+	unsigned long npages = 0;
+	int i;
+
+	cfs_percpt_for_each(epc, i, enc_pool_cpts)
+		npages += epc->epc_npages;
+
+	return npages;
+}
+
+static unsigned long enc_pools_cpt_hits(void)
+{
+	struct enc_pool_cpt *epc;
+	unsigned long hits = 0;
+	int i;
+
+	cfs_percpt_for_each(epc, i, enc_pool_cpts)
+		hits += epc->epc_st_hits;
+
+	return hits;
+}
+
+/*
+ * move all the pages of the per-CPT caches back to the pools, return the
+ * number of pages moved.
+ */
+static unsigned long enc_pools_drain_cpts(void)
+{
+	struct enc_pool_cpt *epc;
+	unsigned long drained = 0;
+	int p_idx, g_idx;
+	int i;
+
+	assert_spin_locked(&page_pools.epp_lock);
+
+	cfs_percpt_for_each(epc, i, enc_pool_cpts) {
+		spin_lock(&epc->epc_lock);
+		while (epc->epc_npages > 0) {
+			LASSERT(page_pools.epp_free_pages <
+				page_pools.epp_total_pages);
+			p_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
+			g_idx = page_pools.epp_free_pages % PAGES_PER_POOL;
+			LASSERT(page_pools.epp_pools[p_idx]);
+			LASSERT(page_pools.epp_pools[p_idx][g_idx] == NULL);
+
+			page_pools.epp_pools[p_idx][g_idx] =
+				epc->epc_pages[--epc->epc_npages];
+			epc->epc_pages[epc->epc_npages] = NULL;
+			page_pools.epp_free_pages++;
+			drained++;
+		}
+		spin_unlock(&epc->epc_lock);
+	}
+
+	return drained;
+}
+
 /*
  * /proc/fs/lustre/sptlrpc/encrypt_page_pools
  */
@@ -146,7 +229,9 @@ int sptlrpc_proc_enc_pool_seq_show(struct seq_file *m, void *v)
 		   "low free mark:           %lu\n"
 		   "max waitqueue depth:     %u\n"
 		   "max wait time ms:        %lld\n"
-		   "out of mem:              %lu\n",
+		   "out of mem:              %lu\n"
+		   "cpt cached pages:        %lu\n"
+		   "cpt cache hits:          %lu\n",
 		   cfs_totalram_pages(), PAGES_PER_POOL,
 		   page_pools.epp_max_pages,
 		   page_pools.epp_max_pools,
@@ -164,7 +249,8 @@ int sptlrpc_proc_enc_pool_seq_show(struct seq_file *m, void *v)
 		   page_pools.epp_st_lowfree,
 		   page_pools.epp_st_max_wqlen,
 		   ktime_to_ms(page_pools.epp_st_max_wait),
-		   page_pools.epp_st_outofmem);
+		   page_pools.epp_st_outofmem,
+		   enc_pools_cpt_pages(), enc_pools_cpt_hits());
 
 	spin_unlock(&page_pools.epp_lock);
 	return 0;
@@ -221,6 +307,8 @@ static void enc_pools_release_free_pages(long npages)
 static unsigned long enc_pools_shrink_count(struct shrinker *s,
 					    struct shrink_control *sc)
 {
+	unsigned long free;
+
 	/*
 	 * if no pool access for a long time, we consider it's fully idle.
 	 * a little race here is fine.
@@ -233,8 +321,9 @@ static unsigned long enc_pools_shrink_count(struct shrinker *s,
 	}
 
 	LASSERT(page_pools.epp_idle_idx <= IDLE_IDX_MAX);
-	return (page_pools.epp_free_pages <= PTLRPC_MAX_BRW_PAGES) ? 0 :
-		(page_pools.epp_free_pages - PTLRPC_MAX_BRW_PAGES) *
+	free = page_pools.epp_free_pages + enc_pools_cpt_pages();
+	return (free <= PTLRPC_MAX_BRW_PAGES) ? 0 :
+		(free - PTLRPC_MAX_BRW_PAGES) *
 		(IDLE_IDX_MAX - page_pools.epp_idle_idx) / IDLE_IDX_MAX;
 }
 
@@ -245,6 +334,7 @@ static unsigned long enc_pools_shrink_scan(struct shrinker *s,
 					   struct shrink_control *sc)
 {
 	spin_lock(&page_pools.epp_lock);
+	enc_pools_drain_cpts();
 	if (page_pools.epp_free_pages <= PTLRPC_MAX_BRW_PAGES)
 		sc->nr_to_scan = 0;
 	else
@@ -517,7 +607,7 @@ static int enc_pools_should_grow(int page_needed, time64_t now)
  */
 int get_free_pages_in_pool(void)
 {
-	return page_pools.epp_free_pages;
+	return page_pools.epp_free_pages + enc_pools_cpt_pages();
 }
 EXPORT_SYMBOL(get_free_pages_in_pool);
 
@@ -530,6 +620,69 @@ int pool_is_at_full_capacity(void)
 }
 EXPORT_SYMBOL(pool_is_at_full_capacity);
 
+/*
+ * take all the pages for \a desc from the cache of the current CPT, if it
+ * holds enough of them.
+ */
+static bool enc_pools_cpt_get(struct ptlrpc_bulk_desc *desc)
+{
+	struct enc_pool_cpt *epc;
+	time64_t now;
+	int i;
+
+	epc = enc_pool_cpts[cfs_cpt_current(cfs_cpt_table, 0)];
+
+	spin_lock(&epc->epc_lock);
+	if (epc->epc_npages < desc->bd_iov_count) {
+		spin_unlock(&epc->epc_lock);
+		return false;
+	}
+
+	for (i = 0; i < desc->bd_iov_count; i++) {
+		BD_GET_ENC_KIOV(desc, i).kiov_page =
+			epc->epc_pages[--epc->epc_npages];
+		epc->epc_pages[epc->epc_npages] = NULL;
+	}
+	epc->epc_st_hits++;
+	spin_unlock(&epc->epc_lock);
+
+	/* racy, but only matters to the shrinker, see epp_idle_idx */
+	now = ktime_get_seconds();
+	if (page_pools.epp_last_access != now)
+		page_pools.epp_last_access = now;
+	return true;
+}
+
+/*
+ * put all the pages of \a desc in the cache of the current CPT, unless it
+ * would overflow or somebody is waiting for pages in the pools.
+ */
+static bool enc_pools_cpt_put(struct ptlrpc_bulk_desc *desc)
+{
+	struct enc_pool_cpt *epc;
+	int i;
+
+	if (unlikely(page_pools.epp_waitqlen))
+		return false;
+
+	epc = enc_pool_cpts[cfs_cpt_current(cfs_cpt_table, 0)];
+
+	spin_lock(&epc->epc_lock);
+	if (epc->epc_npages + desc->bd_iov_count > ENC_POOL_CPT_PAGES) {
+		spin_unlock(&epc->epc_lock);
+		return false;
+	}
+
+	for (i = 0; i < desc->bd_iov_count; i++) {
+		LASSERT(BD_GET_ENC_KIOV(desc, i).kiov_page != NULL);
+		epc->epc_pages[epc->epc_npages++] =
+			BD_GET_ENC_KIOV(desc, i).kiov_page;
+	}
+	spin_unlock(&epc->epc_lock);
+
+	return true;
+}
+
 /*
  * we allocate the requested pages atomically.
  */
@@ -555,10 +708,17 @@ int sptlrpc_enc_pool_get_pages(struct ptlrpc_bulk_desc *desc)
 	if (GET_ENC_KIOV(desc) == NULL)
 		return -ENOMEM;
 
+	if (enc_pools_cpt_get(desc))
+		return 0;
+
 	spin_lock(&page_pools.epp_lock);
 
 	page_pools.epp_st_access++;
 again:
+	if (unlikely(page_pools.epp_free_pages < desc->bd_iov_count) &&
+	    enc_pools_drain_cpts() > 0)
+		goto again;
+
 	if (unlikely(page_pools.epp_free_pages < desc->bd_iov_count)) {
 		if (tick_ns == 0)
 			tick_ns = ktime_get_ns();
@@ -680,6 +840,14 @@ void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc)
 
 	LASSERT(desc->bd_iov_count > 0);
 
+	if (desc->bd_enc_inplace) {
+		desc->bd_enc_inplace = 0;
+		goto out_free;
+	}
+
+	if (enc_pools_cpt_put(desc))
+		goto out_free;
+
 	spin_lock(&page_pools.epp_lock);
 
 	p_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
@@ -709,11 +877,47 @@ void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc)
 
 	spin_unlock(&page_pools.epp_lock);
 
+out_free:
 	OBD_FREE_LARGE(GET_ENC_KIOV(desc),
 		 desc->bd_iov_count * sizeof(*GET_ENC_KIOV(desc)));
 	GET_ENC_KIOV(desc) = NULL;
 }
 
+/*
+ * Have the cipher text of a bulk read received straight into the pages of
+ * \a desc and decrypted there in place, rather than received into pages of
+ * the pools and decrypted into the pages of \a desc.  This is only valid
+ * while nobody else can look at these pages, e.g. for pages being read by
+ * the client, which are locked and not uptodate yet, or for direct I/O.
+ */
+int sptlrpc_enc_pool_get_pages_inplace(struct ptlrpc_bulk_desc *desc)
+{
+	int i;
+
+	LASSERT(ptlrpc_is_bulk_desc_kiov(desc->bd_type));
+	LASSERT(desc->bd_iov_count > 0);
+
+	if (!enc_pool_inplace_read)
+		return sptlrpc_enc_pool_get_pages(desc);
+
+	/* resent bulk, enc iov might have been allocated previously */
+	if (GET_ENC_KIOV(desc) != NULL)
+		return 0;
+
+	OBD_ALLOC_LARGE(GET_ENC_KIOV(desc),
+			desc->bd_iov_count * sizeof(*GET_ENC_KIOV(desc)));
+	if (GET_ENC_KIOV(desc) == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < desc->bd_iov_count; i++)
+		BD_GET_ENC_KIOV(desc, i).kiov_page =
+			BD_GET_KIOV(desc, i).kiov_page;
+	desc->bd_enc_inplace = 1;
+
+	return 0;
+}
+EXPORT_SYMBOL(sptlrpc_enc_pool_get_pages_inplace);
+
 /*
  * we don't do much stuff for add_user/del_user anymore, except adding some
  * initial pages in add_user() if current pools are empty, rest would be
@@ -769,6 +973,8 @@ static inline void enc_pools_free(void)
 
 int sptlrpc_enc_pool_init(void)
 {
+	struct enc_pool_cpt *epc;
+	int i;
 	DEF_SHRINKER_VAR(shvar, enc_pools_shrink,
 			 enc_pools_shrink_count, enc_pools_shrink_scan);
 
@@ -808,8 +1014,18 @@ int sptlrpc_enc_pool_init(void)
 	if (page_pools.epp_pools == NULL)
 		return -ENOMEM;
 
+	enc_pool_cpts = cfs_percpt_alloc(cfs_cpt_table, sizeof(*epc));
+	if (enc_pool_cpts == NULL) {
+		enc_pools_free();
+		return -ENOMEM;
+	}
+
+	cfs_percpt_for_each(epc, i, enc_pool_cpts)
+		spin_lock_init(&epc->epc_lock);
+
 	pools_shrinker = set_shrinker(pools_shrinker_seeks, &shvar);
 	if (pools_shrinker == NULL) {
+		cfs_percpt_free(enc_pool_cpts);
 		enc_pools_free();
 		return -ENOMEM;
 	}
@@ -823,10 +1039,15 @@ void sptlrpc_enc_pool_fini(void)
 
 	LASSERT(pools_shrinker);
 	LASSERT(page_pools.epp_pools);
-	LASSERT(page_pools.epp_total_pages == page_pools.epp_free_pages);
 
 	remove_shrinker(pools_shrinker);
 
+	spin_lock(&page_pools.epp_lock);
+	enc_pools_drain_cpts();
+	spin_unlock(&page_pools.epp_lock);
+	cfs_percpt_free(enc_pool_cpts);
+	LASSERT(page_pools.epp_total_pages == page_pools.epp_free_pages);
+
 	npools = npages_to_npools(page_pools.epp_total_pages);
 	cleaned = enc_pools_cleanup(page_pools.epp_pools, npools);
 	LASSERT(cleaned == page_pools.epp_total_pages);
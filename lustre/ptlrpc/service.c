@@ -621,6 +621,8 @@ static int ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_idle);
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_posted);
 	INIT_LIST_HEAD(&svcpt->scp_req_incoming);
+	init_llist_head(&svcpt->scp_req_staged);
+	atomic_set(&svcpt->scp_nreqs_staged, 0);
 	init_waitqueue_head(&svcpt->scp_waitq);
 	/* history request & rqbd list */
 	INIT_LIST_HEAD(&svcpt->scp_hist_reqs);
@@ -636,6 +638,11 @@ static int ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	init_waitqueue_head(&svcpt->scp_rep_waitq);
 	atomic_set(&svcpt->scp_nreps_difficult, 0);
 
+	atomic64_set(&svcpt->scp_thr_wait_usecs, 0);
+	atomic64_set(&svcpt->scp_thr_busy_usecs, 0);
+	atomic_set(&svcpt->scp_thr_nreqs, 0);
+	svcpt->scp_thr_adapt_start = ktime_get();
+
 	/* adaptive timeout */
 	spin_lock_init(&svcpt->scp_at_lock);
 	array = &svcpt->scp_at_array;
@@ -811,6 +818,11 @@ struct ptlrpc_service *ptlrpc_register_service(struct ptlrpc_service_conf *conf,
 	service->srv_thread_name	= conf->psc_thr.tc_thr_name;
 	service->srv_ctx_tags		= conf->psc_thr.tc_ctx_tags;
 	service->srv_hpreq_ratio	= PTLRPC_SVC_HP_RATIO;
+	service->srv_req_in_batch	= PTLRPC_SVC_REQ_IN_BATCH;
+	service->srv_thr_adapt_interval	= PTLRPC_THR_ADAPT_INTERVAL;
+	service->srv_thr_grow_wait	= PTLRPC_THR_GROW_WAIT;
+	service->srv_thr_shrink_util	= PTLRPC_THR_SHRINK_UTIL;
+	service->srv_thr_shrink_delay	= PTLRPC_THR_SHRINK_DELAY;
 	service->srv_ops		= conf->psc_ops;
 
 	for (i = 0; i < ncpts; i++) {
@@ -884,6 +896,7 @@ static void ptlrpc_server_free_request(struct ptlrpc_request *req)
 	ptlrpc_req_drop_rs(req);
 
 	sptlrpc_svc_ctx_decref(req);
+	ptlrpc_trace_free(req);
 
 	if (req != &req->rq_rqbd->rqbd_req) {
 		/*
@@ -1435,6 +1448,7 @@ static int ptlrpc_at_send_early_reply(struct ptlrpc_request *req)
 	reqcopy->rq_pack_bulk = 0;
 	reqcopy->rq_pack_udesc = 0;
 	reqcopy->rq_packed_final = 0;
+	reqcopy->rq_trace = NULL;
 	sptlrpc_svc_ctx_addref(reqcopy);
 	/* We only need the reqmsg for the magic */
 	reqcopy->rq_reqmsg = reqmsg;
@@ -1593,7 +1607,8 @@ static int ptlrpc_at_check_timed(struct ptlrpc_service_part *svcpt)
 		LCONSOLE_WARN("%s: This server is not able to keep up with request traffic (cpu-bound).\n",
 			      svcpt->scp_service->srv_name);
 		CWARN("earlyQ=%d reqQ=%d recA=%d, svcEst=%d, delay=%lld\n",
-		      counter, svcpt->scp_nreqs_incoming,
+		      counter, svcpt->scp_nreqs_incoming +
+		      atomic_read(&svcpt->scp_nreqs_staged),
 		      svcpt->scp_nreqs_active,
 		      at_get(&svcpt->scp_at_estimate), delay);
 	}
@@ -1935,11 +1950,16 @@ bool ptlrpc_server_request_pending(struct ptlrpc_service_part *svcpt,
 static struct ptlrpc_request *
 ptlrpc_server_request_get(struct ptlrpc_service_part *svcpt, bool force)
 {
+	struct lprocfs_stats *stats = svcpt->scp_service->srv_stats;
 	struct ptlrpc_request *req = NULL;
+	ktime_t start = ktime_get();
 
 	ENTRY;
 
 	spin_lock(&svcpt->scp_req_lock);
+	if (likely(stats != NULL))
+		lprocfs_counter_add(stats, PTLRPC_REQGET_LOCK_CNTR,
+				    ktime_us_delta(ktime_get(), start));
 
 	if (ptlrpc_server_high_pending(svcpt, force)) {
 		req = ptlrpc_nrs_req_get_nolock(svcpt, true, force);
@@ -1961,6 +1981,7 @@ ptlrpc_server_request_get(struct ptlrpc_service_part *svcpt, bool force)
 	RETURN(NULL);
 
 got_request:
+	ptlrpc_trace_stamp(req, RPC_TRACE_NRS_DEQ);
 	svcpt->scp_nreqs_active++;
 	if (req->rq_hp)
 		svcpt->scp_nhreqs_active++;
@@ -1974,37 +1995,162 @@ got_request:
 }
 
 /**
- * Handle freshly incoming reqs, add to timed early reply list,
- * pass on to regular request queue.
- * All incoming requests pass through here before getting into
- * ptlrpc_server_handle_req later on.
+ * Split the OBD_BATCH_RPC \a batch into the requests it carries and queue
+ * them at the head of the incoming list, as if each of them had arrived on
+ * its own, so that they are unwrapped, checked and scheduled separately and
+ * replied to with their own XID.
+ *
+ * The requests point into the request buffer of \a batch and each of them
+ * holds a reference on it.
  */
-static int ptlrpc_server_handle_req_in(struct ptlrpc_service_part *svcpt,
-				       struct ptlrpc_thread *thread)
+static int ptlrpc_server_unbatch_req(struct ptlrpc_service_part *svcpt,
+				     struct ptlrpc_request *batch)
 {
 	struct ptlrpc_service *svc = svcpt->scp_service;
+	struct req_capsule *pill = &batch->rq_pill;
+	struct ptlrpc_request_buffer_desc *rqbd = batch->rq_rqbd;
 	struct ptlrpc_request *req;
-	__u32 deadline;
-	int rc;
+	struct ptlrpc_request *next;
+	struct batch_rpc_sub *subs;
+	LIST_HEAD(reqs);
+	char *msgs;
+	__u32 msgs_len;
+	__u32 offset = 0;
+	int nr;
+	int i;
+	int rc = 0;
 
 	ENTRY;
+	if (batch->rq_export == NULL || !exp_connect_batch_rpc(batch->rq_export))
+		RETURN(-EPROTO);
+
+	req_capsule_init(pill, batch, RCL_SERVER);
+	req_capsule_set(pill, &RQF_OBD_BATCH_RPC);
+	subs = req_capsule_client_get(pill, &RMF_BATCH_SUBS);
+	msgs = req_capsule_client_get(pill, &RMF_BATCH_MSGS);
+	if (subs == NULL || msgs == NULL)
+		GOTO(out, rc = -EPROTO);
+
+	nr = req_capsule_get_size(pill, &RMF_BATCH_SUBS, RCL_CLIENT) /
+	     sizeof(*subs);
+	msgs_len = req_capsule_get_size(pill, &RMF_BATCH_MSGS, RCL_CLIENT);
+	if (nr == 0 || nr > PTLRPC_BATCH_MAX_REQS)
+		GOTO(out, rc = -EPROTO);
+
+	for (i = 0; i < nr; i++) {
+		if (subs[i].brs_len == 0 || offset > msgs_len ||
+		    subs[i].brs_len > msgs_len - offset)
+			GOTO(out_free, rc = -EPROTO);
+
+		req = ptlrpc_request_cache_alloc(GFP_NOFS);
+		if (req == NULL)
+			GOTO(out_free, rc = -ENOMEM);
+
+		/* like request_in_callback() does for a request of its own */
+		ptlrpc_srv_req_init(req);
+		req->rq_xid = subs[i].brs_xid;
+		req->rq_reqbuf = msgs + offset;
+		req->rq_reqdata_len = subs[i].brs_len;
+		req->rq_arrival_time = batch->rq_arrival_time;
+		req->rq_peer = batch->rq_peer;
+		req->rq_source = batch->rq_source;
+		req->rq_self = batch->rq_self;
+		req->rq_rqbd = rqbd;
+		req->rq_phase = RQ_PHASE_NEW;
+		req->rq_batched = 1;
+		list_add_tail(&req->rq_list, &reqs);
+
+		offset += cfs_size_round(subs[i].brs_len);
+	}
+
+	CDEBUG(D_RPCTRACE, "batch x%llu from %s carries %d requests\n",
+	       batch->rq_xid, libcfs_id2str(batch->rq_peer), nr);
 
 	spin_lock(&svcpt->scp_lock);
-	if (list_empty(&svcpt->scp_req_incoming)) {
-		spin_unlock(&svcpt->scp_lock);
-		RETURN(0);
+	list_for_each_entry(req, &reqs, rq_list) {
+		ptlrpc_req_add_history(svcpt, req);
+		rqbd->rqbd_refcount++;
 	}
-
-	req = list_entry(svcpt->scp_req_incoming.next,
-			     struct ptlrpc_request, rq_list);
-	list_del_init(&req->rq_list);
-	svcpt->scp_nreqs_incoming--;
-	/*
-	 * Consider this still a "queued" request as far as stats are
-	 * concerned
-	 */
+	list_splice(&reqs, &svcpt->scp_req_incoming);
+	svcpt->scp_nreqs_incoming += nr;
 	spin_unlock(&svcpt->scp_lock);
 
+	/* one sample per batch, the sum is the requests they carried */
+	if (likely(svc->srv_stats != NULL))
+		lprocfs_counter_add(svc->srv_stats, PTLRPC_REQ_BATCHED_CNTR,
+				    nr);
+
+	wake_up(&svcpt->scp_waitq);
+	GOTO(out, rc = 0);
+
+out_free:
+	list_for_each_entry_safe(req, next, &reqs, rq_list) {
+		list_del(&req->rq_list);
+		ptlrpc_request_cache_free(req);
+	}
+out:
+	req_capsule_fini(pill);
+	return rc;
+}
+
+/**
+ * Move the requests staged by request_in_callback() to the tail of the
+ * incoming list, in the order they arrived, and do the accounting that the
+ * callback leaves to us: request history and the reference on the request
+ * buffer (the request embedded in the buffer takes over the network's one).
+ *
+ * Must be called with ptlrpc_service_part::scp_lock held.
+ */
+static void ptlrpc_server_drain_staged(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_request *req;
+	struct llist_node *node;
+	LIST_HEAD(reqs);
+	int nr = 0;
+
+	assert_spin_locked(&svcpt->scp_lock);
+
+	node = llist_del_all(&svcpt->scp_req_staged);
+	if (node == NULL)
+		return;
+
+	/* llist is LIFO, list_add() puts the requests back in order */
+	while (node != NULL) {
+		req = llist_entry(node, struct ptlrpc_request, rq_staged);
+		node = node->next;
+		list_add(&req->rq_list, &reqs);
+	}
+
+	list_for_each_entry(req, &reqs, rq_list) {
+		ptlrpc_req_add_history(svcpt, req);
+		if (req != &req->rq_rqbd->rqbd_req)
+			req->rq_rqbd->rqbd_refcount++;
+		nr++;
+	}
+	svcpt->scp_nreqs_incoming += nr;
+	atomic_sub(nr, &svcpt->scp_nreqs_staged);
+	list_splice_tail(&reqs, &svcpt->scp_req_incoming);
+}
+
+/**
+ * Preprocess a single incoming request \a req taken off the incoming list
+ * by ptlrpc_server_handle_req_in().
+ */
+static void ptlrpc_server_handle_one_req_in(struct ptlrpc_service_part *svcpt,
+					    struct ptlrpc_thread *thread,
+					    struct ptlrpc_request *req)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	__u32 deadline;
+	int rc;
+
+	ENTRY;
+
+	/* the buffer was unlinked by an LNET_EVENT_UNLINK or a failed PUT,
+	 * this only hands the rqbd reference back */
+	if (req->rq_reqdata_len == 0)
+		goto err_req;
+
 	/* go through security check/transform */
 	rc = sptlrpc_svc_unwrap_request(req);
 	switch (rc) {
@@ -2087,6 +2233,22 @@ static int ptlrpc_server_handle_req_in(struct ptlrpc_service_part *svcpt,
 		ptlrpc_update_export_timer(req->rq_export, 0);
 	}
 
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OBD_BATCH_RPC) {
+		/* there is no reply to the batch itself, and batches don't
+		 * nest: every level would take more rqbd references */
+		if (req->rq_batched)
+			rc = -EPROTO;
+		else
+			rc = ptlrpc_server_unbatch_req(svcpt, req);
+		if (rc)
+			DEBUG_REQ(D_ERROR, req, "dropping bad batch: rc = %d",
+				  rc);
+		goto err_req;
+	}
+
+	ptlrpc_trace_start(req, true);
+	ptlrpc_trace_stamp(req, RPC_TRACE_REQ_IN);
+
 	/* req_in handling should/must be fast */
 	if (ktime_get_real_seconds() - req->rq_arrival_time.tv_sec > 5)
 		DEBUG_REQ(D_WARNING, req, "Slow req_in handling %llds",
@@ -2135,12 +2297,69 @@ static int ptlrpc_server_handle_req_in(struct ptlrpc_service_part *svcpt,
 		GOTO(err_req, rc);
 
 	wake_up(&svcpt->scp_waitq);
-	RETURN(1);
+	RETURN_EXIT;
 
 err_req:
 	ptlrpc_server_finish_request(svcpt, req);
+	EXIT;
+}
 
-	RETURN(1);
+/**
+ * Handle freshly incoming reqs, add to timed early reply list,
+ * pass on to regular request queue.
+ * All incoming requests pass through here before getting into
+ * ptlrpc_server_handle_req later on.
+ *
+ * Up to ptlrpc_service::srv_req_in_batch requests are taken per
+ * acquisition of scp_lock.  Returns the number of requests handled.
+ */
+static int ptlrpc_server_handle_req_in(struct ptlrpc_service_part *svcpt,
+				       struct ptlrpc_thread *thread)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	struct ptlrpc_request *req;
+	LIST_HEAD(reqs);
+	ktime_t start = ktime_get();
+	s64 wait_usecs;
+	int nr = 0;
+
+	ENTRY;
+
+	spin_lock(&svcpt->scp_lock);
+	wait_usecs = ktime_us_delta(ktime_get(), start);
+
+	ptlrpc_server_drain_staged(svcpt);
+	while (nr < svc->srv_req_in_batch &&
+	       !list_empty(&svcpt->scp_req_incoming)) {
+		req = list_entry(svcpt->scp_req_incoming.next,
+				 struct ptlrpc_request, rq_list);
+		list_move_tail(&req->rq_list, &reqs);
+		nr++;
+	}
+	svcpt->scp_nreqs_incoming -= nr;
+	/*
+	 * Consider these still "queued" requests as far as stats are
+	 * concerned
+	 */
+	spin_unlock(&svcpt->scp_lock);
+
+	if (nr == 0)
+		RETURN(0);
+
+	if (likely(svc->srv_stats != NULL)) {
+		lprocfs_counter_add(svc->srv_stats, PTLRPC_REQIN_BATCH_CNTR,
+				    nr);
+		lprocfs_counter_add(svc->srv_stats, PTLRPC_REQIN_LOCK_CNTR,
+				    wait_usecs);
+	}
+
+	while (!list_empty(&reqs)) {
+		req = list_entry(reqs.next, struct ptlrpc_request, rq_list);
+		list_del_init(&req->rq_list);
+		ptlrpc_server_handle_one_req_in(svcpt, thread, req);
+	}
+
+	RETURN(nr);
 }
 
 /**
@@ -2157,6 +2376,7 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 	ktime_t arrived;
 	s64 timediff_usecs;
 	s64 arrived_usecs;
+	s64 wait_usecs;
 	int fail_opc = 0;
 
 	ENTRY;
@@ -2183,16 +2403,20 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 	work_start = ktime_get_real();
 	arrived = timespec64_to_ktime(request->rq_arrival_time);
 	timediff_usecs = ktime_us_delta(work_start, arrived);
+	wait_usecs = timediff_usecs;
 	if (likely(svc->srv_stats != NULL)) {
 		lprocfs_counter_add(svc->srv_stats, PTLRPC_REQWAIT_CNTR,
 				    timediff_usecs);
 		lprocfs_counter_add(svc->srv_stats, PTLRPC_REQQDEPTH_CNTR,
-				    svcpt->scp_nreqs_incoming);
+				    svcpt->scp_nreqs_incoming +
+				    atomic_read(&svcpt->scp_nreqs_staged));
 		lprocfs_counter_add(svc->srv_stats, PTLRPC_REQACTIVE_CNTR,
 				    svcpt->scp_nreqs_active);
 		lprocfs_counter_add(svc->srv_stats, PTLRPC_TIMEOUT,
 				    at_get(&svcpt->scp_at_estimate));
 	}
+	atomic64_add(max_t(s64, timediff_usecs, 0), &svcpt->scp_thr_wait_usecs);
+	atomic_inc(&svcpt->scp_thr_nreqs);
 
 	if (likely(request->rq_export)) {
 		if (unlikely(ptlrpc_check_req(request)))
@@ -2239,7 +2463,9 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 		request->rq_session.lc_thread = thread;
 		thread->t_env->le_ses = &request->rq_session;
 	}
+	ptlrpc_trace_stamp(request, RPC_TRACE_HANDLE_START);
 	svc->srv_ops.so_req_handler(request);
+	ptlrpc_trace_stamp(request, RPC_TRACE_HANDLE_END);
 
 	ptlrpc_rqphase_move(request, RQ_PHASE_COMPLETE);
 
@@ -2256,6 +2482,7 @@ put_conn:
 	work_end = ktime_get_real();
 	timediff_usecs = ktime_us_delta(work_end, work_start);
 	arrived_usecs = ktime_us_delta(work_end, arrived);
+	atomic64_add(max_t(s64, timediff_usecs, 0), &svcpt->scp_thr_busy_usecs);
 	CDEBUG(D_RPCTRACE,
 	       "Handled RPC req@%p pname:cluuid+ref:pid:xid:nid:opc:job %s:%s+%d:%d:x%llu:%s:%d:%s Request processed in %lldus (%lldus total) trans %llu rc %d/%d\n",
 	       request, current_comm(),
@@ -2287,6 +2514,16 @@ put_conn:
 					    timediff_usecs);
 		}
 	}
+	if (likely(svc->srv_lat_stats != NULL && request->rq_reqmsg != NULL)) {
+		__u32 op = lustre_msg_get_opc(request->rq_reqmsg);
+
+		ptlrpc_lprocfs_lat_tally(svc->srv_lat_stats, op,
+					 PTLRPC_LAT_WAIT, wait_usecs);
+		ptlrpc_lprocfs_lat_tally(svc->srv_lat_stats, op,
+					 PTLRPC_LAT_SERVICE, timediff_usecs);
+		ptlrpc_lprocfs_lat_tally(svc->srv_lat_stats, op,
+					 PTLRPC_LAT_TOTAL, arrived_usecs);
+	}
 	if (unlikely(request->rq_early_count)) {
 		DEBUG_REQ(D_ADAPTTO, request,
 			  "sent %d early replies before finishing in %llds",
@@ -2294,6 +2531,7 @@ put_conn:
 			  div_u64(arrived_usecs, USEC_PER_SEC));
 	}
 
+	ptlrpc_trace_end(request, request->rq_status);
 	ptlrpc_server_finish_active_request(svcpt, request);
 
 	RETURN(1);
@@ -2552,6 +2790,116 @@ static inline void ptlrpc_thread_stop(struct ptlrpc_thread *thread)
 	spin_unlock(&svcpt->scp_lock);
 }
 
+/**
+ * The highest numbered thread above threads_min is the next one to be
+ * stopped by ptlrpc_threads_adapt(), so it does not sleep for longer than
+ * an adapt interval and the pool is resized even when the service is idle.
+ */
+static inline bool ptlrpc_thread_adapt_wakeup(struct ptlrpc_thread *thread)
+{
+	struct ptlrpc_service_part *svcpt = thread->t_svcpt;
+	struct ptlrpc_service *svc = svcpt->scp_service;
+
+	return svc->srv_thr_adapt_interval != 0 &&
+	       thread->t_id >= svc->srv_nthrs_cpt_init &&
+	       thread->t_id == svcpt->scp_thr_nextid - 1;
+}
+
+/**
+ * Adaptive thread pool sizing.
+ *
+ * Once per adapt interval, look at the requests started on \a svcpt during
+ * the last interval.  If they waited in the queue for longer than
+ * srv_thr_grow_wait on average while the threads were busy, start one more
+ * thread.  If the threads were busy for less than srv_thr_shrink_util percent
+ * of the interval, srv_thr_shrink_delay intervals in a row, stop the highest
+ * numbered thread.  The pool is kept between threads_min and threads_max, and
+ * ptlrpc_threads_need_create() still adds a thread as soon as all of them
+ * are busy.
+ */
+static void ptlrpc_threads_adapt(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+	struct ptlrpc_thread *victim = NULL;
+	struct ptlrpc_thread *thread;
+	ktime_t now = ktime_get();
+	s64 interval = (s64)svc->srv_thr_adapt_interval * USEC_PER_SEC;
+	s64 elapsed;
+	u64 wait_usecs;
+	u64 busy_usecs;
+	u64 avg_wait = 0;
+	u64 util = 0;
+	bool grow = false;
+	int nreqs;
+
+	if (interval == 0 ||
+	    ktime_us_delta(now, svcpt->scp_thr_adapt_start) < interval)
+		return;
+
+	spin_lock(&svcpt->scp_lock);
+	/* somebody else has just done it */
+	elapsed = ktime_us_delta(now, svcpt->scp_thr_adapt_start);
+	if (elapsed < interval) {
+		spin_unlock(&svcpt->scp_lock);
+		return;
+	}
+	svcpt->scp_thr_adapt_start = now;
+
+	wait_usecs = atomic64_xchg(&svcpt->scp_thr_wait_usecs, 0);
+	busy_usecs = atomic64_xchg(&svcpt->scp_thr_busy_usecs, 0);
+	nreqs = atomic_xchg(&svcpt->scp_thr_nreqs, 0);
+	if (nreqs > 0)
+		avg_wait = div_u64(wait_usecs, nreqs);
+	if (svcpt->scp_nthrs_running > 0)
+		util = div64_u64(busy_usecs * 100,
+				 elapsed * svcpt->scp_nthrs_running);
+
+	if (avg_wait > svc->srv_thr_grow_wait &&
+	    util >= svc->srv_thr_shrink_util) {
+		svcpt->scp_thr_idle_intervals = 0;
+		grow = ptlrpc_threads_increasable(svcpt);
+	} else if (util < svc->srv_thr_shrink_util) {
+		svcpt->scp_thr_idle_intervals++;
+	} else {
+		svcpt->scp_thr_idle_intervals = 0;
+	}
+
+	if (svcpt->scp_thr_idle_intervals >= svc->srv_thr_shrink_delay &&
+	    svcpt->scp_nthrs_running > svc->srv_nthrs_cpt_init &&
+	    svcpt->scp_nthrs_starting == 0) {
+		list_for_each_entry(thread, &svcpt->scp_threads, t_link) {
+			if (thread->t_id == svcpt->scp_thr_nextid - 1 &&
+			    thread_is_running(thread) &&
+			    !thread_is_stopping(thread)) {
+				victim = thread;
+				break;
+			}
+		}
+		if (victim != NULL) {
+			thread_add_flags(victim, SVC_SHRINK);
+			ptlrpc_stop_thread(victim);
+			svcpt->scp_thr_nextid--;
+			svcpt->scp_thr_idle_intervals = 0;
+		}
+	}
+	spin_unlock(&svcpt->scp_lock);
+
+	/* the victim exits now, and the next highest numbered thread arms
+	 * its adapt timeout, see ptlrpc_wait_event() */
+	if (victim != NULL)
+		wake_up_all(&svcpt->scp_waitq);
+
+	CDEBUG(D_RPCTRACE,
+	       "%s[%d]: %d reqs, avg wait %lluus, %llu%% busy, %d threads%s\n",
+	       svc->srv_name, svcpt->scp_cpt, nreqs, avg_wait, util,
+	       svcpt->scp_nthrs_running,
+	       grow ? ", growing" : victim != NULL ? ", shrinking" : "");
+
+	/* Ignore return code - we tried... */
+	if (grow)
+		ptlrpc_start_thread(svcpt, 0);
+}
+
 static inline int ptlrpc_rqbd_pending(struct ptlrpc_service_part *svcpt)
 {
 	return !list_empty(&svcpt->scp_rqbd_idle) &&
@@ -2623,7 +2971,8 @@ static void ptlrpc_watchdog_touch(struct delayed_work *work, time_t time)
 static inline int
 ptlrpc_server_request_incoming(struct ptlrpc_service_part *svcpt)
 {
-	return !list_empty(&svcpt->scp_req_incoming);
+	return !list_empty(&svcpt->scp_req_incoming) ||
+	       !llist_empty(&svcpt->scp_req_staged);
 }
 
 static __attribute__((__noinline__)) int
@@ -2631,8 +2980,14 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 		  struct ptlrpc_thread *thread)
 {
 	/* Don't exit while there are replies to be handled */
-	struct l_wait_info lwi = LWI_TIMEOUT(svcpt->scp_rqbd_timeout,
-					     ptlrpc_retry_rqbds, svcpt);
+	struct l_wait_info lwi;
+	long timeout = svcpt->scp_rqbd_timeout;
+	bool adapt = ptlrpc_thread_adapt_wakeup(thread);
+
+	if (timeout == 0 && adapt)
+		timeout = cfs_time_seconds(
+				svcpt->scp_service->srv_thr_adapt_interval);
+	lwi = LWI_TIMEOUT(timeout, ptlrpc_retry_rqbds, svcpt);
 
 	ptlrpc_watchdog_disable(&thread->t_watchdog);
 
@@ -2643,7 +2998,9 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 				ptlrpc_server_request_incoming(svcpt) ||
 				ptlrpc_server_request_pending(svcpt, false) ||
 				ptlrpc_rqbd_pending(svcpt) ||
-				ptlrpc_at_check(svcpt), &lwi);
+				ptlrpc_at_check(svcpt) ||
+				(!adapt && ptlrpc_thread_adapt_wakeup(thread)),
+				&lwi);
 
 	if (ptlrpc_thread_stopping(thread))
 		return -EINTR;
@@ -2766,6 +3123,7 @@ static int ptlrpc_main(void *arg)
 			break;
 
 		ptlrpc_check_rqbd_pool(svcpt);
+		ptlrpc_threads_adapt(svcpt);
 
 		if (ptlrpc_threads_need_create(svcpt)) {
 			/* Ignore return code - we tried... */
@@ -2777,11 +3135,11 @@ static int ptlrpc_main(void *arg)
 		/* Process all incoming reqs before handling any */
 		if (ptlrpc_server_request_incoming(svcpt)) {
 			lu_context_enter(&env->le_ctx);
-			ptlrpc_server_handle_req_in(svcpt, thread);
+			counter += ptlrpc_server_handle_req_in(svcpt, thread);
 			lu_context_exit(&env->le_ctx);
 
 			/* but limit ourselves in case of flood */
-			if (counter++ < 100)
+			if (counter < 100)
 				continue;
 			counter = 0;
 		}
@@ -2843,8 +3201,20 @@ out:
 	thread_add_flags(thread, SVC_STOPPED);
 
 	wake_up(&thread->t_ctl_waitq);
+	/*
+	 * nobody waits for a thread stopped by ptlrpc_threads_adapt(), so it
+	 * is freed here rather than piling up on scp_threads until the
+	 * service is stopped, unless ptlrpc_svcpt_stop_threads() is at it
+	 */
+	if (thread_is_shrink(thread) && !svc->srv_is_stopping)
+		list_del(&thread->t_link);
+	else
+		thread = NULL;
 	spin_unlock(&svcpt->scp_lock);
 
+	if (thread != NULL)
+		OBD_FREE_PTR(thread);
+
 	return rc;
 }
 
@@ -3411,6 +3781,10 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 		 * all unlinked) and no service threads, so I'm the only
 		 * thread noodling the request queue now
 		 */
+		spin_lock(&svcpt->scp_lock);
+		ptlrpc_server_drain_staged(svcpt);
+		spin_unlock(&svcpt->scp_lock);
+
 		while (!list_empty(&svcpt->scp_req_incoming)) {
 			req = list_entry(svcpt->scp_req_incoming.next,
 					     struct ptlrpc_request, rq_list);
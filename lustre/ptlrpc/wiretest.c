@@ -349,7 +349,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)OBD_PING);
 	LASSERTF(OBD_IDX_READ == 403, "found %lld\n",
 		 (long long)OBD_IDX_READ);
-	LASSERTF(OBD_LAST_OPC == 404, "found %lld\n",
+	LASSERTF(OBD_BATCH_RPC == 404, "found %lld\n",
+		 (long long)OBD_BATCH_RPC);
+	LASSERTF(OBD_LAST_OPC == 405, "found %lld\n",
 		 (long long)OBD_LAST_OPC);
 	LASSERTF(QUOTA_DQACQ == 601, "found %lld\n",
 		 (long long)QUOTA_DQACQ);
@@ -1355,6 +1357,12 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT2_PLAIN_LAYOUT);
 	LASSERTF(OBD_CONNECT2_ASYNC_DISCARD == 0x4000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_ASYNC_DISCARD);
+	LASSERTF(OBD_CONNECT2_COMPRESS == 0x8000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_COMPRESS);
+	LASSERTF(OBD_CONNECT2_MULTIOBJ_BRW == 0x10000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_MULTIOBJ_BRW);
+	LASSERTF(OBD_CONNECT2_BATCH_RPC == 0x20000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_RPC);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -1509,10 +1517,10 @@ void lustre_assert_wire_constants(void)
 		 (long long)(int)offsetof(struct obdo, o_projid));
 	LASSERTF((int)sizeof(((struct obdo *)0)->o_projid) == 4, "found %lld\n",
 		 (long long)(int)sizeof(((struct obdo *)0)->o_projid));
-	LASSERTF((int)offsetof(struct obdo, o_padding_4) == 188, "found %lld\n",
-		 (long long)(int)offsetof(struct obdo, o_padding_4));
-	LASSERTF((int)sizeof(((struct obdo *)0)->o_padding_4) == 4, "found %lld\n",
-		 (long long)(int)sizeof(((struct obdo *)0)->o_padding_4));
+	LASSERTF((int)offsetof(struct obdo, o_compr_size) == 188, "found %lld\n",
+		 (long long)(int)offsetof(struct obdo, o_compr_size));
+	LASSERTF((int)sizeof(((struct obdo *)0)->o_compr_size) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct obdo *)0)->o_compr_size));
 	LASSERTF((int)offsetof(struct obdo, o_padding_5) == 192, "found %lld\n",
 		 (long long)(int)offsetof(struct obdo, o_padding_5));
 	LASSERTF((int)sizeof(((struct obdo *)0)->o_padding_5) == 8, "found %lld\n",
@@ -1626,6 +1634,8 @@ void lustre_assert_wire_constants(void)
 	CLASSERT(OBD_FL_NOSPC_BLK == 0x00100000);
 	CLASSERT(OBD_FL_FLUSH == 0x00200000);
 	CLASSERT(OBD_FL_SHORT_IO == 0x00400000);
+	CLASSERT(OBD_FL_COMPRESS_LZ4 == 0x00800000);
+	CLASSERT(OBD_FL_COMPRESS_DEFLATE == 0x01000000);
 
 	/* Checks for struct lov_ost_data_v1 */
 	LASSERTF((int)sizeof(struct lov_ost_data_v1) == 24, "found %lld\n",
@@ -2225,6 +2235,22 @@ void lustre_assert_wire_constants(void)
 	LASSERTF(II_FL_NONUNQ == 8, "found %lld\n",
 		 (long long)II_FL_NONUNQ);
 
+	/* Checks for struct batch_rpc_sub */
+	LASSERTF((int)sizeof(struct batch_rpc_sub) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct batch_rpc_sub));
+	LASSERTF((int)offsetof(struct batch_rpc_sub, brs_xid) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_rpc_sub, brs_xid));
+	LASSERTF((int)sizeof(((struct batch_rpc_sub *)0)->brs_xid) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_rpc_sub *)0)->brs_xid));
+	LASSERTF((int)offsetof(struct batch_rpc_sub, brs_len) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_rpc_sub, brs_len));
+	LASSERTF((int)sizeof(((struct batch_rpc_sub *)0)->brs_len) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_rpc_sub *)0)->brs_len));
+	LASSERTF((int)offsetof(struct batch_rpc_sub, brs_padding) == 12, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_rpc_sub, brs_padding));
+	LASSERTF((int)sizeof(((struct batch_rpc_sub *)0)->brs_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_rpc_sub *)0)->brs_padding));
+
 	/* Checks for struct niobuf_remote */
 	LASSERTF((int)sizeof(struct niobuf_remote) == 16, "found %lld\n",
 		 (long long)(int)sizeof(struct niobuf_remote));
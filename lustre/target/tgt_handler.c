@@ -42,6 +42,7 @@
 #include <obd.h>
 #include <obd_class.h>
 #include <obd_cksum.h>
+#include <obd_compress.h>
 #include <lustre_lfsck.h>
 #include <lustre_nodemap.h>
 #include <lustre_acl.h>
@@ -191,6 +192,8 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 	struct niobuf_remote	*rnb;
 	struct obd_ioobj	*ioo;
 	int			 obj_count;
+	int			 max_objs = 1;
+	int			 i;
 
 	ENTRY;
 
@@ -212,27 +215,35 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 	}
 	ioo->ioo_oid = *oi;
 
+	/* only writes may carry several objects, see tgt_brw_write() */
+	if (exp_connect_multiobj_brw(tsi->tsi_exp) &&
+	    lustre_msg_get_opc(tgt_ses_req(tsi)->rq_reqmsg) == OST_WRITE)
+		max_objs = OST_MAX_BRW_OBJS;
+
 	obj_count = req_capsule_get_size(tsi->tsi_pill, &RMF_OBD_IOOBJ,
 					RCL_CLIENT) / sizeof(*ioo);
 	if (obj_count == 0) {
 		CERROR("%s: short ioobj\n", tgt_name(tsi->tsi_tgt));
 		RETURN(-EPROTO);
-	} else if (obj_count > 1) {
+	} else if (obj_count > max_objs) {
 		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
 		       obj_count);
 		RETURN(-EPROTO);
 	}
 
-	if (ioo->ioo_bufcnt == 0) {
-		CERROR("%s: ioo has zero bufcnt\n", tgt_name(tsi->tsi_tgt));
-		RETURN(-EPROTO);
-	}
+	for (i = 0; i < obj_count; i++) {
+		if (ioo[i].ioo_bufcnt == 0) {
+			CERROR("%s: ioo has zero bufcnt\n",
+			       tgt_name(tsi->tsi_tgt));
+			RETURN(-EPROTO);
+		}
 
-	if (ioo->ioo_bufcnt > PTLRPC_MAX_BRW_PAGES) {
-		DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
-			  "bulk has too many pages (%d)",
-			  ioo->ioo_bufcnt);
-		RETURN(-EPROTO);
+		if (ioo[i].ioo_bufcnt > PTLRPC_MAX_BRW_PAGES) {
+			DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
+				  "bulk has too many pages (%d)",
+				  ioo[i].ioo_bufcnt);
+			RETURN(-EPROTO);
+		}
 	}
 
 	RETURN(0);
@@ -1597,6 +1608,18 @@ void tgt_io_thread_done(struct ptlrpc_thread *thread)
 	 */
 	tbc = thread->t_data;
 	if (tbc != NULL) {
+		int i;
+
+		for (i = 0; i < OBD_COMPRESS_MAX; i++)
+			if (tbc->compr_tfm[i] != NULL)
+				crypto_free_comp(tbc->compr_tfm[i]);
+		if (tbc->compr_buf != NULL)
+			OBD_FREE_LARGE(tbc->compr_buf, tbc->compr_buf_size);
+		if (tbc->compr_nb != NULL)
+			OBD_FREE_LARGE(tbc->compr_nb, tbc->compr_nb_size);
+		if (tbc->decompr_buf != NULL)
+			OBD_FREE_LARGE(tbc->decompr_buf,
+				       tbc->decompr_buf_size);
 		OBD_FREE_LARGE(tbc, sizeof(*tbc));
 		thread->t_data = NULL;
 	}
@@ -2413,6 +2436,151 @@ static int tgt_shortio2pages(struct niobuf_local *local, int npages,
 	return 0;
 }
 
+/*
+ * Make the buffer \a *bufp of \a *sizep bytes, which the thread keeps
+ * between requests, at least \a size bytes long. It is virtually
+ * contiguous, its pages can be found with vmalloc_to_page().
+ */
+static int tgt_big_cache_grow(void **bufp, int *sizep, int size)
+{
+	if (*sizep >= size)
+		return 0;
+
+	if (*bufp != NULL)
+		OBD_FREE_LARGE(*bufp, *sizep);
+	*sizep = 0;
+
+	OBD_VMALLOC(*bufp, size);
+	if (*bufp == NULL)
+		return -ENOMEM;
+	*sizep = size;
+
+	return 0;
+}
+
+/**
+ * Receive the compressed bulk of a write request.
+ *
+ * The client sends the data of the whole RPC as one compressed stream of
+ * \a csize bytes, see osc_brw_compress(). It is received into a virtually
+ * contiguous buffer, whose pages are also described by \a cnb so that the
+ * checksum of the compressed data can be verified as usual. Both are kept
+ * in \a tbc for the next compressed write handled by the thread.
+ */
+static int tgt_brw_get_compressed(struct ptlrpc_request *req,
+				  struct obd_ioobj *ioo, u32 csize,
+				  struct tgt_thread_big_cache *tbc,
+				  struct ptlrpc_bulk_desc **descp,
+				  char **cbuf, struct niobuf_local **cnb,
+				  int *cnpages)
+{
+	struct ptlrpc_bulk_desc *desc;
+	struct l_wait_info lwi;
+	int npages = DIV_ROUND_UP(csize, PAGE_SIZE);
+	char *buf;
+	int rc, i;
+
+	ENTRY;
+	if (csize == 0 || npages > PTLRPC_MAX_BRW_PAGES)
+		RETURN(-EPROTO);
+
+	rc = tgt_big_cache_grow((void **)&tbc->compr_buf,
+				&tbc->compr_buf_size, npages << PAGE_SHIFT);
+	if (rc != 0)
+		RETURN(rc);
+	buf = tbc->compr_buf;
+	*cbuf = buf;
+
+	rc = tgt_big_cache_grow((void **)&tbc->compr_nb, &tbc->compr_nb_size,
+				npages * sizeof(**cnb));
+	if (rc != 0)
+		RETURN(rc);
+	*cnb = tbc->compr_nb;
+	memset(*cnb, 0, npages * sizeof(**cnb));
+	*cnpages = npages;
+
+	desc = ptlrpc_prep_bulk_exp(req, npages, ioobj_max_brw_get(ioo),
+				    PTLRPC_BULK_GET_SINK |
+				    PTLRPC_BULK_BUF_KIOV,
+				    OST_BULK_PORTAL,
+				    &ptlrpc_bulk_kiov_nopin_ops);
+	if (desc == NULL)
+		RETURN(-ENOMEM);
+	*descp = desc;
+
+	for (i = 0; i < npages; i++) {
+		struct niobuf_local *lnb = &(*cnb)[i];
+
+		lnb->lnb_file_offset = (u64)i << PAGE_SHIFT;
+		lnb->lnb_page_offset = 0;
+		lnb->lnb_len = min_t(u32, csize - lnb->lnb_file_offset,
+				     PAGE_SIZE);
+		lnb->lnb_page = vmalloc_to_page(buf + (i << PAGE_SHIFT));
+		desc->bd_frag_ops->add_kiov_frag(desc, lnb->lnb_page, 0,
+						 lnb->lnb_len);
+	}
+
+	rc = sptlrpc_svc_prep_bulk(req, desc);
+	if (rc != 0)
+		RETURN(rc);
+
+	rc = target_bulk_io(req->rq_export, desc, &lwi);
+	RETURN(rc);
+}
+
+/**
+ * Decompress the bulk received by tgt_brw_get_compressed() into the
+ * local pages prepared for the uncompressed niobufs. The transform and
+ * the buffer for the decompressed data are kept in \a tbc.
+ */
+static int tgt_brw_decompress(struct obd_export *exp, u32 o_flags,
+			      char *cbuf, u32 csize,
+			      struct tgt_thread_big_cache *tbc,
+			      struct niobuf_local *local, int npages)
+{
+	enum obd_compress_type type = obd_compress_type_unpack(o_flags);
+	const char *alg = obd_compress_alg(type);
+	struct crypto_comp *tfm;
+	unsigned int dlen;
+	int nob = 0;
+	int rc, i;
+
+	ENTRY;
+	if (alg == NULL)
+		RETURN(-EPROTO);
+
+	for (i = 0; i < npages; i++)
+		nob += local[i].lnb_len;
+
+	if (tbc->compr_tfm[type] == NULL) {
+		tfm = crypto_alloc_comp(alg, 0, 0);
+		if (IS_ERR(tfm))
+			RETURN(PTR_ERR(tfm));
+		tbc->compr_tfm[type] = tfm;
+	}
+	tfm = tbc->compr_tfm[type];
+
+	rc = tgt_big_cache_grow((void **)&tbc->decompr_buf,
+				&tbc->decompr_buf_size, nob);
+	if (rc != 0)
+		RETURN(rc);
+
+	dlen = nob;
+	rc = crypto_comp_decompress(tfm, cbuf, csize, tbc->decompr_buf, &dlen);
+	if (rc == 0 && dlen != nob)
+		rc = -EINVAL;
+	if (rc != 0) {
+		/* let the client resend, the bulk was damaged in transit */
+		CERROR("%s: cannot decompress %s bulk from %s, %u/%d bytes: rc = %d\n",
+		       exp->exp_obd->obd_name, alg, obd_export_nid2str(exp),
+		       dlen, nob, rc);
+		RETURN(-EAGAIN);
+	}
+
+	rc = tgt_shortio2pages(local, npages, tbc->decompr_buf, nob);
+	RETURN(rc);
+}
+
 static void tgt_warn_on_cksum(struct ptlrpc_request *req,
 			      struct ptlrpc_bulk_desc *desc,
 			      struct niobuf_local *local_nb, int npages,
@@ -2460,6 +2628,141 @@ static void tgt_warn_on_cksum(struct ptlrpc_request *req,
 			   client_cksum, server_cksum);
 }
 
+/**
+ * Unpack the bodies of the additional objects of a multi-object write.
+ *
+ * The first object of an OST_WRITE is described by RMF_OST_BODY as usual,
+ * every following obd_ioobj has its own body in RMF_OST_BODIES. Only the
+ * first body carries the grant information of the export, and lockless
+ * pages are never mixed with other objects.
+ */
+static int tgt_brw_multi_unpack(struct tgt_session_info *tsi,
+				struct obd_ioobj *ioo, int objcount,
+				struct niobuf_remote *rnb, int niocount)
+{
+	struct req_capsule	*pill = tsi->tsi_pill;
+	struct ost_body		*bodies;
+	struct lu_nodemap	*nodemap;
+	int			 rc = 0;
+	int			 i;
+
+	ENTRY;
+
+	for (i = 0; i < niocount; i++)
+		if (rnb[i].rnb_flags & OBD_BRW_SRVLOCK)
+			RETURN(-EPROTO);
+
+	req_capsule_extend(pill, &RQF_OST_BRW_WRITE_MULTI);
+	bodies = req_capsule_client_get(pill, &RMF_OST_BODIES);
+	if (bodies == NULL ||
+	    req_capsule_get_size(pill, &RMF_OST_BODIES, RCL_CLIENT) !=
+	    (objcount - 1) * sizeof(*bodies))
+		RETURN(-EPROTO);
+
+	nodemap = nodemap_get_from_exp(tsi->tsi_exp);
+	if (IS_ERR(nodemap))
+		RETURN(PTR_ERR(nodemap));
+
+	for (i = 1; i < objcount; i++) {
+		struct obdo *oa = &bodies[i - 1].oa;
+
+		if (!(oa->o_valid & OBD_MD_FLID))
+			GOTO(out, rc = -EPROTO);
+
+		rc = tgt_validate_obdo(tsi, oa);
+		if (rc != 0)
+			GOTO(out, rc);
+
+		oa->o_uid = nodemap_map_id(nodemap, NODEMAP_UID,
+					   NODEMAP_CLIENT_TO_FS, oa->o_uid);
+		oa->o_gid = nodemap_map_id(nodemap, NODEMAP_GID,
+					   NODEMAP_CLIENT_TO_FS, oa->o_gid);
+		oa->o_valid &= ~OBD_MD_FLGRANT;
+		ioo[i].ioo_oid = oa->o_oi;
+	}
+out:
+	nodemap_putref(nodemap);
+	RETURN(rc);
+}
+
+static inline struct obdo *tgt_brw_obj_oa(struct ost_body *repbody,
+					  struct ost_body *repbodies, int i)
+{
+	return i == 0 ? &repbody->oa : &repbodies[i - 1].oa;
+}
+
+/**
+ * Commit the first \a count objects of a write prepared with
+ * tgt_brw_preprw_write().
+ *
+ * \retval	the first error returned by obd_commitrw(), or 0
+ */
+static int tgt_brw_commitrw_write(const struct lu_env *env,
+				  struct obd_export *exp,
+				  struct ost_body *repbody,
+				  struct ost_body *repbodies,
+				  struct obd_ioobj *ioo,
+				  struct niobuf_remote *rnb,
+				  struct tgt_thread_big_cache *tbc,
+				  int count, int old_rc)
+{
+	struct niobuf_local	*lnb = tbc->local;
+	int			 rc = 0;
+	int			 i;
+
+	for (i = 0; i < count; i++) {
+		int rc2;
+
+		rc2 = obd_commitrw(env, OBD_BRW_WRITE, exp,
+				   tgt_brw_obj_oa(repbody, repbodies, i), 1,
+				   &ioo[i], rnb, tbc->npages[i], lnb, old_rc);
+		if (rc == 0)
+			rc = rc2;
+		rnb += ioo[i].ioo_bufcnt;
+		lnb += tbc->npages[i];
+	}
+
+	return rc;
+}
+
+/**
+ * Prepare the local buffers of every object of a write.
+ *
+ * The local buffers of all objects are laid out one after the other in
+ * tbc->local, so a single bulk can be used for the whole request. The
+ * number of buffers used by each object is saved in tbc->npages.
+ */
+static int tgt_brw_preprw_write(const struct lu_env *env,
+				struct obd_export *exp,
+				struct ost_body *repbody,
+				struct ost_body *repbodies,
+				int objcount, struct obd_ioobj *ioo,
+				struct niobuf_remote *rnb,
+				struct tgt_thread_big_cache *tbc, int *npages)
+{
+	struct niobuf_remote	*nb = rnb;
+	int			 rc;
+	int			 i;
+
+	for (*npages = 0, i = 0; i < objcount; i++) {
+		tbc->npages[i] = PTLRPC_MAX_BRW_PAGES - *npages;
+		rc = obd_preprw(env, OBD_BRW_WRITE, exp,
+				tgt_brw_obj_oa(repbody, repbodies, i), 1,
+				&ioo[i], nb, &tbc->npages[i],
+				tbc->local + *npages);
+		if (rc < 0) {
+			/* NB Having prepped, we must commit... */
+			tgt_brw_commitrw_write(env, exp, repbody, repbodies,
+					       ioo, rnb, tbc, i, rc);
+			return rc;
+		}
+		nb += ioo[i].ioo_bufcnt;
+		*npages += tbc->npages[i];
+	}
+
+	return 0;
+}
+
 int tgt_brw_write(struct tgt_session_info *tsi)
 {
 	struct ptlrpc_request	*req = tgt_ses_req(tsi);
@@ -2469,6 +2772,7 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	struct niobuf_local	*local_nb;
 	struct obd_ioobj	*ioo;
 	struct ost_body		*body, *repbody;
+	struct ost_body		*bodies = NULL, *repbodies = NULL;
 	struct l_wait_info	 lwi;
 	struct lustre_handle	 lockh = {0};
 	__u32			*rcs;
@@ -2479,6 +2783,12 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	struct tgt_thread_big_cache *tbc = req->rq_svc_thread->t_data;
 	bool wait_sync = false;
 	const char *obd_name = exp->exp_obd->obd_name;
+	struct niobuf_local *cksum_nb;
+	struct niobuf_local *compr_nb = NULL;
+	char *compr_buf = NULL;
+	int cksum_npages;
+	int compr_npages = 0;
+	bool compressed;
 
 	ENTRY;
 
@@ -2516,6 +2826,18 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	body = tsi->tsi_ost_body;
 	LASSERT(body != NULL);
 
+	compressed = body->oa.o_valid & OBD_MD_FLFLAGS &&
+		     body->oa.o_flags & OBD_FL_COMPRESS_ALL;
+	if (compressed && !exp_connect_compress(exp))
+		RETURN(err_serious(-EPROTO));
+	/* the short io buffer is never compressed by the client, so there is
+	 * no compressed bulk to receive the data from */
+	if (compressed && body->oa.o_flags & OBD_FL_SHORT_IO) {
+		CERROR("%s: deny compressed short io write from %s\n",
+		       obd_name, obd_export_nid2str(exp));
+		RETURN(err_serious(-EPROTO));
+	}
+
 	ioo = req_capsule_client_get(&req->rq_pill, &RMF_OBD_IOOBJ);
 	LASSERT(ioo != NULL); /* must exists after tgt_ost_body_unpack */
 
@@ -2532,6 +2854,18 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 			sizeof(*remote_nb))
 		RETURN(err_serious(-EPROTO));
 
+	if (objcount > 1) {
+		rc = tgt_brw_multi_unpack(tsi, ioo, objcount, remote_nb,
+					  niocount);
+		if (rc != 0)
+			RETURN(err_serious(rc));
+		bodies = req_capsule_client_get(&req->rq_pill,
+						&RMF_OST_BODIES);
+		req_capsule_set_size(&req->rq_pill, &RMF_OST_BODIES,
+				     RCL_SERVER,
+				     (objcount - 1) * sizeof(*repbodies));
+	}
+
 	if ((remote_nb[0].rnb_flags & OBD_BRW_MEMALLOC) &&
 	    ptlrpc_connection_is_local(exp->exp_connection))
 		memory_pressure_set();
@@ -2580,9 +2914,16 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 		GOTO(out_lock, rc = -ENOMEM);
 	repbody->oa = body->oa;
 
-	npages = PTLRPC_MAX_BRW_PAGES;
-	rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			objcount, ioo, remote_nb, &npages, local_nb);
+	if (objcount > 1) {
+		repbodies = req_capsule_server_get(&req->rq_pill,
+						   &RMF_OST_BODIES);
+		if (repbodies == NULL)
+			GOTO(out_lock, rc = -ENOMEM);
+		memcpy(repbodies, bodies, (objcount - 1) * sizeof(*repbodies));
+	}
+
+	rc = tgt_brw_preprw_write(tsi->tsi_env, exp, repbody, repbodies,
+				  objcount, ioo, remote_nb, tbc, &npages);
 	if (rc < 0)
 		GOTO(out_lock, rc);
 	if (body->oa.o_flags & OBD_FL_SHORT_IO) {
@@ -2601,6 +2942,10 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 		rc = tgt_shortio2pages(local_nb, npages, short_io_buf,
 				       short_io_size);
 		desc = NULL;
+	} else if (compressed) {
+		rc = tgt_brw_get_compressed(req, ioo, body->oa.o_compr_size,
+					    tbc, &desc, &compr_buf, &compr_nb,
+					    &compr_npages);
 	} else {
 		desc = ptlrpc_prep_bulk_exp(req, npages, ioobj_max_brw_get(ioo),
 					    PTLRPC_BULK_GET_SINK |
@@ -2627,6 +2972,9 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	no_reply = rc != 0;
 
 skip_transfer:
+	/* the checksum of a compressed write covers the compressed bulk */
+	cksum_nb = compressed ? compr_nb : local_nb;
+	cksum_npages = compressed ? compr_npages : npages;
 	if (body->oa.o_valid & OBD_MD_FLCKSUM && rc == 0) {
 		static int cksum_counter;
 
@@ -2639,7 +2987,7 @@ skip_transfer:
 							   cksum_type);
 
 		rc = tgt_checksum_niobuf_rw(tsi->tsi_tgt, cksum_type,
-					    local_nb, npages, OST_WRITE,
+					    cksum_nb, cksum_npages, OST_WRITE,
 					    &repbody->oa.o_cksum);
 		if (rc < 0)
 			GOTO(out_commitrw, rc);
@@ -2650,7 +2998,7 @@ skip_transfer:
 			mmap = (body->oa.o_valid & OBD_MD_FLFLAGS &&
 				body->oa.o_flags & OBD_FL_MMAP);
 
-			tgt_warn_on_cksum(req, desc, local_nb, npages,
+			tgt_warn_on_cksum(req, desc, cksum_nb, cksum_npages,
 					  body->oa.o_cksum,
 					  repbody->oa.o_cksum, mmap);
 			cksum_counter = 0;
@@ -2662,10 +3010,15 @@ skip_transfer:
 		}
 	}
 
+	if (compressed && rc == 0)
+		rc = tgt_brw_decompress(exp, body->oa.o_flags, compr_buf,
+					body->oa.o_compr_size, tbc, local_nb,
+					npages);
+
 out_commitrw:
 	/* Must commit after prep above in all cases */
-	rc = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			  objcount, ioo, remote_nb, npages, local_nb, rc);
+	rc = tgt_brw_commitrw_write(tsi->tsi_env, exp, repbody, repbodies,
+				    ioo, remote_nb, tbc, objcount, rc);
 	if (rc == -ENOTCONN)
 		/* quota acquire process has been given up because
 		 * either the client has been evicted or the client
@@ -2684,6 +3037,9 @@ out_commitrw:
 	 * otherwise it will have to glimpse anyway (see bug 21489, comment 32)
 	 */
 	repbody->oa.o_valid &= ~(OBD_MD_FLMTIME | OBD_MD_FLATIME);
+	for (i = 1; i < objcount; i++)
+		repbodies[i - 1].oa.o_valid &= ~(OBD_MD_FLMTIME |
+						 OBD_MD_FLATIME);
 
 	if (rc == 0) {
 		int nob = 0;
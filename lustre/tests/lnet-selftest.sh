@@ -189,6 +189,242 @@ test_smoke () {
 }
 run_test smoke "lst regression test"
 
+test_unlink_race() {
+	lst_prepare
+
+	local clients=$lst_CLIENTS
+	local servers=$lst_SERVERS
+	local nc=$(echo ${clients//,/ } | wc -w)
+	local ns=$(echo ${servers//,/ } | wc -w)
+	local log=$TMP/$tfile.log
+	local i
+
+	export LST_SESSION=$$
+	$LST new_session --timeo 100000 unlink_race ||
+		error "cannot create lst session"
+	$LST add_group c $(nids_list $clients) || error "add_group c failed"
+	$LST add_group s $(nids_list $servers) || error "add_group s failed"
+	$LST add_batch b || error "add_batch failed"
+	# many RPCs in flight to the same request buffers, so their MDs get
+	# unlinked while events of other messages are still being handled
+	$LST add_test --batch b --loop $lst_LOOP --concurrency 64 \
+		--distribute $nc:$ns --from c --to s brw write size=4k ||
+		error "add brw test failed"
+	$LST add_test --batch b --loop $lst_LOOP --concurrency 64 \
+		--distribute $nc:$ns --from c --to s ping ||
+		error "add ping test failed"
+
+	for i in $(seq 20); do
+		$LST run b || error "run $i failed"
+		sleep 0.$((RANDOM % 10))
+		# aborts the RPCs in flight and unlinks their MDs
+		timeout 60 $LST stop b || error "stop $i hung or failed"
+	done
+
+	timeout 120 $LST end_session | tee $log ||
+		error "end_session hung or failed"
+	lst_cleanup_all
+}
+run_test unlink_race "unlink MDs while their events are being delivered"
+
+test_conns_per_peer() {
+	[[ $NETTYPE = tcp* ]] || skip "need socklnd, not $NETTYPE"
+	local_mode && skip "need separate client and server nodes"
+
+	local param=/sys/module/ksocklnd/parameters/conns_per_peer
+	local ost_host=$(facet_active_host ost1)
+	local list=$(comma_list $HOSTNAME $ost_host)
+	local server=$(host_nids_address $ost_host $NETTYPE)
+	local client=$(host_nids_address $HOSTNAME $NETTYPE)
+	local old=$(do_node $ost_host cat $param)
+	local want=2
+	local nconns
+
+	[ -n "$old" ] || skip "socklnd has no conns_per_peer"
+	stack_trap "do_nodes $list 'echo $old > $param'" EXIT
+
+	lst_prepare
+	do_nodes $list "echo $want > $param" ||
+		error "cannot set conns_per_peer"
+	do_nodes $list "$LCTL --net $NETTYPE disconnect"
+
+	export LST_SESSION=$$
+	# traffic in both directions, so both sides connect at the same time
+	$LST new_session --timeo 100000 conns || error "new_session failed"
+	$LST add_group c $(nids_list $client) || error "add_group c failed"
+	$LST add_group s $(nids_list $server) || error "add_group s failed"
+	$LST add_batch b || error "add_batch failed"
+	$LST add_test --batch b --loop 1000 --concurrency 8 \
+		--from c --to s brw write size=1M || error "add_test c failed"
+	$LST add_test --batch b --loop 1000 --concurrency 8 \
+		--from s --to c brw write size=1M || error "add_test s failed"
+	$LST run b || error "run failed"
+	sleep 10
+
+	# one control, one bulk in and one bulk out connection each
+	$LCTL --net $NETTYPE conn_list
+	nconns=$($LCTL --net $NETTYPE conn_list | grep -c -- "-$server@")
+	(( nconns == 3 * want )) ||
+		error "$nconns connections to $server, expected $((3 * want))"
+	nconns=$(do_node $ost_host $LCTL --net $NETTYPE conn_list |
+		 grep -c -- "-$client@")
+	(( nconns == 3 * want )) ||
+		error "$nconns connections to $client, expected $((3 * want))"
+
+	lst_end_session --verbose
+	lst_cleanup_all
+}
+run_test conns_per_peer "socklnd opens conns_per_peer connections"
+
+# the server GETs 4k from the client, which times the round trip to
+# each of its NIs
+perf_traffic() {
+	local server=$1
+	local client=$2
+	local secs=$3
+
+	export LST_SESSION=$$
+	$LST new_session --timeo 100000 perf || error "new_session failed"
+	$LST add_group c $(nids_list $client) || error "add_group c failed"
+	$LST add_group s $(nids_list $server) || error "add_group s failed"
+	$LST add_batch b || error "add_batch failed"
+	$LST add_test --batch b --loop $lst_LOOP --concurrency 8 \
+		--from s --to c brw write size=4k || error "add_test failed"
+	$LST run b || error "run failed"
+	sleep $secs
+	lst_end_session --verbose
+}
+
+# print the value of $3 under peer NI $2 of peer $1 in peer show -v
+perf_peer_ni_val() {
+	$LNETCTL peer show -v --nid $1 |
+		awk -v nid=$2 -v key="$3:" '$1 == "-" && $2 == "nid:" {
+			cur = $3 } cur == nid && $1 == key { print $2 }'
+}
+
+test_perf_show() {
+	export LNETCTL=$(which lnetctl 2> /dev/null)
+	[ -n "$LNETCTL" ] || skip "without lnetctl support"
+	local_mode && skip "need separate client and server nodes"
+
+	local ost_host=$(facet_active_host ost1)
+	local server=$(host_nids_address $ost_host $NETTYPE)
+	local client=$(host_nids_address $HOSTNAME $NETTYPE)
+	local snid=$server@$NETTYPE
+	local param=/sys/module/lnet/parameters/lnet_perf_sensitivity
+	local old=$(cat $param 2> /dev/null)
+	local rtt
+
+	[ -n "$old" ] || skip "lnet has no lnet_perf_sensitivity"
+	# nothing is measured while selection is disabled
+	stack_trap "echo $old > $param" EXIT
+	echo 20 > $param
+
+	lst_prepare
+	perf_traffic $server $client 10
+
+	$LNETCTL peer show -v --nid $snid
+	$LNETCTL peer show -v --nid $snid | grep -q "selection:" ||
+		error "no selection section for $server"
+	rtt=$(perf_peer_ni_val $snid $snid rtt_usec)
+	(( rtt > 0 )) || error "no round trip time measured to $server"
+	lst_cleanup_all
+}
+run_test perf_show "peer show reports the peer NI estimates"
+
+test_perf_select() {
+	export LNETCTL=$(which lnetctl 2> /dev/null)
+	[ -n "$LNETCTL" ] || skip "without lnetctl support"
+	local_mode && skip "need separate client and server nodes"
+
+	local param=/sys/module/lnet/parameters/lnet_perf_sensitivity
+	local ost_host=$(facet_active_host ost1)
+	local server=$(host_nids_address $ost_host $NETTYPE)
+	local client=$(host_nids_address $HOSTNAME $NETTYPE)
+	local snid=$server@$NETTYPE
+	local old=$(cat $param 2> /dev/null)
+	local nids=($(do_node $ost_host $LCTL list_nids |
+		      grep "@$NETTYPE\$"))
+	local fast=${nids[0]}
+	local slow=${nids[1]}
+	local f0 s0 f1 s1 f2 s2
+
+	[ -n "$old" ] || skip "lnet has no lnet_perf_sensitivity"
+	(( ${#nids[@]} >= 2 )) || skip "need 2 server NIs on $NETTYPE"
+	stack_trap "echo $old > $param" EXIT
+	stack_trap "do_node $ost_host $LCTL net_delay_del -a" EXIT
+
+	lst_prepare
+	# every GET to the slow NI takes a second longer
+	do_node $ost_host $LCTL net_delay_add -s $client@$NETTYPE \
+		-d $slow -r 1 -l 1 -m GET || error "net_delay_add failed"
+
+	echo 0 > $param
+	f0=$(perf_peer_ni_val $snid $fast send_count)
+	s0=$(perf_peer_ni_val $snid $slow send_count)
+	perf_traffic $server $client 20
+	f1=$(perf_peer_ni_val $snid $fast send_count)
+	s1=$(perf_peer_ni_val $snid $slow send_count)
+	echo "disabled: $fast $((f1 - f0)) $slow $((s1 - s0))"
+	# credits and round robin only
+	(( (s1 - s0) * 4 > f1 - f0 )) ||
+		error "$slow avoided with lnet_perf_sensitivity=0"
+
+	echo 50 > $param
+	perf_traffic $server $client 20
+	f2=$(perf_peer_ni_val $snid $fast send_count)
+	s2=$(perf_peer_ni_val $snid $slow send_count)
+	echo "enabled: $fast $((f2 - f1)) $slow $((s2 - s1))"
+	$LNETCTL peer show -v --nid $snid
+	(( (s2 - s1) * 10 < f2 - f1 )) ||
+		error "$slow not avoided with lnet_perf_sensitivity=50"
+
+	lst_cleanup_all
+}
+run_test perf_select "lnet_perf_sensitivity prefers the faster peer NI"
+
+# print the value of $1 in lnetctl stats show
+rtrbuf_stat() {
+	$LNETCTL stats show | awk -v key="$1:" '$1 == key { print $2 }'
+}
+
+test_rtrbuf_autotune() {
+	export LNETCTL=$(which lnetctl 2> /dev/null)
+	[ -n "$LNETCTL" ] || skip "without lnetctl support"
+
+	local old=$($LNETCTL global show |
+		    awk '/router_buffers_autotune:/ { print $2 }')
+	local routing=$($LNETCTL routing show |
+			awk '/enable:/ { print $NF }')
+	local grow
+	local bytes
+
+	[ -n "$old" ] || skip "lnet has no router_buffers_autotune"
+	stack_trap "$LNETCTL set router_buffers_autotune $old" EXIT
+	[ "$routing" = 1 ] ||
+		stack_trap "$LNETCTL set routing ${routing:-0}" EXIT
+
+	$LNETCTL set routing 1 || error "cannot enable routing"
+	$LNETCTL set router_buffers_autotune 1 ||
+		error "cannot set router_buffers_autotune"
+	$LNETCTL global show | grep -q "router_buffers_autotune: 1" ||
+		error "router_buffers_autotune not set"
+
+	$LNETCTL stats show || error "stats show failed"
+	bytes=$(rtrbuf_stat rtr_buf_bytes)
+	(( bytes > 0 )) || error "rtr_buf_bytes '$bytes' with routing enabled"
+	grow=$(rtrbuf_stat rtr_buf_grow_count)
+	[ -n "$grow" ] || error "no rtr_buf_grow_count"
+
+	# nothing waits for buffers, pools stay at their configured size
+	sleep 5
+	(( $(rtrbuf_stat rtr_buf_grow_count) == grow )) ||
+		error "idle pools grown"
+	(( $(rtrbuf_stat rtr_buf_bytes) == bytes )) ||
+		error "pools at the configured size shrunk"
+}
+run_test rtrbuf_autotune "router buffer autotuning counters in stats show"
+
 complete $SECONDS
 _restore_mount
 check_and_cleanup_lustre
@@ -712,6 +712,49 @@ test_102() {
 }
 run_test 102 "survive from insanely fast flavor switch"
 
+# bulk bandwidth of dd with the given flavor on client to OST connections
+krb5_bulk_bw() {
+	local flavor=$1
+	local file=$DIR/$tdir/$tfile.$flavor
+	local count=${KRB5_BW_SIZE_MB:-512}
+	local wbw
+	local rbw
+
+	set_rule $FSNAME any cli2ost $flavor
+	wait_flavor cli2ost $flavor || error "cli2ost is not $flavor"
+
+	wbw=$(dd if=/dev/zero of=$file bs=4M count=$((count / 4)) \
+		oflag=direct 2>&1 | awk '/copied/ { print $(NF-1), $NF }')
+	[ -n "$wbw" ] || error "$flavor: write $file failed"
+	cancel_lru_locks osc
+	rbw=$(dd if=$file of=/dev/null bs=4M 2>&1 |
+		awk '/copied/ { print $(NF-1), $NF }')
+	[ -n "$rbw" ] || error "$flavor: read $file failed"
+	rm -f $file
+
+	printf "%-8s write %-12s read %s\n" $flavor "$wbw" "$rbw"
+}
+
+test_103() {
+	local flavor
+
+	restore_to_default_flavor
+	stack_trap restore_to_default_flavor EXIT
+
+	mkdir -p $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	chmod 0777 $DIR/$tdir || error "chmod $DIR/$tdir failed"
+
+	for flavor in null krb5i krb5p; do
+		krb5_bulk_bw $flavor
+	done
+
+	$LCTL get_param -n sptlrpc.encrypt_page_pools |
+		grep -E "total pages|cache access|cpt"
+	do_facet ost1 $LCTL get_param -n sptlrpc.encrypt_page_pools |
+		grep -E "total pages|cache access|cpt"
+}
+run_test 103 "bulk bandwidth with null, krb5i and krb5p flavors"
+
 test_150() {
 	local mount_opts
 	local count
@@ -7166,6 +7166,73 @@ test_64d() {
 }
 run_test 64d "check grant limit exceed"
 
+test_64e() {
+	local tgt=$($LCTL dl | grep "0000-osc-[^mM]" | awk '{print $4}')
+	local nproc=$(($(nproc) * 2))
+	local dirty
+	local i
+
+	(( nproc > 64 )) && nproc=64
+	stack_trap "rm -f $DIR/$tfile.*" EXIT
+
+	# many small buffered writers dirty pages from the per-CPT caches
+	for ((i = 0; i < nproc; i++)); do
+		$LFS setstripe -c 1 -i 0 $DIR/$tfile.$i ||
+			error "setstripe $tfile.$i failed"
+		dd if=/dev/zero of=$DIR/$tfile.$i bs=4k count=256 \
+			2> /dev/null &
+	done
+	wait
+	sync
+
+	# cached credits must not show up as dirty data
+	dirty=$($LCTL get_param -n osc.${tgt}.cur_dirty_bytes)
+	(( dirty == 0 )) || error "cur_dirty_bytes $dirty after sync"
+
+	# and must be given back when grant is shrunk
+	$LCTL set_param osc.${tgt}.cur_grant_bytes=0 ||
+		error "grant shrink failed"
+	for ((i = 0; i < nproc; i++)); do
+		(( $(stat -c %s $DIR/$tfile.$i) == 1048576 )) ||
+			error "wrong size of $tfile.$i"
+	done
+}
+run_test 64e "parallel small writes with per-CPT grant caches"
+
+test_64f() {
+	[[ $($LCTL get_param osc.$FSNAME-OST0000*.import) =~ \
+		connect_flags.*multiobj_brw ]] ||
+		skip "OST does not support multi-object BRW"
+
+	local osc=$FSNAME-OST0000
+	local count=64
+	local objs
+	local writes
+	local i
+
+	objs=$($LCTL get_param -n osc.$osc*.max_objs_per_rpc | head -n 1)
+	stack_trap "$LCTL set_param osc.$osc*.max_objs_per_rpc=$objs" EXIT
+	$LCTL set_param osc.$osc*.max_objs_per_rpc=32
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	for ((i = 0; i < count; i++)); do
+		dd if=/dev/zero of=$DIR/$tdir/$tfile.$i bs=4k count=1 \
+			2> /dev/null || error "dd $tfile.$i failed"
+	done
+
+	$LCTL set_param -n osc.$osc*.rpc_stats=0
+	sync
+
+	writes=$($LCTL get_param -n osc.$osc*.rpc_stats |
+		sed -n '/pages per rpc/,/^$/p' |
+		awk '/^[0-9]+:/ { writes += $6 }; END { print writes }')
+	echo "$count files written with $writes write RPCs"
+	(( writes < count )) ||
+		error "$writes write RPCs for $count small files"
+}
+run_test 64f "small writes to several objects share BRW RPCs"
+
 # bug 1414 - set/get directories' stripe info
 test_65a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
@@ -7994,6 +8061,77 @@ test_77k() { # LU-10906
 }
 run_test 77k "enable/disable checksum correctly"
 
+test_77l() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$LCTL get_param -n osc.$FSNAME-OST0000-osc-[^mM]*.connect_flags |
+		grep -q compress || skip "server does not support compression"
+
+	local osc="osc.$FSNAME-OST0000-osc-[^mM]*"
+	local tmp=$TMP/$tfile
+	local algo
+	local rpcs
+
+	stack_trap "$LCTL set_param $osc.compress_type=none" EXIT
+	stack_trap "rm -f $tmp" EXIT
+	# well compressible, but not trivially so
+	for i in $(seq 4096); do
+		echo "line $i: $(date) $HOSTNAME $DIR/$tfile"
+	done > $tmp
+	cat $tmp $tmp $tmp $tmp > $tmp.big && mv $tmp.big $tmp
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	for algo in lz4 deflate; do
+		$LCTL set_param $osc.compress_type=$algo ||
+			skip "$algo is not available on the client"
+		$LCTL set_param $osc.compress_stats=clear
+
+		dd if=$tmp of=$DIR/$tfile bs=1M oflag=sync ||
+			error "$algo write failed"
+		cancel_lru_locks osc
+		cmp $tmp $DIR/$tfile || error "$algo data mismatch"
+
+		$LCTL get_param $osc.compress_stats
+		rpcs=$($LCTL get_param -n $osc.compress_stats |
+		       awk '/compressed_rpcs/ { print $2 }')
+		(( rpcs > 0 )) || error "no $algo compressed RPCs"
+
+		# a bad checksum of the compressed bulk is resent
+		set_checksums 1
+		#define OBD_FAIL_OSC_CHECKSUM_SEND       0x409
+		$LCTL set_param fail_loc=0x80000409
+		dd if=$tmp of=$DIR/$tfile bs=1M oflag=sync ||
+			error "$algo write with bad checksum failed"
+		$LCTL set_param fail_loc=0
+		set_checksums 0
+		cancel_lru_locks osc
+		cmp $tmp $DIR/$tfile || error "$algo resend data mismatch"
+	done
+}
+run_test 77l "compressed bulk write"
+
+test_77m() {
+	$LCTL get_param -n osc.$FSNAME-OST0000-osc-[^mM]*.connect_flags |
+		grep -q compress || skip "server does not support compression"
+
+	local osc="osc.$FSNAME-OST0000-osc-[^mM]*"
+
+	(( $($LCTL get_param -n $osc.short_io_bytes) >= 4096 )) ||
+		skip "short io is disabled"
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	# flag a short io write as compressed, the OST must reject it
+	#define OBD_FAIL_OSC_COMPRESS_SHORT_IO   0x415
+	$LCTL set_param fail_loc=0x80000415
+	dd if=/dev/urandom of=$DIR/$tfile bs=4k count=1 oflag=direct &&
+		error "compressed short io write succeeded"
+	$LCTL set_param fail_loc=0
+
+	# the OST is still alive
+	dd if=/dev/urandom of=$DIR/$tfile bs=4k count=1 oflag=direct ||
+		error "short io write failed"
+}
+run_test 77m "compressed short io write is rejected"
+
 [ "$ORIG_CSUM" ] && set_checksums $ORIG_CSUM || true
 rm -f $F77_TMP
 unset F77_TMP
@@ -8637,6 +8775,73 @@ test_101h() {
 }
 run_test 101h "Readahead should cover current read window"
 
+test_101i() {
+	$LCTL get_param -n llite.*.read_ahead_stats | grep -q "reverse" ||
+		skip "no reverse read-ahead support"
+
+	local cmd="o"
+	local count
+	local miss
+	local i
+
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile
+	stack_trap "rm -f $DIR/$tfile" EXIT
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=32 ||
+		error "dd 32M file failed"
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+
+	# read the file backwards in 1MiB records through one descriptor
+	for ((i = 31; i >= 0; i--)); do
+		cmd+="z$((i * 1048576))r1048576"
+	done
+	$MULTIOP $DIR/$tfile ${cmd}c || error "backward read failed"
+
+	$LCTL get_param llite.*.read_ahead_stats
+	count=$($LCTL get_param -n llite.*.read_ahead_stats |
+		get_named_value 'reverse read-ahead' | cut -d" " -f1 |
+		calc_total)
+	(( count > 0 )) || error "no reverse read-ahead done"
+	miss=$($LCTL get_param -n llite.*.read_ahead_stats |
+		get_named_value 'misses' | cut -d" " -f1 | calc_total)
+	# only the first records, before the pattern is detected, should miss
+	(( miss < 8192 / 4 )) || error "too many misses $miss"
+}
+run_test 101i "read-ahead for reverse sequential reads"
+
+test_101j() {
+	$LCTL get_param -n llite.*.read_ahead_stats | grep -q "stream" ||
+		skip "no multi-stream read-ahead support"
+
+	local cmd="o"
+	local count
+	local miss
+	local i
+
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile
+	stack_trap "rm -f $DIR/$tfile" EXIT
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=64 ||
+		error "dd 64M file failed"
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+
+	# two sequential streams interleaved on one descriptor
+	for ((i = 0; i < 32; i++)); do
+		cmd+="z$((i * 1048576))r1048576"
+		cmd+="z$(((i + 32) * 1048576))r1048576"
+	done
+	$MULTIOP $DIR/$tfile ${cmd}c || error "interleaved read failed"
+
+	$LCTL get_param llite.*.read_ahead_stats
+	count=$($LCTL get_param -n llite.*.read_ahead_stats |
+		get_named_value 'stream switch' | cut -d" " -f1 | calc_total)
+	(( count > 0 )) || error "read-ahead streams not switched"
+	miss=$($LCTL get_param -n llite.*.read_ahead_stats |
+		get_named_value 'misses' | cut -d" " -f1 | calc_total)
+	(( miss < 16384 / 4 )) || error "too many misses $miss"
+}
+run_test 101j "read-ahead for interleaved sequential streams"
+
 setup_test102() {
 	test_mkdir $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -9209,6 +9414,86 @@ test_102t() {
 }
 run_test 102t "zero length xattr values handled correctly"
 
+xattr_cache_stat() {
+	$LCTL get_param -n llite.*.stats |
+		awk '/^'$1' / { sum += $2 } END { print sum + 0 }'
+}
+
+test_102u() {
+	local save="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local nfiles=100
+	local nattrs=10
+	local val=$(head -c 1200 /dev/zero | tr '\0' v)
+	local f
+	local i
+
+	save_lustre_params client "llite.*.xattr_cache" > $save
+	save_lustre_params client "llite.*.xattr_cache_max_mb" >> $save
+	stack_trap "restore_lustre_params < $save; rm -f $save" EXIT
+	$LCTL set_param llite.*.xattr_cache=1 ||
+		skip_env "xattr cache is not supported"
+
+	test_mkdir $DIR/$tdir
+	for ((i = 0; i < 32; i++)); do
+		setfattr -n user.attr$i -v value$i $DIR/$tdir ||
+			error "setfattr user.attr$i failed"
+	done
+	cancel_lru_locks mdc
+	$LCTL set_param -n llite.*.stats=clear
+
+	# the first lookup fetches all the xattrs, the rest are served
+	# from the cache, including the ones which do not exist
+	for ((i = 0; i < 32; i++)); do
+		[ "$(getfattr --only-values -n user.attr$i $DIR/$tdir)" == \
+		  "value$i" ] || error "wrong value of user.attr$i"
+		getfattr -n user.none$i $DIR/$tdir &> /dev/null &&
+			error "user.none$i should not exist"
+	done
+	$LCTL get_param llite.*.stats | grep xattr
+	(( $(xattr_cache_stat getxattr_misses) == 1 )) ||
+		error "expected one xattr cache refill"
+	(( $(xattr_cache_stat getxattr_hits) >= 63 )) ||
+		error "expected at least 63 xattr cache hits"
+	(( $(xattr_cache_stat getxattr_negative) == 32 )) ||
+		error "expected 32 negative xattr cache lookups"
+
+	# more than 1MB of xattrs must not stay cached with a 1MB limit
+	$LCTL set_param llite.*.xattr_cache_max_mb=1
+	for ((f = 0; f < nfiles; f++)); do
+		touch $DIR/$tdir/f$f
+		for ((i = 0; i < nattrs; i++)); do
+			setfattr -n user.big$i -v $val $DIR/$tdir/f$f ||
+				error "setfattr $DIR/$tdir/f$f failed"
+		done
+	done
+	cancel_lru_locks mdc
+	for ((f = 0; f < nfiles; f++)); do
+		getfattr -d $DIR/$tdir/f$f > /dev/null ||
+			error "getfattr $DIR/$tdir/f$f failed"
+	done
+	$LCTL get_param llite.*.xattr_cache_bytes
+	for i in $($LCTL get_param -n llite.*.xattr_cache_bytes); do
+		(( i <= 1048576 + 2 * nattrs * 1400 )) ||
+			error "xattr cache holds $i bytes over 1MB limit"
+	done
+	(( $(xattr_cache_stat xattr_cache_evict) > 0 )) ||
+		error "no xattr cache was evicted"
+
+	# lowering the limit shrinks all the caches at once
+	$LCTL set_param llite.*.xattr_cache_max_mb=0
+	for ((f = 0; f < nfiles; f++)); do
+		getfattr -d $DIR/$tdir/f$f > /dev/null ||
+			error "getfattr $DIR/$tdir/f$f failed"
+	done
+	$LCTL set_param llite.*.xattr_cache_max_mb=1
+	$LCTL get_param llite.*.xattr_cache_bytes
+	for i in $($LCTL get_param -n llite.*.xattr_cache_bytes); do
+		(( i <= 1048576 )) ||
+			error "xattr cache holds $i bytes after limit change"
+	done
+}
+run_test 102u "xattr cache hash lookups, negative entries and memory limit"
+
 run_acl_subtest()
 {
     $LUSTRE/tests/acl/run $LUSTRE/tests/acl/$1.test
@@ -9494,8 +9779,8 @@ test_115() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	remote_ost_nodsh && skip "remote OST with nodsh"
 
-	# Lustre does not stop service threads once they are started.
-	# Reset number of running threads to default.
+	# Lustre only stops service threads after they are idle for a
+	# while. Reset number of running threads to default.
 	stopall
 	setupall
 
@@ -9594,6 +9879,56 @@ test_115() {
 }
 run_test 115 "verify dynamic thread creation===================="
 
+test_115b() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local svc=ost.OSS.ost_io
+	local save_params="$TMP/sanity-$TESTNAME.parameters"
+	local ncpts=$(check_cpt_number ost1)
+	local tmin=$((ncpts * 2))
+	local started
+	local excess
+	local i
+
+	do_facet ost1 $LCTL get_param -n $svc.threads_shrink_delay ||
+		skip "OSS does not shrink its thread pool"
+
+	# several threads per partition have to be stopped one after another
+	started=$(do_facet ost1 $LCTL get_param -n $svc.threads_started)
+	if (( started < tmin + 2 * ncpts )); then
+		$LFS setstripe -c 1 -i 0 $DIR/$tfile ||
+			error "setstripe failed"
+		for i in $(seq 32); do
+			dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 \
+				seek=$((i * 16)) oflag=direct conv=notrunc &
+		done
+		wait
+		started=$(do_facet ost1 $LCTL get_param -n $svc.threads_started)
+	fi
+	(( started >= tmin + 2 * ncpts )) ||
+		skip "only $started threads started"
+	excess=$(((started - tmin + ncpts - 1) / ncpts))
+
+	save_lustre_params ost1 "$svc.threads_min" > $save_params
+	save_lustre_params ost1 "$svc.threads_adapt_interval" >> $save_params
+	save_lustre_params ost1 "$svc.threads_shrink_delay" >> $save_params
+	stack_trap "restore_lustre_params < $save_params; rm -f $save_params"
+
+	do_facet ost1 $LCTL set_param $svc.threads_min=$tmin \
+		$svc.threads_adapt_interval=1 $svc.threads_shrink_delay=1
+
+	# one thread per partition is stopped every other idle interval, the
+	# wait is too short if the pool stalls after the first one
+	wait_update_facet ost1 "$LCTL get_param -n $svc.threads_started" \
+		$tmin $((excess * 3 + 10)) ||
+		error "$started idle threads not stopped down to $tmin"
+
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=10 oflag=direct ||
+		error "write after shrinking the thread pool failed"
+}
+run_test 115b "idle service threads are stopped down to threads_min"
+
 free_min_max () {
 	wait_delete_completed
 	AVAIL=($(lctl get_param -n osc.*[oO][sS][cC]-[^M]*.kbytesavail))
@@ -10269,6 +10604,115 @@ test_119d() # bug 15950
 }
 run_test 119d "The DIO path should try to send a new rpc once one is completed"
 
+test_119e() {
+	[ $OSTCOUNT -lt 2 ] && skip_env "needs >= 2 OSTs"
+	$LCTL get_param -n llite.*.parallel_dio > /dev/null 2>&1 ||
+		skip "no parallel_dio support"
+
+	local pdio=$($LCTL get_param -n llite.*.parallel_dio | head -n 1)
+	local bsize=$((4 * 1048576))
+
+	stack_trap "$LCTL set_param -n llite.*.parallel_dio=$pdio" EXIT
+	stack_trap "rm -f $DIR/$tfile*" EXIT
+
+	dd if=/dev/urandom of=$DIR/$tfile.src bs=$bsize count=8 ||
+		error "dd to $DIR/$tfile.src failed"
+	$LFS setstripe -c $OSTCOUNT -S 1M $DIR/$tfile ||
+		error "setstripe $DIR/$tfile failed"
+
+	for pdio in 0 1; do
+		$LCTL set_param -n llite.*.parallel_dio=$pdio
+		dd if=$DIR/$tfile.src of=$DIR/$tfile bs=$bsize oflag=direct \
+			conv=notrunc || error "direct write (pdio=$pdio) failed"
+		cancel_lru_locks osc
+		cmp $DIR/$tfile.src $DIR/$tfile ||
+			error "data mismatch after direct write (pdio=$pdio)"
+		dd if=$DIR/$tfile of=$DIR/$tfile.dst bs=$bsize iflag=direct ||
+			error "direct read (pdio=$pdio) failed"
+		cmp $DIR/$tfile.src $DIR/$tfile.dst ||
+			error "data mismatch after direct read (pdio=$pdio)"
+		rm -f $DIR/$tfile.dst
+	done
+}
+run_test 119e "parallel direct IO across stripes"
+
+test_119f() {
+	$LCTL get_param -n llite.*.unaligned_dio > /dev/null 2>&1 ||
+		skip "no unaligned_dio support"
+
+	local udio=$($LCTL get_param -n llite.*.unaligned_dio | head -n 1)
+	# aligned start with a partial tail page, then unaligned offsets
+	local bsize=$((1048576 + 1000))
+
+	stack_trap "$LCTL set_param -n llite.*.unaligned_dio=$udio" EXIT
+	stack_trap "rm -f $DIR/$tfile*" EXIT
+
+	dd if=/dev/urandom of=$DIR/$tfile.src bs=$bsize count=4 ||
+		error "dd to $DIR/$tfile.src failed"
+
+	$LCTL set_param -n llite.*.unaligned_dio=0
+	dd if=$DIR/$tfile.src of=$DIR/$tfile bs=$bsize oflag=direct \
+		2> /dev/null && error "unaligned direct write should fail"
+
+	$LCTL set_param -n llite.*.unaligned_dio=1
+	dd if=$DIR/$tfile.src of=$DIR/$tfile bs=$bsize oflag=direct ||
+		error "unaligned direct write failed"
+	cancel_lru_locks osc
+	cmp $DIR/$tfile.src $DIR/$tfile ||
+		error "data mismatch after unaligned direct write"
+
+	dd if=$DIR/$tfile of=$DIR/$tfile.dst bs=$bsize iflag=direct ||
+		error "unaligned direct read failed"
+	cmp $DIR/$tfile.src $DIR/$tfile.dst ||
+		error "data mismatch after unaligned direct read"
+}
+run_test 119f "unaligned direct IO via bounce pages"
+
+test_119g() {
+	$LCTL get_param -n llite.*.hybrid_io_write_threshold_mb > /dev/null \
+		2>&1 || skip "no hybrid IO support"
+
+	local rthr=$($LCTL get_param -n llite.*.hybrid_io_read_threshold_mb |
+		     head -n 1)
+	local wthr=$($LCTL get_param -n llite.*.hybrid_io_write_threshold_mb |
+		     head -n 1)
+	local count
+
+	stack_trap "$LCTL set_param -n llite.*.hybrid_io_read_threshold_mb=$rthr" EXIT
+	stack_trap "$LCTL set_param -n llite.*.hybrid_io_write_threshold_mb=$wthr" EXIT
+	stack_trap "rm -f $DIR/$tfile*" EXIT
+
+	dd if=/dev/urandom of=$DIR/$tfile.src bs=4M count=4 ||
+		error "dd to $DIR/$tfile.src failed"
+	cancel_lru_locks osc
+
+	$LCTL set_param -n llite.*.hybrid_io_read_threshold_mb=1
+	$LCTL set_param -n llite.*.hybrid_io_write_threshold_mb=1
+	$LCTL set_param llite.*.stats=clear
+
+	dd if=$DIR/$tfile.src of=$DIR/$tfile bs=4M ||
+		error "dd to $DIR/$tfile failed"
+	count=$($LCTL get_param -n llite.*.stats |
+		awk '/^hybrid_write_bytes/ { sum += $2 } END { print sum+0 }')
+	(( count == 4 )) || error "$count hybrid writes, expected 4"
+	count=$($LCTL get_param -n llite.*.stats |
+		awk '/^hybrid_read_bytes/ { sum += $2 } END { print sum+0 }')
+	(( count == 4 )) || error "$count hybrid reads, expected 4"
+
+	cancel_lru_locks osc
+	cmp $DIR/$tfile.src $DIR/$tfile ||
+		error "data mismatch after hybrid IO"
+
+	# small IO keeps going through the page cache
+	$LCTL set_param llite.*.stats=clear
+	dd if=$DIR/$tfile.src of=$DIR/$tfile bs=64k conv=notrunc ||
+		error "small dd to $DIR/$tfile failed"
+	$LCTL get_param -n llite.*.stats | grep -q "^hybrid_" &&
+		error "small IO shouldn't be switched to direct IO"
+	return 0
+}
+run_test 119g "large buffered IO is switched to direct IO"
+
 test_120a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	remote_mds_nodsh && skip "remote MDS with nodsh"
@@ -10644,6 +11088,212 @@ test_123b () { # statahead(bug 15027)
 }
 run_test 123b "not panic with network error in statahead enqueue (bug 15027)"
 
+test_123c() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$LCTL get_param -n llite.*.statahead_batch_max > /dev/null 2>&1 ||
+		skip "no statahead_batch_max support"
+
+	local batch_max=$($LCTL get_param -n llite.*.statahead_batch_max |
+			  head -n 1)
+	local packed=false
+	local before
+	local after
+	local mds_before
+	local mds_after
+
+	[[ $($LCTL get_param mdc.$FSNAME-MDT0000*.import) =~ \
+		connect_flags.*batch_rpc ]] && packed=true
+
+	test_mkdir $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile-%d 1000 ||
+		error "create files under $DIR/$tdir failed"
+
+	stack_trap "$LCTL set_param -n llite.*.statahead_batch_max=$batch_max" \
+		EXIT
+	$LCTL set_param -n llite.*.statahead_batch_max=16
+
+	before=$($LCTL get_param -n llite.*.statahead_stats |
+		 awk '/batch total:/ { sum += $3 } END { print sum }')
+	mds_before=$(do_facet mds1 $LCTL get_param -n mds.MDS.mdt.stats |
+		     awk '/req_batched/ { print $2 }')
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls -l $DIR/$tdir failed"
+	after=$($LCTL get_param -n llite.*.statahead_stats |
+		awk '/batch total:/ { sum += $3 } END { print sum }')
+	mds_after=$(do_facet mds1 $LCTL get_param -n mds.MDS.mdt.stats |
+		    awk '/req_batched/ { print $2 }')
+	$LCTL get_param -n llite.*.statahead_stats
+	echo "MDT batches before ${mds_before:-0} after ${mds_after:-0}"
+
+	(( after > before )) || error "no statahead batch sent"
+	# the getattrs of a batch go out packed in OBD_BATCH_RPCs
+	if $packed; then
+		(( ${mds_after:-0} > ${mds_before:-0} )) ||
+			error "statahead RPCs not packed into OBD_BATCH_RPCs"
+	fi
+
+	$LCTL set_param -n llite.*.statahead_batch_max=0
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls -l without batch failed"
+}
+run_test 123c "statahead sends async stat RPCs in batches"
+
+test_123d() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	[[ $($LCTL get_param osc.$FSNAME-OST0000*.import) =~ \
+		connect_flags.*batch_rpc ]] ||
+		skip "OST does not support batched RPCs"
+
+	local param=/sys/module/ptlrpc/parameters/ptlrpcd_batch_rpc
+	local old=$(cat $param)
+	local before
+	local after
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	createmany -o $DIR/$tdir/$tfile-%d 500 ||
+		error "create files under $DIR/$tdir failed"
+
+	stack_trap "echo $old > $param" EXIT
+	echo 1 > $param
+
+	before=$(do_facet ost1 $LCTL get_param -n ost.OSS.ost.stats |
+		 awk '/req_batched/ { print $2 }')
+	cancel_lru_locks
+	ls -l $DIR/$tdir > /dev/null || error "ls -l $DIR/$tdir failed"
+	after=$(do_facet ost1 $LCTL get_param -n ost.OSS.ost.stats |
+		awk '/req_batched/ { print $2 }')
+	echo "batches before ${before:-0} after ${after:-0}"
+
+	(( ${after:-0} > ${before:-0} )) || error "no batch sent to ost1"
+
+	echo 0 > $param
+	cancel_lru_locks
+	ls -l $DIR/$tdir > /dev/null || error "ls -l without batching failed"
+}
+run_test 123d "small async RPCs to a target are sent in batches"
+
+test_123e() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local param=mds.MDS.mdt.req_in_batch
+	local old=$(do_facet mds1 $LCTL get_param -n $param 2> /dev/null)
+	local max
+
+	[ -n "$old" ] || skip "MDS does not batch incoming requests"
+	stack_trap "do_facet mds1 $LCTL set_param $param=$old" EXIT
+
+	do_facet mds1 $LCTL set_param $param=0 &&
+		error "req_in_batch=0 should be refused"
+
+	test_mkdir $DIR/$tdir
+	do_facet mds1 $LCTL set_param $param=1
+	do_facet mds1 $LCTL set_param mds.MDS.mdt.stats=clear
+	createmany -o $DIR/$tdir/$tfile-%d 1000 ||
+		error "create files under $DIR/$tdir failed"
+	max=$(do_facet mds1 $LCTL get_param -n mds.MDS.mdt.stats |
+	      awk '/^req_in_batch/ { print $6 }')
+	echo "req_in_batch max $max with $param=1"
+	[ "$max" == "1" ] || error "batch of $max requests, expect 1"
+
+	do_facet mds1 $LCTL set_param $param=$old
+	unlinkmany $DIR/$tdir/$tfile-%d 1000 ||
+		error "unlink files under $DIR/$tdir failed"
+	do_facet mds1 $LCTL get_param mds.MDS.mdt.stats |
+		grep -E "req_in_batch|req_in_lock_wait|req_get_lock_wait" ||
+		error "no request batch stats"
+}
+run_test 123e "incoming requests are preprocessed in batches"
+
+test_123f() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local cparam="mdc.$FSNAME-MDT0000-mdc-*.req_latency"
+	local sparam=mds.MDS.mdt.req_latency
+	local lat
+
+	$LCTL get_param $cparam > /dev/null 2>&1 ||
+		skip "client has no RPC latency histograms"
+
+	$LCTL set_param $cparam=clear
+	do_facet mds1 $LCTL set_param $sparam=clear
+	$LCTL get_param -n $cparam | grep -q "opcode:.*mds_reint" &&
+		error "client histograms not cleared"
+
+	test_mkdir -i 0 $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile-%d 100 ||
+		error "create files under $DIR/$tdir failed"
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null
+
+	lat=$($LCTL get_param -n $cparam)
+	echo "$lat"
+	echo "$lat" | grep -A1 "opcode:.*ldlm_enqueue" |
+		grep -q "^ *total: { samples:.*p99:" ||
+		error "no client total latency for ldlm_enqueue"
+
+	lat=$(do_facet mds1 $LCTL get_param -n $sparam)
+	echo "$lat" | grep -A3 "opcode:.*ldlm_enqueue"
+	for kind in wait service total; do
+		echo "$lat" | grep -A3 "opcode:.*ldlm_enqueue" |
+			grep -q "^ *$kind: { samples:" ||
+			error "no server $kind latency for ldlm_enqueue"
+	done
+	if python3 -c "import yaml" 2> /dev/null; then
+		echo "$lat" |
+			python3 -c "import sys, yaml; yaml.safe_load(sys.stdin)" ||
+			error "server req_latency is not valid YAML"
+	fi
+
+	do_facet mds1 $LCTL set_param $sparam=clear
+	do_facet mds1 $LCTL get_param -n $sparam |
+		grep -q "opcode:.*mds_reint" &&
+		error "server histograms not cleared"
+	return 0
+}
+run_test 123f "per-opcode RPC latency histograms"
+
+test_123g() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	$LCTL get_param -n rpc_trace_sample > /dev/null 2>&1 ||
+		skip "no RPC tracing support"
+
+	local trace=$TMP/$tfile.trace
+	local nr
+
+	stack_trap "rm -f $trace" EXIT
+	stack_trap "$LCTL set_param rpc_trace_sample=0" EXIT
+	stack_trap "do_facet mds1 $LCTL set_param rpc_trace_sample=0" EXIT
+
+	$LCTL set_param rpc_trace_sample=1
+	do_facet mds1 $LCTL set_param rpc_trace_sample=1
+	$LCTL rpc_trace --clear > /dev/null
+	do_facet mds1 $LCTL rpc_trace --clear > /dev/null
+
+	test_mkdir -i 0 $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile-%d 100 ||
+		error "create files under $DIR/$tdir failed"
+
+	$LCTL set_param rpc_trace_sample=0
+	do_facet mds1 $LCTL set_param rpc_trace_sample=0
+
+	$LCTL rpc_trace --output $trace || error "save client trace failed"
+	nr=$($LCTL rpc_trace --input $trace | grep -c " send +0.* reply +")
+	echo "$nr client records"
+	(( nr >= 100 )) || error "only $nr client records for 100 creates"
+
+	nr=$(do_facet mds1 $LCTL rpc_trace |
+	     grep -c "arrive +0 .* handle_start +.* handle_end +")
+	echo "$nr server records"
+	(( nr >= 100 )) || error "only $nr server records for 100 creates"
+
+	do_facet mds1 $LCTL rpc_trace --clear > /dev/null
+	nr=$(do_facet mds1 $LCTL rpc_trace | wc -l)
+	(( nr == 0 )) || error "$nr server records left after clear"
+}
+run_test 123g "sampled RPC tracing with lctl rpc_trace"
+
 test_124a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	$LCTL get_param -n mdc.*.connect_flags | grep -q lru_resize ||
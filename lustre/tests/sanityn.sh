@@ -4030,6 +4030,132 @@ test_77n() { #LU-10802
 }
 run_test 77n "check wildcard support for TBF JobID NRS policy"
 
+test_77o() {
+	local oss=$(comma_list $(osts_nodes))
+	local chained
+
+	# ORR keeps running and moves behind TBF
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="orr" ||
+		error "failed to set ORR policy"
+	do_nodes $oss lctl set_param \
+		ost.OSS.ost_io.nrs_policies="tbf+orr\ jobid" ||
+		error "failed to chain ORR after TBF"
+
+	chained=$(do_facet ost1 lctl get_param -n \
+		ost.OSS.ost_io.nrs_policies |
+		awk '/name: orr/ { orr = 1 }
+		     orr && /chained:/ { print $2; exit }')
+	[[ "$chained" == "yes" ]] || error "ORR is not chained after TBF"
+
+	# a chain whose primary policy cannot be started is rolled back
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_policies="nosuch+trr" &&
+		error "unknown primary policy was started"
+	chained=$(do_facet ost1 lctl get_param -n \
+		ost.OSS.ost_io.nrs_policies |
+		awk '/name: orr/ { orr = 1 }
+		     orr && /chained:/ { print $2; exit }')
+	[[ "$chained" == "yes" ]] || error "ORR chain was not restored"
+
+	do_nodes $oss lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ dd_chain\ jobid={dd.*}\ rate=20"
+	nrs_write_read
+	tbf_verify 20 20
+
+	do_facet ost1 lctl get_param ost.OSS.ost_io.nrs_policies
+	# dropping the chained policy keeps TBF running
+	do_nodes $oss lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ dd_chain" \
+		ost.OSS.ost_io.nrs_policies="tbf\ jobid" ||
+		error "failed to remove the chained policy"
+	chained=$(do_facet ost1 lctl get_param -n \
+		ost.OSS.ost_io.nrs_policies | awk '/chained: yes/')
+	[[ -z "$chained" ]] || error "a policy is still chained: $chained"
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="fifo"
+}
+run_test 77o "chain ORR after TBF NRS policy"
+
+test_77p() {
+	local oss=$(comma_list $(osts_nodes))
+	local dir=$DIR/$tdir
+	local rc=0
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="drr\ jobid" ||
+		rc=$?
+	[[ $rc -eq 3 ]] && skip "no NRS DRR exists" && return
+	[[ $rc -ne 0 ]] && error "failed to set DRR JobID policy"
+
+	# DRR takes weights, a rate limit must be refused
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_drr_rule="start\ dd_rate\ jobid={dd.*}\ rate=20" &&
+		error "DRR rule accepted a rate"
+	do_nodes $oss lctl set_param \
+		ost.OSS.ost_io.nrs_drr_rule="start\ dd_heavy\ jobid={dd.*}\ weight=8" ||
+		error "failed to start DRR rule"
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_drr_rule |
+		grep -q "dd_heavy.* 8, ref" || error "DRR rule has no weight 8"
+
+	# DRR is work conserving, a lone class is not slowed down
+	mkdir $dir || error "mkdir $dir failed"
+	$LFS setstripe -c 1 -i 0 $dir || error "setstripe to $dir failed"
+	local start=$SECONDS
+	dd if=/dev/zero of=$dir/drr bs=1M count=100 oflag=direct ||
+		error "dd to $dir/drr failed"
+	local runtime=$((SECONDS - start))
+	echo "Write runtime is $runtime s"
+	(( runtime < 60 )) || error "write under DRR took $runtime s"
+
+	nrs_write_read
+	do_nodes $oss lctl set_param \
+		ost.OSS.ost_io.nrs_drr_rule="change\ dd_heavy\ weight=2" \
+		ost.OSS.ost_io.nrs_drr_rule="stop\ dd_heavy" ||
+		error "failed to change and stop DRR rule"
+	rm -rf $dir
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="fifo"
+}
+run_test 77p "check DRR weighted NRS policy"
+
+test_77q() {
+	local oss=$(comma_list $(osts_nodes))
+	local dir=$DIR/$tdir
+	local rc=0
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="tbf\ jobid" ||
+		rc=$?
+	[[ $rc -eq 3 ]] && skip "no NRS TBF exists" && return
+	[[ $rc -ne 0 ]] && error "failed to set TBF JobID policy"
+
+	do_nodes $oss lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ dd_bw\ jobid={dd.*}\ rate=1000,bw=4M" ||
+		error "failed to start TBF bandwidth rule"
+
+	mkdir $dir || error "mkdir $dir failed"
+	$LFS setstripe -c 1 -i 0 $dir || error "setstripe to $dir failed"
+	local np=$(check_cpt_number ost1)
+	local start=$SECONDS
+	dd if=/dev/zero of=$dir/bw bs=1M count=$((np * 20)) oflag=direct ||
+		error "dd to $dir/bw failed"
+	local runtime=$((SECONDS - start))
+	echo "Write runtime is $runtime s"
+	# 20MB per CPT at 4MB/s per CPT
+	(( runtime >= 4 )) || error "bandwidth limit ignored, $runtime s"
+
+	local bytes=$(do_facet ost1 lctl get_param -n \
+		ost.OSS.ost_io.nrs_tbf_rule |
+		awk '/^dd_bw/ { for (i = 1; i < NF; i++)
+					if ($i == "bytes") sum += $(i + 1) }
+		     END { print sum + 0 }')
+	(( bytes >= np * 20 * 1048576 )) ||
+		error "rule admitted $bytes bytes, expected $((np * 20))M"
+
+	rm -rf $dir
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_tbf_rule="stop\ dd_bw" \
+		ost.OSS.ost_io.nrs_policies="fifo"
+}
+run_test 77q "check TBF bandwidth limit"
+
 test_78() { #LU-6673
 	local rc
 
@@ -4707,6 +4833,66 @@ test_102() {
 }
 run_test 102 "Test open by handle of unlinked file"
 
+test_103() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local ns="ldlm.namespaces.filter-$FSNAME-OST0000_UUID"
+	local timing
+	local waits
+	local i
+
+	timing=$(do_facet ost1 $LCTL get_param -n $ns.resource_timing) ||
+		skip "OST does not keep DLM resource statistics"
+	stack_trap "do_facet ost1 $LCTL set_param $ns.resource_timing=$timing"
+	do_facet ost1 $LCTL set_param $ns.resource_timing=1
+
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	# each write has to wait for the lock of the other mount
+	for ((i = 0; i < 10; i++)); do
+		dd if=/dev/zero of=$DIR1/$tfile bs=4k count=1 conv=notrunc \
+			2> /dev/null || error "dd on $DIR1 failed"
+		dd if=/dev/zero of=$DIR2/$tfile bs=4k count=1 conv=notrunc \
+			2> /dev/null || error "dd on $DIR2 failed"
+	done
+
+	do_facet ost1 $LCTL get_param -n $ns.resource_stats
+	waits=$(do_facet ost1 $LCTL get_param -n $ns.resource_stats |
+		awk '/lock_waits:/ { sum += $2 } END { print sum + 0 }')
+	(( waits > 0 )) || error "no lock waits accounted"
+	rm -f $DIR1/$tfile
+}
+run_test 103 "DLM statistics of contended extent resources"
+
+test_104() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	local ns="ldlm.namespaces.filter-$FSNAME-OST0000_UUID"
+	local stride
+	local grants
+	local i
+
+	stride=$(do_facet ost1 $LCTL get_param -n $ns.stride_locks) ||
+		skip "OST does not limit locks of strided writers"
+	stack_trap "do_facet ost1 $LCTL set_param $ns.stride_locks=$stride"
+	do_facet ost1 $LCTL set_param $ns.stride_locks=1
+
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	# N-to-1 pattern: the mounts write interleaved 64KiB blocks
+	for ((i = 0; i < 32; i += 2)); do
+		dd if=/dev/zero of=$DIR1/$tfile bs=64k count=1 seek=$i \
+			conv=notrunc 2> /dev/null || error "dd on $DIR1 failed"
+		dd if=/dev/zero of=$DIR2/$tfile bs=64k count=1 seek=$((i + 1)) \
+			conv=notrunc 2> /dev/null || error "dd on $DIR2 failed"
+	done
+
+	do_facet ost1 $LCTL get_param -n $ns.resource_stats
+	grants=$(do_facet ost1 $LCTL get_param -n $ns.resource_stats |
+		awk '/stride_grants:/ { sum += $2 } END { print sum + 0 }')
+	(( grants > 0 )) || error "strided writes were not detected"
+	rm -f $DIR1/$tfile
+}
+run_test 104 "limit extent locks of interleaved writers"
+
 log "cleanup: ======================================================"
 
 # kill and wait in each test only guarentee script finish, but command in script
@@ -260,6 +260,10 @@ command_t cmdlist[] = {
 	{"modules", jt_dbg_modules, 0,
 	 "provide gdb-friendly module information\n"
 	 "usage: modules <path>"},
+	{"rpc_trace", jt_rpc_trace, 0,
+	 "dump the RPC trace records sampled with rpc_trace_sample\n"
+	 "usage: rpc_trace [--clear] [--output <file>]\n"
+	 "       rpc_trace --input <file>"},
 
 	/* Pool commands */
 	{"===  Pools ==", NULL, 0, "pool management"},
@@ -74,6 +74,7 @@
 #include <linux/lustre/lustre_ioctl.h>
 #include <linux/lustre/lustre_ostid.h>
 #include <linux/lustre/lustre_param.h>
+#include <linux/lustre/lustre_rpc_trace_user.h>
 #include <linux/lustre/lustre_ver.h>
 
 #include <lustre/lustreapi.h>
@@ -4751,6 +4752,143 @@ int jt_get_obj_version(int argc, char **argv)
 	return 0;
 }
 
+static void rpc_trace_print(const struct rpc_trace_rec *rec)
+{
+	static const char *names[RPC_TRACE_EV_MAX] = RPC_TRACE_EVENT_NAMES;
+	__s64 start = 0;
+	int i;
+
+	for (i = 0; i < RPC_TRACE_EV_LAST; i++)
+		if (rec->rtr_ts[i] != 0 && (start == 0 || rec->rtr_ts[i] < start))
+			start = rec->rtr_ts[i];
+
+	printf("x%llu opc %u %s %s job %s rc %d%s start %lld.%09lld",
+	       (unsigned long long)rec->rtr_xid, rec->rtr_opc,
+	       rec->rtr_flags & RPC_TRACE_FL_SERVER ? "from" : "to",
+	       libcfs_nid2str(rec->rtr_peer_nid),
+	       rec->rtr_jobid[0] != '\0' ? rec->rtr_jobid : "-",
+	       rec->rtr_status,
+	       rec->rtr_flags & RPC_TRACE_FL_BULK ? " bulk" : "",
+	       (long long)(start / 1000000000),
+	       (long long)(start % 1000000000));
+	/* offsets of each event from the first one, in usec */
+	for (i = 0; i < RPC_TRACE_EV_LAST; i++)
+		if (rec->rtr_ts[i] != 0)
+			printf(" %s +%lld", names[i],
+			       (long long)(rec->rtr_ts[i] - start) / 1000);
+	printf("\n");
+}
+
+int jt_rpc_trace(int argc, char **argv)
+{
+	static struct option long_opts[] = {
+		{ .val = 'c',	.name = "clear",	.has_arg = no_argument },
+		{ .val = 'i',	.name = "input",	.has_arg = required_argument },
+		{ .val = 'o',	.name = "output",	.has_arg = required_argument },
+		{ .name = NULL } };
+	struct rpc_trace_rec recs[64];
+	char *input = NULL;
+	char *output = NULL;
+	bool clear = false;
+	glob_t path;
+	ssize_t len;
+	int ofd = -1;
+	int fd;
+	int rc = 0;
+	int c;
+	int i;
+
+	while ((c = getopt_long(argc, argv, "ci:o:", long_opts, NULL)) != -1) {
+		switch (c) {
+		case 'c':
+			clear = true;
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			return CMD_HELP;
+		}
+	}
+	if (optind != argc || (input != NULL && (output != NULL || clear)))
+		return CMD_HELP;
+
+	if (input == NULL) {
+		rc = cfs_get_param_paths(&path, "rpc_trace");
+		if (rc != 0) {
+			fprintf(stderr, "%s: RPC tracing is not available: %s\n",
+				jt_cmdname(argv[0]), strerror(errno));
+			return -errno;
+		}
+		fd = open(path.gl_pathv[0], O_RDWR);
+		cfs_free_param_data(&path);
+	} else {
+		fd = open(input, O_RDONLY);
+	}
+	if (fd < 0) {
+		rc = -errno;
+		fprintf(stderr, "%s: cannot open %s: %s\n",
+			jt_cmdname(argv[0]), input ? input : "rpc_trace",
+			strerror(-rc));
+		return rc;
+	}
+
+	if (output != NULL) {
+		ofd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (ofd < 0) {
+			rc = -errno;
+			fprintf(stderr, "%s: cannot open %s: %s\n",
+				jt_cmdname(argv[0]), output, strerror(-rc));
+			goto out;
+		}
+	}
+
+	while ((len = read(fd, recs, sizeof(recs))) > 0) {
+		if (ofd >= 0) {
+			if (write(ofd, recs, len) != len) {
+				rc = -errno;
+				fprintf(stderr, "%s: cannot write %s: %s\n",
+					jt_cmdname(argv[0]), output,
+					strerror(-rc));
+				goto out;
+			}
+			continue;
+		}
+
+		for (i = 0; i < len / sizeof(recs[0]); i++) {
+			if (recs[i].rtr_magic != RPC_TRACE_MAGIC ||
+			    recs[i].rtr_size != sizeof(recs[i])) {
+				fprintf(stderr, "%s: bad trace record %#x/%u\n",
+					jt_cmdname(argv[0]), recs[i].rtr_magic,
+					recs[i].rtr_size);
+				rc = -EINVAL;
+				goto out;
+			}
+			rpc_trace_print(&recs[i]);
+		}
+	}
+	if (len < 0) {
+		rc = -errno;
+		fprintf(stderr, "%s: cannot read trace records: %s\n",
+			jt_cmdname(argv[0]), strerror(-rc));
+		goto out;
+	}
+
+	if (clear && write(fd, "clear", 5) != 5) {
+		rc = -errno;
+		fprintf(stderr, "%s: cannot clear trace records: %s\n",
+			jt_cmdname(argv[0]), strerror(-rc));
+	}
+out:
+	if (ofd >= 0)
+		close(ofd);
+	close(fd);
+	return rc;
+}
+
 int jt_changelog_register(int argc, char **argv)
 {
 	struct obd_ioctl_data	 data = { 0 };
@@ -131,6 +131,7 @@ int jt_lcfg_clear(int argc, char **argv);
 int jt_lcfg_fork(int argc, char **argv);
 int jt_lcfg_erase(int argc, char **argv);
 int jt_get_obj_version(int argc, char **argv);
+int jt_rpc_trace(int argc, char **argv);
 
 int jt_llog_catlist(int argc, char **argv);
 int jt_llog_info(int argc, char **argv);
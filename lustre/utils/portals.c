@@ -788,7 +788,7 @@ jt_ptl_print_connections (int argc, char **argv)
 		if (g_net_is_compatible(NULL, SOCKLND, 0)) {
 			id.nid = data.ioc_nid;
 			id.pid = data.ioc_u32[6];
-			printf("%-20s %s[%d]%s->%s:%d %d/%d %s\n",
+			printf("%-20s %s[%d]%s->%s:%d %d/%d %s read_sock_rx %llu\n",
 			       libcfs_id2str(id),
 			       (data.ioc_u32[3] == SOCKLND_CONN_ANY) ? "A" :
 			       (data.ioc_u32[3] == SOCKLND_CONN_CONTROL) ? "C" :
@@ -804,7 +804,8 @@ jt_ptl_print_connections (int argc, char **argv)
 			       data.ioc_u32[1],         /* remote port */
 			       data.ioc_count, /* tx buffer size */
 			       data.ioc_u32[5], /* rx buffer size */
-			       data.ioc_flags ? "nagle" : "nonagle");
+			       data.ioc_flags ? "nagle" : "nonagle",
+			       (unsigned long long)data.ioc_u64[0]);
 		} else if (g_net_is_compatible(NULL, O2IBLND, 0)) {
 			printf("%s mtu %d\n",
 			       libcfs_nid2str(data.ioc_nid),
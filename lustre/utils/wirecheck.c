@@ -612,6 +612,9 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_PCC);
 	CHECK_DEFINE_64X(OBD_CONNECT2_PLAIN_LAYOUT);
 	CHECK_DEFINE_64X(OBD_CONNECT2_ASYNC_DISCARD);
+	CHECK_DEFINE_64X(OBD_CONNECT2_COMPRESS);
+	CHECK_DEFINE_64X(OBD_CONNECT2_MULTIOBJ_BRW);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_RPC);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -668,7 +671,7 @@ check_obdo(void)
 	CHECK_MEMBER(obdo, o_gid_h);
 	CHECK_MEMBER(obdo, o_data_version);
 	CHECK_MEMBER(obdo, o_projid);
-	CHECK_MEMBER(obdo, o_padding_4);
+	CHECK_MEMBER(obdo, o_compr_size);
 	CHECK_MEMBER(obdo, o_padding_5);
 	CHECK_MEMBER(obdo, o_padding_6);
 
@@ -738,6 +741,8 @@ check_obdo(void)
 	CHECK_CVALUE_X(OBD_FL_NOSPC_BLK);
 	CHECK_CVALUE_X(OBD_FL_FLUSH);
 	CHECK_CVALUE_X(OBD_FL_SHORT_IO);
+	CHECK_CVALUE_X(OBD_FL_COMPRESS_LZ4);
+	CHECK_CVALUE_X(OBD_FL_COMPRESS_DEFLATE);
 }
 
 static void
@@ -995,6 +1000,16 @@ check_obd_idx_read(void)
 	CHECK_VALUE(II_FL_NONUNQ);
 }
 
+static void
+check_batch_rpc_sub(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(batch_rpc_sub);
+	CHECK_MEMBER(batch_rpc_sub, brs_xid);
+	CHECK_MEMBER(batch_rpc_sub, brs_len);
+	CHECK_MEMBER(batch_rpc_sub, brs_padding);
+}
+
 static void
 check_niobuf_remote(void)
 {
@@ -2792,6 +2807,7 @@ main(int argc, char **argv)
 
 	CHECK_VALUE(OBD_PING);
 	CHECK_VALUE(OBD_IDX_READ);
+	CHECK_VALUE(OBD_BATCH_RPC);
 	CHECK_VALUE(OBD_LAST_OPC);
 
 	CHECK_VALUE(QUOTA_DQACQ);
@@ -2862,6 +2878,7 @@ main(int argc, char **argv)
 	check_obd_ioobj();
 	check_obd_quotactl();
 	check_obd_idx_read();
+	check_batch_rpc_sub();
 	check_niobuf_remote();
 	check_ost_body();
 	check_ll_fid();